@@ -0,0 +1,349 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "constants.h"
+#include "logic.h"
+#include "search.h"
+#include "minimax.h"
+#include "position_file.h"
+#include "host_util.h"
+
+// Evaluates a file of packed positions (position_file.h) and writes an
+// analysis record for each: best move, score and nodes searched.
+//
+// Both files are memory-mapped. Threads take chunks of records with an atomic
+// counter, read the positions straight out of the input mapping and write the
+// results straight into the output mapping, which the kernel writes back; no
+// record is copied through a buffer. Input chunks that are done are dropped
+// from memory, so files far larger than RAM stream through.
+//
+//   analyse positions.bin analysis.bin --threads 0
+//   analyse --generate 100000000 positions.bin
+
+#define MAX_THREADS 256
+#define DEFAULT_CHUNK 65536 // records, a multiple of the page size in bytes
+
+typedef enum
+{
+    EngineMinimax,
+    EngineSearch
+} Engine;
+
+typedef struct
+{
+    pthread_t thread;
+    Minimax minimax;
+    uint64_t nodes;
+    uint64_t status[3];
+} Worker;
+
+static const uint64_t *positions;
+static AnalysisRecord *analysis;
+static uint64_t recordCount;
+static uint64_t chunkRecords = DEFAULT_CHUNK;
+static uint64_t nextChunk; // taken with an atomic add
+static uint64_t recordsDone;
+static Engine engine = EngineMinimax;
+static int depthOption;
+static Worker workers[MAX_THREADS];
+static pthread_mutex_t searchLock = PTHREAD_MUTEX_INITIALIZER;
+
+// By size and win length, built before the threads start.
+static BoardGeometry geometries[POSITION_MAX_SIZE + 1][POSITION_MAX_SIZE + 1];
+
+static void analysePosition(Worker *worker, uint64_t packed, AnalysisRecord *record)
+{
+    int size = positionSize(packed);
+    int winLength = positionWinLength(packed);
+    Board board;
+    Player toMove;
+
+    record->move = -1;
+    record->score = 0;
+    record->nodes = 0;
+    if (size < BOARD_MIN_WIN || size > POSITION_MAX_SIZE || winLength < BOARD_MIN_WIN ||
+        winLength > size || !positionUnpack(packed, &geometries[size][winLength], &board, &toMove))
+    {
+        record->status = AnalysisInvalid;
+        return;
+    }
+    if (board.winner != empty || board.filled == board.geometry->cells)
+    {
+        record->status = AnalysisGameOver;
+        return;
+    }
+
+    int left = board.geometry->cells - board.filled;
+    int depth = depthOption ? depthOption : size == 3 ? left : 6;
+    if (depth > left)
+        depth = left;
+    record->status = AnalysisOk;
+    if (engine == EngineMinimax)
+    {
+        int scores[BOARD_MAX_CELLS];
+        uint64_t nodes = worker->minimax.nodes;
+        int best = minimaxScoreMoves(&worker->minimax, &board, toMove, depth, scores);
+        for (int pos = 0; pos < board.geometry->cells && record->move < 0; pos++)
+        {
+            if (board.cell[pos] == empty && scores[pos] == best)
+                record->move = pos;
+        }
+        record->score = best;
+        record->nodes = worker->minimax.nodes - nodes;
+    }
+    else
+    {
+        SearchResult result;
+        pthread_mutex_lock(&searchLock);
+        record->move = searchBestMove(&board, toMove, depth, 1, &result);
+        pthread_mutex_unlock(&searchLock);
+        record->score = result.score;
+        record->nodes = result.nodes[0] + result.nodes[1];
+    }
+}
+
+static void *workerMain(void *context)
+{
+    Worker *worker = context;
+    uint64_t chunks = (recordCount + chunkRecords - 1) / chunkRecords;
+    uint64_t chunk;
+
+    while ((chunk = __atomic_fetch_add(&nextChunk, 1, __ATOMIC_RELAXED)) < chunks)
+    {
+        uint64_t first = chunk * chunkRecords;
+        uint64_t last = first + chunkRecords < recordCount ? first + chunkRecords : recordCount;
+        for (uint64_t i = first; i < last; i++)
+        {
+            analysePosition(worker, positions[i], &analysis[i]);
+            worker->nodes += analysis[i].nodes;
+            worker->status[analysis[i].status]++;
+        }
+        // Done with these positions; the results are written back from the
+        // page cache.
+        madvise((void *)&positions[first], (last - first) * sizeof(uint64_t), MADV_DONTNEED);
+        __atomic_fetch_add(&recordsDone, last - first, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+// Writes count random positions of the given shape: a random number of
+// random moves, X first, stopping early at a win.
+static int generate(const char *path, uint64_t count, int size, int winLength)
+{
+    BoardGeometry *geometry = &geometries[size][winLength];
+    FILE *out = fopen(path, "wb");
+    uint64_t state = 1;
+
+    if (out == NULL)
+    {
+        perror(path);
+        return 1;
+    }
+    for (uint64_t i = 0; i < count; i++)
+    {
+        Board board;
+        Player toMove = human;
+        boardInit(&board, geometry);
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        int plies = (state >> 33) % geometry->cells;
+        for (int ply = 0; ply < plies && board.winner == empty; ply++)
+        {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            int pos = (state >> 33) % geometry->cells;
+            while (board.cell[pos] != empty)
+                pos = (pos + 1) % geometry->cells;
+            boardPlay(&board, pos, toMove);
+            toMove = opponent(toMove);
+        }
+        uint64_t packed = positionPack(&board, toMove);
+        fwrite(&packed, sizeof(packed), 1, out);
+    }
+    if (fclose(out) != 0)
+    {
+        perror(path);
+        return 1;
+    }
+    return 0;
+}
+
+// Maps the file at path into *map, which is NULL if the file is empty. With
+// PROT_WRITE the file is first sized to *length; otherwise *length is set to
+// its size. Returns false, having said why, if it can't be opened or mapped.
+static bool mapFile(const char *path, int flags, int prot, uint64_t *length, void **map)
+{
+    int fd = open(path, flags, 0644);
+    struct stat info;
+    bool ok = true;
+
+    *map = NULL;
+    if (fd < 0)
+    {
+        perror(path);
+        return false;
+    }
+    if (prot & PROT_WRITE)
+        ok = ftruncate(fd, *length) == 0;
+    else if ((ok = fstat(fd, &info) == 0))
+        *length = info.st_size;
+    if (ok && *length > 0)
+    {
+        *map = mmap(NULL, *length, prot, prot & PROT_WRITE ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+        ok = *map != MAP_FAILED;
+        if (!ok)
+            *map = NULL;
+    }
+    if (!ok)
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    close(fd);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    const char *paths[2] = {NULL, NULL};
+    int pathCount = 0;
+    int threadCount = 0;
+    uint64_t generateCount = 0;
+    int size = GRID_SIZE;
+    int winLength = -1;
+    bool ok = true;
+
+    for (int i = 1; i < argc && ok; i++)
+    {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--engine") == 0 && hasValue)
+        {
+            const char *name = argv[++i];
+            if (strcmp(name, "minimax") == 0)
+                engine = EngineMinimax;
+            else if (strcmp(name, "search") == 0)
+                engine = EngineSearch;
+            else
+                ok = false;
+        }
+        else if (strcmp(arg, "--depth") == 0 && hasValue)
+            depthOption = atoi(argv[++i]);
+        else if (strcmp(arg, "--threads") == 0 && hasValue)
+            threadCount = atoi(argv[++i]);
+        else if (strcmp(arg, "--chunk") == 0 && hasValue)
+            chunkRecords = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(arg, "--generate") == 0 && hasValue)
+            generateCount = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(arg, "--size") == 0 && hasValue)
+            size = atoi(argv[++i]);
+        else if (strcmp(arg, "--win") == 0 && hasValue)
+            winLength = atoi(argv[++i]);
+        else if (arg[0] != '-' && pathCount < 2)
+            paths[pathCount++] = arg;
+        else
+            ok = false;
+    }
+    if (winLength < 0)
+        winLength = size;
+    threadCount = hostThreadCount(threadCount);
+    if (threadCount > MAX_THREADS)
+        threadCount = MAX_THREADS;
+    // Whole pages per chunk, so that finished input can be dropped.
+    chunkRecords = chunkRecords ? (chunkRecords + 511) / 512 * 512 : DEFAULT_CHUNK;
+    if (!ok || pathCount != (generateCount ? 1 : 2) || depthOption < 0 || threadCount < 1 ||
+        size < BOARD_MIN_WIN || size > POSITION_MAX_SIZE || winLength < BOARD_MIN_WIN ||
+        winLength > size)
+    {
+        fprintf(stderr,
+                "usage: %s [--engine minimax|search] [--depth N] [--threads N (0 for all cores)] [--chunk N] "
+                "positions.bin analysis.bin\n"
+                "       %s --generate N [--size N] [--win N] positions.bin\n",
+                argv[0], argv[0]);
+        return 2;
+    }
+
+    for (int s = BOARD_MIN_WIN; s <= POSITION_MAX_SIZE; s++)
+    {
+        for (int w = BOARD_MIN_WIN; w <= s; w++)
+            boardGeometryInit(&geometries[s][w], s, w);
+    }
+    if (generateCount)
+        return generate(paths[0], generateCount, size, winLength);
+
+    uint64_t inLength = 0;
+    void *map;
+    if (!mapFile(paths[0], O_RDONLY, PROT_READ, &inLength, &map))
+        return 1;
+    positions = map;
+    if (inLength % sizeof(uint64_t) != 0)
+        fprintf(stderr, "%s: ignoring %d trailing bytes\n", paths[0],
+                (int)(inLength % sizeof(uint64_t)));
+    recordCount = inLength / sizeof(uint64_t);
+    uint64_t outLength = recordCount * sizeof(AnalysisRecord);
+    if (!mapFile(paths[1], O_RDWR | O_CREAT | O_TRUNC, PROT_READ | PROT_WRITE, &outLength, &map))
+        return 1;
+    analysis = map;
+    if (recordCount > 0)
+        madvise((void *)positions, inLength, MADV_SEQUENTIAL);
+
+    if (engine == EngineSearch)
+        searchInit(NULL);
+    for (int t = 0; t < threadCount; t++)
+    {
+        if (engine == EngineMinimax && !minimaxInit(&workers[t].minimax))
+        {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+
+    double start = nowSeconds();
+    for (int t = 0; t < threadCount; t++)
+    {
+        pthread_create(&workers[t].thread, NULL, workerMain, &workers[t]);
+    }
+    uint64_t done;
+    while ((done = __atomic_load_n(&recordsDone, __ATOMIC_RELAXED)) < recordCount)
+    {
+        usleep(500000);
+        done = __atomic_load_n(&recordsDone, __ATOMIC_RELAXED);
+        double elapsed = nowSeconds() - start;
+        double rate = done / elapsed;
+        fprintf(stderr, "\r%llu / %llu positions (%.1f%%), %.0f/s, %.0f s left   ",
+                (unsigned long long)done, (unsigned long long)recordCount,
+                100.0 * done / recordCount, rate,
+                rate > 0 ? (recordCount - done) / rate : 0.0);
+    }
+
+    uint64_t nodes = 0;
+    uint64_t status[3] = {0, 0, 0};
+    for (int t = 0; t < threadCount; t++)
+    {
+        pthread_join(workers[t].thread, NULL);
+        nodes += workers[t].nodes;
+        for (int s = 0; s < 3; s++)
+            status[s] += workers[t].status[s];
+        minimaxFree(&workers[t].minimax);
+    }
+    double seconds = nowSeconds() - start;
+
+    if (recordCount > 0)
+    {
+        fprintf(stderr, "\n");
+        msync(analysis, outLength, MS_SYNC);
+        munmap(analysis, outLength);
+        munmap((void *)positions, inLength);
+    }
+    printf("%llu positions in %.2f s on %d threads: %.0f positions/s, %.1f M nodes/s\n",
+           (unsigned long long)recordCount, seconds, threadCount,
+           seconds > 0 ? recordCount / seconds : 0.0, seconds > 0 ? nodes / seconds / 1e6 : 0.0);
+    printf("%llu analysed, %llu already over, %llu invalid\n",
+           (unsigned long long)status[AnalysisOk], (unsigned long long)status[AnalysisGameOver],
+           (unsigned long long)status[AnalysisInvalid]);
+    return 0;
+}
@@ -0,0 +1,436 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "book.h"
+#include "constants.h"
+#include "logic.h"
+#include "retro.h"
+#include "search.h"
+#include "host_util.h"
+
+// Builds an opening book for the firmware (src/book.h): a C source of const
+// tables, which the firmware keeps in flash, covering the positions with O to
+// move and at most --plies pieces that the book's own moves can lead to,
+// whatever X plays.
+//
+// With --solver the moves come from a database solved by retro_solve: every
+// move with the best outcome, weighted by how many of X's replies would then
+// throw away X's result, so the book favours the moves with the most ways for
+// the human to go wrong. --moves keeps the heaviest few of them, which bounds
+// the book's size. With --depth each position takes the move of the
+// firmware's search to that depth instead, for boards too big to solve.
+//
+// The positions the book leads to are looked up again through bookMove(),
+// and the lookups are timed.
+//
+//   book_gen --size 4 --plies 7 --solver 4x4.rdb src/book_data.c
+//   book_gen --size 5 --win 4 --plies 3 --depth 9 src/book_data.c
+//
+// and configure the firmware with -DTTT_BOOK=.../src/book_data.c.
+
+#define MAX_WEIGHT 255
+#define TIMED_PROBES 65536
+
+typedef struct
+{
+    uint64_t key;
+    uint8_t moveCount;
+    BookMove moves[BOARD_MAX_CELLS];
+} Entry;
+
+static BoardGeometry geometry;
+static RetroShape shape;
+static RetroDb db;
+static bool useSolver;
+static int searchDepth;
+static int maxPlies;
+static int movesKept;
+
+static Entry *entries;
+static uint32_t entryCount;
+static uint32_t entryCapacity;
+static uint32_t *slots; // open addressing over entries by key, index + 1
+static uint32_t slotMask;
+static uint32_t perPly[BOARD_MAX_CELLS + 1];
+
+static void *allocate(size_t bytes)
+{
+    void *memory = calloc(1, bytes);
+    if (memory == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    return memory;
+}
+
+static uint32_t *findSlot(uint64_t key)
+{
+    uint32_t slot = (uint32_t)(key >> 32) & slotMask;
+    while (slots[slot] != 0 && entries[slots[slot] - 1].key != key)
+        slot = (slot + 1) & slotMask;
+    return &slots[slot];
+}
+
+static Entry *addEntry(uint64_t key)
+{
+    if (entryCount == entryCapacity)
+    {
+        entryCapacity = entryCapacity ? entryCapacity * 2 : 1024;
+        entries = realloc(entries, entryCapacity * sizeof(Entry));
+        if (entries == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    if (entryCount * 2 >= slotMask)
+    {
+        free(slots);
+        slotMask = slotMask * 2 + 1;
+        slots = allocate((slotMask + 1) * sizeof(uint32_t));
+        for (uint32_t i = 0; i < entryCount; i++)
+            *findSlot(entries[i].key) = i + 1;
+    }
+    *findSlot(key) = entryCount + 1;
+    Entry *entry = &entries[entryCount++];
+    memset(entry, 0, sizeof(*entry));
+    entry->key = key;
+    return entry;
+}
+
+static RetroValue probe(const Board *board)
+{
+    uint32_t masks[2] = {0, 0};
+    for (int pos = 0; pos < geometry.cells; pos++)
+    {
+        if (board->cell[pos] != empty)
+            masks[board->cell[pos] - 1] |= 1u << pos;
+    }
+    return retroProbe(&db, masks[0], masks[1]);
+}
+
+// The value for the player who just moved.
+static int valueForMover(Board *board, Player mover)
+{
+    if (board->winner == mover)
+        return RetroWin;
+    if (board->filled == geometry.cells)
+        return RetroDraw;
+    return RetroWin + RetroLoss - probe(board);
+}
+
+// O's moves in the board's own cells; returns how many.
+static int solverMoves(Board *board, BookMove moves[])
+{
+    int outcome[BOARD_MAX_CELLS];
+    int best = RetroUnknown;
+    int count = 0;
+
+    for (int pos = 0; pos < geometry.cells; pos++)
+    {
+        if (board->cell[pos] != empty)
+            continue;
+        boardPlay(board, pos, ai);
+        outcome[pos] = valueForMover(board, ai);
+        // Finishing now beats a win later.
+        if (board->winner == ai)
+            outcome[pos]++;
+        boardUndo(board, pos);
+        if (outcome[pos] > best)
+            best = outcome[pos];
+    }
+    for (int pos = 0; pos < geometry.cells; pos++)
+    {
+        if (board->cell[pos] != empty || outcome[pos] != best)
+            continue;
+        int weight = 1;
+        boardPlay(board, pos, ai);
+        if (board->winner == empty && board->filled < geometry.cells)
+        {
+            for (int reply = 0; reply < geometry.cells; reply++)
+            {
+                if (board->cell[reply] != empty)
+                    continue;
+                boardPlay(board, reply, human);
+                if (RetroWin + RetroLoss - valueForMover(board, human) > best)
+                    weight++;
+                boardUndo(board, reply);
+            }
+        }
+        boardUndo(board, pos);
+        if (weight > MAX_WEIGHT)
+            weight = MAX_WEIGHT;
+
+        // Kept heaviest first, up to movesKept of them.
+        int at = count < movesKept ? count++ : count;
+        while (at > 0 && moves[at - 1].weight < weight)
+        {
+            if (at < movesKept)
+                moves[at] = moves[at - 1];
+            at--;
+        }
+        if (at < movesKept)
+        {
+            moves[at].pos = pos;
+            moves[at].weight = weight;
+        }
+    }
+    return count;
+}
+
+static int searchMoves(Board *board, BookMove moves[])
+{
+    SearchResult result;
+    searchClear();
+    int pos = searchBestMove(board, ai, searchDepth, 1, &result);
+    if (pos < 0)
+        return 0;
+    moves[0].pos = pos;
+    moves[0].weight = 1;
+    return 1;
+}
+
+// Every X move from the board (X to move), then the book's replies to each.
+static void expand(Board *board)
+{
+    for (int pos = 0; pos < geometry.cells; pos++)
+    {
+        if (board->cell[pos] != empty)
+            continue;
+        boardPlay(board, pos, human);
+        if (board->winner == empty && board->filled < geometry.cells &&
+            board->filled <= maxPlies)
+        {
+            int symmetry;
+            uint64_t key = bookKey(board, &symmetry);
+            if (*findSlot(key) == 0)
+            {
+                BookMove moves[BOARD_MAX_CELLS];
+                int count = useSolver ? solverMoves(board, moves) : searchMoves(board, moves);
+                Entry *entry = addEntry(key);
+                perPly[board->filled]++;
+                entry->moveCount = count;
+                for (int i = 0; i < count; i++)
+                {
+                    entry->moves[i].pos = geometry.symmetry[symmetry][moves[i].pos];
+                    entry->moves[i].weight = moves[i].weight;
+                }
+                for (int i = 0; i < count; i++)
+                {
+                    boardPlay(board, moves[i].pos, ai);
+                    if (board->winner == empty && board->filled + 1 <= maxPlies)
+                        expand(board);
+                    boardUndo(board, moves[i].pos);
+                }
+            }
+        }
+        boardUndo(board, pos);
+    }
+}
+
+static int compareEntries(const void *a, const void *b)
+{
+    uint64_t left = ((const Entry *)a)->key, right = ((const Entry *)b)->key;
+    return left < right ? -1 : left > right;
+}
+
+// Walks the same tree as expand(), checking that the book has every position
+// it should; returns the mismatches, and collects positions to time.
+static uint64_t checkBook(const Book *book, Board *board, Board timed[], int *timedCount)
+{
+    uint64_t mismatches = 0;
+    for (int pos = 0; pos < geometry.cells; pos++)
+    {
+        if (board->cell[pos] != empty)
+            continue;
+        boardPlay(board, pos, human);
+        if (board->winner == empty && board->filled < geometry.cells &&
+            board->filled <= maxPlies)
+        {
+            int move = bookMove(book, board, pos);
+            if (move < 0 || board->cell[move] != empty)
+                mismatches++;
+            else
+            {
+                if (*timedCount < TIMED_PROBES)
+                    timed[(*timedCount)++] = *board;
+                boardPlay(board, move, ai);
+                if (board->winner == empty && board->filled + 1 <= maxPlies)
+                    mismatches += checkBook(book, board, timed, timedCount);
+                boardUndo(board, move);
+            }
+        }
+        boardUndo(board, pos);
+    }
+    return mismatches;
+}
+
+int main(int argc, char **argv)
+{
+    int size = GRID_SIZE;
+    int winLength = -1;
+    const char *solverPath = NULL;
+    const char *outPath = NULL;
+    bool ok = true;
+
+    maxPlies = 3;
+    movesKept = 3;
+    for (int i = 1; i < argc && ok; i++)
+    {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--size") == 0 && hasValue)
+            size = atoi(argv[++i]);
+        else if (strcmp(arg, "--win") == 0 && hasValue)
+            winLength = atoi(argv[++i]);
+        else if (strcmp(arg, "--plies") == 0 && hasValue)
+            maxPlies = atoi(argv[++i]);
+        else if (strcmp(arg, "--moves") == 0 && hasValue)
+            movesKept = atoi(argv[++i]);
+        else if (strcmp(arg, "--solver") == 0 && hasValue)
+            solverPath = argv[++i];
+        else if (strcmp(arg, "--depth") == 0 && hasValue)
+            searchDepth = atoi(argv[++i]);
+        else if (arg[0] != '-' && outPath == NULL)
+            outPath = arg;
+        else
+            ok = false;
+    }
+    if (winLength < 0)
+        winLength = size;
+    useSolver = solverPath != NULL;
+    if (!ok || outPath == NULL || useSolver == (searchDepth > 0) || maxPlies < 1 ||
+        movesKept < 1)
+    {
+        fprintf(stderr, "usage: %s [--size N] [--win N] [--plies N] (--solver DATABASE "
+                        "[--moves N] | --depth N) OUTPUT.c\n",
+                argv[0]);
+        return 2;
+    }
+    if (!boardGeometryInit(&geometry, size, winLength))
+    {
+        fprintf(stderr, "can't have a %dx%d board with %d in a row\n", size, size, winLength);
+        return 2;
+    }
+    if (useSolver)
+    {
+        if (!retroShapeInit(&shape, size, winLength) ||
+            !retroDbOpen(&db, solverPath, &shape, false) || db.header->completedLayer != 0)
+        {
+            fprintf(stderr, "%s is not a solved database for this board\n", solverPath);
+            return 1;
+        }
+    }
+    else
+    {
+        searchInit(NULL);
+    }
+
+    slotMask = 1023;
+    slots = allocate((slotMask + 1) * sizeof(uint32_t));
+    Board board;
+    boardInit(&board, &geometry);
+    double start = nowSeconds();
+    expand(&board);
+    double seconds = nowSeconds() - start;
+
+    qsort(entries, entryCount, sizeof(Entry), compareEntries);
+    uint32_t moveCount = 0;
+    for (uint32_t i = 0; i < entryCount; i++)
+        moveCount += entries[i].moveCount;
+    if (moveCount > UINT16_MAX)
+    {
+        fprintf(stderr, "%u moves are too many for the book's 16-bit offsets; use fewer --plies\n",
+                moveCount);
+        return 1;
+    }
+
+    uint64_t *keys = allocate(entryCount * sizeof(uint64_t));
+    uint16_t *moveStart = allocate((entryCount + 1) * sizeof(uint16_t));
+    BookMove *moves = allocate((moveCount + 1) * sizeof(BookMove));
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < entryCount; i++)
+    {
+        keys[i] = entries[i].key;
+        moveStart[i] = next;
+        for (int m = 0; m < entries[i].moveCount; m++)
+            moves[next++] = entries[i].moves[m];
+    }
+    moveStart[entryCount] = next;
+
+    Book built = {
+        .size = size,
+        .winLength = winLength,
+        .maxPlies = maxPlies,
+        .entryCount = entryCount,
+        .keys = keys,
+        .moveStart = moveStart,
+        .moves = moves,
+    };
+    built.flashBytes = sizeof(Book) + entryCount * (sizeof(uint64_t) + sizeof(uint16_t)) +
+                       sizeof(uint16_t) + moveCount * sizeof(BookMove);
+
+    printf("book %dx%d, %d in a row: O to move with up to %d pieces, from %s\n", size, size,
+           winLength, maxPlies, useSolver ? "the solver" : "the search");
+    for (int ply = 1; ply <= maxPlies; ply += 2)
+        printf("  ply %2d: %u positions\n", ply, perPly[ply]);
+    printf("%u positions, %u moves, %u bytes of flash; built in %.2f s\n", entryCount,
+           moveCount, built.flashBytes, seconds);
+
+    static Board timed[TIMED_PROBES];
+    int timedCount = 0;
+    boardInit(&board, &geometry);
+    uint64_t mismatches = checkBook(&built, &board, timed, &timedCount);
+    printf("looked up every position again: %llu missing\n", (unsigned long long)mismatches);
+    if (timedCount > 0)
+    {
+        int repeats = 1 + 1000000 / timedCount;
+        int found = 0;
+        start = nowSeconds();
+        for (int r = 0; r < repeats; r++)
+        {
+            for (int i = 0; i < timedCount; i++)
+                found += bookMove(&built, &timed[i], r + i) >= 0;
+        }
+        seconds = nowSeconds() - start;
+        printf("lookup: %.0f ns on the host (%d positions, %d times)\n",
+               seconds * 1e9 / ((double)repeats * timedCount), timedCount, repeats);
+        mismatches += (uint64_t)repeats * timedCount - found;
+    }
+
+    FILE *out = fopen(outPath, "w");
+    if (out == NULL)
+    {
+        perror(outPath);
+        return 1;
+    }
+    fprintf(out, "// Opening book for %dx%d, %d in a row, written by host/book_gen; do not edit.\n"
+                 "// O to move with up to %d pieces, from %s: %u bytes.\n\n"
+                 "#include \"book.h\"\n\n",
+            size, size, winLength, maxPlies, useSolver ? "the solver" : "the search",
+            built.flashBytes);
+    fprintf(out, "static const uint64_t keys[] = {");
+    for (uint32_t i = 0; i < entryCount; i++)
+        fprintf(out, "%s0x%016llxull,", i % 4 == 0 ? "\n    " : " ", (unsigned long long)keys[i]);
+    fprintf(out, "\n};\n\nstatic const uint16_t moveStart[] = {");
+    for (uint32_t i = 0; i <= entryCount; i++)
+        fprintf(out, "%s%u,", i % 12 == 0 ? "\n    " : " ", moveStart[i]);
+    fprintf(out, "\n};\n\nstatic const BookMove moves[] = {");
+    for (uint32_t i = 0; i < moveCount; i++)
+        fprintf(out, "%s{%u, %u},", i % 8 == 0 ? "\n    " : " ", moves[i].pos, moves[i].weight);
+    fprintf(out, "\n};\n\nconst Book book = {%d, %d, %d, %u, %u, keys, moveStart, moves};\n", size,
+            winLength, maxPlies, entryCount, built.flashBytes);
+    fclose(out);
+    printf("wrote %s\n", outPath);
+
+    if (useSolver)
+    {
+        retroDbClose(&db);
+        retroShapeFree(&shape);
+    }
+    return mismatches == 0 ? 0 : 1;
+}
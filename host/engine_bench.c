@@ -0,0 +1,188 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+
+#include "constants.h"
+#include "logic.h"
+#include "search.h"
+#include "painting.h"
+#include "ICM20948.h"
+#include "i2c_async.h"
+#include "i2c_async_mock.h"
+#include "st7735_sim.h"
+#include "host_util.h"
+
+// Times the game core on the workstation: winner detection, the AI move, the
+// parallel search with core 1 running as a thread, a full grid repaint through
+// the ST7735 driver into the display model, and one IMU sample through the
+// async I2C path, the raw-sample parse and the AHRS filter. Built with the
+// same sources as the firmware, so it can be run under perf or valgrind.
+
+static void report(const char *name, uint64_t elapsedNs, unsigned iterations)
+{
+    printf("  %-22s %10u calls %12.1f ns/call\n", name, iterations,
+           (double)elapsedNs / iterations);
+}
+
+// Keeps results live so the timed loops aren't optimised away.
+static volatile int sink;
+
+// Core 1 sleeps until the search wakes it, as the firmware's helper task does.
+static void core1Entry(void)
+{
+    while (true)
+    {
+        __wfe();
+        searchHelperRun();
+    }
+}
+
+static void wakeSearchHelper(void)
+{
+    __sev();
+}
+
+// A fixed spread of positions: every prefix of a pseudo-random game.
+static void benchWinner(unsigned iterations)
+{
+    GridPos grids[POSITIONS][POSITIONS];
+    uint32_t seed = 1;
+
+    memset(grids, 0, sizeof(grids));
+    for (int g = 0; g < POSITIONS; g++)
+    {
+        for (int i = 0; i < g; i++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            int pos = (seed >> 16) % POSITIONS;
+            while (grids[g][pos].player != empty)
+                pos = (pos + 1) % POSITIONS;
+            grids[g][pos].player = i % 2 ? ai : human;
+        }
+    }
+
+    uint64_t start = nowNs();
+    for (unsigned n = 0; n < iterations; n++)
+    {
+        sink = winner(grids[n % POSITIONS]);
+    }
+    report("winner", nowNs() - start, iterations);
+}
+
+static void benchAiPlay(unsigned iterations)
+{
+    GridPos grid[POSITIONS];
+
+    uint64_t start = nowNs();
+    for (unsigned n = 0; n < iterations; n++)
+    {
+        memset(grid, 0, sizeof(grid));
+        grid[n % POSITIONS].player = human;
+        searchClear();
+        sink = aiPlay(grid);
+    }
+    report("aiPlay (first reply)", nowNs() - start, iterations);
+}
+
+static void benchPaint(unsigned iterations, const char *ppmPath)
+{
+    GridPos grid[POSITIONS];
+
+    memset(grid, 0, sizeof(grid));
+    for (int pos = 0; pos < POSITIONS; pos += 2)
+    {
+        grid[pos].player = pos % 4 ? ai : human;
+    }
+
+    st7735SimAttach();
+    ST7735_Init();
+    st7735SimReset();
+
+    uint64_t start = nowNs();
+    for (unsigned n = 0; n < iterations; n++)
+    {
+        paintGrid(grid, n % POSITIONS);
+    }
+    report("paintGrid", nowNs() - start, iterations);
+
+    const St7735SimStats *stats = st7735SimStats();
+    printf("  %-22s %10.1f commands %9.1f data bytes %8.1f pixels\n", "  per repaint",
+           (double)stats->commands / iterations, (double)stats->dataBytes / iterations,
+           (double)stats->pixels / iterations);
+    if (ppmPath != NULL && !st7735SimWritePpm(ppmPath))
+    {
+        fprintf(stderr, "can't write %s\n", ppmPath);
+    }
+}
+
+static void benchImu(unsigned iterations)
+{
+    static uint8_t registers[256];
+    static const int16_t raw[6] = {120, -340, 16384, 12, -7, 3};
+    uint8_t sampleBuf[ICM20948_SAMPLE_LEN];
+    I2C_ASYNC_ST_TXN txn;
+
+    for (int i = 0; i < 6; i++)
+    {
+        registers[REG_ADD_ACCEL_XOUT_H + 2 * i] = (uint16_t)raw[i] >> 8;
+        registers[REG_ADD_ACCEL_XOUT_H + 2 * i + 1] = (uint16_t)raw[i] & 0xFF;
+    }
+    mockI2cAsyncReset();
+    mockI2cAsyncAddDevice(I2C_ADD_ICM20948, registers);
+    i2cAsyncInit();
+    icm20948InvalidateBank();
+
+    uint64_t start = nowNs();
+    for (unsigned n = 0; n < iterations; n++)
+    {
+        ICM20948_ST_RAW_SAMPLE sample;
+        icm20948SubmitSampleRead(&txn, sampleBuf, NULL, NULL);
+        while (mockI2cAsyncStep())
+            ;
+        icm20948ParseSample(sampleBuf, &sample);
+        icm20948ApplyOffsets(&sample);
+        imuAHRSupdate(sample.stGyro.s16X / 32.8f * 0.0175f, sample.stGyro.s16Y / 32.8f * 0.0175f,
+                      sample.stGyro.s16Z / 32.8f * 0.0175f, sample.stAccel.s16X,
+                      sample.stAccel.s16Y, sample.stAccel.s16Z, 0, 0, 0);
+    }
+    report("IMU sample", nowNs() - start, iterations);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned iterations = 100000;
+    const char *ppmPath = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--iterations") == 0 && hasValue)
+            iterations = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--ppm") == 0 && hasValue)
+            ppmPath = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: %s [--iterations N] [--ppm grid.ppm]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (iterations == 0)
+        iterations = 1;
+
+    multicore_launch_core1(core1Entry);
+    searchInit(wakeSearchHelper);
+
+    printf("engine (%dx%d grid)\n", GRID_SIZE, GRID_SIZE);
+    benchWinner(iterations * 10);
+    benchAiPlay(iterations / 100 ? iterations / 100 : 1);
+    benchPaint(iterations / 100 ? iterations / 100 : 1, ppmPath);
+    benchImu(iterations);
+    searchBenchmark();
+    return 0;
+}
@@ -0,0 +1,279 @@
+#include "hal_host.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Cores
+
+static _Thread_local uint coreNum = 0;
+static pthread_t core1Thread;
+static bool core1Running = false;
+
+uint get_core_num(void)
+{
+    return coreNum;
+}
+
+static void *core1Main(void *entry)
+{
+    coreNum = 1;
+    ((void (*)(void))entry)();
+    return NULL;
+}
+
+void multicore_launch_core1(void (*entry)(void))
+{
+    if (core1Running)
+    {
+        fprintf(stderr, "hal: core 1 is already running\n");
+        abort();
+    }
+    core1Running = true;
+    pthread_create(&core1Thread, NULL, core1Main, (void *)entry);
+}
+
+// Core 1's entry never returns on the device, so neither can be joined here;
+// this only lets a later multicore_launch_core1() through.
+void multicore_reset_core1(void)
+{
+    if (core1Running)
+    {
+        pthread_cancel(core1Thread);
+        pthread_join(core1Thread, NULL);
+        core1Running = false;
+    }
+}
+
+// Time
+
+static uint64_t monotonicUs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000ull + now.tv_nsec / 1000;
+}
+
+uint64_t time_us_64(void)
+{
+    static uint64_t bootUs = 0;
+    if (bootUs == 0)
+    {
+        bootUs = monotonicUs() - 1; // so that boot is never time 0
+    }
+    return monotonicUs() - bootUs;
+}
+
+void sleep_us(uint64_t us)
+{
+    struct timespec delay = {us / 1000000, (us % 1000000) * 1000};
+    while (nanosleep(&delay, &delay) != 0)
+    {
+    }
+}
+
+void sleep_ms(uint32_t ms)
+{
+    sleep_us(ms * 1000ull);
+}
+
+void busy_wait_us(uint64_t us)
+{
+    uint64_t end = time_us_64() + us;
+    while (time_us_64() < end)
+    {
+    }
+}
+
+// Events: the device's single-bit event register, shared by both cores.
+
+static pthread_mutex_t eventMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t eventCond = PTHREAD_COND_INITIALIZER;
+static uint64_t eventCount = 0;
+static _Thread_local uint64_t eventSeen = 0;
+
+void __sev(void)
+{
+    pthread_mutex_lock(&eventMutex);
+    eventCount++;
+    pthread_cond_broadcast(&eventCond);
+    pthread_mutex_unlock(&eventMutex);
+}
+
+// Returns at the latest after timeoutUs, like a WFE woken by an unrelated
+// interrupt.
+static void waitForEvent(uint64_t timeoutUs)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeoutUs / 1000000;
+    deadline.tv_nsec += (timeoutUs % 1000000) * 1000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&eventMutex);
+    if (eventSeen == eventCount)
+    {
+        pthread_cond_timedwait(&eventCond, &eventMutex, &deadline);
+    }
+    eventSeen = eventCount;
+    pthread_mutex_unlock(&eventMutex);
+}
+
+void __wfe(void)
+{
+    waitForEvent(1000);
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout)
+{
+    uint64_t now = time_us_64();
+    if (now >= timeout)
+    {
+        return true;
+    }
+    uint64_t wait = timeout - now;
+    waitForEvent(wait < 1000 ? wait : 1000);
+    return time_us_64() >= timeout;
+}
+
+// Spin locks
+
+#define HAL_SPIN_LOCKS 32
+
+static spin_lock_t spinLocks[HAL_SPIN_LOCKS];
+static pthread_mutex_t spinMutexes[HAL_SPIN_LOCKS];
+static pthread_once_t spinOnce = PTHREAD_ONCE_INIT;
+static uint32_t spinClaimed = 0;
+
+static void spinInit(void)
+{
+    for (int i = 0; i < HAL_SPIN_LOCKS; i++)
+    {
+        pthread_mutex_init(&spinMutexes[i], NULL);
+    }
+}
+
+spin_lock_t *spin_lock_instance(uint lockNum)
+{
+    pthread_once(&spinOnce, spinInit);
+    return &spinLocks[lockNum];
+}
+
+// The SDK reserves 0-15; claims come from the rest, as on the device.
+int spin_lock_claim_unused(bool required)
+{
+    for (int i = 16; i < HAL_SPIN_LOCKS; i++)
+    {
+        if (!(__atomic_fetch_or(&spinClaimed, 1u << i, __ATOMIC_SEQ_CST) & (1u << i)))
+        {
+            return i;
+        }
+    }
+    if (required)
+    {
+        fprintf(stderr, "hal: no spin locks left\n");
+        abort();
+    }
+    return -1;
+}
+
+uint32_t spin_lock_blocking(spin_lock_t *lock)
+{
+    pthread_mutex_lock(&spinMutexes[lock - spinLocks]);
+    return 0;
+}
+
+void spin_unlock(spin_lock_t *lock, uint32_t saved)
+{
+    (void)saved;
+    pthread_mutex_unlock(&spinMutexes[lock - spinLocks]);
+}
+
+// GPIO
+
+#define HAL_GPIO_COUNT 30
+
+static volatile bool gpioLevel[HAL_GPIO_COUNT];
+static bool gpioPullUp[HAL_GPIO_COUNT];
+static bool gpioOutput[HAL_GPIO_COUNT];
+
+void gpio_init(uint gpio)
+{
+    gpioOutput[gpio] = false;
+    gpioLevel[gpio] = false;
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+    gpioOutput[gpio] = out;
+    if (!out)
+    {
+        gpioLevel[gpio] = gpioPullUp[gpio];
+    }
+}
+
+void gpio_put(uint gpio, bool value)
+{
+    gpioLevel[gpio] = value;
+}
+
+bool gpio_get(uint gpio)
+{
+    return gpioLevel[gpio];
+}
+
+// An undriven input with a pull-up reads high, e.g. the button when released.
+void gpio_pull_up(uint gpio)
+{
+    gpioPullUp[gpio] = true;
+    if (!gpioOutput[gpio])
+    {
+        gpioLevel[gpio] = true;
+    }
+}
+
+void gpio_set_function(uint gpio, enum gpio_function function)
+{
+    (void)gpio;
+    (void)function;
+}
+
+// SPI
+
+struct spi_inst
+{
+    int index;
+};
+
+static struct spi_inst spiInstances[2] = {{0}, {1}};
+spi_inst_t *const spi0 = &spiInstances[0];
+spi_inst_t *const spi1 = &spiInstances[1];
+
+static HalSpiSink spiSink = NULL;
+static void *spiSinkContext = NULL;
+
+void halHostSetSpiSink(HalSpiSink sink, void *context)
+{
+    spiSink = sink;
+    spiSinkContext = context;
+}
+
+uint spi_init(spi_inst_t *spi, uint baudrate)
+{
+    (void)spi;
+    return baudrate;
+}
+
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len)
+{
+    if (spiSink != NULL)
+    {
+        spiSink(spi, src, len, spiSinkContext);
+    }
+    return (int)len;
+}
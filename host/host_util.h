@@ -0,0 +1,31 @@
+#ifndef _HOST_UTIL_H_
+#define _HOST_UTIL_H_
+
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+// Small helpers shared by the host tools.
+
+// CLOCK_MONOTONIC, for timing runs.
+static inline double nowSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static inline uint64_t nowNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+}
+
+// A --threads value, with 0 meaning one per online core.
+static inline int hostThreadCount(int requested)
+{
+    return requested == 0 ? (int)sysconf(_SC_NPROCESSORS_ONLN) : requested;
+}
+
+#endif // _HOST_UTIL_H_
@@ -0,0 +1,172 @@
+#include "i2c_async_mock.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "i2c_async.h"
+#include "hal_host.h"
+
+typedef struct {
+  uint8_t  u8Addr;
+  uint8_t *pu8Regs;  // 256 registers, auto-incrementing like the ICM20948
+  uint8_t  u8Pointer;
+} MOCK_ST_DEVICE;
+
+static MOCK_ST_DEVICE sstDevices[MOCK_I2C_MAX_DEVICES];
+static uint8_t        su8DeviceCount;
+
+static bool     sbInFlight;
+static uint8_t  su8Addr;
+static uint32_t su32Cmds[2 * I2C_ASYNC_MAX_LEN];
+static uint8_t  su8CmdLen;
+static uint8_t *spu8Read;
+static uint32_t su32Completed;
+
+void mockI2cAsyncReset(void) {
+  su8DeviceCount = 0;
+  sbInFlight     = false;
+  su32Completed  = 0;
+}
+
+bool mockI2cAsyncAddDevice(uint8_t u8Addr, uint8_t *pu8Regs) {
+  if (su8DeviceCount == MOCK_I2C_MAX_DEVICES) {
+    return false;
+  }
+  sstDevices[su8DeviceCount].u8Addr    = u8Addr;
+  sstDevices[su8DeviceCount].pu8Regs   = pu8Regs;
+  sstDevices[su8DeviceCount].u8Pointer = 0;
+  su8DeviceCount++;
+  return true;
+}
+
+bool mockI2cAsyncInFlight(void) {
+  return sbInFlight;
+}
+
+uint32_t mockI2cAsyncCompleted(void) {
+  return su32Completed;
+}
+
+static MOCK_ST_DEVICE *mockFindDevice(uint8_t u8Addr) {
+  for (uint8_t i = 0; i < su8DeviceCount; i++) {
+    if (sstDevices[i].u8Addr == u8Addr) {
+      return &sstDevices[i];
+    }
+  }
+  return NULL;
+}
+
+// Executes the in-flight transaction by interpreting its IC_DATA_CMD words the
+// way the device would: the first written byte is the register pointer,
+// further writes store and auto-increment, reads return and auto-increment.
+bool mockI2cAsyncStep(void) {
+  MOCK_ST_DEVICE *pstDevice;
+  bool            bFirstWrite = true;
+  uint8_t         u8ReadIndex = 0;
+
+  if (!sbInFlight) {
+    return false;
+  }
+  sbInFlight = false;
+  su32Completed++;
+
+  pstDevice = mockFindDevice(su8Addr);
+  if (pstDevice == NULL) {
+    i2cAsyncOnComplete(false);  // address NACK
+    return true;
+  }
+  for (uint8_t i = 0; i < su8CmdLen; i++) {
+    uint32_t u32Cmd = su32Cmds[i];
+    if (u32Cmd & I2C_ASYNC_CMD_READ) {
+      spu8Read[u8ReadIndex++] = pstDevice->pu8Regs[pstDevice->u8Pointer++];
+    }
+    else if (bFirstWrite) {
+      pstDevice->u8Pointer = (uint8_t)u32Cmd;
+      bFirstWrite          = false;
+    }
+    else {
+      pstDevice->pu8Regs[pstDevice->u8Pointer++] = (uint8_t)u32Cmd;
+    }
+  }
+  i2cAsyncOnComplete(true);
+  return true;
+}
+
+void i2cAsyncPortInit(void) {
+  sbInFlight = false;
+}
+
+void i2cAsyncPortStart(uint8_t u8Addr, const uint32_t *pu32Cmds, uint8_t u8CmdLen,
+                       uint8_t *pu8Read, uint8_t u8ReadLen) {
+  (void)u8ReadLen;
+  su8Addr   = u8Addr;
+  su8CmdLen = u8CmdLen;
+  spu8Read  = pu8Read;
+  memcpy(su32Cmds, pu32Cmds, u8CmdLen * sizeof(uint32_t));
+  sbInFlight = true;
+}
+
+// Completions only happen inside mockI2cAsyncStep(), which runs on the
+// caller's thread, so there is nothing to mask.
+uint32_t i2cAsyncPortLock(void) {
+  return 0;
+}
+
+void i2cAsyncPortUnlock(uint32_t u32State) {
+  (void)u32State;
+}
+
+// A blocking wait on the host simply runs the bus.
+void i2cAsyncPortIdleWait(void) {
+  mockI2cAsyncStep();
+}
+
+/* Blocking SDK calls. A write's first byte sets the register pointer, the
+ * rest store and auto-increment; a read returns from the pointer onwards. */
+struct i2c_inst {
+  int iIndex;
+};
+
+static struct i2c_inst sstI2cInstances[2] = { { 0 }, { 1 } };
+i2c_inst_t *const i2c0 = &sstI2cInstances[0];
+i2c_inst_t *const i2c1 = &sstI2cInstances[1];
+
+uint i2c_init(i2c_inst_t *pstI2c, uint u32Baudrate) {
+  (void)pstI2c;
+  return u32Baudrate;
+}
+
+int i2c_write_blocking(i2c_inst_t *pstI2c, uint8_t u8Addr, const uint8_t *pu8Src,
+                       size_t len, bool bNoStop) {
+  MOCK_ST_DEVICE *pstDevice = mockFindDevice(u8Addr);
+
+  (void)pstI2c;
+  (void)bNoStop;
+  if (pstDevice == NULL) {
+    return PICO_ERROR_GENERIC;
+  }
+  for (size_t i = 0; i < len; i++) {
+    if (i == 0) {
+      pstDevice->u8Pointer = pu8Src[0];
+    }
+    else {
+      pstDevice->pu8Regs[pstDevice->u8Pointer++] = pu8Src[i];
+    }
+  }
+  return (int)len;
+}
+
+int i2c_read_blocking(i2c_inst_t *pstI2c, uint8_t u8Addr, uint8_t *pu8Dst, size_t len,
+                      bool bNoStop) {
+  MOCK_ST_DEVICE *pstDevice = mockFindDevice(u8Addr);
+
+  (void)pstI2c;
+  (void)bNoStop;
+  if (pstDevice == NULL) {
+    return PICO_ERROR_GENERIC;
+  }
+  for (size_t i = 0; i < len; i++) {
+    pu8Dst[i] = pstDevice->pu8Regs[pstDevice->u8Pointer++];
+  }
+  return (int)len;
+}
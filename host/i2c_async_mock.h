@@ -0,0 +1,25 @@
+#ifndef _I2C_ASYNC_MOCK_H_
+#define _I2C_ASYNC_MOCK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Host implementation of the async I2C port. Instead of a bus there is a set
+ * of simulated register-file devices; a started transaction stays in flight
+ * until mockI2cAsyncStep() executes it, so tests control exactly when each
+ * completion "interrupt" fires.
+ *
+ * The SDK's blocking i2c_write_blocking()/i2c_read_blocking() (declared by
+ * shim/hal_host.h) reach the same devices and complete immediately.
+ */
+
+#define MOCK_I2C_MAX_DEVICES 4
+
+void mockI2cAsyncReset(void);
+bool mockI2cAsyncAddDevice(uint8_t u8Addr, uint8_t *pu8Regs);
+bool mockI2cAsyncInFlight(void);
+bool mockI2cAsyncStep(void);
+uint32_t mockI2cAsyncCompleted(void);
+
+#endif  //_I2C_ASYNC_MOCK_H_
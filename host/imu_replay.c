@@ -0,0 +1,249 @@
+// Replays a captured IMU trace through the firmware's gesture recogniser and
+// reports the moves it produces, their latency and the processing throughput.
+//
+//   imu_replay [options] capture.bin
+//
+// The capture is the raw USB serial stream of a TTT_IMU_TRACE firmware build
+// (e.g. `cat /dev/ttyACM0 > capture.bin`); printf text in between frames is
+// skipped. Options override fields of gestureDefaultConfig:
+//
+//   --smoothing A          low-pass coefficient
+//   --enter X,Y            enter thresholds (g)
+//   --exit X,Y             exit thresholds (g)
+//   --repeat-delay MS      0 disables auto-repeat
+//   --repeat-interval MS
+//   --verbose              print every move
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame.h"
+#include "gesture.h"
+#include "imu_trace.h"
+#include "host_util.h"
+
+static const char *moveNames[] = {"Left", "Right", "Up", "Down"};
+
+typedef struct
+{
+    ImuTraceRecord *records;
+    size_t count;
+    size_t capacity;
+    ImuTraceHeader header;
+    bool haveHeader;
+} Trace;
+
+typedef struct
+{
+    uint32_t moves[4];
+    uint32_t repeats;
+    uint32_t latencySamples;
+    double latencySumUs;
+    uint32_t latencyMinUs;
+    uint32_t latencyMaxUs;
+} ReplayStats;
+
+static void traceAppend(Trace *trace, const ImuTraceRecord *record)
+{
+    if (trace->count == trace->capacity)
+    {
+        trace->capacity = trace->capacity ? trace->capacity * 2 : 1024;
+        trace->records = realloc(trace->records, trace->capacity * sizeof(ImuTraceRecord));
+        if (trace->records == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    trace->records[trace->count++] = *record;
+}
+
+static bool traceLoad(const char *path, Trace *trace)
+{
+    FILE *file = fopen(path, "rb");
+    FrameParser parser;
+    int c;
+
+    if (file == NULL)
+    {
+        perror(path);
+        return false;
+    }
+    memset(trace, 0, sizeof(*trace));
+    frameParserInit(&parser);
+    while ((c = fgetc(file)) != EOF)
+    {
+        if (!frameParserFeed(&parser, (uint8_t)c))
+            continue;
+
+        if (parser.type == FrameImuTraceHeader)
+        {
+            trace->haveHeader |= imuTraceDecodeHeader(parser.payload, parser.length, &trace->header);
+        }
+        else if (parser.type == FrameImuTraceSamples)
+        {
+            for (int i = 0; i + IMU_TRACE_RECORD_LEN <= parser.length; i += IMU_TRACE_RECORD_LEN)
+            {
+                ImuTraceRecord record;
+                imuTraceDecodeRecord(&parser.payload[i], &record);
+                traceAppend(trace, &record);
+            }
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+// Replays the whole trace once. Latency is measured for each fresh (non
+// repeated) move, from the first raw sample beyond the enter threshold in that
+// direction to the sample on which the recogniser fired.
+static void replay(const Trace *trace, const GestureConfig *config, float lsbPerG,
+                   bool verbose, ReplayStats *stats)
+{
+    Gesture gesture;
+    uint32_t onset[2][2];
+    bool onsetValid[2][2] = {{false, false}, {false, false}};
+
+    memset(stats, 0, sizeof(*stats));
+    stats->latencyMinUs = UINT32_MAX;
+    gestureInit(&gesture, config);
+
+    for (size_t n = 0; n < trace->count; n++)
+    {
+        const ImuTraceRecord *record = &trace->records[n];
+        float value[2] = {record->accel[0] / lsbPerG, record->accel[1] / lsbPerG};
+
+        for (int axis = 0; axis < 2; axis++)
+        {
+            for (int dir = 0; dir < 2; dir++)
+            {
+                float v = dir == 0 ? value[axis] : -value[axis];
+                if (v <= config->enterThreshold[axis])
+                    onsetValid[axis][dir] = false;
+                else if (!onsetValid[axis][dir])
+                {
+                    onset[axis][dir] = record->timeUs;
+                    onsetValid[axis][dir] = true;
+                }
+            }
+        }
+
+        AxisState before[2] = {gesture.axis[0], gesture.axis[1]};
+        Move move;
+        if (!gestureUpdate(&gesture, value[0], value[1], record->timeUs, &move))
+            continue;
+
+        int axis = (move == Left || move == Right) ? 0 : 1;
+        int dir = (move == Left || move == Up) ? 0 : 1;
+        bool repeat = before[axis] != AxisNeutral;
+        stats->moves[move]++;
+        if (repeat)
+        {
+            stats->repeats++;
+        }
+        else if (onsetValid[axis][dir])
+        {
+            uint32_t latency = record->timeUs - onset[axis][dir];
+            stats->latencySamples++;
+            stats->latencySumUs += latency;
+            if (latency < stats->latencyMinUs)
+                stats->latencyMinUs = latency;
+            if (latency > stats->latencyMaxUs)
+                stats->latencyMaxUs = latency;
+        }
+        if (verbose)
+        {
+            printf("%10.3f ms  %-5s%s\n", record->timeUs / 1000.0, moveNames[move],
+                   repeat ? " (repeat)" : "");
+        }
+    }
+}
+
+static bool parsePair(const char *text, float pair[2])
+{
+    return sscanf(text, "%f,%f", &pair[0], &pair[1]) == 2;
+}
+
+int main(int argc, char **argv)
+{
+    GestureConfig config = gestureDefaultConfig;
+    const char *path = NULL;
+    bool verbose = false;
+    bool ok = true;
+
+    for (int i = 1; i < argc && ok; i++)
+    {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--verbose") == 0)
+            verbose = true;
+        else if (strcmp(arg, "--smoothing") == 0 && hasValue)
+            config.smoothing = strtof(argv[++i], NULL);
+        else if (strcmp(arg, "--enter") == 0 && hasValue)
+            ok = parsePair(argv[++i], config.enterThreshold);
+        else if (strcmp(arg, "--exit") == 0 && hasValue)
+            ok = parsePair(argv[++i], config.exitThreshold);
+        else if (strcmp(arg, "--repeat-delay") == 0 && hasValue)
+            config.repeatDelayUs = strtoul(argv[++i], NULL, 10) * 1000;
+        else if (strcmp(arg, "--repeat-interval") == 0 && hasValue)
+            config.repeatIntervalUs = strtoul(argv[++i], NULL, 10) * 1000;
+        else if (arg[0] != '-' && path == NULL)
+            path = arg;
+        else
+            ok = false;
+    }
+    if (!ok || path == NULL)
+    {
+        fprintf(stderr, "usage: %s [--smoothing A] [--enter X,Y] [--exit X,Y] "
+                        "[--repeat-delay MS] [--repeat-interval MS] [--verbose] capture.bin\n",
+                argv[0]);
+        return 2;
+    }
+
+    Trace trace;
+    if (!traceLoad(path, &trace))
+        return 1;
+    if (trace.count == 0)
+    {
+        fprintf(stderr, "%s: no IMU trace frames found\n", path);
+        return 1;
+    }
+    float lsbPerG = trace.haveHeader ? trace.header.accelLsbPerG : 8192.0f;
+
+    ReplayStats stats;
+    replay(&trace, &config, lsbPerG, verbose, &stats);
+
+    // Throughput: repeat the replay until enough wall time has passed to be
+    // measurable.
+    ReplayStats scratch;
+    uint64_t processed = 0;
+    double start = nowSeconds();
+    double elapsed;
+    do
+    {
+        replay(&trace, &config, lsbPerG, false, &scratch);
+        processed += trace.count;
+    } while ((elapsed = nowSeconds() - start) < 0.25);
+
+    uint32_t span = trace.records[trace.count - 1].timeUs - trace.records[0].timeUs;
+    printf("trace:      %zu samples over %.2f s%s\n", trace.count, span / 1e6,
+           trace.haveHeader ? "" : " (no header, assuming +-4 g)");
+    printf("config:     smoothing %.3f  enter %.2f,%.2f  exit %.2f,%.2f  repeat %u/%u ms\n",
+           config.smoothing, config.enterThreshold[0], config.enterThreshold[1],
+           config.exitThreshold[0], config.exitThreshold[1], config.repeatDelayUs / 1000,
+           config.repeatIntervalUs / 1000);
+    printf("moves:      Left %u  Right %u  Up %u  Down %u  (%u repeats)\n", stats.moves[Left],
+           stats.moves[Right], stats.moves[Up], stats.moves[Down], stats.repeats);
+    if (stats.latencySamples > 0)
+    {
+        printf("latency:    min %.1f ms  mean %.1f ms  max %.1f ms  (%u moves)\n",
+               stats.latencyMinUs / 1000.0, stats.latencySumUs / stats.latencySamples / 1000.0,
+               stats.latencyMaxUs / 1000.0, stats.latencySamples);
+    }
+    printf("throughput: %.2f Msamples/s  (%.1f ns/sample)\n", processed / elapsed / 1e6,
+           elapsed * 1e9 / processed);
+
+    free(trace.records);
+    return 0;
+}
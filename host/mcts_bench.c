@@ -0,0 +1,225 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "constants.h"
+#include "logic.h"
+#include "mcts.h"
+#include "search.h"
+#include "host_util.h"
+
+// Measures the Monte Carlo tree search of src/mcts.c on the workstation: how
+// many random playouts a second it runs from the empty board and from a board
+// a third full, then how it plays against the firmware's alpha-beta search.
+//
+// The games alternate colours, and each starts from a few random plies (the
+// same for both colourings of a pair) so they don't all repeat. MCTS gets
+// --budget milliseconds a move, alpha-beta searches to --depth on one thread.
+//
+//   mcts_bench --size 5 --win 4 --budget 50 --games 20
+//   mcts_bench --size 4 --depth 6 --seconds 2
+
+typedef struct
+{
+    uint64_t moves;
+    double seconds;
+} EngineTime;
+
+static uint32_t nextRandom(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static void playoutRate(const char *name, const Board *board, Player toMove, double seconds)
+{
+    uint32_t seed = 12345;
+    uint64_t playouts = 0;
+    uint64_t wins[3] = {0, 0, 0};
+    double start = nowSeconds(), elapsed;
+
+    do
+    {
+        for (int i = 0; i < 1024; i++)
+        {
+            wins[mctsPlayout(board, toMove, &seed)]++;
+        }
+        playouts += 1024;
+    } while ((elapsed = nowSeconds() - start) < seconds);
+    printf("  %-12s %10.0f playouts/s  (X %.1f%%, O %.1f%%, draw %.1f%%)\n", name,
+           playouts / elapsed, 100.0 * wins[human] / playouts, 100.0 * wins[ai] / playouts,
+           100.0 * wins[empty] / playouts);
+}
+
+// One game; returns the winner, or empty for a draw.
+static Player playGame(const BoardGeometry *geometry, Player mctsSide, int openingPlies,
+                       uint32_t openingSeed, uint32_t budgetUs, int depth, EngineTime *mctsTime,
+                       EngineTime *searchTime, uint64_t *iterations, uint64_t *reused)
+{
+    Board board;
+    Player toMove = human;
+
+    boardInit(&board, geometry);
+    mctsReset();
+    searchClear();
+    for (int ply = 0; ply < openingPlies && board.filled < geometry->cells; ply++)
+    {
+        int pos;
+        do
+        {
+            pos = nextRandom(&openingSeed) % geometry->cells;
+        } while (board.cell[pos] != empty);
+        boardPlay(&board, pos, toMove);
+        toMove = opponent(toMove);
+        if (board.winner != empty)
+            return board.winner;
+    }
+
+    while (board.winner == empty && board.filled < geometry->cells)
+    {
+        double start = nowSeconds();
+        int pos;
+        if (toMove == mctsSide)
+        {
+            MctsResult result;
+            pos = mctsBestMove(&board, toMove, budgetUs, 0, &result);
+            *iterations += result.iterations;
+            *reused += result.reused;
+            mctsTime->seconds += nowSeconds() - start;
+            mctsTime->moves++;
+        }
+        else
+        {
+            SearchResult result;
+            pos = searchBestMove(&board, toMove, depth, 1, &result);
+            searchTime->seconds += nowSeconds() - start;
+            searchTime->moves++;
+        }
+        if (pos < 0)
+        {
+            fprintf(stderr, "no move in a position with empty cells\n");
+            exit(1);
+        }
+        boardPlay(&board, pos, toMove);
+        toMove = opponent(toMove);
+    }
+    return board.winner;
+}
+
+int main(int argc, char **argv)
+{
+    int size = GRID_SIZE;
+    int winLength = -1;
+    int games = 10;
+    int depth = SEARCH_DEPTH;
+    int openingPlies = 2;
+    double budgetMs = MCTS_BUDGET_US / 1000.0;
+    double seconds = 1;
+    uint32_t seed = 1;
+    bool ok = true;
+
+    for (int i = 1; i < argc && ok; i++)
+    {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--size") == 0 && hasValue)
+            size = atoi(argv[++i]);
+        else if (strcmp(arg, "--win") == 0 && hasValue)
+            winLength = atoi(argv[++i]);
+        else if (strcmp(arg, "--games") == 0 && hasValue)
+            games = atoi(argv[++i]);
+        else if (strcmp(arg, "--depth") == 0 && hasValue)
+            depth = atoi(argv[++i]);
+        else if (strcmp(arg, "--budget") == 0 && hasValue)
+            budgetMs = atof(argv[++i]);
+        else if (strcmp(arg, "--opening") == 0 && hasValue)
+            openingPlies = atoi(argv[++i]);
+        else if (strcmp(arg, "--seconds") == 0 && hasValue)
+            seconds = atof(argv[++i]);
+        else if (strcmp(arg, "--seed") == 0 && hasValue)
+            seed = strtoul(argv[++i], NULL, 0);
+        else
+            ok = false;
+    }
+    if (winLength < 0)
+        winLength = size;
+
+    static BoardGeometry geometry;
+    if (ok)
+        ok = boardGeometryInit(&geometry, size, winLength) && games >= 0 && depth > 0 &&
+             budgetMs > 0 && openingPlies >= 0 && seed != 0;
+    if (!ok)
+    {
+        fprintf(stderr, "usage: %s [--size N] [--win N] [--games N] [--budget MS] [--depth N] "
+                        "[--opening PLIES] [--seconds S] [--seed N]\n",
+                argv[0]);
+        return 2;
+    }
+    searchInit(NULL);
+
+    printf("mcts %dx%d, %d in a row, pool %d nodes\n", size, size, winLength, MCTS_POOL_NODES);
+    Board board;
+    boardInit(&board, &geometry);
+    playoutRate("empty board", &board, human, seconds);
+    uint32_t state = seed;
+    Player toMove = human;
+    while (board.filled < geometry.cells / 3)
+    {
+        int pos = nextRandom(&state) % geometry.cells;
+        if (board.cell[pos] != empty)
+            continue;
+        boardPlay(&board, pos, toMove);
+        if (board.winner != empty)
+        {
+            boardUndo(&board, pos);
+            continue;
+        }
+        toMove = opponent(toMove);
+    }
+    playoutRate("third full", &board, toMove, seconds);
+
+    MctsResult result;
+    boardInit(&board, &geometry);
+    mctsReset();
+    mctsBestMove(&board, human, (uint32_t)(budgetMs * 1000), 0, &result);
+    printf("  %-12s %10.0f iterations/s  (%u in %.1f ms, %u nodes)\n", "tree search",
+           result.iterations / (result.timeUs / 1e6), result.iterations, result.timeUs / 1000.0,
+           result.nodes);
+
+    if (games == 0)
+        return 0;
+    printf("\n%d games against alpha-beta at depth %d, MCTS %.1f ms a move, %d opening plies\n",
+           games, depth, budgetMs, openingPlies);
+    int won = 0, drawn = 0, lost = 0;
+    EngineTime mctsTime = {0, 0}, searchTime = {0, 0};
+    uint64_t iterations = 0, reused = 0;
+    for (int game = 0; game < games; game++)
+    {
+        // A pair of games shares its opening, with the colours swapped.
+        Player mctsSide = game % 2 == 0 ? human : ai;
+        uint32_t openingSeed = seed + game / 2 * 0x9e3779b9u;
+        if (openingSeed == 0)
+            openingSeed = 1;
+        Player winner = playGame(&geometry, mctsSide, openingPlies, openingSeed,
+                                 (uint32_t)(budgetMs * 1000), depth, &mctsTime, &searchTime,
+                                 &iterations, &reused);
+        if (winner == empty)
+            drawn++;
+        else if (winner == mctsSide)
+            won++;
+        else
+            lost++;
+    }
+    printf("  MCTS won %d, drew %d, lost %d\n", won, drawn, lost);
+    if (mctsTime.moves > 0)
+        printf("  MCTS       %8.2f ms a move, %.0f iterations, %.0f nodes reused\n",
+               1000 * mctsTime.seconds / mctsTime.moves, (double)iterations / mctsTime.moves,
+               (double)reused / mctsTime.moves);
+    if (searchTime.moves > 0)
+        printf("  alpha-beta %8.2f ms a move\n", 1000 * searchTime.seconds / searchTime.moves);
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+
+#include "bench.h"
+#include "search.h"
+#include "st7735_sim.h"
+
+// Runs the microbenchmarks of src/bench.c on the host and writes their JSON
+// report, for tools/bench_compare.py. Drawing goes to the display model and
+// core 1 is a thread helping with the AI search, as on the device.
+
+static void core1Entry(void)
+{
+    while (true)
+    {
+        __wfe();
+        searchHelperRun();
+    }
+}
+
+static void wakeSearchHelper(void)
+{
+    __sev();
+}
+
+int main(int argc, char **argv)
+{
+    FILE *out = stdout;
+
+    if (argc == 3 && strcmp(argv[1], "-o") == 0)
+    {
+        out = fopen(argv[2], "w");
+        if (out == NULL)
+        {
+            perror(argv[2]);
+            return 1;
+        }
+    }
+    else if (argc != 1)
+    {
+        fprintf(stderr, "usage: %s [-o report.json]\n", argv[0]);
+        return 2;
+    }
+
+    st7735SimAttach();
+    ST7735_Init();
+    multicore_launch_core1(core1Entry);
+    searchInit(wakeSearchHelper);
+
+    benchRun(out);
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include "minimax.h"
+
+#include <stdlib.h>
+
+#include "search.h"
+
+enum
+{
+    BoundExact,
+    BoundLower,
+    BoundUpper
+};
+
+bool minimaxInit(Minimax *minimax)
+{
+    minimax->table = calloc(1u << MINIMAX_TT_BITS, sizeof(MinimaxEntry));
+    minimax->nodes = 0;
+    return minimax->table != NULL;
+}
+
+void minimaxFree(Minimax *minimax)
+{
+    free(minimax->table);
+    minimax->table = NULL;
+}
+
+static int negamax(Minimax *minimax, Board *board, Player toMove, int depth, int alpha,
+                   int beta)
+{
+    int cells = board->geometry->cells;
+    minimax->nodes++;
+    if (board->winner != empty)
+        return -(SEARCH_WIN + cells - board->filled); // the previous move won
+    if (board->filled == cells || depth == 0)
+        return 0;
+
+    // Scores depend only on the position (a win's distance is counted from
+    // the empty board), so they can be shared between paths.
+    MinimaxEntry *entry = &minimax->table[board->hash & ((1u << MINIMAX_TT_BITS) - 1)];
+    if (entry->key == board->hash && entry->depth >= depth)
+    {
+        if (entry->bound == BoundExact)
+            return entry->score;
+        if (entry->bound == BoundLower && entry->score > alpha)
+            alpha = entry->score;
+        else if (entry->bound == BoundUpper && entry->score < beta)
+            beta = entry->score;
+        if (alpha >= beta)
+            return entry->score;
+    }
+
+    int originalAlpha = alpha;
+    int best = -SEARCH_INF;
+    for (int pos = 0; pos < cells; pos++)
+    {
+        if (board->cell[pos] != empty)
+            continue;
+        boardPlay(board, pos, toMove);
+        int score = -negamax(minimax, board, opponent(toMove), depth - 1, -beta, -alpha);
+        boardUndo(board, pos);
+        if (score > best)
+            best = score;
+        if (score > alpha)
+        {
+            alpha = score;
+            if (alpha >= beta)
+                break;
+        }
+    }
+
+    entry->key = board->hash;
+    entry->score = best;
+    entry->depth = depth;
+    entry->bound = best <= originalAlpha ? BoundUpper : best >= beta ? BoundLower : BoundExact;
+    return best;
+}
+
+// Negamax above counts a win from the empty board, which makes scores
+// independent of the path to a position; the search counts it from the root.
+static int minimaxRootScore(int score, int rootLeft)
+{
+    return score > 0 ? score - rootLeft : score < 0 ? score + rootLeft : 0;
+}
+
+// Searches every move of toMove to depth plies and returns the best score, or
+// -SEARCH_INF if there is no move. scores[pos] is set for each empty cell.
+// Each move is searched with a window just below the best score so far, so
+// moves scoring the best are exact and the others are upper bounds below it.
+int minimaxScoreMoves(Minimax *minimax, Board *board, Player toMove, int depth,
+                      int scores[BOARD_MAX_CELLS])
+{
+    int cells = board->geometry->cells;
+    int rootLeft = cells - board->filled;
+    int best = -SEARCH_INF;
+
+    if (board->winner != empty)
+        return best;
+    for (int pos = 0; pos < cells; pos++)
+    {
+        if (board->cell[pos] != empty)
+            continue;
+        boardPlay(board, pos, toMove);
+        scores[pos] = -negamax(minimax, board, opponent(toMove), depth - 1, -SEARCH_INF,
+                               -(best - 1));
+        boardUndo(board, pos);
+        if (scores[pos] > best)
+            best = scores[pos];
+    }
+    for (int pos = 0; pos < cells; pos++)
+    {
+        if (board->cell[pos] == empty)
+            scores[pos] = minimaxRootScore(scores[pos], rootLeft);
+    }
+    return best == -SEARCH_INF ? best : minimaxRootScore(best, rootLeft);
+}
@@ -0,0 +1,39 @@
+#ifndef _MINIMAX_H_
+#define _MINIMAX_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "logic.h"
+
+// Reentrant alpha-beta search over a Board for the host tools. Unlike the
+// firmware's search (search.h), whose transposition table and root state are
+// global, each Minimax carries its own table, so one per thread can run at
+// once.
+//
+// Scores are from the side to move's point of view on the search's scale: a
+// win n plies ahead is SEARCH_WIN - n, a loss -(SEARCH_WIN - n), and 0 is a
+// draw or the depth limit.
+
+#define MINIMAX_TT_BITS 16
+
+typedef struct
+{
+  uint64_t key;
+  int16_t score;
+  uint8_t depth;
+  uint8_t bound;
+} MinimaxEntry;
+
+typedef struct
+{
+  MinimaxEntry *table; // 1 << MINIMAX_TT_BITS entries
+  uint64_t nodes;      // positions visited, over every call
+} Minimax;
+
+bool minimaxInit(Minimax *minimax);
+void minimaxFree(Minimax *minimax);
+int minimaxScoreMoves(Minimax *minimax, Board *board, Player toMove, int depth,
+                      int scores[BOARD_MAX_CELLS]);
+
+#endif // _MINIMAX_H_
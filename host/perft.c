@@ -0,0 +1,347 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "constants.h"
+#include "logic.h"
+#include "host_util.h"
+
+// Enumerates the game tree from a position to a given depth, counting the
+// positions reached at every ply and the games that end on it (X wins, O wins,
+// draws), as a check on move generation and win detection in logic.c and a
+// measure of their throughput.
+//
+// By default it walks the search's Board (boardPlay/boardUndo with the
+// incremental win check); --grid walks the game's GridPos[] with playPos() and
+// winner() instead. --bulk counts the last ply without playing it: the moves
+// are the empty cells, and a move wins if a line through it already holds
+// winLength - 1 of the mover's pieces. --threads splits the root moves between
+// threads.
+//
+// From the empty 3x3 board the totals are checked against the known ones.
+//
+//   perft --threads 4 --bulk
+//   perft --position X...O.... --depth 4
+
+#define MAX_PLIES BOARD_MAX_CELLS
+#define MAX_THREADS 64
+
+typedef struct
+{
+    uint64_t nodes[MAX_PLIES + 1]; // positions after each ply
+    uint64_t xWins[MAX_PLIES + 1]; // games ending on each ply
+    uint64_t oWins[MAX_PLIES + 1];
+    uint64_t draws[MAX_PLIES + 1];
+} PerftCounts;
+
+typedef struct
+{
+    pthread_t thread;
+    Board board;
+    GridPos grid[POSITIONS];
+    PerftCounts counts;
+} Worker;
+
+// Per-ply positions of the full 3x3 tree, and its 255168 games.
+static const uint64_t knownNodes[] = {9, 72, 504, 3024, 15120, 54720, 148176, 200448, 127872};
+static const uint64_t knownXWins = 131184;
+static const uint64_t knownOWins = 77904;
+static const uint64_t knownDraws = 46080;
+
+static BoardGeometry geometry;
+static Board start;
+static Player startToMove;
+static int depth;
+static bool bulk;
+static bool useGrid;
+static int rootMoves[BOARD_MAX_CELLS];
+static int rootMoveCount;
+static int nextRootMove; // taken with an atomic add
+static Worker workers[MAX_THREADS];
+
+static void countEnd(PerftCounts *counts, int ply, Player won)
+{
+    if (won == human)
+        counts->xWins[ply]++;
+    else if (won == ai)
+        counts->oWins[ply]++;
+    else
+        counts->draws[ply]++;
+}
+
+// The side to move plays every empty cell; ply is the number of plies played
+// since the start position.
+static void perftBoard(Board *board, Player toMove, int ply, PerftCounts *counts)
+{
+    int cells = board->geometry->cells;
+    int side = toMove - 1;
+
+    if (bulk && ply + 1 == depth)
+    {
+        const BoardGeometry *shape = board->geometry;
+        int moves = cells - board->filled;
+        int wins = 0;
+        for (int pos = 0; pos < cells; pos++)
+        {
+            if (board->cell[pos] != empty)
+                continue;
+            for (int i = 0; i < shape->cellLineCount[pos]; i++)
+            {
+                if (board->count[shape->cellLines[pos][i]][side] == shape->winLength - 1)
+                {
+                    wins++;
+                    break;
+                }
+            }
+        }
+        counts->nodes[ply + 1] += moves;
+        if (toMove == human)
+            counts->xWins[ply + 1] += wins;
+        else
+            counts->oWins[ply + 1] += wins;
+        // Only the last empty cell can fill the board.
+        if (moves == 1 && wins == 0)
+            counts->draws[ply + 1]++;
+        return;
+    }
+
+    for (int pos = 0; pos < cells; pos++)
+    {
+        if (board->cell[pos] != empty)
+            continue;
+        boardPlay(board, pos, toMove);
+        counts->nodes[ply + 1]++;
+        if (board->winner != empty || board->filled == cells)
+            countEnd(counts, ply + 1, board->winner);
+        else if (ply + 1 < depth)
+            perftBoard(board, opponent(toMove), ply + 1, counts);
+        boardUndo(board, pos);
+    }
+}
+
+static void perftGrid(GridPos grid[], Player toMove, int ply, int filled, PerftCounts *counts)
+{
+    for (int pos = 0; pos < POSITIONS; pos++)
+    {
+        if (!canPlayAtPos(pos, grid))
+            continue;
+        playPos(toMove, pos, grid);
+        counts->nodes[ply + 1]++;
+        Player won = winner(grid);
+        if (won != empty || filled + 1 == POSITIONS)
+            countEnd(counts, ply + 1, won);
+        else if (ply + 1 < depth)
+            perftGrid(grid, opponent(toMove), ply + 1, filled + 1, counts);
+        grid[pos].player = empty;
+    }
+}
+
+// Plays root moves until there are none left; each is counted as ply 1.
+static void *workerMain(void *context)
+{
+    Worker *worker = context;
+    int move;
+
+    while ((move = __atomic_fetch_add(&nextRootMove, 1, __ATOMIC_RELAXED)) < rootMoveCount)
+    {
+        int pos = rootMoves[move];
+        worker->board = start;
+        boardPlay(&worker->board, pos, startToMove);
+        worker->counts.nodes[1]++;
+        if (worker->board.winner != empty || worker->board.filled == geometry.cells)
+        {
+            countEnd(&worker->counts, 1, worker->board.winner);
+            continue;
+        }
+        if (depth == 1)
+            continue;
+        if (useGrid)
+        {
+            for (int cell = 0; cell < POSITIONS; cell++)
+            {
+                worker->grid[cell].player = worker->board.cell[cell];
+                worker->grid[cell].winningPos = false;
+            }
+            perftGrid(worker->grid, opponent(startToMove), 1, worker->board.filled,
+                      &worker->counts);
+        }
+        else
+        {
+            perftBoard(&worker->board, opponent(startToMove), 1, &worker->counts);
+        }
+    }
+    return NULL;
+}
+
+static bool parsePosition(const char *text)
+{
+    int pieces[2] = {0, 0};
+
+    if ((int)strlen(text) != geometry.cells)
+        return false;
+    boardInit(&start, &geometry);
+    for (int pos = 0; pos < geometry.cells; pos++)
+    {
+        Player player;
+        switch (text[pos])
+        {
+        case 'X':
+        case 'x':
+            player = human;
+            break;
+        case 'O':
+        case 'o':
+            player = ai;
+            break;
+        case '.':
+        case '-':
+            continue;
+        default:
+            return false;
+        }
+        boardPlay(&start, pos, player);
+        pieces[player - 1]++;
+    }
+    // X moves first.
+    if (pieces[0] != pieces[1] && pieces[0] != pieces[1] + 1)
+        return false;
+    startToMove = pieces[0] == pieces[1] ? human : ai;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int size = GRID_SIZE;
+    int winLength = -1;
+    int threadCount = 1;
+    const char *position = NULL;
+    bool ok = true;
+
+    depth = -1;
+    for (int i = 1; i < argc && ok; i++)
+    {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--depth") == 0 && hasValue)
+            depth = atoi(argv[++i]);
+        else if (strcmp(arg, "--size") == 0 && hasValue)
+            size = atoi(argv[++i]);
+        else if (strcmp(arg, "--win") == 0 && hasValue)
+            winLength = atoi(argv[++i]);
+        else if (strcmp(arg, "--position") == 0 && hasValue)
+            position = argv[++i];
+        else if (strcmp(arg, "--threads") == 0 && hasValue)
+            threadCount = atoi(argv[++i]);
+        else if (strcmp(arg, "--bulk") == 0)
+            bulk = true;
+        else if (strcmp(arg, "--grid") == 0)
+            useGrid = true;
+        else
+            ok = false;
+    }
+    if (winLength < 0)
+        winLength = size;
+    threadCount = hostThreadCount(threadCount);
+    if (ok)
+        ok = boardGeometryInit(&geometry, size, winLength) && threadCount > 0 &&
+             threadCount <= MAX_THREADS;
+    if (ok && useGrid && (size != GRID_SIZE || winLength != GRID_SIZE || bulk))
+    {
+        fprintf(stderr, "--grid walks the game's %dx%d grid, without --bulk\n", GRID_SIZE,
+                GRID_SIZE);
+        return 2;
+    }
+    if (ok && position != NULL && !parsePosition(position))
+    {
+        fprintf(stderr, "bad position '%s': %d cells of X, O or '.', X to move first\n", position,
+                geometry.cells);
+        return 2;
+    }
+    if (!ok)
+    {
+        fprintf(stderr, "usage: %s [--depth N] [--size N] [--win N] [--position X.O......] "
+                        "[--threads N (0 for all cores)] [--bulk] [--grid]\n",
+                argv[0]);
+        return 2;
+    }
+    if (position == NULL)
+    {
+        boardInit(&start, &geometry);
+        startToMove = human;
+    }
+    int left = geometry.cells - start.filled;
+    if (depth < 0 || depth > left)
+        depth = left;
+    if (start.winner != empty || depth == 0)
+    {
+        printf("nothing to play from this position\n");
+        return 0;
+    }
+
+    for (int pos = 0; pos < geometry.cells; pos++)
+    {
+        if (start.cell[pos] == empty)
+            rootMoves[rootMoveCount++] = pos;
+    }
+    if (useGrid)
+    {
+        // winner() builds its line table on first use; not from the threads.
+        GridPos grid[POSITIONS] = {{0}};
+        winner(grid);
+    }
+
+    double startTime = nowSeconds();
+    for (int t = 0; t < threadCount; t++)
+    {
+        pthread_create(&workers[t].thread, NULL, workerMain, &workers[t]);
+    }
+    PerftCounts total;
+    memset(&total, 0, sizeof(total));
+    for (int t = 0; t < threadCount; t++)
+    {
+        pthread_join(workers[t].thread, NULL);
+        for (int ply = 1; ply <= depth; ply++)
+        {
+            total.nodes[ply] += workers[t].counts.nodes[ply];
+            total.xWins[ply] += workers[t].counts.xWins[ply];
+            total.oWins[ply] += workers[t].counts.oWins[ply];
+            total.draws[ply] += workers[t].counts.draws[ply];
+        }
+    }
+    double seconds = nowSeconds() - startTime;
+
+    uint64_t nodes = 0, xWins = 0, oWins = 0, draws = 0;
+    printf("perft %dx%d, %d in a row, depth %d%s%s, %d threads\n", size, size, winLength, depth,
+           useGrid ? ", grid" : "", bulk ? ", bulk" : "", threadCount);
+    printf("  %4s %14s %12s %12s %12s\n", "ply", "positions", "X wins", "O wins", "draws");
+    for (int ply = 1; ply <= depth; ply++)
+    {
+        printf("  %4d %14llu %12llu %12llu %12llu\n", ply, (unsigned long long)total.nodes[ply],
+               (unsigned long long)total.xWins[ply], (unsigned long long)total.oWins[ply],
+               (unsigned long long)total.draws[ply]);
+        nodes += total.nodes[ply];
+        xWins += total.xWins[ply];
+        oWins += total.oWins[ply];
+        draws += total.draws[ply];
+    }
+    printf("  %4s %14llu %12llu %12llu %12llu\n", "all", (unsigned long long)nodes,
+           (unsigned long long)xWins, (unsigned long long)oWins, (unsigned long long)draws);
+    printf("%llu leaves at depth %d, %llu games ended\n", (unsigned long long)total.nodes[depth],
+           depth, (unsigned long long)(xWins + oWins + draws));
+    printf("%.3f s, %.1f M positions/s\n", seconds, nodes / seconds / 1e6);
+
+    if (size == 3 && winLength == 3 && start.filled == 0 && depth == 9)
+    {
+        bool match = xWins == knownXWins && oWins == knownOWins && draws == knownDraws;
+        for (int ply = 1; ply <= depth; ply++)
+        {
+            match = match && total.nodes[ply] == knownNodes[ply - 1];
+        }
+        printf("3x3 totals: %s\n", match ? "match the known ones" : "DO NOT MATCH the known ones");
+        return match ? 0 : 1;
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+#ifndef _POSITION_FILE_H_
+#define _POSITION_FILE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "logic.h"
+
+// Fixed-size binary records for files of positions and of their analysis, as
+// read and written by host/analyse. Both are 8 bytes, little endian, with no
+// header, so record i is at offset 8 * i.
+//
+// A position is one 64-bit word:
+//   bits 0-49   cell i in bits 2i and 2i + 1: 0 empty, 1 X (human), 2 O (ai)
+//   bits 50-52  board size, 3 to POSITION_MAX_SIZE
+//   bits 53-55  win length, BOARD_MIN_WIN to the size
+//   bit  56     side to move: 0 X, 1 O
+
+// Two bits a cell leaves room for 5x5, not for the bigger boards of logic.h.
+#define POSITION_MAX_SIZE 5
+
+#define POSITION_SIZE_SHIFT 50
+#define POSITION_WIN_SHIFT 53
+#define POSITION_TO_MOVE_SHIFT 56
+
+typedef enum
+{
+  AnalysisOk,
+  AnalysisGameOver, // already won or full: no move
+  AnalysisInvalid   // not a position this build can read
+} AnalysisStatus;
+
+typedef struct
+{
+  int8_t move; // cell, or -1
+  uint8_t status;
+  int16_t score; // for the side to move, on the search's scale (search.h)
+  uint32_t nodes;
+} AnalysisRecord;
+
+_Static_assert(sizeof(AnalysisRecord) == 8, "analysis records are 8 bytes");
+
+static inline uint64_t positionPack(const Board *board, Player toMove)
+{
+  uint64_t packed = (uint64_t)board->geometry->size << POSITION_SIZE_SHIFT |
+                    (uint64_t)board->geometry->winLength << POSITION_WIN_SHIFT |
+                    (uint64_t)(toMove == ai) << POSITION_TO_MOVE_SHIFT;
+  for (int pos = 0; pos < board->geometry->cells; pos++)
+  {
+    packed |= (uint64_t)board->cell[pos] << (2 * pos);
+  }
+  return packed;
+}
+
+static inline int positionSize(uint64_t packed)
+{
+  return (packed >> POSITION_SIZE_SHIFT) & 7;
+}
+
+static inline int positionWinLength(uint64_t packed)
+{
+  return (packed >> POSITION_WIN_SHIFT) & 7;
+}
+
+// Plays the packed cells onto a Board of the given geometry, which must match
+// the record's size and win length. False if a cell holds 3.
+static inline bool positionUnpack(uint64_t packed, const BoardGeometry *geometry, Board *board,
+                                  Player *toMove)
+{
+  boardInit(board, geometry);
+  for (int pos = 0; pos < geometry->cells; pos++)
+  {
+    int cell = (packed >> (2 * pos)) & 3;
+    if (cell == 3)
+      return false;
+    if (cell != empty)
+      boardPlay(board, pos, cell);
+  }
+  *toMove = (packed >> POSITION_TO_MOVE_SHIFT) & 1 ? ai : human;
+  return true;
+}
+
+#endif // _POSITION_FILE_H_
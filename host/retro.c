@@ -0,0 +1,361 @@
+#include "retro.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define RETRO_PAGE 4096
+
+// Applies the geometry's cell permutations a byte of the mask at a time.
+static void retroSymmetries(RetroShape *shape, const BoardGeometry *geometry)
+{
+    for (int s = 0; s < RETRO_SYMMETRIES; s++)
+    {
+        for (int byte = 0; byte < 4; byte++)
+        {
+            for (int value = 0; value < 256; value++)
+            {
+                uint32_t mask = 0;
+                for (int bit = 0; bit < 8; bit++)
+                {
+                    int cell = byte * 8 + bit;
+                    if (value & (1 << bit) && cell < shape->cells)
+                        mask |= 1u << geometry->symmetry[s][cell];
+                }
+                shape->symmetryBytes[s][byte][value] = mask;
+            }
+        }
+    }
+}
+
+// Every mask of count cells that no symmetry maps to a smaller one, in
+// increasing order (Gosper's hack enumerates them that way).
+static bool retroCanonicalSets(RetroShape *shape, int count)
+{
+    uint32_t capacity = 1024;
+    uint32_t *sets = malloc(capacity * sizeof(uint32_t));
+    uint32_t found = 0;
+    uint64_t limit = 1ull << shape->cells;
+    uint64_t mask = (1ull << count) - 1;
+
+    while (sets != NULL && mask < limit)
+    {
+        bool canonical = true;
+        for (int s = 1; s < RETRO_SYMMETRIES && canonical; s++)
+        {
+            canonical = retroTransform(shape, s, mask) >= mask;
+        }
+        if (canonical)
+        {
+            if (found == capacity)
+            {
+                capacity *= 2;
+                uint32_t *grown = realloc(sets, capacity * sizeof(uint32_t));
+                if (grown == NULL)
+                {
+                    free(sets);
+                    return false;
+                }
+                sets = grown;
+            }
+            sets[found++] = mask;
+        }
+        if (mask == 0)
+            break;
+        uint64_t low = mask & -mask;
+        uint64_t ripple = mask + low;
+        mask = (((ripple ^ mask) >> 2) / low) | ripple;
+    }
+    shape->canonicalX[count] = sets;
+    shape->canonicalXCount[count] = found;
+    return sets != NULL;
+}
+
+bool retroShapeInit(RetroShape *shape, int size, int winLength)
+{
+    BoardGeometry geometry;
+
+    memset(shape, 0, sizeof(*shape));
+    if (!boardGeometryInit(&geometry, size, winLength) || geometry.cells > RETRO_MAX_CELLS)
+        return false;
+    shape->size = size;
+    shape->winLength = winLength;
+    shape->cells = geometry.cells;
+    shape->lineCount = geometry.lineCount;
+    for (int line = 0; line < geometry.lineCount; line++)
+    {
+        for (int i = 0; i < winLength; i++)
+            shape->lineMasks[line] |= 1u << geometry.lines[line][i];
+    }
+    for (int n = 0; n <= RETRO_MAX_CELLS; n++)
+    {
+        shape->binomial[n][0] = 1;
+        for (int k = 1; k <= n; k++)
+            shape->binomial[n][k] = shape->binomial[n - 1][k - 1] + shape->binomial[n - 1][k];
+    }
+    retroSymmetries(shape, &geometry);
+    for (int count = 0; count <= retroLayerX(shape->cells); count++)
+    {
+        if (!retroCanonicalSets(shape, count))
+        {
+            retroShapeFree(shape);
+            return false;
+        }
+    }
+    return true;
+}
+
+void retroShapeFree(RetroShape *shape)
+{
+    for (int count = 0; count <= RETRO_MAX_CELLS; count++)
+    {
+        free(shape->canonicalX[count]);
+        shape->canonicalX[count] = NULL;
+    }
+}
+
+uint32_t retroTransform(const RetroShape *shape, int symmetry, uint32_t mask)
+{
+    const uint32_t (*bytes)[256] = shape->symmetryBytes[symmetry];
+    return bytes[0][mask & 0xFF] | bytes[1][(mask >> 8) & 0xFF] | bytes[2][(mask >> 16) & 0xFF] |
+           bytes[3][mask >> 24];
+}
+
+// The symmetry of the position with the least X set, and of those the least
+// O set.
+void retroCanonical(const RetroShape *shape, uint32_t *x, uint32_t *o)
+{
+    uint32_t bestX = *x;
+    uint32_t bestO = *o;
+    for (int s = 1; s < RETRO_SYMMETRIES; s++)
+    {
+        uint32_t sx = retroTransform(shape, s, *x);
+        if (sx > bestX)
+            continue;
+        uint32_t so = retroTransform(shape, s, *o);
+        if (sx < bestX || so < bestO)
+        {
+            bestX = sx;
+            bestO = so;
+        }
+    }
+    *x = bestX;
+    *o = bestO;
+}
+
+// For an X set that is already canonical.
+bool retroIsCanonical(const RetroShape *shape, uint32_t x, uint32_t o)
+{
+    for (int s = 1; s < RETRO_SYMMETRIES; s++)
+    {
+        if (retroTransform(shape, s, x) == x && retroTransform(shape, s, o) < o)
+            return false;
+    }
+    return true;
+}
+
+bool retroHasLine(const RetroShape *shape, uint32_t mask)
+{
+    for (int line = 0; line < shape->lineCount; line++)
+    {
+        if ((mask & shape->lineMasks[line]) == shape->lineMasks[line])
+            return true;
+    }
+    return false;
+}
+
+uint64_t retroLayerPositions(const RetroShape *shape, int layer)
+{
+    int x = retroLayerX(layer);
+    int o = retroLayerO(layer);
+    return shape->canonicalXCount[x] * shape->binomial[shape->cells - x][o];
+}
+
+// For a canonical position (see retroCanonical).
+uint64_t retroRank(const RetroShape *shape, uint32_t x, uint32_t o)
+{
+    int xCount = __builtin_popcount(x);
+    int oCount = __builtin_popcount(o);
+    const uint32_t *sets = shape->canonicalX[xCount];
+    uint32_t low = 0, high = shape->canonicalXCount[xCount];
+
+    while (low + 1 < high)
+    {
+        uint32_t middle = (low + high) / 2;
+        if (sets[middle] <= x)
+            low = middle;
+        else
+            high = middle;
+    }
+
+    // Colex rank of O among the cells X leaves free.
+    uint32_t free = ~x & ((1u << shape->cells) - 1);
+    uint64_t oRank = 0;
+    int i = 0;
+    for (uint32_t rest = o; rest; rest &= rest - 1)
+    {
+        int cell = __builtin_ctz(rest);
+        int freeIndex = __builtin_popcount(free & ((1u << cell) - 1));
+        oRank += shape->binomial[freeIndex][++i];
+    }
+    return low * shape->binomial[shape->cells - xCount][oCount] + oRank;
+}
+
+void retroUnrank(const RetroShape *shape, int layer, uint64_t index, uint32_t *x, uint32_t *o)
+{
+    int xCount = retroLayerX(layer);
+    int oCount = retroLayerO(layer);
+    int freeCount = shape->cells - xCount;
+    uint64_t oSets = shape->binomial[freeCount][oCount];
+    uint8_t freeCells[RETRO_MAX_CELLS];
+    int n = 0;
+
+    *x = shape->canonicalX[xCount][index / oSets];
+    for (int cell = 0; cell < shape->cells; cell++)
+    {
+        if (!(*x & (1u << cell)))
+            freeCells[n++] = cell;
+    }
+
+    uint64_t rank = index % oSets;
+    int top = freeCount;
+    *o = 0;
+    for (int i = oCount; i > 0; i--)
+    {
+        do
+            top--;
+        while (shape->binomial[top][i] > rank);
+        rank -= shape->binomial[top][i];
+        *o |= 1u << freeCells[top];
+    }
+}
+
+static void retroLayout(const RetroShape *shape, RetroHeader *header)
+{
+    uint64_t offset = RETRO_HEADER_BYTES;
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, RETRO_MAGIC, sizeof(header->magic));
+    header->size = shape->size;
+    header->winLength = shape->winLength;
+    header->cells = shape->cells;
+    header->completedLayer = shape->cells + 1;
+    for (int layer = 0; layer <= shape->cells; layer++)
+    {
+        // Page-aligned, so each layer can be synced on its own.
+        header->layerOffset[layer] = offset;
+        header->layerPositions[layer] = retroLayerPositions(shape, layer);
+        offset += (header->layerPositions[layer] + 3) / 4;
+        offset = (offset + RETRO_PAGE - 1) / RETRO_PAGE * RETRO_PAGE;
+    }
+}
+
+static uint64_t retroFileLength(const RetroHeader *header)
+{
+    uint64_t end = header->layerOffset[header->cells] + (header->layerPositions[header->cells] + 3) / 4;
+    return (end + RETRO_PAGE - 1) / RETRO_PAGE * RETRO_PAGE;
+}
+
+static bool retroMap(RetroDb *db, int fd, uint64_t length, bool writable)
+{
+    db->map = mmap(NULL, length, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                   writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (db->map == MAP_FAILED)
+    {
+        perror("retro: mmap");
+        return false;
+    }
+    db->header = (RetroHeader *)db->map;
+    db->length = length;
+    db->writable = writable;
+    return true;
+}
+
+// A new, empty database; every value starts as RetroUnknown.
+bool retroDbCreate(RetroDb *db, const char *path, const RetroShape *shape)
+{
+    RetroHeader header;
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    db->shape = shape;
+    if (fd < 0)
+    {
+        perror(path);
+        return false;
+    }
+    retroLayout(shape, &header);
+    uint64_t length = retroFileLength(&header);
+    if (ftruncate(fd, length) != 0)
+    {
+        perror(path);
+        close(fd);
+        return false;
+    }
+    if (!retroMap(db, fd, length, true))
+        return false;
+    *db->header = header;
+    msync(db->map, RETRO_HEADER_BYTES, MS_SYNC);
+    return true;
+}
+
+// False if the file is missing or was made for another board.
+bool retroDbOpen(RetroDb *db, const char *path, const RetroShape *shape, bool writable)
+{
+    RetroHeader expected, header;
+    int fd = open(path, writable ? O_RDWR : O_RDONLY);
+    struct stat info;
+
+    db->shape = shape;
+    if (fd < 0)
+        return false;
+    retroLayout(shape, &expected);
+    if (fstat(fd, &info) != 0 || read(fd, &header, sizeof(header)) != sizeof(header) ||
+        memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+        header.size != expected.size || header.winLength != expected.winLength ||
+        memcmp(header.layerOffset, expected.layerOffset, sizeof(header.layerOffset)) != 0 ||
+        (uint64_t)info.st_size != retroFileLength(&expected))
+    {
+        close(fd);
+        return false;
+    }
+    return retroMap(db, fd, info.st_size, writable);
+}
+
+// Makes completedLayer and progressPositions (of the layer below it) durable:
+// the data is synced before the header, so the header never claims more than
+// is on disk.
+void retroDbSync(RetroDb *db, int completedLayer, uint64_t progressPositions)
+{
+    int layer = progressPositions ? completedLayer - 1 : completedLayer;
+    if (layer >= 0 && layer <= db->shape->cells)
+    {
+        uint64_t positions = progressPositions ? progressPositions : db->header->layerPositions[layer];
+        msync(db->map + db->header->layerOffset[layer], (positions + 3) / 4, MS_SYNC);
+    }
+    db->header->completedLayer = completedLayer;
+    db->header->progressPositions = progressPositions;
+    msync(db->map, RETRO_HEADER_BYTES, MS_SYNC);
+}
+
+void retroDbClose(RetroDb *db)
+{
+    if (db->map != NULL && db->map != MAP_FAILED)
+        munmap(db->map, db->length);
+    db->map = NULL;
+    db->header = NULL;
+}
+
+// The value of any position, or RetroUnknown if its layer isn't solved yet.
+RetroValue retroProbe(const RetroDb *db, uint32_t x, uint32_t o)
+{
+    int layer = __builtin_popcount(x) + __builtin_popcount(o);
+    if (layer < (int)db->header->completedLayer)
+        return RetroUnknown;
+    retroCanonical(db->shape, &x, &o);
+    return retroDbGet(db, layer, retroRank(db->shape, x, o));
+}
@@ -0,0 +1,125 @@
+#ifndef _RETRO_H_
+#define _RETRO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "logic.h"
+
+// Database of solved positions for the retrograde solver (retro_solve.c), on
+// any board logic.h supports.
+//
+// A position is a pair of cell masks, X (human, who moves first) and O. Moves
+// only ever add a piece, so positions fall into layers by piece count, and
+// layer n has ceil(n / 2) X and floor(n / 2) O pieces with X to move when n is
+// even. Within a layer positions are ranked combinatorially:
+//
+//   index = rank of the X set * C(cells - x, o) + rank of the O set
+//
+// where X sets are only the canonical ones (the least mask among the board's
+// 8 symmetries), ranked by their place in a sorted table, and the O set is
+// ranked in colex order among the cells X leaves free. That stores each
+// position once up to symmetry (about an eighth of them), bar the few whose
+// X set is itself symmetric. Of those only the symmetry-least O set is
+// solved; the others are left unknown and never looked up.
+//
+// Each position holds a 2-bit RetroValue, four to a byte, in a memory-mapped
+// file laid out as RetroHeader, then each layer's bytes in turn.
+
+// Up to 5x5: positions are 32-bit masks, and the header is laid out for this
+// many layers.
+#define RETRO_MAX_CELLS 25
+#define RETRO_SYMMETRIES BOARD_SYMMETRIES
+#define RETRO_MAGIC "TTTRDB1"
+
+// For the side to move.
+typedef enum
+{
+  RetroUnknown, // not solved, not canonical, or not a legal position
+  RetroLoss,
+  RetroDraw,
+  RetroWin
+} RetroValue;
+
+typedef struct
+{
+  char magic[8];
+  uint8_t size;
+  uint8_t winLength;
+  uint8_t cells;
+  uint8_t reserved;
+  // Layers from this one up are solved; cells + 1 when none is.
+  uint32_t completedLayer;
+  // Positions of completedLayer - 1 solved and synced so far, a prefix.
+  uint64_t progressPositions;
+  uint64_t layerOffset[RETRO_MAX_CELLS + 1]; // bytes from the start of the file
+  uint64_t layerPositions[RETRO_MAX_CELLS + 1];
+} RetroHeader;
+
+#define RETRO_HEADER_BYTES 4096
+
+// Everything derived from the board's shape.
+typedef struct
+{
+  int size;
+  int winLength;
+  int cells;
+  int lineCount;
+  uint32_t lineMasks[BOARD_MAX_LINES];
+  uint32_t symmetryBytes[RETRO_SYMMETRIES][4][256]; // mask to mask, a byte at a time
+  uint64_t binomial[RETRO_MAX_CELLS + 1][RETRO_MAX_CELLS + 1];
+  // Canonical X sets by piece count, sorted.
+  uint32_t *canonicalX[RETRO_MAX_CELLS + 1];
+  uint32_t canonicalXCount[RETRO_MAX_CELLS + 1];
+} RetroShape;
+
+typedef struct
+{
+  const RetroShape *shape;
+  RetroHeader *header;
+  uint8_t *map;
+  uint64_t length;
+  bool writable;
+} RetroDb;
+
+bool retroShapeInit(RetroShape *shape, int size, int winLength);
+void retroShapeFree(RetroShape *shape);
+uint32_t retroTransform(const RetroShape *shape, int symmetry, uint32_t mask);
+void retroCanonical(const RetroShape *shape, uint32_t *x, uint32_t *o);
+bool retroIsCanonical(const RetroShape *shape, uint32_t x, uint32_t o);
+bool retroHasLine(const RetroShape *shape, uint32_t mask);
+uint64_t retroLayerPositions(const RetroShape *shape, int layer);
+uint64_t retroRank(const RetroShape *shape, uint32_t x, uint32_t o);
+void retroUnrank(const RetroShape *shape, int layer, uint64_t index, uint32_t *x, uint32_t *o);
+
+bool retroDbCreate(RetroDb *db, const char *path, const RetroShape *shape);
+bool retroDbOpen(RetroDb *db, const char *path, const RetroShape *shape, bool writable);
+void retroDbSync(RetroDb *db, int completedLayer, uint64_t progressPositions);
+void retroDbClose(RetroDb *db);
+RetroValue retroProbe(const RetroDb *db, uint32_t x, uint32_t o);
+
+static inline int retroLayerX(int layer)
+{
+  return (layer + 1) / 2;
+}
+
+static inline int retroLayerO(int layer)
+{
+  return layer / 2;
+}
+
+static inline RetroValue retroDbGet(const RetroDb *db, int layer, uint64_t index)
+{
+  const uint8_t *data = db->map + db->header->layerOffset[layer];
+  return (RetroValue)((data[index >> 2] >> ((index & 3) * 2)) & 3);
+}
+
+// Not atomic: each byte (four positions) must only be written by one thread.
+static inline void retroDbSet(RetroDb *db, int layer, uint64_t index, RetroValue value)
+{
+  uint8_t *data = db->map + db->header->layerOffset[layer];
+  int shift = (index & 3) * 2;
+  data[index >> 2] = (data[index >> 2] & ~(3 << shift)) | value << shift;
+}
+
+#endif // _RETRO_H_
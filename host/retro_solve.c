@@ -0,0 +1,347 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "constants.h"
+#include "logic.h"
+#include "minimax.h"
+#include "retro.h"
+#include "search.h"
+#include "host_util.h"
+
+// Solves a board outright by retrograde analysis into an on-disk database
+// (retro.h) of the value of every legal position up to symmetry.
+//
+// Moves only add pieces, so the game graph is acyclic and layered by piece
+// count: a pass over layer n only needs layer n + 1. The solver runs one pass
+// per layer, from the full board back to the empty one. A position whose
+// last mover has a line is lost, a full board without one is drawn, and any
+// other is won if some move leads to a lost position, else drawn if one leads
+// to a drawn one, else lost. Illegal positions (the side to move already has
+// a line) and non-canonical ones are left unknown.
+//
+// Each pass is split into chunks of positions that threads take in turn.
+// Every --checkpoint seconds the finished prefix of the layer is synced and
+// recorded in the header, and each finished layer likewise, so an interrupted
+// run resumes from there when started again on the same file.
+//
+// --verify checks positions a few moves from the end of random games against
+// a full-depth minimax search.
+//
+//   retro_solve --size 4 --threads 0 4x4.rdb
+//   retro_solve --size 4 --win 3 --verify 10000 4x4-3.rdb
+
+#define MAX_THREADS 64
+#define CHUNK_POSITIONS (1u << 16) // a multiple of four, so no byte is shared
+#define VERIFY_EMPTY 10           // at most this many empty cells left to search
+
+typedef struct
+{
+    pthread_t thread;
+    uint64_t values[4]; // positions solved to each RetroValue this layer
+    bool failed;
+} Worker;
+
+static RetroShape shape;
+static RetroDb db;
+static int layer;
+static uint64_t chunkCount;
+static uint64_t nextChunk; // taken with an atomic add
+static uint8_t *chunkDone; // set with an atomic store
+static Worker workers[MAX_THREADS];
+
+static const char *const valueNames[] = {"unknown", "loss", "draw", "win"};
+
+static RetroValue solvePosition(uint64_t index, bool *failed)
+{
+    uint32_t x, o;
+
+    retroUnrank(&shape, layer, index, &x, &o);
+    if (!retroIsCanonical(&shape, x, o))
+        return RetroUnknown;
+
+    bool xToMove = layer % 2 == 0;
+    uint32_t mover = xToMove ? x : o;
+    uint32_t waiting = xToMove ? o : x;
+    if (retroHasLine(&shape, mover))
+        return RetroUnknown;
+    if (retroHasLine(&shape, waiting))
+        return RetroLoss;
+    if (layer == shape.cells)
+        return RetroDraw;
+
+    RetroValue best = RetroLoss;
+    uint32_t free = ~(x | o) & ((1u << shape.cells) - 1);
+    for (uint32_t rest = free; rest; rest &= rest - 1)
+    {
+        uint32_t played = mover | (rest & -rest);
+        if (retroHasLine(&shape, played))
+            return RetroWin;
+        uint32_t childX = xToMove ? played : x;
+        uint32_t childO = xToMove ? o : played;
+        retroCanonical(&shape, &childX, &childO);
+        RetroValue child = retroDbGet(&db, layer + 1, retroRank(&shape, childX, childO));
+        if (child == RetroLoss)
+            return RetroWin;
+        if (child == RetroDraw)
+            best = RetroDraw;
+        else if (child == RetroUnknown)
+            *failed = true;
+    }
+    return best;
+}
+
+static void *workerMain(void *context)
+{
+    Worker *worker = context;
+    uint64_t positions = db.header->layerPositions[layer];
+    uint64_t chunk;
+
+    while ((chunk = __atomic_fetch_add(&nextChunk, 1, __ATOMIC_RELAXED)) < chunkCount)
+    {
+        uint64_t end = (chunk + 1) * CHUNK_POSITIONS;
+        if (end > positions)
+            end = positions;
+        for (uint64_t index = chunk * CHUNK_POSITIONS; index < end; index++)
+        {
+            RetroValue value = solvePosition(index, &worker->failed);
+            retroDbSet(&db, layer, index, value);
+            worker->values[value]++;
+        }
+        __atomic_store_n(&chunkDone[chunk], 1, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+// Solves the current layer from position startIndex; false if a position
+// needed a child the layer above doesn't have.
+static bool solveLayer(int threadCount, uint64_t startIndex, double checkpointSeconds)
+{
+    uint64_t positions = db.header->layerPositions[layer];
+    uint64_t firstChunk = startIndex / CHUNK_POSITIONS;
+
+    chunkCount = (positions + CHUNK_POSITIONS - 1) / CHUNK_POSITIONS;
+    nextChunk = firstChunk;
+    chunkDone = calloc(chunkCount + 1, 1);
+    if (chunkDone == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    memset(workers, 0, sizeof(workers));
+    for (int t = 0; t < threadCount; t++)
+    {
+        pthread_create(&workers[t].thread, NULL, workerMain, &workers[t]);
+    }
+
+    // Checkpoint the finished prefix of the layer now and then.
+    uint64_t synced = firstChunk;
+    double lastSync = nowSeconds();
+    while (checkpointSeconds > 0 && __atomic_load_n(&nextChunk, __ATOMIC_RELAXED) < chunkCount)
+    {
+        usleep(10000);
+        uint64_t done = synced;
+        while (done < chunkCount && __atomic_load_n(&chunkDone[done], __ATOMIC_ACQUIRE))
+            done++;
+        if (nowSeconds() - lastSync >= checkpointSeconds && done > synced)
+        {
+            retroDbSync(&db, layer + 1, done * CHUNK_POSITIONS);
+            fprintf(stderr, "  layer %d: checkpoint at %llu of %llu positions\n", layer,
+                    (unsigned long long)(done * CHUNK_POSITIONS), (unsigned long long)positions);
+            synced = done;
+            lastSync = nowSeconds();
+        }
+    }
+
+    bool failed = false;
+    for (int t = 0; t < threadCount; t++)
+    {
+        pthread_join(workers[t].thread, NULL);
+        failed = failed || workers[t].failed;
+    }
+    free(chunkDone);
+    if (!failed)
+        retroDbSync(&db, layer, 0);
+    return !failed;
+}
+
+static uint32_t xorshift(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// Plays random games to VERIFY_EMPTY empty cells (or fewer when the game
+// would end first) and compares the database with minimax there.
+static int verify(int count, uint32_t seed)
+{
+    BoardGeometry geometry;
+    Minimax minimax;
+    int scores[BOARD_MAX_CELLS];
+    int mismatches = 0;
+
+    boardGeometryInit(&geometry, shape.size, shape.winLength);
+    if (!minimaxInit(&minimax))
+    {
+        fprintf(stderr, "out of memory\n");
+        return -1;
+    }
+    for (int game = 0; game < count; game++)
+    {
+        Board board;
+        Player toMove = human;
+        uint32_t masks[2] = {0, 0};
+        int stop = shape.cells - VERIFY_EMPTY;
+
+        boardInit(&board, &geometry);
+        while (board.filled < stop)
+        {
+            int pos;
+            do
+                pos = xorshift(&seed) % shape.cells;
+            while (board.cell[pos] != empty);
+            boardPlay(&board, pos, toMove);
+            if (board.winner != empty || board.filled == shape.cells)
+            {
+                boardUndo(&board, pos);
+                break;
+            }
+            masks[toMove - 1] |= 1u << pos;
+            toMove = opponent(toMove);
+        }
+
+        int best = minimaxScoreMoves(&minimax, &board, toMove, shape.cells - board.filled, scores);
+        RetroValue expected = best > 0 ? RetroWin : best < 0 ? RetroLoss : RetroDraw;
+        RetroValue found = retroProbe(&db, masks[0], masks[1]);
+        if (found != expected)
+        {
+            if (mismatches++ < 10)
+            {
+                fprintf(stderr, "  mismatch: X %07x O %07x, database %s, minimax %s\n", masks[0],
+                        masks[1], valueNames[found], valueNames[expected]);
+            }
+        }
+    }
+    minimaxFree(&minimax);
+    return mismatches;
+}
+
+int main(int argc, char **argv)
+{
+    int size = GRID_SIZE;
+    int winLength = -1;
+    int threadCount = 1;
+    double checkpointSeconds = 60;
+    int verifyCount = 0;
+    const char *path = NULL;
+    bool ok = true;
+
+    for (int i = 1; i < argc && ok; i++)
+    {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--size") == 0 && hasValue)
+            size = atoi(argv[++i]);
+        else if (strcmp(arg, "--win") == 0 && hasValue)
+            winLength = atoi(argv[++i]);
+        else if (strcmp(arg, "--threads") == 0 && hasValue)
+            threadCount = atoi(argv[++i]);
+        else if (strcmp(arg, "--checkpoint") == 0 && hasValue)
+            checkpointSeconds = atof(argv[++i]);
+        else if (strcmp(arg, "--verify") == 0 && hasValue)
+            verifyCount = atoi(argv[++i]);
+        else if (arg[0] != '-' && path == NULL)
+            path = arg;
+        else
+            ok = false;
+    }
+    if (winLength < 0)
+        winLength = size;
+    threadCount = hostThreadCount(threadCount);
+    ok = ok && path != NULL && threadCount > 0 && threadCount <= MAX_THREADS;
+    if (!ok)
+    {
+        fprintf(stderr, "usage: %s [--size N] [--win N] [--threads N (0 for all cores)] "
+                        "[--checkpoint SECONDS] [--verify N] DATABASE\n",
+                argv[0]);
+        return 2;
+    }
+    if (!retroShapeInit(&shape, size, winLength))
+    {
+        fprintf(stderr, "can't solve a %dx%d board with %d in a row\n", size, size, winLength);
+        return 2;
+    }
+
+    bool resumed = retroDbOpen(&db, path, &shape, true);
+    if (!resumed)
+    {
+        if (errno != ENOENT && access(path, F_OK) == 0)
+            fprintf(stderr, "%s is not a database for this board; starting over\n", path);
+        if (!retroDbCreate(&db, path, &shape))
+            return 1;
+    }
+
+    uint64_t total = 0;
+    for (int n = 0; n <= shape.cells; n++)
+        total += db.header->layerPositions[n];
+    printf("retro %dx%d, %d in a row: %llu positions in %d layers, %.1f MiB on disk\n", size,
+           size, winLength, (unsigned long long)total, shape.cells + 1,
+           db.length / (1024.0 * 1024.0));
+    if (resumed)
+    {
+        printf("resuming %s: layers %u and up solved, %llu positions into the next\n", path,
+               db.header->completedLayer, (unsigned long long)db.header->progressPositions);
+    }
+
+    printf("  %5s %14s %12s %12s %12s %12s %9s\n", "layer", "positions", "wins", "draws",
+           "losses", "unknown", "seconds");
+    uint64_t solved = 0;
+    double startTime = nowSeconds();
+    for (layer = (int)db.header->completedLayer - 1; layer >= 0; layer--)
+    {
+        uint64_t startIndex = db.header->progressPositions;
+        double layerStart = nowSeconds();
+        if (!solveLayer(threadCount, startIndex, checkpointSeconds))
+        {
+            fprintf(stderr, "layer %d: a position's child was not in the database\n", layer);
+            retroDbClose(&db);
+            return 1;
+        }
+        uint64_t values[4] = {0, 0, 0, 0};
+        for (int t = 0; t < threadCount; t++)
+        {
+            for (int v = 0; v < 4; v++)
+                values[v] += workers[t].values[v];
+        }
+        solved += db.header->layerPositions[layer] - startIndex;
+        printf("  %5d %14llu %12llu %12llu %12llu %12llu %9.2f%s\n", layer,
+               (unsigned long long)db.header->layerPositions[layer],
+               (unsigned long long)values[RetroWin], (unsigned long long)values[RetroDraw],
+               (unsigned long long)values[RetroLoss], (unsigned long long)values[RetroUnknown],
+               nowSeconds() - layerStart, startIndex ? " (resumed)" : "");
+    }
+    double seconds = nowSeconds() - startTime;
+
+    RetroValue root = retroProbe(&db, 0, 0);
+    printf("empty board: %s for X, the first player\n", valueNames[root]);
+    if (solved > 0)
+        printf("%.3f s, %.1f M positions/s\n", seconds, solved / seconds / 1e6);
+
+    int status = 0;
+    if (verifyCount > 0)
+    {
+        int mismatches = verify(verifyCount, 0x9E3779B9u);
+        printf("verify: %d positions against minimax, %d mismatches\n", verifyCount, mismatches);
+        status = mismatches == 0 ? 0 : 1;
+    }
+    retroDbClose(&db);
+    retroShapeFree(&shape);
+    return status;
+}
@@ -0,0 +1,517 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "constants.h"
+#include "logic.h"
+#include "search.h"
+#include "minimax.h"
+#include "host_util.h"
+
+// Self-play on the workstation: plays every pairing of the chosen strategies
+// against each other, X (human, moves first) against O (ai), through the
+// logic.h API the game uses, on all CPU cores.
+//
+// Games are handed out through a work-stealing pool: each thread starts with
+// an equal range of game numbers and takes them a chunk at a time; a thread
+// that runs out steals the top half of the largest range left. Each thread
+// owns its RNG, reseeded at the start of a game from the seed and the game's
+// number, so the totals don't depend on the thread count or on who played
+// which game.
+//
+//   selfplay --games 100000 --x random,minimax --o minimax,table
+
+#define CHUNK_GAMES 64
+#define MAX_STRATEGIES 8
+#define MAX_THREADS 256
+#define LATENCY_BUCKETS 40 // log2 ns
+
+typedef struct Worker Worker;
+
+typedef struct
+{
+    const char *name;
+    int (*choose)(Worker *worker, GridPos grid[], Player toMove);
+} Strategy;
+
+typedef enum
+{
+    ResultXWin,
+    ResultDraw,
+    ResultOWin,
+    ResultCount
+} Result;
+
+struct Worker
+{
+    pthread_t thread;
+    pthread_mutex_t lock; // guards next and end, which thieves move
+    uint64_t next;
+    uint64_t end;
+    uint64_t rng;
+    Board board;
+    Minimax minimax; // for the minimax strategy, set up on first use
+    uint64_t results[MAX_STRATEGIES][MAX_STRATEGIES][ResultCount];
+    uint64_t latency[MAX_STRATEGIES][LATENCY_BUCKETS]; // moves per strategy and bucket
+    uint64_t latencyNs[MAX_STRATEGIES];
+    uint64_t latencyMaxNs[MAX_STRATEGIES];
+};
+
+static const BoardGeometry *geometry;
+static BoardGeometry gridShape;
+static int searchDepth = SEARCH_DEPTH;
+static uint64_t seed = 1;
+static uint64_t gamesPerPairing = 10000;
+static int threadCount;
+static Worker workers[MAX_THREADS];
+static int xStrategies[MAX_STRATEGIES], oStrategies[MAX_STRATEGIES];
+static int xCount, oCount;
+static pthread_mutex_t engineLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Solved 3x3 positions by base 3 index: the score for the side to move, with
+// quicker wins scoring higher.
+static int8_t *solved;
+
+static uint64_t splitmix64(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+static uint32_t workerRandom(Worker *worker, uint32_t bound)
+{
+    // xorshift64*
+    worker->rng ^= worker->rng >> 12;
+    worker->rng ^= worker->rng << 25;
+    worker->rng ^= worker->rng >> 27;
+    return (uint32_t)((worker->rng * 0x2545F4914F6CDD1Dull) >> 32) % bound;
+}
+
+// Strategies
+
+static int chooseFirst(Worker *worker, GridPos grid[], Player toMove)
+{
+    return nextFreePos(grid);
+}
+
+static int chooseRandom(Worker *worker, GridPos grid[], Player toMove)
+{
+    int free[POSITIONS];
+    int count = 0;
+    for (int pos = 0; pos < POSITIONS; pos++)
+    {
+        if (canPlayAtPos(pos, grid))
+            free[count++] = pos;
+    }
+    return count ? free[workerRandom(worker, count)] : -1;
+}
+
+// Alpha-beta to searchDepth plies with the thread's own transposition table,
+// picking at random between the moves that score best.
+static int chooseMinimax(Worker *worker, GridPos grid[], Player toMove)
+{
+    Board *board = &worker->board;
+    int scores[BOARD_MAX_CELLS];
+    int moves[POSITIONS];
+    int count = 0;
+
+    if (worker->minimax.table == NULL && !minimaxInit(&worker->minimax))
+        return -1;
+    boardFromGrid(board, geometry, grid);
+    int best = minimaxScoreMoves(&worker->minimax, board, toMove, searchDepth, scores);
+    for (int pos = 0; pos < POSITIONS; pos++)
+    {
+        if (grid[pos].player == empty && scores[pos] == best)
+            moves[count++] = pos;
+    }
+    return count ? moves[workerRandom(worker, count)] : -1;
+}
+
+static uint32_t gridIndex(GridPos grid[])
+{
+    uint32_t index = 0;
+    for (int pos = POSITIONS - 1; pos >= 0; pos--)
+    {
+        index = index * 3 + grid[pos].player;
+    }
+    return index;
+}
+
+static int solve(GridPos grid[], Player toMove, int filled)
+{
+    uint32_t index = gridIndex(grid);
+    if (solved[index] != INT8_MIN)
+        return solved[index];
+
+    int best;
+    if (winner(grid) != empty)
+        best = -(1 + POSITIONS - filled);
+    else if (filled == POSITIONS)
+        best = 0;
+    else
+    {
+        best = -POSITIONS - 1;
+        for (int pos = 0; pos < POSITIONS; pos++)
+        {
+            if (grid[pos].player != empty)
+                continue;
+            grid[pos].player = toMove;
+            int score = -solve(grid, opponent(toMove), filled + 1);
+            grid[pos].player = empty;
+            if (score > best)
+                best = score;
+        }
+    }
+    solved[index] = best;
+    return best;
+}
+
+// Perfect play looked up in the solved table, picking at random between the
+// moves that score best.
+static int chooseTable(Worker *worker, GridPos grid[], Player toMove)
+{
+    int best = INT32_MIN;
+    int moves[POSITIONS];
+    int count = 0;
+
+    for (int pos = 0; pos < POSITIONS; pos++)
+    {
+        if (grid[pos].player != empty)
+            continue;
+        grid[pos].player = toMove;
+        int score = -solved[gridIndex(grid)];
+        grid[pos].player = empty;
+        if (score > best)
+        {
+            best = score;
+            count = 0;
+        }
+        if (score == best)
+            moves[count++] = pos;
+    }
+    return count ? moves[workerRandom(worker, count)] : -1;
+}
+
+// The firmware's own search. Its transposition table and root state are
+// global, so engine moves are played one at a time whatever the thread count.
+static int chooseEngine(Worker *worker, GridPos grid[], Player toMove)
+{
+    SearchResult result;
+    Board *board = &worker->board;
+
+    boardFromGrid(board, geometry, grid);
+    pthread_mutex_lock(&engineLock);
+    int pos = searchBestMove(board, toMove, SEARCH_DEPTH, 1, &result);
+    pthread_mutex_unlock(&engineLock);
+    return pos;
+}
+
+static const Strategy strategies[] = {
+    {"first", chooseFirst},
+    {"random", chooseRandom},
+    {"minimax", chooseMinimax},
+    {"table", chooseTable},
+    {"engine", chooseEngine},
+};
+#define STRATEGY_COUNT ((int)(sizeof(strategies) / sizeof(strategies[0])))
+
+// Games
+
+static void playGame(Worker *worker, uint64_t game)
+{
+    uint64_t pairing = game / gamesPerPairing;
+    int players[2] = {xStrategies[pairing / oCount], oStrategies[pairing % oCount]};
+    GridPos grid[POSITIONS];
+    Player toMove = human;
+    Result result = ResultDraw;
+
+    worker->rng = splitmix64(seed ^ splitmix64(game)) | 1;
+    memset(grid, 0, sizeof(grid));
+    for (int ply = 0; ply < POSITIONS; ply++)
+    {
+        int strategy = players[toMove == ai];
+        uint64_t start = nowNs();
+        int pos = strategies[strategy].choose(worker, grid, toMove);
+        uint64_t elapsed = nowNs() - start;
+
+        int bucket = elapsed ? 64 - __builtin_clzll(elapsed) : 0;
+        if (bucket >= LATENCY_BUCKETS)
+            bucket = LATENCY_BUCKETS - 1;
+        worker->latency[strategy][bucket]++;
+        worker->latencyNs[strategy] += elapsed;
+        if (elapsed > worker->latencyMaxNs[strategy])
+            worker->latencyMaxNs[strategy] = elapsed;
+
+        if (pos < 0 || !playPos(toMove, pos, grid))
+        {
+            fprintf(stderr, "%s made an illegal move in game %llu\n", strategies[strategy].name,
+                    (unsigned long long)game);
+            exit(1);
+        }
+        Player won = winner(grid);
+        if (won != empty)
+        {
+            result = won == human ? ResultXWin : ResultOWin;
+            break;
+        }
+        toMove = opponent(toMove);
+    }
+    worker->results[players[0]][players[1]][result]++;
+}
+
+// Takes the next chunk of this worker's range, or steals half of the largest
+// range left. False once every game has been handed out.
+static bool takeGames(Worker *worker, uint64_t *first, uint64_t *last)
+{
+    pthread_mutex_lock(&worker->lock);
+    if (worker->next < worker->end)
+    {
+        *first = worker->next;
+        *last = worker->next + CHUNK_GAMES < worker->end ? worker->next + CHUNK_GAMES : worker->end;
+        worker->next = *last;
+        pthread_mutex_unlock(&worker->lock);
+        return true;
+    }
+    pthread_mutex_unlock(&worker->lock);
+
+    while (true)
+    {
+        Worker *victim = NULL;
+        uint64_t most = 0;
+        for (int i = 0; i < threadCount; i++)
+        {
+            uint64_t left = workers[i].end - workers[i].next; // a hint, unlocked
+            if (&workers[i] != worker && left > most)
+            {
+                most = left;
+                victim = &workers[i];
+            }
+        }
+        if (victim == NULL)
+            return false;
+
+        pthread_mutex_lock(&victim->lock);
+        uint64_t left = victim->end - victim->next;
+        if (left == 0)
+        {
+            pthread_mutex_unlock(&victim->lock);
+            continue;
+        }
+        uint64_t stolen = left > CHUNK_GAMES ? left / 2 : left;
+        uint64_t begin = victim->end - stolen;
+        victim->end = begin;
+        pthread_mutex_unlock(&victim->lock);
+
+        *first = begin;
+        *last = begin + (stolen < CHUNK_GAMES ? stolen : CHUNK_GAMES);
+        pthread_mutex_lock(&worker->lock);
+        worker->next = *last;
+        worker->end = begin + stolen;
+        pthread_mutex_unlock(&worker->lock);
+        return true;
+    }
+}
+
+static void *workerMain(void *context)
+{
+    Worker *worker = context;
+    uint64_t first, last;
+    while (takeGames(worker, &first, &last))
+    {
+        for (uint64_t game = first; game < last; game++)
+        {
+            playGame(worker, game);
+        }
+    }
+    return NULL;
+}
+
+// Reports
+
+static void printResults(double seconds, uint64_t games)
+{
+    uint64_t results[MAX_STRATEGIES][MAX_STRATEGIES][ResultCount] = {{{0}}};
+    for (int t = 0; t < threadCount; t++)
+    {
+        for (int x = 0; x < STRATEGY_COUNT; x++)
+            for (int o = 0; o < STRATEGY_COUNT; o++)
+                for (int r = 0; r < ResultCount; r++)
+                    results[x][o][r] += workers[t].results[x][o][r];
+    }
+
+    printf("%llu games in %.2f s on %d threads: %.0f games/s\n\n", (unsigned long long)games,
+           seconds, threadCount, games / seconds);
+    printf("X wins / draws / O wins, %% of %llu games (rows X, columns O)\n",
+           (unsigned long long)gamesPerPairing);
+    printf("  %-8s", "");
+    for (int o = 0; o < oCount; o++)
+        printf(" %20s", strategies[oStrategies[o]].name);
+    printf("\n");
+    for (int x = 0; x < xCount; x++)
+    {
+        printf("  %-8s", strategies[xStrategies[x]].name);
+        for (int o = 0; o < oCount; o++)
+        {
+            const uint64_t *counts = results[xStrategies[x]][oStrategies[o]];
+            printf("     %5.1f/%5.1f/%5.1f", 100.0 * counts[ResultXWin] / gamesPerPairing,
+                   100.0 * counts[ResultDraw] / gamesPerPairing,
+                   100.0 * counts[ResultOWin] / gamesPerPairing);
+        }
+        printf("\n");
+    }
+}
+
+static void printLatency(void)
+{
+    printf("\nmove latency\n");
+    for (int s = 0; s < STRATEGY_COUNT; s++)
+    {
+        uint64_t histogram[LATENCY_BUCKETS] = {0};
+        uint64_t moves = 0, totalNs = 0, maxNs = 0;
+        for (int t = 0; t < threadCount; t++)
+        {
+            for (int b = 0; b < LATENCY_BUCKETS; b++)
+            {
+                histogram[b] += workers[t].latency[s][b];
+                moves += workers[t].latency[s][b];
+            }
+            totalNs += workers[t].latencyNs[s];
+            if (workers[t].latencyMaxNs[s] > maxNs)
+                maxNs = workers[t].latencyMaxNs[s];
+        }
+        if (moves == 0)
+            continue;
+
+        uint64_t peak = 0;
+        for (int b = 0; b < LATENCY_BUCKETS; b++)
+        {
+            if (histogram[b] > peak)
+                peak = histogram[b];
+        }
+        printf("  %s: %llu moves, mean %.0f ns, max %llu ns\n", strategies[s].name,
+               (unsigned long long)moves, (double)totalNs / moves, (unsigned long long)maxNs);
+        for (int b = 0; b < LATENCY_BUCKETS; b++)
+        {
+            if (histogram[b] == 0)
+                continue;
+            int bar = (int)(40 * histogram[b] / peak);
+            printf("    < %12llu ns %12llu %6.2f%% %.*s\n", 1ull << b,
+                   (unsigned long long)histogram[b], 100.0 * histogram[b] / moves, bar > 0 ? bar : 1,
+                   "########################################");
+        }
+    }
+}
+
+static bool parseStrategies(const char *list, int indices[MAX_STRATEGIES], int *count)
+{
+    char names[256];
+    snprintf(names, sizeof(names), "%s", list);
+    *count = 0;
+    for (char *name = strtok(names, ","); name != NULL; name = strtok(NULL, ","))
+    {
+        int s = 0;
+        while (s < STRATEGY_COUNT && strcmp(strategies[s].name, name) != 0)
+            s++;
+        if (s == STRATEGY_COUNT || *count == MAX_STRATEGIES)
+        {
+            fprintf(stderr, "unknown strategy '%s'\n", name);
+            return false;
+        }
+        indices[(*count)++] = s;
+    }
+    return *count > 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *xList = "first,random,minimax,table";
+    const char *oList = NULL;
+    bool ok = true;
+
+    for (int i = 1; i < argc && ok; i++)
+    {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--games") == 0 && hasValue)
+            gamesPerPairing = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(arg, "--threads") == 0 && hasValue)
+            threadCount = atoi(argv[++i]);
+        else if (strcmp(arg, "--seed") == 0 && hasValue)
+            seed = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(arg, "--depth") == 0 && hasValue)
+            searchDepth = atoi(argv[++i]);
+        else if (strcmp(arg, "--x") == 0 && hasValue)
+            xList = argv[++i];
+        else if (strcmp(arg, "--o") == 0 && hasValue)
+            oList = argv[++i];
+        else
+            ok = false;
+    }
+    threadCount = hostThreadCount(threadCount);
+    if (ok)
+        ok = parseStrategies(xList, xStrategies, &xCount) &&
+             parseStrategies(oList ? oList : xList, oStrategies, &oCount);
+    if (!ok || gamesPerPairing == 0 || threadCount < 1 || searchDepth < 1)
+    {
+        fprintf(stderr, "usage: %s [--games N] [--threads N (0 for all cores)] [--seed N] [--depth N] "
+                        "[--x first,random,minimax,table,engine] [--o ...]\n",
+                argv[0]);
+        return 2;
+    }
+    if (threadCount > MAX_THREADS)
+        threadCount = MAX_THREADS;
+
+    // Built before the threads start; read-only afterwards.
+    boardGeometryInit(&gridShape, GRID_SIZE, GRID_SIZE);
+    geometry = &gridShape;
+    GridPos grid[POSITIONS] = {{0}};
+    winner(grid);
+    searchInit(NULL);
+    for (int i = 0; i < xCount + oCount; i++)
+    {
+        int s = i < xCount ? xStrategies[i] : oStrategies[i - xCount];
+        if (strategies[s].choose == chooseTable && solved == NULL)
+        {
+            if (POSITIONS > 9)
+            {
+                fprintf(stderr, "the table strategy is only built for 3x3\n");
+                return 2;
+            }
+            uint32_t size = 1;
+            for (int pos = 0; pos < POSITIONS; pos++)
+                size *= 3;
+            solved = malloc(size);
+            memset(solved, INT8_MIN, size);
+            solve(grid, human, 0);
+        }
+    }
+
+    uint64_t games = gamesPerPairing * xCount * oCount;
+    for (int t = 0; t < threadCount; t++)
+    {
+        pthread_mutex_init(&workers[t].lock, NULL);
+        workers[t].next = games * t / threadCount;
+        workers[t].end = games * (t + 1) / threadCount;
+    }
+    uint64_t start = nowNs();
+    for (int t = 0; t < threadCount; t++)
+    {
+        pthread_create(&workers[t].thread, NULL, workerMain, &workers[t]);
+    }
+    for (int t = 0; t < threadCount; t++)
+    {
+        pthread_join(workers[t].thread, NULL);
+        minimaxFree(&workers[t].minimax);
+    }
+    double seconds = (nowNs() - start) / 1e9;
+
+    printResults(seconds, games);
+    printLatency();
+    free(solved);
+    return 0;
+}
@@ -0,0 +1,176 @@
+#ifndef _HAL_HOST_H_
+#define _HAL_HOST_H_
+
+// The slice of the Pico SDK that the portable firmware sources use, for
+// building them natively on Linux. The SDK's own header names under shim/ all
+// include this file.
+//
+// Time is CLOCK_MONOTONIC since the first call. "Cores" are threads:
+// multicore_launch_core1() starts one and get_core_num() tells them apart.
+// Spin locks are mutexes, and __wfe() waits (with a short timeout) for a
+// __sev() from another thread. GPIO levels are remembered so that drivers can
+// read back what they wrote. SPI output goes to a sink set with
+// halHostSetSpiSink(); I2C goes to the simulated devices of i2c_async_mock.h.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PICO_NO_HARDWARE 1
+#define PICO_ON_DEVICE 0
+
+#define PICO_OK 0
+#define PICO_ERROR_GENERIC -1
+#define PICO_ERROR_TIMEOUT -2
+
+typedef unsigned int uint;
+
+// pico/platform.h
+#define __not_in_flash(group)
+#define __not_in_flash_func(name) name
+#define __time_critical_func(name) name
+#define XIP_BASE 0x10000000
+#define XIP_NOCACHE_NOALLOC_BASE 0x13000000
+
+static inline void tight_loop_contents(void)
+{
+}
+
+uint get_core_num(void);
+
+// pico/time.h
+typedef uint64_t absolute_time_t;
+
+uint64_t time_us_64(void);
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+void busy_wait_us(uint64_t us);
+bool best_effort_wfe_or_timeout(absolute_time_t timeout);
+
+static inline uint32_t time_us_32(void)
+{
+    return (uint32_t)time_us_64();
+}
+
+static inline absolute_time_t get_absolute_time(void)
+{
+    return time_us_64();
+}
+
+static inline uint64_t to_us_since_boot(absolute_time_t time)
+{
+    return time;
+}
+
+static inline absolute_time_t from_us_since_boot(uint64_t us)
+{
+    return us;
+}
+
+static inline absolute_time_t make_timeout_time_us(uint64_t us)
+{
+    return time_us_64() + us;
+}
+
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms)
+{
+    return time_us_64() + ms * 1000ull;
+}
+
+static inline bool time_reached(absolute_time_t time)
+{
+    return time_us_64() >= time;
+}
+
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to)
+{
+    return (int64_t)(to - from);
+}
+
+// hardware/sync.h
+typedef volatile uint32_t spin_lock_t;
+
+void __sev(void);
+void __wfe(void);
+spin_lock_t *spin_lock_instance(uint lockNum);
+int spin_lock_claim_unused(bool required);
+uint32_t spin_lock_blocking(spin_lock_t *lock);
+void spin_unlock(spin_lock_t *lock, uint32_t saved);
+
+static inline void __dmb(void)
+{
+    __sync_synchronize();
+}
+
+// There are no interrupts to mask; interrupt handlers don't run on the host.
+static inline uint32_t save_and_disable_interrupts(void)
+{
+    return 0;
+}
+
+static inline void restore_interrupts(uint32_t saved)
+{
+    (void)saved;
+}
+
+// hardware/gpio.h
+#define GPIO_IN false
+#define GPIO_OUT true
+
+enum gpio_function
+{
+    GPIO_FUNC_SPI = 1,
+    GPIO_FUNC_UART = 2,
+    GPIO_FUNC_I2C = 3,
+    GPIO_FUNC_PWM = 4,
+    GPIO_FUNC_SIO = 5,
+    GPIO_FUNC_NULL = 0x1f,
+};
+
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+void gpio_pull_up(uint gpio);
+void gpio_set_function(uint gpio, enum gpio_function function);
+
+// hardware/spi.h
+typedef struct spi_inst spi_inst_t;
+extern spi_inst_t *const spi0;
+extern spi_inst_t *const spi1;
+
+uint spi_init(spi_inst_t *spi, uint baudrate);
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len);
+
+// hardware/i2c.h, implemented by i2c_async_mock.c
+typedef struct i2c_inst i2c_inst_t;
+extern i2c_inst_t *const i2c0;
+extern i2c_inst_t *const i2c1;
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len,
+                       bool nostop);
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+
+// pico/multicore.h
+void multicore_launch_core1(void (*entry)(void));
+void multicore_reset_core1(void);
+
+static inline void multicore_lockout_victim_init(void)
+{
+}
+
+static inline void multicore_lockout_start_blocking(void)
+{
+}
+
+static inline void multicore_lockout_end_blocking(void)
+{
+}
+
+// Host-only: receives every byte written to an SPI port. The sink can
+// gpio_get() chip select and data/command to interpret them.
+typedef void (*HalSpiSink)(spi_inst_t *spi, const uint8_t *data, size_t len, void *context);
+void halHostSetSpiSink(HalSpiSink sink, void *context);
+
+#endif // _HAL_HOST_H_
@@ -0,0 +1,6 @@
+#ifndef _SHIM_HARDWARE_PWM_H_
+#define _SHIM_HARDWARE_PWM_H_
+
+#include "hal_host.h"
+
+#endif // _SHIM_HARDWARE_PWM_H_
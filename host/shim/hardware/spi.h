@@ -0,0 +1,6 @@
+#ifndef _SHIM_HARDWARE_SPI_H_
+#define _SHIM_HARDWARE_SPI_H_
+
+#include "hal_host.h"
+
+#endif // _SHIM_HARDWARE_SPI_H_
@@ -0,0 +1,6 @@
+#ifndef _SHIM_PICO_STDLIB_H_
+#define _SHIM_PICO_STDLIB_H_
+
+#include "hal_host.h"
+
+#endif // _SHIM_PICO_STDLIB_H_
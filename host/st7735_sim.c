@@ -0,0 +1,150 @@
+#include "st7735_sim.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "DEV_Config.h"
+#include "hal_host.h"
+
+typedef struct
+{
+    uint16_t framebuffer[ST7735_HEIGHT][ST7735_WIDTH];
+    uint8_t command;
+    uint8_t args[4];
+    uint32_t argCount;
+    int x0, x1, y0, y1; // address window, inclusive
+    int x, y;           // next pixel of RAMWR
+    uint8_t pixelHigh;
+    bool havePixelHigh;
+    St7735SimStats stats;
+} St7735Sim;
+
+static St7735Sim sim;
+
+static void simCommand(uint8_t command)
+{
+    sim.command = command;
+    sim.argCount = 0;
+    sim.havePixelHigh = false;
+    sim.stats.commands++;
+    if (command == ST7735_RAMWR)
+    {
+        sim.x = sim.x0;
+        sim.y = sim.y0;
+    }
+}
+
+static void simData(uint8_t byte)
+{
+    sim.stats.dataBytes++;
+    switch (sim.command)
+    {
+    case ST7735_CASET:
+    case ST7735_RASET:
+        if (sim.argCount < 4)
+        {
+            sim.args[sim.argCount++] = byte;
+        }
+        if (sim.argCount == 4)
+        {
+            int start = (sim.args[0] << 8 | sim.args[1]);
+            int end = (sim.args[2] << 8 | sim.args[3]);
+            if (sim.command == ST7735_CASET)
+            {
+                sim.x0 = start - ST7735_XSTART;
+                sim.x1 = end - ST7735_XSTART;
+            }
+            else
+            {
+                sim.y0 = start - ST7735_YSTART;
+                sim.y1 = end - ST7735_YSTART;
+            }
+        }
+        break;
+    case ST7735_RAMWR:
+        if (!sim.havePixelHigh)
+        {
+            sim.pixelHigh = byte;
+            sim.havePixelHigh = true;
+            break;
+        }
+        sim.havePixelHigh = false;
+        if (sim.y > sim.y1)
+        {
+            break; // past the window; the controller ignores it
+        }
+        if (sim.x >= 0 && sim.x < ST7735_WIDTH && sim.y >= 0 && sim.y < ST7735_HEIGHT)
+        {
+            sim.framebuffer[sim.y][sim.x] = sim.pixelHigh << 8 | byte;
+        }
+        sim.stats.pixels++;
+        if (++sim.x > sim.x1)
+        {
+            sim.x = sim.x0;
+            sim.y++;
+        }
+        break;
+    default:
+        break; // configuration commands don't affect the picture
+    }
+}
+
+static void simSpiWrite(spi_inst_t *spi, const uint8_t *data, size_t len, void *context)
+{
+    if (spi != SPI_PORT || gpio_get(EPD_CS_PIN))
+    {
+        return; // not selected
+    }
+    bool isData = gpio_get(EPD_DC_PIN);
+    for (size_t i = 0; i < len; i++)
+    {
+        if (isData)
+            simData(data[i]);
+        else
+            simCommand(data[i]);
+    }
+}
+
+void st7735SimAttach(void)
+{
+    st7735SimReset();
+    halHostSetSpiSink(simSpiWrite, NULL);
+}
+
+void st7735SimReset(void)
+{
+    memset(&sim, 0, sizeof(sim));
+    sim.x1 = ST7735_WIDTH - 1;
+    sim.y1 = ST7735_HEIGHT - 1;
+}
+
+uint16_t st7735SimPixel(int x, int y)
+{
+    return sim.framebuffer[y][x];
+}
+
+const St7735SimStats *st7735SimStats(void)
+{
+    return &sim.stats;
+}
+
+// Binary PPM, RGB565 expanded to 8 bits per channel.
+bool st7735SimWritePpm(const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return false;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", ST7735_WIDTH, ST7735_HEIGHT);
+    for (int y = 0; y < ST7735_HEIGHT; y++)
+    {
+        for (int x = 0; x < ST7735_WIDTH; x++)
+        {
+            uint16_t pixel = sim.framebuffer[y][x];
+            uint8_t rgb[3] = {(pixel >> 11) << 3, ((pixel >> 5) & 0x3F) << 2, (pixel & 0x1F) << 3};
+            fwrite(rgb, 1, sizeof(rgb), file);
+        }
+    }
+    return fclose(file) == 0;
+}
@@ -0,0 +1,26 @@
+#ifndef _ST7735_SIM_H_
+#define _ST7735_SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "st7735.h"
+
+// A model of the ST7735 controller on the host's SPI port: it follows the
+// column/row address window and RAMWR pixel data the driver sends, so drawing
+// code can be run and its output inspected or saved.
+
+typedef struct
+{
+  uint32_t commands;
+  uint32_t dataBytes;
+  uint32_t pixels;
+} St7735SimStats;
+
+void st7735SimAttach(void);
+void st7735SimReset(void);
+uint16_t st7735SimPixel(int x, int y);
+const St7735SimStats *st7735SimStats(void);
+bool st7735SimWritePpm(const char *path);
+
+#endif // _ST7735_SIM_H_
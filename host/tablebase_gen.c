@@ -0,0 +1,375 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "constants.h"
+#include "logic.h"
+#include "retro.h"
+#include "tablebase.h"
+#include "host_util.h"
+
+// Converts a database solved by retro_solve into an endgame tablebase for the
+// firmware (src/tablebase.h): a C source of const tables, which the firmware
+// keeps in flash, holding every position with X to move and at most
+// --max-empty empty cells. aiPlay() looks moves up in it once the game is
+// within one move of that.
+//
+// Every position the table holds is probed back through tablebaseProbe() and
+// checked against the database, and the probes are timed. The flash footprint
+// is printed per layer.
+//
+//   tablebase_gen --size 4 --max-empty 10 4x4.rdb src/tablebase_data.c
+//
+// and configure the firmware with -DTTT_TABLEBASE=.../src/tablebase_data.c.
+
+#define DEFAULT_BLOCK 1024
+// Shorter runs of one value are cheaper as literals.
+#define RUN_MIN 32
+#define TIMED_PROBES 65536
+
+typedef struct
+{
+    uint8_t *data;
+    size_t length;
+    size_t capacity;
+} Buffer;
+
+static RetroShape shape;
+static RetroDb db;
+
+static void bufferPut(Buffer *buffer, uint8_t byte)
+{
+    if (buffer->length == buffer->capacity)
+    {
+        buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+        buffer->data = realloc(buffer->data, buffer->capacity);
+        if (buffer->data == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    buffer->data[buffer->length++] = byte;
+}
+
+// Positions from start that hold one value, unknown ones matching anything.
+static uint32_t runLength(const uint8_t *values, uint32_t start, uint32_t count, uint8_t *value)
+{
+    uint32_t end = start;
+    *value = TablebaseUnknown;
+    while (end < count && end - start < TABLEBASE_RUN_MAX)
+    {
+        if (values[end] != TablebaseUnknown)
+        {
+            if (*value == TablebaseUnknown)
+                *value = values[end];
+            else if (values[end] != *value)
+                break;
+        }
+        end++;
+    }
+    if (*value == TablebaseUnknown)
+        *value = TablebaseLoss;
+    return end - start;
+}
+
+// Appends one block's tokens (see tablebase.h).
+static void encodeBlock(const uint8_t *values, uint32_t count, Buffer *out)
+{
+    uint32_t pos = 0;
+    uint8_t value;
+
+    while (pos < count)
+    {
+        uint32_t run = runLength(values, pos, count, &value);
+        if (run >= RUN_MIN)
+        {
+            bufferPut(out, 0x80 | value << 5 | (run - 1) >> 8);
+            bufferPut(out, (run - 1) & 0xFF);
+            pos += run;
+            continue;
+        }
+
+        // A literal up to the next long run.
+        uint32_t first = pos;
+        uint32_t seen[4] = {0, 0, 0, 0};
+        while (pos < count && pos - first < TABLEBASE_LITERAL_MAX)
+        {
+            if (pos > first && runLength(values, pos, count, &value) >= RUN_MIN)
+                break;
+            seen[values[pos++]]++;
+        }
+        uint8_t common = TablebaseLoss;
+        for (uint8_t v = TablebaseDraw; v <= TablebaseWin; v++)
+        {
+            if (seen[v] > seen[common])
+                common = v;
+        }
+        uint8_t code[TABLEBASE_LITERAL_MAX / 4];
+        uint32_t bits = 0;
+        memset(code, 0, sizeof(code));
+        for (uint32_t i = first; i < pos; i++)
+        {
+            uint8_t v = values[i] == TablebaseUnknown ? common : values[i];
+            if (v == common)
+            {
+                bits++;
+                continue;
+            }
+            // The other two values in order: 10, then 11.
+            uint8_t other = v > common ? v - 1 : v;
+            code[bits / 8] |= 1 << bits % 8;
+            bits++;
+            if (other == TablebaseDraw)
+                code[bits / 8] |= 1 << bits % 8;
+            bits++;
+        }
+        uint32_t length = pos - first;
+        uint32_t bytes = (bits + 7) / 8;
+        bufferPut(out, common << 5 | (length - 1) >> 8);
+        bufferPut(out, (length - 1) & 0xFF);
+        bufferPut(out, bytes - 1);
+        for (uint32_t i = 0; i < bytes; i++)
+            bufferPut(out, code[i]);
+    }
+}
+
+static void boardFromMasks(Board *board, const BoardGeometry *geometry, uint32_t x, uint32_t o)
+{
+    boardInit(board, geometry);
+    for (int pos = 0; pos < geometry->cells; pos++)
+    {
+        if (x & (1u << pos))
+            boardPlay(board, pos, human);
+        else if (o & (1u << pos))
+            boardPlay(board, pos, ai);
+    }
+}
+
+static void writeWords(FILE *out, const char *type, const char *name, const uint32_t *words,
+                       size_t count)
+{
+    fprintf(out, "static const %s %s[] = {", type, name);
+    for (size_t i = 0; i < count; i++)
+    {
+        fprintf(out, "%s0x%x,", i % 8 == 0 ? "\n    " : " ", words[i]);
+    }
+    fprintf(out, "\n};\n\n");
+}
+
+static void writeBytes(FILE *out, const char *name, const uint8_t *bytes, size_t count)
+{
+    fprintf(out, "static const uint8_t %s[] = {", name);
+    for (size_t i = 0; i < count; i++)
+    {
+        fprintf(out, "%s0x%02x,", i % 12 == 0 ? "\n    " : " ", bytes[i]);
+    }
+    fprintf(out, "\n};\n\n");
+}
+
+int main(int argc, char **argv)
+{
+    int size = GRID_SIZE;
+    int winLength = -1;
+    int maxEmpty = -1;
+    int blockPositions = DEFAULT_BLOCK;
+    const char *paths[2] = {NULL, NULL};
+    int pathCount = 0;
+    bool ok = true;
+
+    for (int i = 1; i < argc && ok; i++)
+    {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--size") == 0 && hasValue)
+            size = atoi(argv[++i]);
+        else if (strcmp(arg, "--win") == 0 && hasValue)
+            winLength = atoi(argv[++i]);
+        else if (strcmp(arg, "--max-empty") == 0 && hasValue)
+            maxEmpty = atoi(argv[++i]);
+        else if (strcmp(arg, "--block") == 0 && hasValue)
+            blockPositions = atoi(argv[++i]);
+        else if (arg[0] != '-' && pathCount < 2)
+            paths[pathCount++] = arg;
+        else
+            ok = false;
+    }
+    if (winLength < 0)
+        winLength = size;
+    if (!ok || pathCount != 2 || blockPositions < 4 || blockPositions > UINT16_MAX)
+    {
+        fprintf(stderr, "usage: %s [--size N] [--win N] [--max-empty N] [--block POSITIONS] "
+                        "DATABASE OUTPUT.c\n",
+                argv[0]);
+        return 2;
+    }
+    if (!retroShapeInit(&shape, size, winLength))
+    {
+        fprintf(stderr, "can't have a %dx%d board with %d in a row\n", size, size, winLength);
+        return 2;
+    }
+    if (maxEmpty < 0 || maxEmpty > shape.cells)
+        maxEmpty = shape.cells;
+    if (!retroDbOpen(&db, paths[0], &shape, false))
+    {
+        fprintf(stderr, "%s is not a database for this board\n", paths[0]);
+        return 1;
+    }
+    // X is to move in the even layers.
+    int firstLayer = shape.cells - maxEmpty;
+    firstLayer += firstLayer % 2;
+    if ((int)db.header->completedLayer > firstLayer)
+    {
+        fprintf(stderr, "%s is only solved from layer %u; run retro_solve on it first\n",
+                paths[0], db.header->completedLayer);
+        return 1;
+    }
+
+    BoardGeometry geometry;
+    boardGeometryInit(&geometry, size, winLength);
+    static TablebaseLayer layers[BOARD_MAX_CELLS + 1];
+    static Buffer data[BOARD_MAX_CELLS + 1];
+    static uint32_t *blockIndex[BOARD_MAX_CELLS + 1];
+    Tablebase table;
+    memset(&table, 0, sizeof(table));
+    table.size = size;
+    table.winLength = winLength;
+    table.maxEmpty = maxEmpty;
+    table.blockPositions = blockPositions;
+
+    printf("tablebase %dx%d, %d in a row: X to move, at most %d empty cells, blocks of %d "
+           "positions\n",
+           size, size, winLength, maxEmpty, blockPositions);
+    printf("  %5s %12s %12s %12s %12s %12s\n", "layer", "positions", "2-bit bytes", "data bytes",
+           "index bytes", "x-set bytes");
+    uint64_t rawBytes = 0;
+    uint32_t flashBytes = sizeof(Tablebase);
+    uint8_t *values = malloc(blockPositions);
+    for (int layer = firstLayer; layer <= shape.cells; layer += 2)
+    {
+        TablebaseLayer *stored = &layers[layer];
+        int x = retroLayerX(layer);
+        uint32_t positions = db.header->layerPositions[layer];
+        uint32_t blocks = (positions + blockPositions - 1) / blockPositions;
+
+        blockIndex[layer] = malloc((blocks + 1) * sizeof(uint32_t));
+        for (uint32_t block = 0; block < blocks; block++)
+        {
+            uint32_t first = block * blockPositions;
+            uint32_t count = positions - first;
+            if (count > (uint32_t)blockPositions)
+                count = blockPositions;
+            for (uint32_t i = 0; i < count; i++)
+                values[i] = retroDbGet(&db, layer, first + i);
+            blockIndex[layer][block] = data[layer].length;
+            encodeBlock(values, count, &data[layer]);
+        }
+        blockIndex[layer][blocks] = data[layer].length;
+
+        stored->positions = positions;
+        stored->oSets = shape.binomial[shape.cells - x][retroLayerO(layer)];
+        stored->xSetCount = shape.canonicalXCount[x];
+        stored->xSets = shape.canonicalX[x];
+        stored->blockIndex = blockIndex[layer];
+        stored->data = data[layer].data;
+        table.layers[layer] = stored;
+
+        uint32_t indexBytes = (blocks + 1) * sizeof(uint32_t);
+        uint32_t xSetBytes = stored->xSetCount * sizeof(uint32_t);
+        printf("  %5d %12u %12u %12zu %12u %12u\n", layer, positions, (positions + 3) / 4,
+               data[layer].length, indexBytes, xSetBytes);
+        rawBytes += (positions + 3) / 4;
+        flashBytes += sizeof(TablebaseLayer) + data[layer].length + indexBytes + xSetBytes;
+    }
+    free(values);
+    table.flashBytes = flashBytes;
+    printf("flash: %u bytes, against %llu bytes of plain 2-bit values\n", flashBytes,
+           (unsigned long long)rawBytes);
+
+    // Every stored position probed back; a sample of them timed.
+    static Board timed[TIMED_PROBES];
+    static TablebaseValue expected[TIMED_PROBES];
+    uint64_t checked = 0, mismatches = 0;
+    int timedCount = 0;
+    for (int layer = firstLayer; layer <= shape.cells; layer += 2)
+    {
+        for (uint64_t index = 0; index < db.header->layerPositions[layer]; index++)
+        {
+            RetroValue value = retroDbGet(&db, layer, index);
+            if (value == RetroUnknown)
+                continue;
+            uint32_t x, o;
+            Board board;
+            retroUnrank(&shape, layer, index, &x, &o);
+            // Some other symmetry of the position, to exercise the lookup's.
+            int symmetry = index % RETRO_SYMMETRIES;
+            boardFromMasks(&board, &geometry, retroTransform(&shape, symmetry, x),
+                           retroTransform(&shape, symmetry, o));
+            if (tablebaseProbe(&table, &board) != (TablebaseValue)value && mismatches++ < 10)
+                fprintf(stderr, "  mismatch: layer %d, position %llu\n", layer,
+                        (unsigned long long)index);
+            if (checked++ % 7 == 0 && timedCount < TIMED_PROBES)
+            {
+                timed[timedCount] = board;
+                expected[timedCount++] = (TablebaseValue)value;
+            }
+        }
+    }
+    printf("probed back %llu positions: %llu mismatches\n", (unsigned long long)checked,
+           (unsigned long long)mismatches);
+
+    int repeats = 1 + 1000000 / (timedCount + 1);
+    int found = 0;
+    double start = nowSeconds();
+    for (int r = 0; r < repeats; r++)
+    {
+        for (int i = 0; i < timedCount; i++)
+            found += tablebaseProbe(&table, &timed[i]) == expected[i];
+    }
+    double seconds = nowSeconds() - start;
+    if (timedCount > 0)
+        printf("probe: %.0f ns on the host (%d positions, %d times)\n",
+               seconds * 1e9 / ((double)repeats * timedCount), timedCount, repeats);
+
+    FILE *out = fopen(paths[1], "w");
+    if (out == NULL)
+    {
+        perror(paths[1]);
+        return 1;
+    }
+    fprintf(out, "// Endgame tablebase for %dx%d, %d in a row, written by host/tablebase_gen; do "
+                 "not edit.\n// X to move with at most %d empty cells: %u bytes.\n\n"
+                 "#include \"tablebase.h\"\n\n",
+            size, size, winLength, maxEmpty, flashBytes);
+    for (int layer = firstLayer; layer <= shape.cells; layer += 2)
+    {
+        const TablebaseLayer *stored = &layers[layer];
+        char name[32];
+        snprintf(name, sizeof(name), "xSets%d", layer);
+        writeWords(out, "uint32_t", name, stored->xSets, stored->xSetCount);
+        snprintf(name, sizeof(name), "blockIndex%d", layer);
+        writeWords(out, "uint32_t", name, stored->blockIndex,
+                   (stored->positions + blockPositions - 1) / blockPositions + 1);
+        snprintf(name, sizeof(name), "data%d", layer);
+        writeBytes(out, name, stored->data, data[layer].length);
+        fprintf(out, "static const TablebaseLayer layer%d = {%u, %u, %u, xSets%d, blockIndex%d, "
+                     "data%d};\n\n",
+                layer, stored->positions, stored->oSets, stored->xSetCount, layer, layer, layer);
+    }
+    fprintf(out, "const Tablebase tablebase = {\n    %d, %d, %d, %d, %u,\n    {", size, winLength,
+            maxEmpty, blockPositions, flashBytes);
+    for (int layer = 0; layer <= BOARD_MAX_CELLS; layer++)
+    {
+        if (table.layers[layer] != NULL)
+            fprintf(out, "%s[%d] = &layer%d", layer > firstLayer ? ", " : "", layer, layer);
+    }
+    fprintf(out, "},\n};\n");
+    fclose(out);
+    printf("wrote %s\n", paths[1]);
+
+    retroDbClose(&db);
+    retroShapeFree(&shape);
+    return mismatches == 0 && found == repeats * timedCount ? 0 : 1;
+}
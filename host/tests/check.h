@@ -0,0 +1,49 @@
+#ifndef _CHECK_H_
+#define _CHECK_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+// Assertions for the host tests. A failed check is reported with its file and
+// line and the test carries on, so one run shows every failure; checkExit()
+// turns the count into the exit status ctest looks at.
+
+static int checkFailures;
+static int checkCount;
+
+static inline bool checkResult(bool ok, const char *file, int line, const char *what)
+{
+    checkCount++;
+    if (!ok)
+    {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+        checkFailures++;
+    }
+    return ok;
+}
+
+static inline bool checkEqual(long long actual, long long expected, const char *file, int line,
+                              const char *what)
+{
+    checkCount++;
+    if (actual != expected)
+    {
+        fprintf(stderr, "%s:%d: check failed: %s is %lld, expected %lld\n", file, line, what,
+                actual, expected);
+        checkFailures++;
+        return false;
+    }
+    return true;
+}
+
+#define CHECK(condition) checkResult((condition), __FILE__, __LINE__, #condition)
+#define CHECK_EQ(actual, expected) \
+  checkEqual((long long)(actual), (long long)(expected), __FILE__, __LINE__, #actual)
+
+static inline int checkExit(const char *name)
+{
+    printf("%s: %d checks, %d failed\n", name, checkCount, checkFailures);
+    return checkFailures ? 1 : 0;
+}
+
+#endif // _CHECK_H_
@@ -0,0 +1,142 @@
+#include "search.h"
+#include "book.h"
+#include "minimax.h"
+#include "check.h"
+
+// The linked-in opening book (a 3x3 one generated by the build unless
+// TTT_BOOK names another): the key is the same for every symmetry of a
+// position, the book answers whatever X plays against it up to maxPlies, and
+// every move it gives is as good as a full alpha-beta search's best.
+
+static uint32_t nextRandom(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// The board with symmetry s applied to every piece.
+static void transform(Board *out, const Board *board, int s)
+{
+    const BoardGeometry *geometry = board->geometry;
+
+    boardInit(out, geometry);
+    for (int pos = 0; pos < geometry->cells; pos++)
+    {
+        if (board->cell[pos] != empty)
+            boardPlay(out, geometry->symmetry[s][pos], board->cell[pos]);
+    }
+}
+
+static void testKeys(void)
+{
+    static BoardGeometry geometry;
+    uint32_t seed = 17;
+
+    CHECK(boardGeometryInit(&geometry, book.size, book.winLength));
+    for (int game = 0; game < 500; game++)
+    {
+        Board board;
+        Player toMove = human;
+
+        boardInit(&board, &geometry);
+        while (board.winner == empty && board.filled < geometry.cells)
+        {
+            int pos = nextRandom(&seed) % geometry.cells;
+            if (board.cell[pos] != empty)
+                continue;
+            boardPlay(&board, pos, toMove);
+            toMove = opponent(toMove);
+
+            int symmetry;
+            uint64_t key = bookKey(&board, &symmetry);
+            CHECK(symmetry >= 0 && symmetry < BOARD_SYMMETRIES);
+            for (int s = 1; s < BOARD_SYMMETRIES; s++)
+            {
+                Board other;
+                int otherSymmetry;
+                transform(&other, &board, s);
+                if (!CHECK(bookKey(&other, &otherSymmetry) == key))
+                    return;
+            }
+        }
+    }
+}
+
+static int checked;
+
+// Every X move from board, O to answer from the book, down to maxPlies.
+static void checkBook(Minimax *minimax, Board *board, uint32_t *seed)
+{
+    const BoardGeometry *geometry = board->geometry;
+    int scores[BOARD_MAX_CELLS];
+
+    for (int pos = 0; pos < geometry->cells; pos++)
+    {
+        if (board->cell[pos] != empty)
+            continue;
+        boardPlay(board, pos, human);
+        if (board->winner == empty && board->filled <= book.maxPlies &&
+            board->filled < geometry->cells)
+        {
+            int left = geometry->cells - board->filled;
+            int best = minimaxScoreMoves(minimax, board, ai, left, scores);
+
+            // Any of the book's moves will do, so try a few picks.
+            for (int pick = 0; pick < 3; pick++)
+            {
+                int move = bookMove(&book, board, nextRandom(seed));
+                if (!CHECK(move >= 0 && board->cell[move] == empty))
+                    break;
+                boardPlay(board, move, ai);
+                int reply = 0;
+                if (board->winner == ai)
+                    reply = -SEARCH_INF;
+                else if (board->filled < geometry->cells)
+                    reply = minimaxScoreMoves(minimax, board, human, left - 1, scores);
+                // O's outcome is the opposite of X's best reply's.
+                CHECK_EQ((reply < 0) - (reply > 0), (best > 0) - (best < 0));
+                checked++;
+                if (pick == 0 && board->winner == empty)
+                    checkBook(minimax, board, seed);
+                boardUndo(board, move);
+            }
+        }
+        boardUndo(board, pos);
+    }
+}
+
+static void testMoves(Minimax *minimax)
+{
+    static BoardGeometry geometry;
+    Board board;
+    uint32_t seed = 23;
+
+    CHECK(boardGeometryInit(&geometry, book.size, book.winLength));
+    boardInit(&board, &geometry);
+    checked = 0;
+    checkBook(minimax, &board, &seed);
+    CHECK(checked > 0);
+
+    // Past maxPlies, and on a board of another shape, there is no answer.
+    while (board.filled <= book.maxPlies)
+        boardPlay(&board, board.filled, board.filled % 2 ? ai : human);
+    CHECK_EQ(bookMove(&book, &board, 0), -1);
+    CHECK(boardGeometryInit(&geometry, book.size == 3 ? 4 : 3, 3));
+    boardInit(&board, &geometry);
+    boardPlay(&board, 0, human);
+    CHECK_EQ(bookMove(&book, &board, 0), -1);
+}
+
+int main(void)
+{
+    Minimax minimax;
+
+    if (!minimaxInit(&minimax))
+        return 1;
+    testKeys();
+    testMoves(&minimax);
+    minimaxFree(&minimax);
+    return checkExit("test_book");
+}
@@ -0,0 +1,140 @@
+#include <string.h>
+
+#include "eval.h"
+#include "check.h"
+
+// The static evaluation: the state kept up to date by evalPlay() and
+// evalUndo() over random games always equals one built from scratch, and
+// evalScore() reads the threats on a few hand-made positions.
+
+static uint32_t nextRandom(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static bool sameState(const EvalState *a, const EvalState *b, const EvalTables *tables)
+{
+    return CHECK(memcmp(a->code, b->code, tables->lineCount) == 0) &&
+           CHECK_EQ(a->score, b->score) && CHECK_EQ(a->counts, b->counts);
+}
+
+static void testIncremental(void)
+{
+    static BoardGeometry geometry;
+    static EvalTables tables;
+    uint32_t seed = 11;
+
+    for (int size = BOARD_MIN_WIN; size <= BOARD_MAX_SIZE; size++)
+    {
+        for (int winLength = BOARD_MIN_WIN; winLength <= size; winLength++)
+        {
+            CHECK(boardGeometryInit(&geometry, size, winLength));
+            evalTablesInit(&tables, &geometry);
+            CHECK(evalTablesMatch(&tables, &geometry));
+
+            for (int game = 0; game < 200; game++)
+            {
+                Board board;
+                EvalState state, initial, rebuilt;
+                int moves[BOARD_MAX_CELLS];
+                int moveCount = 0;
+                Player toMove = human;
+
+                boardInit(&board, &geometry);
+                evalInit(&initial, &tables, &board);
+                state = initial;
+                while (board.winner == empty && board.filled < geometry.cells)
+                {
+                    int pos = nextRandom(&seed) % geometry.cells;
+                    if (board.cell[pos] != empty)
+                        continue;
+                    boardPlay(&board, pos, toMove);
+                    evalPlay(&state, &tables, pos, toMove);
+                    moves[moveCount++] = pos;
+                    evalInit(&rebuilt, &tables, &board);
+                    if (!sameState(&state, &rebuilt, &tables))
+                        return;
+                    toMove = opponent(toMove);
+                }
+                while (moveCount > 0)
+                {
+                    int pos = moves[--moveCount];
+                    toMove = opponent(toMove);
+                    evalUndo(&state, &tables, pos, toMove);
+                    boardUndo(&board, pos);
+                }
+                if (!sameState(&state, &initial, &tables))
+                    return;
+            }
+        }
+    }
+}
+
+// Plays a row of pieces on row, from column from up to but not including to.
+static void playRow(Board *board, EvalState *state, const EvalTables *tables, int row, int from,
+                    int to, Player player)
+{
+    int size = board->geometry->size;
+    for (int col = from; col < to; col++)
+    {
+        boardPlay(board, row * size + col, player);
+        evalPlay(state, tables, row * size + col, player);
+    }
+}
+
+static void testThreats(void)
+{
+    static BoardGeometry geometry;
+    static EvalTables tables;
+    Board board;
+    EvalState state;
+
+    if (!CHECK(boardGeometryInit(&geometry, 5, 4)))
+        return;
+    evalTablesInit(&tables, &geometry);
+
+    // An empty board is even, and the score is X's patterns less O's.
+    boardInit(&board, &geometry);
+    evalInit(&state, &tables, &board);
+    CHECK_EQ(state.score, 0);
+    CHECK_EQ(evalScore(&state, &tables, human), 0);
+    playRow(&board, &state, &tables, 2, 2, 3, human);
+    CHECK(state.score > 0);
+    CHECK_EQ(evalScore(&state, &tables, ai), -state.score);
+
+    // A four: a win next move for X, one cell for O to block.
+    boardInit(&board, &geometry);
+    evalInit(&state, &tables, &board);
+    playRow(&board, &state, &tables, 0, 0, 3, human);
+    playRow(&board, &state, &tables, 4, 3, 5, ai);
+    CHECK_EQ(evalScore(&state, &tables, human), EVAL_WIN_NEXT);
+    CHECK(evalScore(&state, &tables, ai) > -EVAL_WIN_NEXT);
+
+    // Open on both ends: O can't block both.
+    boardInit(&board, &geometry);
+    evalInit(&state, &tables, &board);
+    playRow(&board, &state, &tables, 2, 1, 4, human);
+    playRow(&board, &state, &tables, 4, 0, 2, ai);
+    CHECK_EQ(evalScore(&state, &tables, human), EVAL_WIN_NEXT);
+    CHECK_EQ(evalScore(&state, &tables, ai), -EVAL_WIN_NEXT);
+
+    // An open three for O with X to move and no four: not yet decisive for
+    // X, but a win soon for O once it's O's turn.
+    boardInit(&board, &geometry);
+    evalInit(&state, &tables, &board);
+    playRow(&board, &state, &tables, 2, 1, 3, ai);
+    playRow(&board, &state, &tables, 0, 0, 1, human);
+    playRow(&board, &state, &tables, 4, 4, 5, human);
+    CHECK_EQ(evalScore(&state, &tables, ai), EVAL_WIN_SOON);
+    CHECK(evalScore(&state, &tables, human) > -EVAL_WIN_SOON);
+}
+
+int main(void)
+{
+    testIncremental();
+    testThreats();
+    return checkExit("test_eval");
+}
@@ -0,0 +1,177 @@
+#include <stdbool.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+
+#include "event_queue.h"
+#include "check.h"
+
+// The event queue: FIFO order, EventDrop and EventCoalesce on a full queue,
+// and a producer on core 1 (a thread) against a consumer on core 0.
+
+static Event moveEvent(uint8_t move, uint32_t timeUs)
+{
+    Event event = {.type = EventMove, .arg = move, .count = 1, .timeUs = timeUs};
+    return event;
+}
+
+static void fill(EventQueue *queue)
+{
+    for (int i = 0; i < EVENT_QUEUE_LEN; i++)
+    {
+        Event event = moveEvent(0, i);
+        CHECK(eventQueuePush(queue, &event, EventDrop));
+    }
+}
+
+static void testOrder(void)
+{
+    EventQueue queue;
+    Event event;
+
+    eventQueueInit(&queue);
+    CHECK(eventQueueEmpty(&queue));
+    CHECK(!eventQueuePop(&queue, &event));
+
+    // Several laps of the ring, half full at a time.
+    uint32_t pushed = 0, popped = 0;
+    for (int lap = 0; lap < 5; lap++)
+    {
+        for (int i = 0; i < EVENT_QUEUE_LEN / 2; i++)
+        {
+            Event in = moveEvent(pushed % 4, pushed);
+            CHECK(eventQueuePush(&queue, &in, EventDrop));
+            pushed++;
+        }
+        while (eventQueuePop(&queue, &event))
+        {
+            CHECK_EQ(event.timeUs, popped);
+            CHECK_EQ(event.arg, popped % 4);
+            popped++;
+        }
+    }
+    CHECK_EQ(popped, pushed);
+    CHECK(eventQueueEmpty(&queue));
+}
+
+static void testDrop(void)
+{
+    EventQueue queue;
+    Event event;
+
+    eventQueueInit(&queue);
+    fill(&queue);
+    Event extra = moveEvent(1, 1000);
+    CHECK(!eventQueuePush(&queue, &extra, EventDrop));
+    CHECK(!eventQueuePush(&queue, &extra, EventDrop));
+    CHECK_EQ(queue.dropped, 2);
+
+    // The queued events are untouched, and room is made by popping.
+    for (int i = 0; i < EVENT_QUEUE_LEN; i++)
+    {
+        CHECK(eventQueuePop(&queue, &event));
+        CHECK_EQ(event.timeUs, i);
+    }
+    CHECK(!eventQueuePop(&queue, &event));
+    CHECK(eventQueuePush(&queue, &extra, EventDrop));
+    CHECK(eventQueuePop(&queue, &event));
+    CHECK_EQ(event.timeUs, 1000);
+}
+
+static void testCoalesce(void)
+{
+    EventQueue queue;
+    Event event;
+
+    eventQueueInit(&queue);
+    fill(&queue);
+
+    // Repeats of one event merge in the parked slot, keeping the latest time.
+    for (int i = 0; i < 3; i++)
+    {
+        Event repeat = moveEvent(2, 100 + i);
+        CHECK(eventQueuePush(&queue, &repeat, EventCoalesce));
+    }
+    CHECK(queue.hasPending);
+    CHECK_EQ(queue.pending.count, 3);
+    CHECK_EQ(queue.pending.timeUs, 102);
+    CHECK_EQ(queue.coalesced, 2);
+    CHECK_EQ(queue.dropped, 0);
+
+    // Still full, so the slot can't be flushed yet.
+    CHECK(!eventQueueFlush(&queue));
+
+    // A different event replaces the parked one, which counts as dropped.
+    Event other = moveEvent(3, 200);
+    CHECK(eventQueuePush(&queue, &other, EventCoalesce));
+    CHECK_EQ(queue.pending.arg, 3);
+    CHECK_EQ(queue.pending.count, 1);
+    CHECK_EQ(queue.dropped, 1);
+
+    // Once there is room the parked event goes ahead of a new one.
+    CHECK(eventQueuePop(&queue, &event));
+    CHECK(eventQueuePop(&queue, &event));
+    Event next = moveEvent(1, 300);
+    CHECK(eventQueuePush(&queue, &next, EventCoalesce));
+    CHECK(!queue.hasPending);
+    for (int i = 2; i < EVENT_QUEUE_LEN; i++)
+    {
+        CHECK(eventQueuePop(&queue, &event));
+        CHECK_EQ(event.timeUs, i);
+    }
+    CHECK(eventQueuePop(&queue, &event));
+    CHECK_EQ(event.arg, 3);
+    CHECK_EQ(event.timeUs, 200);
+    CHECK(eventQueuePop(&queue, &event));
+    CHECK_EQ(event.timeUs, 300);
+    CHECK(eventQueueEmpty(&queue));
+}
+
+#define CROSS_CORE_EVENTS 20000
+
+static EventQueue crossQueue;
+
+// Pushes every number in turn, waiting whenever the ring is full. Popping
+// doesn't SEV, so the wait is WFE's timeout.
+static void producerEntry(void)
+{
+    for (uint32_t i = 0; i < CROSS_CORE_EVENTS; i++)
+    {
+        Event event = moveEvent(i & 3, i);
+        while (!eventQueuePush(&crossQueue, &event, EventDrop))
+            __wfe();
+    }
+}
+
+static void testCrossCore(void)
+{
+    Event event;
+    uint32_t expected = 0;
+    bool inOrder = true;
+
+    eventQueueInit(&crossQueue);
+    multicore_launch_core1(producerEntry);
+    while (expected < CROSS_CORE_EVENTS)
+    {
+        if (!eventQueuePop(&crossQueue, &event))
+        {
+            __wfe(); // each push SEVs
+            continue;
+        }
+        if (event.timeUs != expected || event.arg != (expected & 3))
+            inOrder = false;
+        expected++;
+    }
+    CHECK(inOrder);
+    CHECK_EQ(expected, CROSS_CORE_EVENTS);
+}
+
+int main(void)
+{
+    testOrder();
+    testDrop();
+    testCoalesce();
+    testCrossCore();
+    return checkExit("test_event_queue");
+}
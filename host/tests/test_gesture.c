@@ -0,0 +1,220 @@
+#include "gesture.h"
+#include "check.h"
+
+// Tilt gestures from synthetic accelerometer streams at the IMU's 125 Hz: a
+// tilt is one move, an axis re-arms only through its neutral zone, a held
+// tilt repeats after the delay and then at the interval, and a diagonal tilt
+// moves on one axis only.
+
+#define SAMPLE_US 8000
+#define MAX_MOVES 32
+
+typedef struct
+{
+  uint32_t timeUs; // of the next sample
+  int count;
+  Move moves[MAX_MOVES];
+  uint32_t movesUs[MAX_MOVES];
+} Stream;
+
+// Feeds (x, y) for durationUs, recording the moves it makes.
+static void hold(Gesture *gesture, Stream *stream, float x, float y, uint32_t durationUs)
+{
+    for (uint32_t t = 0; t < durationUs; t += SAMPLE_US)
+    {
+        Move move;
+        if (gestureUpdate(gesture, x, y, stream->timeUs, &move) && stream->count < MAX_MOVES)
+        {
+            stream->moves[stream->count] = move;
+            stream->movesUs[stream->count] = stream->timeUs;
+            stream->count++;
+        }
+        stream->timeUs += SAMPLE_US;
+    }
+}
+
+// The default thresholds without filtering, so each sample acts at once.
+static GestureConfig unfiltered(void)
+{
+    GestureConfig config = gestureDefaultConfig;
+    config.smoothing = 1;
+    return config;
+}
+
+static void testDirections(void)
+{
+    const GestureConfig config = unfiltered();
+    const float tilts[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    const Move expected[4] = {Left, Right, Up, Down};
+
+    for (int i = 0; i < 4; i++)
+    {
+        Gesture gesture;
+        Stream stream = {0};
+        gestureInit(&gesture, &config);
+        hold(&gesture, &stream, tilts[i][0], tilts[i][1], 100000);
+        CHECK_EQ(stream.count, 1);
+        CHECK_EQ(stream.moves[0], expected[i]);
+    }
+}
+
+// With the default filter: a short tilt is one move, a little late, and
+// returning to level and tilting again is another.
+static void testSingleMove(void)
+{
+    Gesture gesture;
+    Stream stream = {0};
+
+    gestureInit(&gesture, &gestureDefaultConfig);
+    hold(&gesture, &stream, 0, 0, 100000);
+    CHECK_EQ(stream.count, 0);
+    hold(&gesture, &stream, 0.9f, 0, 400000);
+    CHECK_EQ(stream.count, 1);
+    CHECK_EQ(stream.moves[0], Left);
+    // The filter takes a few samples to pass the threshold, not many.
+    CHECK(stream.movesUs[0] > 100000 && stream.movesUs[0] <= 100000 + 5 * SAMPLE_US);
+
+    hold(&gesture, &stream, 0, 0, 200000);
+    CHECK_EQ(stream.count, 1);
+    hold(&gesture, &stream, 0.9f, 0, 200000);
+    CHECK_EQ(stream.count, 2);
+    CHECK_EQ(stream.moves[1], Left);
+}
+
+static void testHysteresis(void)
+{
+    const GestureConfig config = unfiltered();
+    Gesture gesture;
+    Stream stream = {0};
+
+    gestureInit(&gesture, &config);
+    hold(&gesture, &stream, 0.7f, 0, SAMPLE_US);
+    CHECK_EQ(stream.count, 1);
+
+    // Wobbling across the enter threshold but never under the exit one
+    // doesn't fire again.
+    for (int i = 0; i < 20; i++)
+    {
+        hold(&gesture, &stream, 0.35f, 0, SAMPLE_US);
+        hold(&gesture, &stream, 0.7f, 0, SAMPLE_US);
+    }
+    CHECK_EQ(stream.count, 1);
+
+    // Through the neutral zone re-arms it: once.
+    hold(&gesture, &stream, 0.25f, 0, SAMPLE_US);
+    hold(&gesture, &stream, 0.7f, 0, SAMPLE_US);
+    CHECK_EQ(stream.count, 2);
+
+    // Noise about the enter threshold from neutral is also one move.
+    hold(&gesture, &stream, 0, 0, SAMPLE_US);
+    for (int i = 0; i < 20; i++)
+    {
+        hold(&gesture, &stream, 0.59f, 0, SAMPLE_US);
+        hold(&gesture, &stream, 0.61f, 0, SAMPLE_US);
+    }
+    CHECK_EQ(stream.count, 3);
+
+    // Straight through to the other side is a move that way, without one
+    // for passing back through neutral.
+    hold(&gesture, &stream, -0.7f, 0, SAMPLE_US);
+    CHECK_EQ(stream.count, 3); // released on this sample
+    hold(&gesture, &stream, -0.7f, 0, SAMPLE_US);
+    CHECK_EQ(stream.count, 4);
+    CHECK_EQ(stream.moves[3], Right);
+}
+
+// Moves at startUs, the delay after it, and every interval after that.
+static void checkRepeats(const Stream *stream, uint32_t startUs, const GestureConfig *config,
+                         int expectedCount)
+{
+    if (!CHECK_EQ(stream->count, expectedCount))
+        return;
+    uint32_t dueUs = startUs;
+    for (int i = 0; i < stream->count; i++)
+    {
+        CHECK_EQ(stream->moves[i], Left);
+        // Each falls on the first sample at or after its time.
+        CHECK(stream->movesUs[i] - dueUs < SAMPLE_US);
+        dueUs = stream->movesUs[i] + (i == 0 ? config->repeatDelayUs : config->repeatIntervalUs);
+    }
+}
+
+static void testAutoRepeat(void)
+{
+    GestureConfig config = unfiltered();
+    Gesture gesture;
+    Stream stream = {0};
+
+    // 2 s: the first move, then at 500, 850, 1200, 1550 and 1900 ms.
+    gestureInit(&gesture, &config);
+    hold(&gesture, &stream, 1, 0, 2000000);
+    checkRepeats(&stream, 0, &config, 6);
+
+    // Just short of the delay, nothing repeats.
+    gestureInit(&gesture, &config);
+    stream = (Stream){0};
+    hold(&gesture, &stream, 1, 0, config.repeatDelayUs - SAMPLE_US);
+    CHECK_EQ(stream.count, 1);
+
+    // Releasing restarts the delay.
+    hold(&gesture, &stream, 0, 0, SAMPLE_US);
+    uint32_t startUs = stream.timeUs;
+    hold(&gesture, &stream, 1, 0, config.repeatDelayUs + SAMPLE_US);
+    CHECK_EQ(stream.count, 3);
+    CHECK_EQ(stream.movesUs[1], startUs);
+    CHECK(stream.movesUs[2] - startUs >= config.repeatDelayUs);
+
+    // Over the 32-bit microsecond wrap.
+    gestureInit(&gesture, &config);
+    stream = (Stream){.timeUs = UINT32_MAX - 300000};
+    startUs = stream.timeUs;
+    hold(&gesture, &stream, 1, 0, 2000000);
+    checkRepeats(&stream, startUs, &config, 6);
+
+    // A zero delay turns repeating off.
+    config.repeatDelayUs = 0;
+    gestureInit(&gesture, &config);
+    stream = (Stream){0};
+    hold(&gesture, &stream, 1, 0, 2000000);
+    CHECK_EQ(stream.count, 1);
+}
+
+static void testDiagonal(void)
+{
+    const GestureConfig config = unfiltered();
+    Gesture gesture;
+    Stream stream = {0};
+
+    // Both axes past their thresholds at once: x wins, and only x repeats.
+    gestureInit(&gesture, &config);
+    hold(&gesture, &stream, 0.8f, -0.8f, 1000000);
+    CHECK_EQ(stream.count, 3);
+    for (int i = 0; i < stream.count; i++)
+        CHECK_EQ(stream.moves[i], Left);
+
+    // y tilting past its threshold while x is held adds nothing.
+    gestureInit(&gesture, &config);
+    stream = (Stream){0};
+    hold(&gesture, &stream, 0.8f, 0, 100000);
+    hold(&gesture, &stream, 0.8f, 0.8f, 100000);
+    CHECK_EQ(stream.count, 1);
+
+    // Through the filter, a diagonal tilt from level is one move, on y,
+    // whose lower threshold the rising tilt passes first.
+    gestureInit(&gesture, &gestureDefaultConfig);
+    stream = (Stream){0};
+    hold(&gesture, &stream, 0, 0, 100000);
+    hold(&gesture, &stream, -0.7f, 0.7f, 300000);
+    CHECK_EQ(stream.count, 1);
+    CHECK_EQ(stream.moves[0], Up);
+}
+
+int main(void)
+{
+    testDirections();
+    testSingleMove();
+    testHysteresis();
+    testAutoRepeat();
+    testDiagonal();
+    return checkExit("test_gesture");
+}
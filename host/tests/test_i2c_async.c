@@ -0,0 +1,219 @@
+#include <string.h>
+
+#include "i2c_async.h"
+#include "i2c_async_mock.h"
+#include "check.h"
+
+// The async I2C queue against the mock port: transactions complete in the
+// order they were submitted, a NACK ends in I2C_ASYNC_ERROR without stalling
+// the queue, a full queue refuses submissions, and a completion callback may
+// submit again.
+
+#define DEVICE_ADDR 0x68
+#define ABSENT_ADDR 0x50
+
+static uint8_t su8Regs[256];
+
+typedef struct {
+  uint8_t            au8Write[2];
+  uint8_t            u8Read;
+  I2C_ASYNC_ST_TXN   stTxn;
+} TEST_ST_WRITE_READ;
+
+static uint8_t             su8Order[2 * I2C_ASYNC_QUEUE_LEN];
+static uint8_t             su8OrderLen;
+static I2C_ASYNC_EN_STATUS senLastStatus;
+
+static void recordDone(I2C_ASYNC_ST_TXN *pstTxn) {
+  su8Order[su8OrderLen++] = (uint8_t)(uintptr_t)pstTxn->pvContext;
+  senLastStatus           = pstTxn->enStatus;
+}
+
+static void reset(void) {
+  memset(su8Regs, 0, sizeof(su8Regs));
+  mockI2cAsyncReset();
+  mockI2cAsyncAddDevice(DEVICE_ADDR, su8Regs);
+  i2cAsyncInit();
+  su8OrderLen = 0;
+}
+
+// Writes value to register reg; the read phase has no register pointer of its
+// own, so it returns the register after.
+static void setUpWrite(TEST_ST_WRITE_READ *pstTest, uint8_t u8Addr, uint8_t u8Reg,
+                       uint8_t u8Value, uint8_t u8Id) {
+  memset(pstTest, 0, sizeof(*pstTest));
+  pstTest->au8Write[0]      = u8Reg;
+  pstTest->au8Write[1]      = u8Value;
+  pstTest->stTxn.u8Addr     = u8Addr;
+  pstTest->stTxn.pu8Write   = pstTest->au8Write;
+  pstTest->stTxn.u8WriteLen = 2;
+  pstTest->stTxn.pu8Read    = &pstTest->u8Read;
+  pstTest->stTxn.u8ReadLen  = 1;
+  pstTest->stTxn.pfnDone    = recordDone;
+  pstTest->stTxn.pvContext  = (void *)(uintptr_t)u8Id;
+}
+
+static void testEncode(void) {
+  uint8_t          au8Write[2] = { 0x10, 0x20 };
+  uint8_t          au8Read[3];
+  uint32_t         au32Cmds[2 * I2C_ASYNC_MAX_LEN];
+  I2C_ASYNC_ST_TXN stTxn = { .u8Addr = DEVICE_ADDR, .pu8Write = au8Write, .u8WriteLen = 2,
+                             .pu8Read = au8Read, .u8ReadLen = 3 };
+
+  CHECK_EQ(i2cAsyncEncode(&stTxn, au32Cmds), 5);
+  CHECK_EQ(au32Cmds[0], 0x10);
+  CHECK_EQ(au32Cmds[1], 0x20);
+  CHECK_EQ(au32Cmds[2], I2C_ASYNC_CMD_READ | I2C_ASYNC_CMD_RESTART);
+  CHECK_EQ(au32Cmds[3], I2C_ASYNC_CMD_READ);
+  CHECK_EQ(au32Cmds[4], I2C_ASYNC_CMD_READ | I2C_ASYNC_CMD_STOP);
+
+  stTxn.u8ReadLen = 0;
+  CHECK_EQ(i2cAsyncEncode(&stTxn, au32Cmds), 2);
+  CHECK_EQ(au32Cmds[1], 0x20 | I2C_ASYNC_CMD_STOP);
+}
+
+static void testCompletionOrder(void) {
+  TEST_ST_WRITE_READ astTests[5];
+
+  reset();
+  su8Regs[11] = 0xA1;
+  su8Regs[12] = 0xA2;
+  for (uint8_t i = 0; i < 5; i++) {
+    setUpWrite(&astTests[i], DEVICE_ADDR, 10 + i, 0x30 + i, i);
+    CHECK(i2cAsyncSubmit(&astTests[i].stTxn));
+  }
+  CHECK_EQ(astTests[0].stTxn.enStatus, I2C_ASYNC_BUSY);
+  for (uint8_t i = 1; i < 5; i++) {
+    CHECK_EQ(astTests[i].stTxn.enStatus, I2C_ASYNC_QUEUED);
+  }
+
+  // One completion at a time, each starting the next.
+  for (uint8_t i = 0; i < 5; i++) {
+    CHECK(mockI2cAsyncStep());
+    CHECK_EQ(astTests[i].stTxn.enStatus, I2C_ASYNC_DONE);
+    CHECK(i2cAsyncIsDone(&astTests[i].stTxn));
+    if (i + 1 < 5) {
+      CHECK_EQ(astTests[i + 1].stTxn.enStatus, I2C_ASYNC_BUSY);
+    }
+  }
+  CHECK(!mockI2cAsyncStep());
+  CHECK(i2cAsyncIdle());
+  CHECK_EQ(su8OrderLen, 5);
+  for (uint8_t i = 0; i < 5; i++) {
+    CHECK_EQ(su8Order[i], i);
+    CHECK_EQ(su8Regs[10 + i], 0x30 + i);
+  }
+  // Each read ran before the next transaction's write reached its register.
+  CHECK_EQ(astTests[0].u8Read, 0xA1);
+  CHECK_EQ(astTests[1].u8Read, 0xA2);
+}
+
+static void testNack(void) {
+  TEST_ST_WRITE_READ stAbsent, stPresent;
+
+  reset();
+  setUpWrite(&stAbsent, ABSENT_ADDR, 1, 0x55, 0);
+  setUpWrite(&stPresent, DEVICE_ADDR, 1, 0x66, 1);
+  CHECK(i2cAsyncSubmit(&stAbsent.stTxn));
+  CHECK(i2cAsyncSubmit(&stPresent.stTxn));
+
+  CHECK_EQ(i2cAsyncWait(&stAbsent.stTxn), I2C_ASYNC_ERROR);
+  CHECK(i2cAsyncIsDone(&stAbsent.stTxn));
+  CHECK_EQ(senLastStatus, I2C_ASYNC_ERROR);
+  CHECK_EQ(stPresent.stTxn.enStatus, I2C_ASYNC_BUSY);
+
+  // The queue carries on past the error.
+  CHECK_EQ(i2cAsyncWait(&stPresent.stTxn), I2C_ASYNC_DONE);
+  CHECK_EQ(su8Regs[1], 0x66);
+  CHECK_EQ(su8OrderLen, 2);
+  CHECK_EQ(mockI2cAsyncCompleted(), 2);
+}
+
+static void testFullQueue(void) {
+  TEST_ST_WRITE_READ astTests[I2C_ASYNC_QUEUE_LEN + 2];
+  TEST_ST_WRITE_READ stExtra;
+
+  reset();
+  // One in flight plus a full queue behind it.
+  for (uint8_t i = 0; i < I2C_ASYNC_QUEUE_LEN + 1; i++) {
+    setUpWrite(&astTests[i], DEVICE_ADDR, i, i, i);
+    CHECK(i2cAsyncSubmit(&astTests[i].stTxn));
+  }
+  setUpWrite(&stExtra, DEVICE_ADDR, 100, 1, 100);
+  CHECK(!i2cAsyncSubmit(&stExtra.stTxn));
+  CHECK_EQ(stExtra.stTxn.enStatus, I2C_ASYNC_IDLE);
+
+  // A completion makes room.
+  CHECK(mockI2cAsyncStep());
+  CHECK(i2cAsyncSubmit(&stExtra.stTxn));
+  CHECK_EQ(stExtra.stTxn.enStatus, I2C_ASYNC_QUEUED);
+  i2cAsyncFlush();
+  CHECK_EQ(su8OrderLen, I2C_ASYNC_QUEUE_LEN + 2);
+  CHECK_EQ(su8Order[I2C_ASYNC_QUEUE_LEN + 1], 100);
+  CHECK_EQ(su8Regs[100], 1);
+
+  // Empty and oversized transactions are refused outright.
+  stExtra.stTxn.u8WriteLen = 0;
+  stExtra.stTxn.u8ReadLen  = 0;
+  CHECK(!i2cAsyncSubmit(&stExtra.stTxn));
+  stExtra.stTxn.u8ReadLen = I2C_ASYNC_MAX_LEN + 1;
+  CHECK(!i2cAsyncSubmit(&stExtra.stTxn));
+}
+
+#define RESUBMITS 5
+
+static uint8_t su8Resubmits;
+
+// Counts a register up by resubmitting itself, like a polling driver does.
+static void resubmitDone(I2C_ASYNC_ST_TXN *pstTxn) {
+  TEST_ST_WRITE_READ *pstTest = pstTxn->pvContext;
+
+  su8Order[su8OrderLen++] = 200 + su8Resubmits;
+  if (pstTxn->enStatus == I2C_ASYNC_DONE && ++su8Resubmits < RESUBMITS) {
+    pstTest->au8Write[1]++;
+    CHECK(i2cAsyncSubmit(pstTxn));
+  }
+}
+
+static void testResubmitFromCallback(void) {
+  TEST_ST_WRITE_READ stChain, stOther;
+
+  reset();
+  su8Resubmits = 0;
+  setUpWrite(&stChain, DEVICE_ADDR, 7, 1, 0);
+  stChain.stTxn.pfnDone   = resubmitDone;
+  stChain.stTxn.pvContext = &stChain;
+  setUpWrite(&stOther, DEVICE_ADDR, 8, 9, 1);
+
+  CHECK(i2cAsyncSubmit(&stChain.stTxn));
+  CHECK(i2cAsyncSubmit(&stOther.stTxn));
+
+  // The first resubmission queues behind the other transaction. After that
+  // the queue is empty, so each one starts on the spot.
+  CHECK(mockI2cAsyncStep());
+  CHECK_EQ(stChain.stTxn.enStatus, I2C_ASYNC_QUEUED);
+  CHECK_EQ(stOther.stTxn.enStatus, I2C_ASYNC_BUSY);
+  CHECK(mockI2cAsyncStep());
+  CHECK_EQ(stChain.stTxn.enStatus, I2C_ASYNC_BUSY);
+
+  i2cAsyncFlush();
+  CHECK(i2cAsyncIdle());
+  CHECK_EQ(su8Resubmits, RESUBMITS);
+  CHECK_EQ(stChain.stTxn.enStatus, I2C_ASYNC_DONE);
+  CHECK_EQ(su8Regs[7], RESUBMITS);
+  CHECK_EQ(su8Regs[8], 9);
+  CHECK_EQ(mockI2cAsyncCompleted(), RESUBMITS + 1);
+  CHECK_EQ(su8OrderLen, RESUBMITS + 1);
+  CHECK_EQ(su8Order[0], 200);
+  CHECK_EQ(su8Order[1], 1);
+  CHECK_EQ(su8Order[2], 201);
+}
+
+int main(void) {
+  testEncode();
+  testCompletionOrder();
+  testNack();
+  testFullQueue();
+  testResubmitFromCallback();
+  return checkExit("test_i2c_async");
+}
@@ -0,0 +1,187 @@
+#include <string.h>
+
+#include "constants.h"
+#include "logic.h"
+#include "check.h"
+
+// The game rules: winner(), playPos() and nextFreePos() on the GRID_SIZE grid
+// (built at 3x3 and at 4x4), and the search's Board on every supported size
+// and win length.
+
+static void clearGrid(GridPos grid[])
+{
+    memset(grid, 0, POSITIONS * sizeof(GridPos));
+}
+
+// A line of GRID_SIZE cells from (row, col) stepping by (dRow, dCol).
+static void fillLine(GridPos grid[], int row, int col, int dRow, int dCol, Player player)
+{
+    for (int i = 0; i < GRID_SIZE; i++)
+        grid[rowColToPos(row + i * dRow, col + i * dCol)].player = player;
+}
+
+static void testGridLines(void)
+{
+    GridPos grid[POSITIONS];
+    const Player players[] = {human, ai};
+
+    clearGrid(grid);
+    CHECK_EQ(winner(grid), empty);
+
+    for (int p = 0; p < 2; p++)
+    {
+        Player player = players[p];
+        for (int i = 0; i < GRID_SIZE; i++)
+        {
+            clearGrid(grid);
+            fillLine(grid, i, 0, 0, 1, player);
+            CHECK_EQ(winner(grid), player);
+            clearGrid(grid);
+            fillLine(grid, 0, i, 1, 0, player);
+            CHECK_EQ(winner(grid), player);
+        }
+        clearGrid(grid);
+        fillLine(grid, 0, 0, 1, 1, player);
+        CHECK_EQ(winner(grid), player);
+        clearGrid(grid);
+        fillLine(grid, 0, GRID_SIZE - 1, 1, -1, player);
+        CHECK_EQ(winner(grid), player);
+    }
+
+    // A line one short, or with one of the other player's pieces, isn't a win.
+    clearGrid(grid);
+    fillLine(grid, 0, 0, 0, 1, human);
+    grid[rowColToPos(0, GRID_SIZE - 1)].player = empty;
+    CHECK_EQ(winner(grid), empty);
+    grid[rowColToPos(0, GRID_SIZE - 1)].player = ai;
+    CHECK_EQ(winner(grid), empty);
+}
+
+static void testPlayPos(void)
+{
+    GridPos grid[POSITIONS];
+
+    clearGrid(grid);
+    CHECK(canPlayAtPos(0, grid));
+    CHECK(playPos(human, 0, grid));
+    CHECK_EQ(grid[0].player, human);
+    CHECK(!canPlayAtPos(0, grid));
+    CHECK(!playPos(ai, 0, grid));
+    CHECK_EQ(grid[0].player, human);
+
+    CHECK(playPos(ai, LAST_POSITION, grid));
+    CHECK_EQ(grid[LAST_POSITION].player, ai);
+    CHECK_EQ(rowColToPos(GRID_SIZE - 1, GRID_SIZE - 1), LAST_POSITION);
+    CHECK_EQ(rowColToPos(1, 0), GRID_SIZE);
+}
+
+static void testNextFreePos(void)
+{
+    GridPos grid[POSITIONS];
+
+    clearGrid(grid);
+    CHECK_EQ(nextFreePos(grid), 0);
+    for (int pos = 0; pos < POSITIONS; pos++)
+    {
+        CHECK_EQ(nextFreePos(grid), pos);
+        grid[pos].player = pos % 2 ? ai : human;
+    }
+    CHECK_EQ(nextFreePos(grid), -1);
+
+    // Gaps are found wherever they are.
+    grid[POSITIONS / 2].player = empty;
+    CHECK_EQ(nextFreePos(grid), POSITIONS / 2);
+    grid[1].player = empty;
+    CHECK_EQ(nextFreePos(grid), 1);
+}
+
+static uint32_t nextRandom(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// Random games on the grid, with the Board built from it after every move
+// agreeing with winner().
+static void testRandomGames(void)
+{
+    static BoardGeometry geometry;
+    uint32_t seed = 7;
+
+    CHECK(boardGeometryInit(&geometry, GRID_SIZE, GRID_SIZE));
+    for (int game = 0; game < 2000; game++)
+    {
+        GridPos grid[POSITIONS];
+        Player toMove = human;
+        Board board;
+
+        clearGrid(grid);
+        while (winner(grid) == empty && nextFreePos(grid) >= 0)
+        {
+            int pos = nextRandom(&seed) % POSITIONS;
+            if (!canPlayAtPos(pos, grid))
+                continue;
+            CHECK(playPos(toMove, pos, grid));
+            boardFromGrid(&board, &geometry, grid);
+            if (!CHECK_EQ(board.winner, winner(grid)))
+                return;
+            toMove = opponent(toMove);
+        }
+    }
+}
+
+// Every line of every supported geometry wins when, and only when, its last
+// cell is played, and undoing restores the board.
+static void testBoardGeometries(void)
+{
+    static BoardGeometry geometry;
+
+    CHECK(!boardGeometryInit(&geometry, BOARD_MAX_SIZE + 1, BOARD_MIN_WIN));
+    CHECK(!boardGeometryInit(&geometry, 3, 4));
+    CHECK(!boardGeometryInit(&geometry, 4, BOARD_MIN_WIN - 1));
+
+    for (int size = BOARD_MIN_WIN; size <= BOARD_MAX_SIZE; size++)
+    {
+        for (int winLength = BOARD_MIN_WIN; winLength <= size; winLength++)
+        {
+            int starts = size - winLength + 1;
+            CHECK(boardGeometryInit(&geometry, size, winLength));
+            CHECK_EQ(geometry.cells, size * size);
+            CHECK_EQ(geometry.lineCount, 2 * size * starts + 2 * starts * starts);
+
+            for (int line = 0; line < geometry.lineCount; line++)
+            {
+                Board board;
+                boardInit(&board, &geometry);
+                uint64_t emptyHash = board.hash;
+                for (int i = 0; i < winLength - 1; i++)
+                {
+                    boardPlay(&board, geometry.lines[line][i], ai);
+                    CHECK_EQ(board.winner, empty);
+                }
+                int last = geometry.lines[line][winLength - 1];
+                boardPlay(&board, last, ai);
+                CHECK_EQ(board.winner, ai);
+                CHECK_EQ(board.filled, winLength);
+                boardUndo(&board, last);
+                CHECK_EQ(board.winner, empty);
+                for (int i = winLength - 2; i >= 0; i--)
+                    boardUndo(&board, geometry.lines[line][i]);
+                CHECK_EQ(board.filled, 0);
+                CHECK(board.hash == emptyHash);
+            }
+        }
+    }
+}
+
+int main(void)
+{
+    testGridLines();
+    testPlayPos();
+    testNextFreePos();
+    testRandomGames();
+    testBoardGeometries();
+    return checkExit("test_logic");
+}
@@ -0,0 +1,128 @@
+#include "mcts.h"
+#include "check.h"
+
+// Monte Carlo tree search: random playouts on 3x3 end as often in each result
+// as the known odds say, the search takes a win and blocks a loss, and the
+// tree of the position reached is kept for the next call.
+
+#define PLAYOUTS 200000
+
+static void play(Board *board, int row, int col, Player player)
+{
+    boardPlay(board, row * board->geometry->size + col, player);
+}
+
+// Uniformly random play from the empty 3x3 board: X wins 58.49% of games, O
+// 28.81% and 12.70% are drawn.
+static void testPlayoutOdds(void)
+{
+    static BoardGeometry geometry;
+    Board board;
+    uint32_t seed = 3;
+    uint32_t results[3] = {0, 0, 0};
+
+    CHECK(boardGeometryInit(&geometry, 3, 3));
+    boardInit(&board, &geometry);
+    mctsReset();
+    for (int i = 0; i < PLAYOUTS; i++)
+        results[mctsPlayout(&board, human, &seed)]++;
+    CHECK(results[human] > 0.575 * PLAYOUTS && results[human] < 0.595 * PLAYOUTS);
+    CHECK(results[ai] > 0.278 * PLAYOUTS && results[ai] < 0.298 * PLAYOUTS);
+    CHECK(results[empty] > 0.117 * PLAYOUTS && results[empty] < 0.137 * PLAYOUTS);
+
+    // A won board is its own result, and a board one move from full has only
+    // one way to go.
+    play(&board, 0, 0, human);
+    play(&board, 0, 1, human);
+    play(&board, 0, 2, human);
+    CHECK_EQ(mctsPlayout(&board, ai, &seed), human);
+
+    //   X O X
+    //   X O O
+    //   O X .   X to move draws at (2,2).
+    static const int cells[] = {human, ai, human, human, ai, ai, ai, human, empty};
+    boardInit(&board, &geometry);
+    for (int pos = 0; pos < 9; pos++)
+    {
+        if (cells[pos] != empty)
+            boardPlay(&board, pos, cells[pos]);
+    }
+    for (int i = 0; i < 10; i++)
+        CHECK_EQ(mctsPlayout(&board, human, &seed), empty);
+}
+
+static void testTactics(void)
+{
+    static BoardGeometry geometry;
+    Board board;
+    MctsResult result;
+
+    CHECK(boardGeometryInit(&geometry, 4, 3));
+    mctsReset();
+
+    // O to move wins at once at (1,2), without searching.
+    boardInit(&board, &geometry);
+    play(&board, 0, 0, human);
+    play(&board, 1, 0, ai);
+    play(&board, 0, 3, human);
+    play(&board, 1, 1, ai);
+    play(&board, 3, 3, human);
+    CHECK_EQ(mctsBestMove(&board, ai, 0, 5000, &result), 6);
+    CHECK_EQ(result.iterations, 0);
+    CHECK(result.score == 1);
+
+    // X threatens (0,2), and any other move of O's loses at once.
+    boardInit(&board, &geometry);
+    play(&board, 0, 0, human);
+    play(&board, 1, 0, ai);
+    play(&board, 0, 1, human);
+    play(&board, 1, 3, ai);
+    play(&board, 0, 3, human);
+    CHECK_EQ(mctsBestMove(&board, ai, 0, 20000, &result), 2);
+    CHECK_EQ(result.iterations, 20000);
+    CHECK(result.nodes > 1 && result.nodes <= MCTS_POOL_NODES);
+
+    // Nothing to play on a won board.
+    play(&board, 0, 2, human);
+    CHECK_EQ(board.winner, human);
+    CHECK_EQ(mctsBestMove(&board, ai, 0, 100, &result), -1);
+    CHECK_EQ(result.move, -1);
+}
+
+// The second search of a game starts from the subtree of the first one's
+// move and the reply to it.
+static void testReuse(void)
+{
+    static BoardGeometry geometry;
+    Board board;
+    MctsResult first, second;
+
+    CHECK(boardGeometryInit(&geometry, 4, 4));
+    mctsReset();
+    boardInit(&board, &geometry);
+    play(&board, 1, 1, human);
+    int move = mctsBestMove(&board, ai, 0, 4000, &first);
+    if (!CHECK(move >= 0))
+        return;
+    CHECK_EQ(first.reused, 0);
+    boardPlay(&board, move, ai);
+
+    int reply = move == 0 ? 15 : 0;
+    boardPlay(&board, reply, human);
+    CHECK(mctsBestMove(&board, ai, 0, 4000, &second) >= 0);
+    CHECK(second.reused > 0);
+    CHECK(second.reused < first.nodes);
+
+    // After a reset nothing is kept.
+    mctsReset();
+    CHECK(mctsBestMove(&board, ai, 0, 100, &second) >= 0);
+    CHECK_EQ(second.reused, 0);
+}
+
+int main(void)
+{
+    testPlayoutOdds();
+    testTactics();
+    testReuse();
+    return checkExit("test_mcts");
+}
@@ -0,0 +1,179 @@
+#include <stdbool.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+
+#include "scheduler.h"
+#include "check.h"
+
+// The scheduler on the pthread HAL: periodic and one-shot timers, signalled
+// tasks, taskStop(), and a signal from core 1 (a thread) waking core 0.
+
+#define MAX_RUNS 64
+
+typedef struct
+{
+  uint32_t runs;
+  uint64_t runUs[MAX_RUNS];
+  Task *signalDuringRun; // signalled by the task itself on its first run
+} Recorder;
+
+static void recordRun(void *context)
+{
+    Recorder *recorder = context;
+    if (recorder->runs < MAX_RUNS)
+        recorder->runUs[recorder->runs] = time_us_64();
+    if (recorder->runs == 0 && recorder->signalDuringRun)
+        taskSignal(recorder->signalDuringRun);
+    recorder->runs++;
+}
+
+// schedulerRun()'s loop, but only for a while.
+static void runFor(Scheduler *scheduler, uint32_t us)
+{
+    uint64_t end = time_us_64() + us;
+    uint64_t now;
+    while ((now = time_us_64()) < end)
+    {
+        uint64_t next = schedulerRunReady(scheduler);
+        if (next > end)
+            next = end;
+        if (next > now)
+            best_effort_wfe_or_timeout(from_us_since_boot(next));
+    }
+}
+
+static void testPeriodic(void)
+{
+    Scheduler scheduler;
+    Task task;
+    Recorder recorder = {0};
+    const uint32_t periodUs = 5000;
+
+    schedulerInit(&scheduler);
+    CHECK(schedulerAdd(&scheduler, &task, "periodic", recordRun, &recorder));
+    // Event-driven until a timer is started.
+    CHECK_EQ(schedulerRunReady(&scheduler), SCHEDULER_NEVER);
+    CHECK_EQ(recorder.runs, 0);
+
+    uint64_t start = time_us_64();
+    taskStartPeriodic(&task, periodUs);
+    runFor(&scheduler, 20 * periodUs + periodUs / 2);
+
+    // The first run is immediate and no run comes before its time. A slow
+    // host may skip some, but not most.
+    CHECK(recorder.runs >= 10 && recorder.runs <= 21);
+    CHECK(recorder.runUs[0] - start < periodUs);
+    for (uint32_t i = 1; i < recorder.runs && i < MAX_RUNS; i++)
+        CHECK(recorder.runUs[i] >= start + i * periodUs);
+    CHECK_EQ(task.runs, recorder.runs);
+
+    taskStop(&task);
+    uint32_t runs = recorder.runs;
+    runFor(&scheduler, 3 * periodUs);
+    CHECK_EQ(recorder.runs, runs);
+}
+
+static void testOneShot(void)
+{
+    Scheduler scheduler;
+    Task task;
+    Recorder recorder = {0};
+
+    schedulerInit(&scheduler);
+    schedulerAdd(&scheduler, &task, "one-shot", recordRun, &recorder);
+    uint64_t start = time_us_64();
+    taskStartOneShot(&task, 10000);
+    CHECK(schedulerRunReady(&scheduler) >= start + 10000);
+    CHECK_EQ(recorder.runs, 0);
+    runFor(&scheduler, 30000);
+    CHECK_EQ(recorder.runs, 1);
+    CHECK(recorder.runUs[0] >= start + 10000);
+    CHECK_EQ(task.dueUs, SCHEDULER_NEVER);
+}
+
+static void testSignal(void)
+{
+    Scheduler scheduler;
+    Task first, second;
+    Recorder firstRecorder = {0}, secondRecorder = {0};
+
+    schedulerInit(&scheduler);
+    schedulerAdd(&scheduler, &first, "first", recordRun, &firstRecorder);
+    schedulerAdd(&scheduler, &second, "second", recordRun, &secondRecorder);
+
+    taskSignal(&second);
+    CHECK_EQ(schedulerRunReady(&scheduler), SCHEDULER_NEVER);
+    CHECK_EQ(firstRecorder.runs, 0);
+    CHECK_EQ(secondRecorder.runs, 1);
+
+    // Signals don't queue up: two before a pass are one run.
+    taskSignal(&first);
+    taskSignal(&first);
+    schedulerRunReady(&scheduler);
+    CHECK_EQ(firstRecorder.runs, 1);
+    CHECK_EQ(secondRecorder.runs, 1);
+
+    // A signal raised while a task runs is kept, and the pass asks to be
+    // called again straight away.
+    firstRecorder.signalDuringRun = &first;
+    firstRecorder.runs = 0;
+    taskSignal(&first);
+    CHECK_EQ(schedulerRunReady(&scheduler), 0);
+    CHECK_EQ(schedulerRunReady(&scheduler), SCHEDULER_NEVER);
+    CHECK_EQ(firstRecorder.runs, 2);
+
+    // A stopped task ignores signals.
+    taskStop(&second);
+    taskSignal(&second);
+    CHECK_EQ(schedulerRunReady(&scheduler), SCHEDULER_NEVER);
+    CHECK_EQ(secondRecorder.runs, 1);
+}
+
+#define CORE1_SIGNALS 20
+
+static Task wokenTask;
+static volatile uint32_t signalsSent;
+static volatile uint64_t lastSignalUs;
+
+static void signallerEntry(void)
+{
+    for (int i = 0; i < CORE1_SIGNALS; i++)
+    {
+        sleep_ms(2);
+        lastSignalUs = time_us_64();
+        signalsSent++;
+        taskSignal(&wokenTask);
+    }
+}
+
+// Core 0 sleeps with nothing due; each signal from core 1 must wake it.
+static void testCrossCoreSignal(void)
+{
+    Scheduler scheduler;
+    Recorder recorder = {0};
+
+    schedulerInit(&scheduler);
+    schedulerAdd(&scheduler, &wokenTask, "woken", recordRun, &recorder);
+    multicore_launch_core1(signallerEntry);
+
+    uint64_t deadline = time_us_64() + 2000000;
+    while (signalsSent < CORE1_SIGNALS && time_us_64() < deadline)
+        runFor(&scheduler, 1000);
+    runFor(&scheduler, 5000);
+
+    CHECK_EQ(signalsSent, CORE1_SIGNALS);
+    CHECK(recorder.runs >= 1 && recorder.runs <= CORE1_SIGNALS);
+    CHECK(recorder.runs >= 1 && recorder.runUs[recorder.runs - 1] >= lastSignalUs);
+    CHECK(!wokenTask.signalled);
+}
+
+int main(void)
+{
+    testPeriodic();
+    testOneShot();
+    testSignal();
+    testCrossCoreSignal();
+    return checkExit("test_scheduler");
+}
@@ -0,0 +1,127 @@
+#include <stdbool.h>
+
+#include "pico/stdlib.h"
+#include "hardware/spi.h"
+
+#include "DEV_Config.h"
+#include "st7735.h"
+#include "st7735_sim.h"
+#include "check.h"
+
+// The ST7735 model that the host tools draw through: the driver's fills and
+// images land inside the CASET/RASET window, RAMWR data wraps row by row and
+// stops at the window's end, and nothing is taken while chip select is high.
+
+static void sendCommand(uint8_t command)
+{
+    gpio_put(EPD_DC_PIN, 0);
+    spi_write_blocking(SPI_PORT, &command, 1);
+}
+
+static void sendData(const uint8_t *data, size_t len)
+{
+    gpio_put(EPD_DC_PIN, 1);
+    spi_write_blocking(SPI_PORT, data, len);
+}
+
+static void sendWindow(int x0, int y0, int x1, int y1)
+{
+    uint8_t columns[] = {0, x0 + ST7735_XSTART, 0, x1 + ST7735_XSTART};
+    uint8_t rows[] = {0, y0 + ST7735_YSTART, 0, y1 + ST7735_YSTART};
+    sendCommand(ST7735_CASET);
+    sendData(columns, sizeof(columns));
+    sendCommand(ST7735_RASET);
+    sendData(rows, sizeof(rows));
+}
+
+static void testDriver(void)
+{
+    ST7735_FillScreen(ST7735_BLACK);
+    CHECK_EQ(st7735SimStats()->pixels, ST7735_WIDTH * ST7735_HEIGHT);
+    CHECK_EQ(st7735SimPixel(0, 0), ST7735_BLACK);
+    CHECK_EQ(st7735SimPixel(ST7735_WIDTH - 1, ST7735_HEIGHT - 1), ST7735_BLACK);
+
+    ST7735_FillRectangle(10, 20, 5, 3, ST7735_RED);
+    for (int y = 20; y < 23; y++)
+    {
+        for (int x = 10; x < 15; x++)
+            CHECK_EQ(st7735SimPixel(x, y), ST7735_RED);
+    }
+    CHECK_EQ(st7735SimPixel(9, 20), ST7735_BLACK);
+    CHECK_EQ(st7735SimPixel(15, 20), ST7735_BLACK);
+    CHECK_EQ(st7735SimPixel(10, 19), ST7735_BLACK);
+    CHECK_EQ(st7735SimPixel(10, 23), ST7735_BLACK);
+
+    // Big-endian RGB565, filled left to right and then down.
+    const uint16_t colours[6] = {0x0001, 0x0102, 0x0203, 0x0304, 0x0405, 0x0506};
+    uint8_t image[sizeof(colours)];
+    for (int i = 0; i < 6; i++)
+    {
+        image[2 * i] = colours[i] >> 8;
+        image[2 * i + 1] = colours[i] & 0xFF;
+    }
+    ST7735_DrawImage(30, 40, 3, 2, image);
+    for (int i = 0; i < 6; i++)
+        CHECK_EQ(st7735SimPixel(30 + i % 3, 40 + i / 3), colours[i]);
+    CHECK_EQ(st7735SimPixel(33, 40), ST7735_BLACK);
+
+    // Clipped at the bottom right corner.
+    uint32_t pixels = st7735SimStats()->pixels;
+    ST7735_FillRectangle(ST7735_WIDTH - 2, ST7735_HEIGHT - 2, 10, 10, ST7735_GREEN);
+    CHECK_EQ(st7735SimStats()->pixels - pixels, 4);
+    CHECK_EQ(st7735SimPixel(ST7735_WIDTH - 1, ST7735_HEIGHT - 1), ST7735_GREEN);
+    CHECK_EQ(st7735SimPixel(ST7735_WIDTH - 3, ST7735_HEIGHT - 1), ST7735_BLACK);
+
+    ST7735_DrawPixel(0, 0, ST7735_BLUE);
+    CHECK_EQ(st7735SimPixel(0, 0), ST7735_BLUE);
+    CHECK_EQ(st7735SimPixel(1, 0), ST7735_BLACK);
+    CHECK_EQ(st7735SimPixel(0, 1), ST7735_BLACK);
+}
+
+static void testRawWindow(void)
+{
+    st7735SimReset();
+
+    // After a reset the window is the whole screen.
+    gpio_put(EPD_CS_PIN, 0);
+    const uint8_t white[] = {0xFF, 0xFF};
+    sendCommand(ST7735_RAMWR);
+    sendData(white, sizeof(white));
+    CHECK_EQ(st7735SimPixel(0, 0), ST7735_WHITE);
+
+    // A two pixel window takes two pixels; the third is past its end.
+    sendWindow(5, 6, 6, 6);
+    sendCommand(ST7735_RAMWR);
+    const uint8_t pixels[] = {0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC};
+    sendData(pixels, sizeof(pixels));
+    CHECK_EQ(st7735SimPixel(5, 6), 0x1234);
+    CHECK_EQ(st7735SimPixel(6, 6), 0x5678);
+    CHECK_EQ(st7735SimPixel(5, 7), 0);
+    CHECK_EQ(st7735SimPixel(7, 6), 0);
+    CHECK_EQ(st7735SimStats()->pixels, 3);
+
+    // A new RAMWR starts over at the window's top left, and a pixel's bytes
+    // may arrive in separate writes.
+    sendCommand(ST7735_RAMWR);
+    sendData(&pixels[4], 1);
+    sendData(&pixels[5], 1);
+    CHECK_EQ(st7735SimPixel(5, 6), 0x9ABC);
+    CHECK_EQ(st7735SimPixel(6, 6), 0x5678);
+
+    // Deselected, the bus is someone else's.
+    gpio_put(EPD_CS_PIN, 1);
+    uint32_t commands = st7735SimStats()->commands;
+    sendCommand(ST7735_RAMWR);
+    sendData(white, sizeof(white));
+    CHECK_EQ(st7735SimStats()->commands, commands);
+    CHECK_EQ(st7735SimPixel(5, 6), 0x9ABC);
+}
+
+int main(void)
+{
+    st7735SimAttach();
+    ST7735_Init();
+    testDriver();
+    testRawWindow();
+    return checkExit("test_st7735_sim");
+}
@@ -0,0 +1,119 @@
+#include "search.h"
+#include "tablebase.h"
+#include "minimax.h"
+#include "check.h"
+
+// The linked-in tablebase (a 3x3 one generated by the build unless
+// TTT_TABLEBASE names another) against a full alpha-beta search: a probe
+// gives every stored position's value with X to move, and
+// tablebaseBestMove() plays O's best move.
+
+#define POSITIONS 20000
+
+static uint32_t nextRandom(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// The value of a minimaxScoreMoves() result, for the side to move.
+static TablebaseValue valueOf(int score)
+{
+    if (score == -SEARCH_INF || score == 0)
+        return TablebaseDraw;
+    return score > 0 ? TablebaseWin : TablebaseLoss;
+}
+
+static void testAgainstMinimax(Minimax *minimax)
+{
+    static BoardGeometry geometry;
+    int scores[BOARD_MAX_CELLS];
+    uint32_t seed = 9;
+    int probed = 0, played = 0;
+
+    if (!CHECK(boardGeometryInit(&geometry, tablebase.size, tablebase.winLength)))
+        return;
+    int minFilled = geometry.cells - tablebase.maxEmpty;
+
+    for (int n = 0; n < POSITIONS; n++)
+    {
+        Board board;
+        Player toMove = human;
+        TablebaseValue value;
+        int filled = minFilled + nextRandom(&seed) % (tablebase.maxEmpty + 1);
+
+        boardInit(&board, &geometry);
+        while (board.winner == empty && board.filled < filled)
+        {
+            int pos = nextRandom(&seed) % geometry.cells;
+            if (board.cell[pos] != empty)
+                continue;
+            boardPlay(&board, pos, toMove);
+            toMove = opponent(toMove);
+        }
+        if (board.winner != empty || board.filled == geometry.cells)
+            continue;
+        int left = geometry.cells - board.filled;
+        TablebaseValue expected =
+            valueOf(minimaxScoreMoves(minimax, &board, toMove, left, scores));
+
+        if (toMove == human)
+        {
+            probed++;
+            if (!CHECK_EQ(tablebaseProbe(&tablebase, &board), expected))
+                return;
+            CHECK_EQ(tablebaseBestMove(&tablebase, &board, &value), -1);
+            continue;
+        }
+
+        // O's move, and what it leaves X.
+        int move = tablebaseBestMove(&tablebase, &board, &value);
+        if (!CHECK(move >= 0 && board.cell[move] == empty) || !CHECK_EQ(value, expected))
+            return;
+        boardPlay(&board, move, ai);
+        if (board.winner == empty && board.filled < geometry.cells)
+        {
+            int reply = minimaxScoreMoves(minimax, &board, human, left - 1, scores);
+            if (!CHECK_EQ(TablebaseWin + TablebaseLoss - valueOf(reply), expected))
+                return;
+        }
+        else
+        {
+            CHECK_EQ(value, board.winner == ai ? TablebaseWin : TablebaseDraw);
+        }
+        played++;
+    }
+    CHECK(probed > POSITIONS / 4);
+    CHECK(played > POSITIONS / 4);
+}
+
+static void testOutside(void)
+{
+    static BoardGeometry geometry;
+    Board board;
+
+    // Another board shape.
+    CHECK(boardGeometryInit(&geometry, tablebase.size == 3 ? 4 : 3, 3));
+    boardInit(&board, &geometry);
+    CHECK_EQ(tablebaseProbe(&tablebase, &board), TablebaseUnknown);
+
+    // O to move isn't probed.
+    CHECK(boardGeometryInit(&geometry, tablebase.size, tablebase.winLength));
+    boardInit(&board, &geometry);
+    boardPlay(&board, 0, human);
+    CHECK_EQ(tablebaseProbe(&tablebase, &board), TablebaseUnknown);
+}
+
+int main(void)
+{
+    Minimax minimax;
+
+    if (!minimaxInit(&minimax))
+        return 1;
+    testAgainstMinimax(&minimax);
+    testOutside();
+    minimaxFree(&minimax);
+    return checkExit("test_tablebase");
+}
@@ -0,0 +1,132 @@
+#include "search.h"
+#include "threat.h"
+#include "minimax.h"
+#include "check.h"
+
+// Threat-space search against a full alpha-beta search: every win it reports
+// is a real one, won at least as fast as it says, and it never misses a win
+// on the spot. Also a hand-made win that takes two fours.
+
+static uint32_t nextRandom(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// Random positions with maxEmpty or fewer empty cells and nobody won yet,
+// checked with the side to move attacking.
+static void testAgainstMinimax(Minimax *minimax, int size, int winLength, int maxEmpty,
+                               int positions)
+{
+    static BoardGeometry geometry;
+    int scores[BOARD_MAX_CELLS];
+    uint32_t seed = 5;
+    int found = 0;
+
+    if (!CHECK(boardGeometryInit(&geometry, size, winLength)))
+        return;
+    for (int n = 0; n < positions;)
+    {
+        Board board;
+        Player toMove = human;
+
+        boardInit(&board, &geometry);
+        while (board.winner == empty && geometry.cells - board.filled > maxEmpty)
+        {
+            int pos = nextRandom(&seed) % geometry.cells;
+            if (board.cell[pos] != empty)
+                continue;
+            boardPlay(&board, pos, toMove);
+            toMove = opponent(toMove);
+        }
+        if (board.winner != empty)
+            continue;
+        n++;
+
+        ThreatResult threat;
+        int move = threatSearch(&board, toMove, maxEmpty, &threat);
+        int best = minimaxScoreMoves(minimax, &board, toMove, maxEmpty, scores);
+        if (best == SEARCH_WIN - 1 && !CHECK(move >= 0 && threat.moves == 1))
+            return;
+        if (move < 0)
+            continue;
+        found++;
+        if (!CHECK(board.cell[move] == empty) ||
+            !CHECK(best >= SEARCH_WIN - (2 * threat.moves - 1)))
+            return;
+
+        // The move itself wins: after it the defender loses whatever it does.
+        boardPlay(&board, move, toMove);
+        if (board.winner == empty)
+        {
+            int reply = minimaxScoreMoves(minimax, &board, opponent(toMove), maxEmpty, scores);
+            if (!CHECK(reply < 0))
+                return;
+        }
+        boardUndo(&board, move);
+    }
+    // Some wins were found, or the checks above mean nothing.
+    CHECK(found > 0);
+}
+
+// 5x5 with four in a row. X at (2,3) makes a four on the middle row and one
+// in the fourth column, with two cells to win at that O can't both block.
+//
+//   . . . O .
+//   . . . X .
+//   O X X . .
+//   . . . X .
+//   O . . . O
+static void testTwoFours(void)
+{
+    static BoardGeometry geometry;
+    Board board;
+    ThreatResult threat;
+    const int xCells[] = {11, 12, 8, 18};
+    const int oCells[] = {10, 3, 20, 24};
+
+    if (!CHECK(boardGeometryInit(&geometry, 5, 4)))
+        return;
+    boardInit(&board, &geometry);
+    for (int i = 0; i < 4; i++)
+    {
+        boardPlay(&board, xCells[i], human);
+        boardPlay(&board, oCells[i], ai);
+    }
+    CHECK_EQ(board.winner, empty);
+
+    // Not a win in one, but a win in two. Given longer it may find a longer
+    // one first.
+    CHECK_EQ(threatSearch(&board, human, 1, &threat), -1);
+    CHECK_EQ(threat.moves, 0);
+    CHECK_EQ(threatSearch(&board, human, 2, &threat), 13);
+    CHECK_EQ(threat.moves, 2);
+    CHECK(threatSearch(&board, human, 4, &threat) >= 0);
+    CHECK(threat.moves >= 2 && threat.moves <= 4);
+    CHECK(threat.nodes > 0 && threat.nodes <= THREAT_MAX_NODES);
+    // O has no four, so nothing for O.
+    CHECK_EQ(threatSearch(&board, ai, 3, &threat), -1);
+
+    // A won board has nothing to search.
+    boardPlay(&board, 13, human);
+    boardPlay(&board, 14, human);
+    CHECK_EQ(board.winner, human);
+    CHECK_EQ(threatSearch(&board, human, 3, &threat), -1);
+    CHECK_EQ(threat.move, -1);
+}
+
+int main(void)
+{
+    Minimax minimax;
+
+    if (!minimaxInit(&minimax))
+        return 1;
+    testAgainstMinimax(&minimax, 4, 3, 8, 300);
+    testAgainstMinimax(&minimax, 4, 4, 10, 300);
+    testAgainstMinimax(&minimax, 5, 4, 10, 200);
+    testTwoFours();
+    minimaxFree(&minimax);
+    return checkExit("test_threat");
+}
@@ -0,0 +1,358 @@
+#include "bench.h"
+
+#if BENCH_ENABLED
+
+#include <math.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "lib/st7735.h"
+#include "lib/fonts.h"
+#include "lib/ICM20948.h"
+#include "logic.h"
+#include "search.h"
+#include "painting.h"
+#include "tablebase.h"
+#include "book.h"
+#include "mcts.h"
+#include "constants.h"
+
+#if PICO_NO_HARDWARE
+#define BENCH_PLATFORM "host"
+#else
+#define BENCH_PLATFORM "rp2040"
+#endif
+
+#if HOT_IN_RAM
+#define BENCH_HOT_IN_RAM "true"
+#else
+#define BENCH_HOT_IN_RAM "false"
+#endif
+
+// Positions per aiPlay class, cycled through call by call.
+#define BENCH_POSITIONS 8
+
+typedef struct
+{
+    const char *name;
+    void (*prepare)(int arg); // untimed, may be NULL
+    void (*run)(uint32_t call, int arg);
+    int arg;
+} BenchCase;
+
+typedef struct
+{
+    double min;
+    double median;
+    double mean;
+    double max;
+    double stddev;
+} BenchStats;
+
+// Results are stored here so the calls can't be optimised away.
+static volatile int benchSink;
+
+static GridPos benchGrid[POSITIONS];
+static GridPos benchPositions[BENCH_POSITIONS][POSITIONS];
+static uint8_t benchSampleBuf[ICM20948_SAMPLE_LEN] = {
+    0x00, 0x78, 0xFE, 0xAC, 0x40, 0x00, // accel x, y, z
+    0x00, 0x0C, 0xFF, 0xF9, 0x00, 0x03, // gyro x, y, z
+};
+
+// Plays plies pseudo-random moves, human first, none of which wins.
+static void benchFillGrid(GridPos grid[], int plies, uint32_t seed)
+{
+    Player toMove = human;
+    int ply = 0;
+    int tries = 0;
+
+    memset(grid, 0, POSITIONS * sizeof(GridPos));
+    while (ply < plies)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        int pos = (seed >> 16) % POSITIONS;
+        if (++tries > 4 * POSITIONS)
+        {
+            // Every free cell wins for toMove; start over.
+            memset(grid, 0, POSITIONS * sizeof(GridPos));
+            toMove = human;
+            ply = tries = 0;
+            continue;
+        }
+        if (grid[pos].player != empty)
+            continue;
+        grid[pos].player = toMove;
+        if (winner(grid) != empty)
+        {
+            grid[pos].player = empty;
+            continue;
+        }
+        toMove = opponent(toMove);
+        ply++;
+        tries = 0;
+    }
+    for (int pos = 0; pos < POSITIONS; pos++)
+    {
+        grid[pos].winningPos = false;
+    }
+}
+
+static void benchPrepareGrid(int plies)
+{
+    benchFillGrid(benchGrid, plies, 1);
+}
+
+static void benchPreparePositions(int plies)
+{
+    for (int p = 0; p < BENCH_POSITIONS; p++)
+    {
+        benchFillGrid(benchPositions[p], plies, p + 1);
+    }
+}
+
+static BoardGeometry benchGeometry;
+static Board benchBoards[BENCH_POSITIONS];
+
+// benchPositions after plies moves, as Boards.
+static void benchPrepareBoards(int plies)
+{
+    boardGeometryInit(&benchGeometry, GRID_SIZE, GRID_SIZE);
+    benchPreparePositions(plies);
+    for (int p = 0; p < BENCH_POSITIONS; p++)
+    {
+        boardFromGrid(&benchBoards[p], &benchGeometry, benchPositions[p]);
+    }
+}
+
+// One random game to the end from positions after arg plies.
+static void benchMctsPlayout(uint32_t call, int arg)
+{
+    static uint32_t seed = 1;
+    benchSink = mctsPlayout(&benchBoards[call % BENCH_POSITIONS], arg % 2 ? ai : human, &seed);
+}
+
+#if TABLEBASE_ENABLED
+// X to move, with as many empty cells as the tablebase holds.
+static void benchPrepareTablebase(int arg)
+{
+    int plies = POSITIONS - tablebase.maxEmpty;
+    benchPrepareBoards(plies < 0 ? 0 : plies + plies % 2);
+}
+
+static void benchTablebaseProbe(uint32_t call, int arg)
+{
+    benchSink = tablebaseProbe(&tablebase, &benchBoards[call % BENCH_POSITIONS]);
+}
+#endif
+
+#if BOOK_ENABLED
+static void benchBookMove(uint32_t call, int arg)
+{
+    benchSink = bookMove(&book, &benchBoards[call % BENCH_POSITIONS], call);
+}
+
+// Plays games of random human moves against aiPlay() and reports how many of
+// the AI's moves came from the book, and the search time that saved per game:
+// each book move is timed against the search aiPlay() would have run instead.
+static void benchBookGames(FILE *out)
+{
+    uint32_t seed = 1;
+    uint32_t aiMoves = 0, hits = 0;
+    int64_t savedUs = 0;
+
+    boardGeometryInit(&benchGeometry, GRID_SIZE, GRID_SIZE);
+    for (int game = 0; game < BENCH_BOOK_GAMES; game++)
+    {
+        GridPos grid[POSITIONS];
+        memset(grid, 0, sizeof(grid));
+        for (int filled = 0; filled < POSITIONS; filled += 2)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            int pick = (seed >> 16) % (POSITIONS - filled);
+            int pos = 0;
+            while (grid[pos].player != empty || pick-- > 0)
+                pos++;
+            grid[pos].player = human;
+            if (winner(grid) != empty || filled + 1 == POSITIONS)
+                break;
+
+            Board board;
+            boardFromGrid(&board, &benchGeometry, grid);
+            bool hit = bookMove(&book, &board, 0) >= 0;
+            searchClear();
+            uint64_t start = time_us_64();
+            pos = aiPlay(grid);
+            int64_t took = time_us_64() - start;
+            aiMoves++;
+            if (hit)
+            {
+                SearchResult result;
+                hits++;
+                searchClear();
+                start = time_us_64();
+                searchBestMove(&board, ai, SEARCH_DEPTH, 2, &result);
+                savedUs += (int64_t)(time_us_64() - start) - took;
+            }
+            grid[pos].player = ai;
+            if (winner(grid) != empty)
+                break;
+        }
+    }
+    fprintf(out,
+            "\"book\": {\"bytes\": %lu, \"positions\": %lu, \"games\": %d, \"ai_moves\": %lu, "
+            "\"hits\": %lu, \"hit_rate\": %.3f, \"saved_us_per_game\": %.1f}, ",
+            (unsigned long)book.flashBytes, (unsigned long)book.entryCount, BENCH_BOOK_GAMES,
+            (unsigned long)aiMoves, (unsigned long)hits, aiMoves ? (double)hits / aiMoves : 0.0,
+            (double)savedUs / BENCH_BOOK_GAMES);
+}
+#endif
+
+static void benchWinner(uint32_t call, int arg)
+{
+    benchSink = winner(benchPositions[call % BENCH_POSITIONS]);
+}
+
+static void benchPlayPos(uint32_t call, int arg)
+{
+    int pos = call % POSITIONS;
+    benchSink = playPos(human, pos, benchGrid);
+    benchGrid[pos].player = empty;
+}
+
+// From a cleared transposition table, so calls don't get cheaper as the
+// table fills and the numbers repeat from run to run.
+static void benchAiPlay(uint32_t call, int arg)
+{
+    searchClear();
+    benchSink = aiPlay(benchPositions[call % BENCH_POSITIONS]);
+}
+
+static void benchPaintGrid(uint32_t call, int arg)
+{
+    paintGrid(benchGrid, call % POSITIONS);
+}
+
+// Two glyphs, expanded pixel by pixel onto the display.
+static void benchWriteString(uint32_t call, int arg)
+{
+    ST7735_WriteString(0, 0, "XO", Font_16x26, ST7735_WHITE, ST7735_BLACK);
+}
+
+static void benchParseSample(uint32_t call, int arg)
+{
+    ICM20948_ST_RAW_SAMPLE sample;
+    benchSampleBuf[1] = call;
+    icm20948ParseSample(benchSampleBuf, &sample);
+    icm20948ApplyOffsets(&sample);
+    benchSink = sample.stAccel.s16X;
+}
+
+static void benchAhrs(uint32_t call, int arg)
+{
+    imuAHRSupdate(0.01f, -0.02f, 0.005f, 0.0f, 0.0f, 1.0f, 20.0f, 5.0f, -40.0f);
+}
+
+static const BenchCase benchCases[] = {
+    {"winner", benchPreparePositions, benchWinner, POSITIONS / 2 + 1},
+    {"playPos", benchPrepareGrid, benchPlayPos, 0},
+    {"aiPlay opening", benchPreparePositions, benchAiPlay, 0},
+    {"aiPlay reply", benchPreparePositions, benchAiPlay, 1},
+    {"aiPlay middle", benchPreparePositions, benchAiPlay, POSITIONS / 3},
+    {"aiPlay late", benchPreparePositions, benchAiPlay, POSITIONS / 2 + 1},
+    {"mcts playout", benchPrepareBoards, benchMctsPlayout, 0},
+#if TABLEBASE_ENABLED
+    {"tablebase probe", benchPrepareTablebase, benchTablebaseProbe, 0},
+#endif
+#if BOOK_ENABLED
+    // O to move after the human's first move, which the book always holds.
+    {"book move", benchPrepareBoards, benchBookMove, 1},
+#endif
+    {"paintGrid", benchPrepareGrid, benchPaintGrid, POSITIONS / 2},
+    {"WriteString 16x26 x2", NULL, benchWriteString, 0},
+    {"ParseSample", NULL, benchParseSample, 0},
+    {"imuAHRSupdate", NULL, benchAhrs, 0},
+};
+#define BENCH_CASES ((int)(sizeof(benchCases) / sizeof(benchCases[0])))
+
+static uint64_t benchTime(const BenchCase *bench, uint32_t batch, uint32_t *call)
+{
+    uint64_t start = time_us_64();
+    for (uint32_t n = 0; n < batch; n++)
+    {
+        bench->run((*call)++, bench->arg);
+    }
+    return time_us_64() - start;
+}
+
+static void benchSummarise(double samples[], int count, BenchStats *stats)
+{
+    double sum = 0;
+    for (int i = 1; i < count; i++)
+    {
+        double value = samples[i];
+        int j = i;
+        for (; j > 0 && samples[j - 1] > value; j--)
+            samples[j] = samples[j - 1];
+        samples[j] = value;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        sum += samples[i];
+    }
+    stats->min = samples[0];
+    stats->median = samples[count / 2];
+    stats->max = samples[count - 1];
+    stats->mean = sum / count;
+
+    double squares = 0;
+    for (int i = 0; i < count; i++)
+    {
+        squares += (samples[i] - stats->mean) * (samples[i] - stats->mean);
+    }
+    stats->stddev = count > 1 ? sqrt(squares / (count - 1)) : 0;
+}
+
+// Runs every case and writes the report to out.
+void benchRun(FILE *out)
+{
+    fprintf(out, "{\"platform\": \"" BENCH_PLATFORM "\", \"grid_size\": %d, "
+                 "\"hot_in_ram\": " BENCH_HOT_IN_RAM ", ",
+            GRID_SIZE);
+#if TABLEBASE_ENABLED
+    fprintf(out, "\"tablebase_bytes\": %lu, ", (unsigned long)tablebase.flashBytes);
+#endif
+#if BOOK_ENABLED
+    benchBookGames(out);
+#endif
+    fprintf(out, "\"samples\": %d, \"results\": [\n", BENCH_SAMPLES);
+    for (int c = 0; c < BENCH_CASES; c++)
+    {
+        const BenchCase *bench = &benchCases[c];
+        double samples[BENCH_SAMPLES];
+        uint32_t call = 0;
+        uint32_t batch = 1;
+        BenchStats stats;
+
+        if (bench->prepare)
+            bench->prepare(bench->arg);
+        // Doubling the batch until it is long enough also warms up caches.
+        while (benchTime(bench, batch, &call) < BENCH_SAMPLE_US && batch < (1u << 24))
+        {
+            batch *= 2;
+        }
+        for (int s = 0; s < BENCH_SAMPLES; s++)
+        {
+            samples[s] = benchTime(bench, batch, &call) * 1000.0 / batch;
+        }
+        benchSummarise(samples, BENCH_SAMPLES, &stats);
+        fprintf(out,
+                "  {\"name\": \"%s\", \"batch\": %lu, \"ns\": {\"min\": %.1f, \"median\": %.1f, "
+                "\"mean\": %.1f, \"max\": %.1f, \"stddev\": %.1f}}%s\n",
+                bench->name, (unsigned long)batch, stats.min, stats.median, stats.mean,
+                stats.max, stats.stddev,
+                c + 1 < BENCH_CASES ? "," : "");
+    }
+    fprintf(out, "]}\n");
+}
+
+#endif // BENCH_ENABLED
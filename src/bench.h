@@ -0,0 +1,36 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <stdio.h>
+
+// Microbenchmarks of the game logic, rendering and sensor kernels, with the
+// same cases and report on the device and on the host.
+//
+// Each case is first calibrated to a batch of calls that takes at least
+// BENCH_SAMPLE_US, then timed over BENCH_SAMPLES batches. The report is one
+// JSON object giving min/median/mean/max/stddev ns per call for every case.
+// tools/bench_compare.py prints one report as a table, or compares two.
+//
+// On the device, configure with -DTTT_BENCH=ON and send 'b' over USB serial;
+// the cases draw on the real display. On the host, build-host/micro_bench
+// draws into the display model of host/st7735_sim.c.
+//
+// The AI search wakes core 1 to help, so searchInit() must have been called
+// with a working wake callback beforehand.
+
+#ifndef BENCH_SAMPLES
+#define BENCH_SAMPLES 21
+#endif
+#ifndef BENCH_SAMPLE_US
+#define BENCH_SAMPLE_US 2000
+#endif
+// Games against random human moves for the opening book's hit rate.
+#ifndef BENCH_BOOK_GAMES
+#define BENCH_BOOK_GAMES 16
+#endif
+
+#if BENCH_ENABLED
+void benchRun(FILE *out);
+#endif
+
+#endif // _BENCH_H_
@@ -0,0 +1,88 @@
+#include "book.h"
+
+// The canonical hash of the position, and in symmetry the symmetry that gives
+// it.
+uint64_t bookKey(const Board *board, int *symmetry)
+{
+    const BoardGeometry *geometry = board->geometry;
+    uint64_t best = 0;
+
+    *symmetry = 0;
+    for (int s = 0; s < BOARD_SYMMETRIES; s++)
+    {
+        const uint8_t *target = geometry->symmetry[s];
+        uint64_t hash = 0;
+        for (int pos = 0; pos < geometry->cells; pos++)
+        {
+            if (board->cell[pos] != empty)
+            {
+                hash ^= geometry->zobrist[target[pos]][board->cell[pos] - 1];
+            }
+        }
+        if (s == 0 || hash < best)
+        {
+            best = hash;
+            *symmetry = s;
+        }
+    }
+    return best;
+}
+
+// A move from the book for the position, chosen by weight with random, or -1
+// if the book doesn't have it.
+int bookMove(const Book *book, const Board *board, uint32_t random)
+{
+    const BoardGeometry *geometry = board->geometry;
+
+    if (book->size != geometry->size || book->winLength != geometry->winLength ||
+        board->filled > book->maxPlies || board->winner != empty)
+    {
+        return -1;
+    }
+
+    int symmetry;
+    uint64_t key = bookKey(board, &symmetry);
+    uint32_t low = 0, high = book->entryCount;
+    while (low < high)
+    {
+        uint32_t middle = (low + high) / 2;
+        if (book->keys[middle] < key)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low == book->entryCount || book->keys[low] != key)
+    {
+        return -1;
+    }
+
+    const BookMove *first = &book->moves[book->moveStart[low]];
+    const BookMove *end = &book->moves[book->moveStart[low + 1]];
+    uint32_t total = 0;
+    for (const BookMove *move = first; move < end; move++)
+    {
+        total += move->weight;
+    }
+    if (total == 0)
+    {
+        return -1;
+    }
+    uint32_t pick = random % total;
+    const BookMove *move = first;
+    while (pick >= move->weight)
+    {
+        pick -= move->weight;
+        move++;
+    }
+
+    // Back from the canonical symmetry's cells to the board's.
+    for (int pos = 0; pos < geometry->cells; pos++)
+    {
+        if (geometry->symmetry[symmetry][pos] == move->pos)
+        {
+            // Against a hash collision.
+            return board->cell[pos] == empty ? pos : -1;
+        }
+    }
+    return -1;
+}
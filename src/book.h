@@ -0,0 +1,45 @@
+#ifndef _BOOK_H_
+#define _BOOK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "logic.h"
+
+// Opening book kept in flash: for positions early in the game with O (the AI)
+// to move, the moves worth playing and how often to play each. It is written
+// as a C source file by host/book_gen, from a database solved by
+// host/retro_solve or from deep searches. aiPlay() tries it before searching.
+//
+// A position is keyed by its canonical hash, the least of the Zobrist hashes
+// (logic.h) of its symmetries, so one entry serves all of them. keys is sorted
+// for a binary search. The moves of keys[i] are moves[moveStart[i]] up to
+// moves[moveStart[i + 1]], given as cells of the symmetry with the least hash.
+
+typedef struct
+{
+  uint8_t pos;
+  uint8_t weight; // relative to the position's other moves
+} BookMove;
+
+typedef struct
+{
+  uint8_t size;
+  uint8_t winLength;
+  uint8_t maxPlies; // positions with up to this many pieces
+  uint32_t entryCount;
+  uint32_t flashBytes; // all of the book's data, for reports
+  const uint64_t *keys;
+  const uint16_t *moveStart; // entryCount + 1 of them
+  const BookMove *moves;
+} Book;
+
+#if BOOK_ENABLED
+// Defined by the generated source the build links in (TTT_BOOK).
+extern const Book book;
+#endif
+
+uint64_t bookKey(const Board *board, int *symmetry);
+int bookMove(const Book *book, const Board *board, uint32_t random);
+
+#endif // _BOOK_H_
@@ -0,0 +1,54 @@
+#include "boot.h"
+
+#include <stdio.h>
+
+#include "pico/stdlib.h"
+
+typedef struct
+{
+    uint32_t startUs; // since reset; 0 if the phase never ran
+    uint32_t endUs;
+} BootSpan;
+
+static const char *const phaseNames[BootPhaseCount] = {
+#define BOOT_PHASE_NAME(name, core) #name,
+    BOOT_PHASES(BOOT_PHASE_NAME)
+#undef BOOT_PHASE_NAME
+};
+
+static const uint8_t phaseCores[BootPhaseCount] = {
+#define BOOT_PHASE_CORE(name, core) core,
+    BOOT_PHASES(BOOT_PHASE_CORE)
+#undef BOOT_PHASE_CORE
+};
+
+// Each phase is only ever written by its own core.
+static BootSpan bootSpans[BootPhaseCount];
+
+void bootBegin(BootPhase phase)
+{
+    bootSpans[phase].startUs = time_us_32();
+}
+
+void bootEnd(BootPhase phase)
+{
+    bootSpans[phase].endUs = time_us_32();
+}
+
+// Call once both cores are past boot.
+void bootPrintReport(void)
+{
+    printf("boot (ms since reset)\n");
+    printf("  %-12s %4s %8s %8s %8s\n", "phase", "core", "start", "end", "took");
+    for (int phase = 0; phase < BootPhaseCount; phase++)
+    {
+        const BootSpan *span = &bootSpans[phase];
+        if (span->startUs == 0)
+            continue;
+        printf("  %-12s %4d %8.1f %8.1f %8.1f\n", phaseNames[phase], phaseCores[phase],
+               span->startUs / 1000.0, span->endUs / 1000.0,
+               (span->endUs - span->startUs) / 1000.0);
+    }
+    printf("first interactive frame at %lu ms\n",
+           (unsigned long)(bootSpans[BootFirstFrame].endUs / 1000));
+}
@@ -0,0 +1,40 @@
+#ifndef _BOOT_H_
+#define _BOOT_H_
+
+#include <stdint.h>
+
+// Boot runs as two chains, one per core, that meet at the first frame:
+//
+//   core 0: Stdio -> Tasks -> Display -> Splash -> ImuWait -> FirstFrame
+//   core 1:              `-> Imu -> Calibration -> Sensor -'
+//
+// Core 1 is launched as soon as the tasks it signals exist, so IMU reset and
+// calibration overlap the display's power-up delays. The splash stays up until
+// the IMU is ready, which only takes noticeably long when calibration has to be
+// measured. Each phase records when it started and ended; bootPrintReport()
+// prints them.
+
+#define BOOT_PHASES(X) \
+  X(Stdio, 0)          \
+  X(Tasks, 0)          \
+  X(Display, 0)        \
+  X(Splash, 0)         \
+  X(ImuWait, 0)        \
+  X(FirstFrame, 0)     \
+  X(Imu, 1)            \
+  X(Calibration, 1)    \
+  X(Sensor, 1)
+
+typedef enum
+{
+#define BOOT_PHASE_ENUM(name, core) Boot##name,
+  BOOT_PHASES(BOOT_PHASE_ENUM)
+#undef BOOT_PHASE_ENUM
+  BootPhaseCount
+} BootPhase;
+
+void bootBegin(BootPhase phase);
+void bootEnd(BootPhase phase);
+void bootPrintReport(void);
+
+#endif // _BOOT_H_
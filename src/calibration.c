@@ -0,0 +1,315 @@
+#include "calibration.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+
+ImuCalibration imuCalibration;
+
+// Set by the sensor core when drift tracking changed the offsets; the record is
+// written back to flash at the next calibrationFlush().
+static volatile bool dirty = false;
+
+uint32_t calibrationCrc32(const void *data, uint32_t length)
+{
+    const uint8_t *bytes = data;
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (uint32_t i = 0; i < length; i++)
+    {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+bool calibrationValid(const ImuCalibration *calibration)
+{
+    return calibration->magic == CALIBRATION_MAGIC &&
+           calibration->version == CALIBRATION_VERSION &&
+           calibration->size == sizeof(ImuCalibration) &&
+           calibration->crc == calibrationCrc32(calibration, offsetof(ImuCalibration, crc));
+}
+
+bool calibrationLoad(ImuCalibration *calibration)
+{
+    const ImuCalibration *stored =
+        (const ImuCalibration *)(XIP_BASE + CALIBRATION_FLASH_OFFSET);
+
+    if (!calibrationValid(stored))
+    {
+        return false;
+    }
+    *calibration = *stored;
+    return true;
+}
+
+// Erases the calibration sector and programs the record into its first page.
+// Once core 1 is running it must be parked first (it executes from flash too),
+// which needs multicore_lockout_victim_init() to have been called there.
+void calibrationSave(ImuCalibration *calibration, bool lockoutOtherCore)
+{
+    uint8_t page[FLASH_PAGE_SIZE];
+
+    // Lock out first so the record cannot change under the CRC.
+    if (lockoutOtherCore)
+        multicore_lockout_start_blocking();
+
+    calibration->magic = CALIBRATION_MAGIC;
+    calibration->version = CALIBRATION_VERSION;
+    calibration->size = sizeof(ImuCalibration);
+    calibration->crc = calibrationCrc32(calibration, offsetof(ImuCalibration, crc));
+
+    memset(page, 0xFF, sizeof(page));
+    memcpy(page, calibration, sizeof(ImuCalibration));
+
+    uint32_t interrupts = save_and_disable_interrupts();
+    flash_range_erase(CALIBRATION_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+    flash_range_program(CALIBRATION_FLASH_OFFSET, page, FLASH_PAGE_SIZE);
+    restore_interrupts(interrupts);
+    if (lockoutOtherCore)
+        multicore_lockout_end_blocking();
+}
+
+// Copies a record into the IMU driver.
+void calibrationApply(const ImuCalibration *calibration)
+{
+    gstGyroOffset.s16X = calibration->gyroOffset[0];
+    gstGyroOffset.s16Y = calibration->gyroOffset[1];
+    gstGyroOffset.s16Z = calibration->gyroOffset[2];
+    gstAccelOffset.s16X = calibration->accelOffset[0];
+    gstAccelOffset.s16Y = calibration->accelOffset[1];
+    gstAccelOffset.s16Z = calibration->accelOffset[2];
+    for (int i = 0; i < 3; i++)
+    {
+        gfMagHardIron[i] = calibration->magHardIron[i];
+        gfMagSoftIron[i] = calibration->magSoftIron[i];
+    }
+}
+
+// The inverse of calibrationApply().
+void calibrationCapture(ImuCalibration *calibration)
+{
+    calibration->gyroOffset[0] = gstGyroOffset.s16X;
+    calibration->gyroOffset[1] = gstGyroOffset.s16Y;
+    calibration->gyroOffset[2] = gstGyroOffset.s16Z;
+    calibration->accelOffset[0] = gstAccelOffset.s16X;
+    calibration->accelOffset[1] = gstAccelOffset.s16Y;
+    calibration->accelOffset[2] = gstAccelOffset.s16Z;
+    for (int i = 0; i < 3; i++)
+    {
+        calibration->magHardIron[i] = gfMagHardIron[i];
+        calibration->magSoftIron[i] = gfMagSoftIron[i];
+    }
+}
+
+// Restores the stored calibration, or measures and stores a new one. A normal
+// boot without a valid record only measures the gyro bias (the board just has
+// to be still); a forced calibration also measures the accelerometer bias
+// (board flat, face up) and the magnetometer hard/soft iron (board rotated
+// through every orientation). If the IMU can't be read well enough to measure,
+// nothing is saved: the stored record, if any, stays in flash and in use.
+// Returns true if the stored record was used.
+bool calibrationBoot(bool force)
+{
+    bool haveStored = calibrationLoad(&imuCalibration);
+
+    if (haveStored && !force)
+    {
+        calibrationApply(&imuCalibration);
+        return true;
+    }
+    if (haveStored)
+        calibrationApply(&imuCalibration);
+
+    printf("Calibrating IMU, keep the board still...\n");
+    bool measured = icm20948GyroOffset();
+    if (measured && force)
+    {
+        measured = icm20948AccelOffset();
+        if (measured)
+        {
+            printf("Rotate the board through every orientation...\n");
+            calibrationRunMag(CALIBRATION_MAG_DURATION_MS);
+        }
+    }
+    if (!measured)
+    {
+        printf("IMU calibration failed, %s\n",
+               haveStored ? "keeping the stored one" : "nothing saved");
+        if (haveStored)
+            calibrationApply(&imuCalibration);
+        return haveStored;
+    }
+    calibrationCapture(&imuCalibration);
+    // Boot calibration runs on core 1 while core 0 is already drawing.
+    calibrationSave(&imuCalibration, true);
+    printf("IMU calibration saved\n");
+    return false;
+}
+
+// Tracks the per-axis min/max magnetometer reading while the board is turned.
+// The centre of each range is the hard-iron offset; scaling every axis to the
+// mean radius is a diagonal soft-iron correction.
+void calibrationRunMag(uint32_t durationMs)
+{
+    float min[3] = {1e9f, 1e9f, 1e9f};
+    float max[3] = {-1e9f, -1e9f, -1e9f};
+    float value[3];
+    absolute_time_t end = make_timeout_time_ms(durationMs);
+
+    for (int i = 0; i < 3; i++)
+    {
+        gfMagHardIron[i] = 0.0f;
+        gfMagSoftIron[i] = 1.0f;
+    }
+    while (!time_reached(end))
+    {
+        if (!icm20948MagRead(&value[0], &value[1], &value[2]))
+            continue;
+        for (int i = 0; i < 3; i++)
+        {
+            if (value[i] < min[i])
+                min[i] = value[i];
+            if (value[i] > max[i])
+                max[i] = value[i];
+        }
+    }
+
+    float radius[3];
+    float meanRadius = 0.0f;
+    for (int i = 0; i < 3; i++)
+    {
+        if (max[i] < min[i])
+            return; // no readings
+        radius[i] = (max[i] - min[i]) / 2;
+        meanRadius += radius[i] / 3;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        gfMagHardIron[i] = (max[i] + min[i]) / 2;
+        gfMagSoftIron[i] = radius[i] > 0.0f ? meanRadius / radius[i] : 1.0f;
+    }
+}
+
+void calibrationTrackerInit(DriftTracker *tracker)
+{
+    memset(tracker, 0, sizeof(*tracker));
+}
+
+// Feeds one offset-corrected sample. While the board is still (accel magnitude
+// close to 1 g and gyro flat) the gyro should read zero, so a full window with
+// a consistent non-zero mean is residual bias: it is folded into the offset
+// and the record marked for saving. Returns true when that happens.
+bool calibrationTrackDrift(DriftTracker *tracker, const ICM20948_ST_RAW_SAMPLE *sample)
+{
+    const int16_t gyro[3] = {sample->stGyro.s16X, sample->stGyro.s16Y, sample->stGyro.s16Z};
+    float ax = sample->stAccel.s16X / ICM20948_ACCEL_LSB_PER_G;
+    float ay = sample->stAccel.s16Y / ICM20948_ACCEL_LSB_PER_G;
+    float az = sample->stAccel.s16Z / ICM20948_ACCEL_LSB_PER_G;
+    float magnitude2 = ax * ax + ay * ay + az * az;
+    const float low = 1.0f - CALIBRATION_STILL_ACCEL_TOLERANCE;
+    const float high = 1.0f + CALIBRATION_STILL_ACCEL_TOLERANCE;
+
+    if (magnitude2 < low * low || magnitude2 > high * high)
+    {
+        tracker->count = 0;
+        return false;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        if (tracker->count == 0)
+        {
+            tracker->gyroSum[i] = 0;
+            tracker->gyroMin[i] = gyro[i];
+            tracker->gyroMax[i] = gyro[i];
+        }
+        tracker->gyroSum[i] += gyro[i];
+        if (gyro[i] < tracker->gyroMin[i])
+            tracker->gyroMin[i] = gyro[i];
+        if (gyro[i] > tracker->gyroMax[i])
+            tracker->gyroMax[i] = gyro[i];
+        if (tracker->gyroMax[i] - tracker->gyroMin[i] > CALIBRATION_STILL_GYRO_RANGE)
+        {
+            tracker->count = 0;
+            return false;
+        }
+    }
+    if (++tracker->count < CALIBRATION_DRIFT_WINDOW)
+        return false;
+    tracker->count = 0;
+
+    int16_t bias[3];
+    bool drifted = false;
+    for (int i = 0; i < 3; i++)
+    {
+        bias[i] = tracker->gyroSum[i] / CALIBRATION_DRIFT_WINDOW;
+        if (bias[i] > CALIBRATION_DRIFT_THRESHOLD || bias[i] < -CALIBRATION_DRIFT_THRESHOLD)
+            drifted = true;
+    }
+    if (!drifted)
+        return false;
+
+    gstGyroOffset.s16X += bias[0];
+    gstGyroOffset.s16Y += bias[1];
+    gstGyroOffset.s16Z += bias[2];
+    calibrationCapture(&imuCalibration);
+    dirty = true;
+    return true;
+}
+
+bool calibrationPending(void)
+{
+    return dirty;
+}
+
+// Sum over the axes of how far the gyro offsets are from the stored record's.
+static int calibrationGyroDelta(const ImuCalibration *calibration)
+{
+    const ImuCalibration *stored =
+        (const ImuCalibration *)(XIP_BASE + CALIBRATION_FLASH_OFFSET);
+    int delta = 0;
+
+    if (!calibrationValid(stored))
+        return CALIBRATION_SAVE_MIN_DELTA;
+    for (int i = 0; i < 3; i++)
+    {
+        int axis = calibration->gyroOffset[i] - stored->gyroOffset[i];
+        delta += axis < 0 ? -axis : axis;
+    }
+    return delta;
+}
+
+// Persists offsets updated by drift tracking, rate limited (see
+// CALIBRATION_SAVE_INTERVAL_MS). Called from core 0 while core 1 is running,
+// so core 1 is locked out for the duration of the flash write.
+void calibrationFlush(void)
+{
+    static uint64_t lastSaveUs;
+    static bool saved = false;
+
+    if (!dirty)
+        return;
+    uint64_t now = time_us_64();
+    if (saved && now - lastSaveUs < (uint64_t)CALIBRATION_SAVE_INTERVAL_MS * 1000)
+        return;
+    // The lockout handshake pops core 0's FIFO until it sees its reply, so it
+    // would swallow anything else queued there. Nothing else uses the FIFO,
+    // but if that ever changes, wait rather than lose it.
+    if (multicore_fifo_rvalid())
+        return;
+    dirty = false;
+    if (calibrationGyroDelta(&imuCalibration) < CALIBRATION_SAVE_MIN_DELTA)
+        return; // dirty again at the next drift update, from its new total
+    calibrationSave(&imuCalibration, true);
+    lastSaveUs = now;
+    saved = true;
+}
@@ -0,0 +1,71 @@
+#ifndef _CALIBRATION_H_
+#define _CALIBRATION_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lib/ICM20948.h"
+
+// IMU calibration persisted in the last sector of flash so boots can skip
+// measuring it. The record is only trusted if magic, version, size and CRC all
+// match; anything else (erased flash, an older layout) triggers a fresh
+// calibration.
+
+#define CALIBRATION_MAGIC 0x4C414349 // "ICAL"
+#define CALIBRATION_VERSION 1
+#define CALIBRATION_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+
+// Background drift tracking: a window of this many samples in which the board
+// is still gives a new gyro bias estimate.
+#define CALIBRATION_DRIFT_WINDOW 128
+// Residual gyro bias (raw LSB, ~0.25 dps) above which the offset is updated.
+#define CALIBRATION_DRIFT_THRESHOLD 4
+// Peak-to-peak gyro noise (raw LSB) still counted as "not moving".
+#define CALIBRATION_STILL_GYRO_RANGE 48
+// Allowed deviation of the accel magnitude from 1 g while still.
+#define CALIBRATION_STILL_ACCEL_TOLERANCE 0.1f
+// Drift updates are written back at most this often, and only once the gyro
+// offsets have moved this far (raw LSB, summed over the axes) from the stored
+// record, so thermal drift on a still board can't wear out the sector.
+#define CALIBRATION_SAVE_INTERVAL_MS (10 * 60 * 1000)
+#define CALIBRATION_SAVE_MIN_DELTA 16
+
+#define CALIBRATION_MAG_DURATION_MS 10000
+
+typedef struct
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;
+  int16_t gyroOffset[3];  // raw LSB
+  int16_t accelOffset[3]; // raw LSB
+  float magHardIron[3];   // uT
+  float magSoftIron[3];   // per-axis scale
+  uint32_t crc;           // CRC-32 of every byte before this field
+} ImuCalibration;
+
+typedef struct
+{
+  int32_t gyroSum[3];
+  int16_t gyroMin[3];
+  int16_t gyroMax[3];
+  uint16_t count;
+} DriftTracker;
+
+extern ImuCalibration imuCalibration;
+
+uint32_t calibrationCrc32(const void *data, uint32_t length);
+bool calibrationValid(const ImuCalibration *calibration);
+bool calibrationLoad(ImuCalibration *calibration);
+void calibrationSave(ImuCalibration *calibration, bool lockoutOtherCore);
+void calibrationApply(const ImuCalibration *calibration);
+void calibrationCapture(ImuCalibration *calibration);
+bool calibrationBoot(bool force);
+void calibrationRunMag(uint32_t durationMs);
+
+void calibrationTrackerInit(DriftTracker *tracker);
+bool calibrationTrackDrift(DriftTracker *tracker, const ICM20948_ST_RAW_SAMPLE *sample);
+bool calibrationPending(void);
+void calibrationFlush(void);
+
+#endif // _CALIBRATION_H_
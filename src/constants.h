@@ -1,9 +1,40 @@
 #include <stdio.h>
 
 // Game constants
+// The grid can be built larger (e.g. -DGRID_SIZE=4); a line has to span the
+// whole grid to win.
+#ifndef GRID_SIZE
 #define GRID_SIZE 3
+#endif
 #define POSITIONS (GRID_SIZE * GRID_SIZE)
 #define LAST_POSITION (POSITIONS - 1)
 
 // Hardware
-#define BUTTON_GPIO 21
\ No newline at end of file
+#define BUTTON_GPIO 21
+// Time the button must stay pressed, after its first edge, to count.
+#define BUTTON_DEBOUNCE_MS 20
+
+// Input
+// Matches the ~125 Hz output data rate the ICM20948 is configured for.
+#define IMU_SAMPLE_PERIOD_MS 8
+
+// AI
+// Search depth in plies: enough to solve 3x3, a heuristic cut-off beyond.
+#ifndef SEARCH_DEPTH
+#if GRID_SIZE <= 3
+#define SEARCH_DEPTH POSITIONS
+#else
+#define SEARCH_DEPTH 6
+#endif
+#endif
+// Thinking time per move when aiPlay() uses Monte Carlo tree search (TTT_MCTS).
+#ifndef MCTS_BUDGET_US
+#define MCTS_BUDGET_US 200000
+#endif
+
+// Tasks
+// The log task also drains deferred LOG() output, so it runs often.
+#define LOG_PERIOD_MS 50
+#define COMMAND_POLL_PERIOD_MS 50
+// How often the log task prints the schedulers' run-time accounting.
+#define TASK_REPORT_PERIOD_MS 30000
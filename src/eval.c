@@ -0,0 +1,243 @@
+#include "eval.h"
+
+#include <string.h>
+
+#include "hot.h"
+
+// Weight of a window holding n pieces of only one player, indexed by n.
+static const int16_t lineWeight[BOARD_MAX_SIZE] = {0, 1, 4, 16, 64, 256, 1024};
+
+static int evalPower3(int n)
+{
+    int power = 1;
+    while (n-- > 0)
+        power *= 3;
+    return power;
+}
+
+// Where the patterns of lines of length start: after those of every shorter
+// length from winLength up, 3^winLength + ... + 3^(length - 1) of them.
+static int evalPatternStart(int winLength, int length)
+{
+    return (evalPower3(length) - evalPower3(winLength)) / 2;
+}
+
+static void evalAddLine(EvalTables *tables, int start, int rowStep, int colStep)
+{
+    int size = tables->size;
+    int row = start / size, col = start % size;
+    int length = 0;
+    uint8_t cells[BOARD_MAX_SIZE];
+
+    while (row >= 0 && row < size && col >= 0 && col < size)
+    {
+        cells[length++] = row * size + col;
+        row += rowStep;
+        col += colStep;
+    }
+    if (length < tables->winLength)
+    {
+        return;
+    }
+    int line = tables->lineCount++;
+    tables->lineLength[line] = length;
+    tables->linePatterns[line] = &tables->patterns[evalPatternStart(tables->winLength, length)];
+    memcpy(tables->lineCells[line], cells, length);
+    int weight = 1;
+    for (int i = 0; i < length; i++)
+    {
+        int pos = cells[i];
+        int n = tables->cellLineCount[pos]++;
+        tables->cellLines[pos][n] = line;
+        tables->cellWeights[pos][n] = weight;
+        weight *= 3;
+    }
+}
+
+// The empty cells of the line where player would complete a window.
+static uint8_t evalWinCells(const uint8_t *cells, int length, int winLength, int player)
+{
+    uint8_t mask = 0;
+    for (int start = 0; start + winLength <= length; start++)
+    {
+        int mine = 0, gap = -1;
+        for (int i = start; i < start + winLength; i++)
+        {
+            if (cells[i] == player)
+                mine++;
+            else if (cells[i] == empty)
+                gap = i;
+        }
+        if (mine == winLength - 1 && gap >= 0)
+            mask |= 1u << gap;
+    }
+    return mask;
+}
+
+static void evalPatternInit(EvalPattern *pattern, uint8_t *cells, int length, int winLength)
+{
+    memset(pattern, 0, sizeof(*pattern));
+    for (int player = human; player <= ai; player++)
+    {
+        int score = 0;
+        for (int start = 0; start + winLength <= length; start++)
+        {
+            int mine = 0, theirs = 0;
+            for (int i = start; i < start + winLength; i++)
+            {
+                mine += cells[i] == player;
+                theirs += cells[i] != player && cells[i] != empty;
+            }
+            if (theirs == 0)
+                score += lineWeight[mine < winLength ? mine : winLength - 1];
+        }
+
+        uint8_t winCells = evalWinCells(cells, length, winLength, player);
+        pattern->winCells[player - 1] = winCells;
+        pattern->counts += (uint32_t)__builtin_popcount(winCells) << EVAL_WIN_CELLS(player - 1);
+        if (winCells == 0)
+        {
+            // One move from two win cells in the line.
+            for (int i = 0; i < length; i++)
+            {
+                if (cells[i] != empty)
+                    continue;
+                cells[i] = player;
+                uint8_t after = evalWinCells(cells, length, winLength, player);
+                cells[i] = empty;
+                if (after & (after - 1))
+                {
+                    pattern->counts += 1u << EVAL_OPEN_THREES(player - 1);
+                    score += lineWeight[winLength - 1];
+                    break;
+                }
+            }
+        }
+        pattern->score += player == human ? score : -score;
+    }
+}
+
+void evalTablesInit(EvalTables *tables, const BoardGeometry *geometry)
+{
+    int size = geometry->size;
+
+    memset(tables, 0, sizeof(*tables));
+    tables->geometry = geometry;
+    tables->size = size;
+    tables->winLength = geometry->winLength;
+    for (int i = 0; i < size; i++)
+    {
+        evalAddLine(tables, i * size, 0, 1); // row
+        evalAddLine(tables, i, 1, 0); // column
+        evalAddLine(tables, i, 1, 1); // diagonals from the top edge
+        evalAddLine(tables, i, 1, -1);
+        if (i > 0)
+        {
+            evalAddLine(tables, i * size, 1, 1); // and from the sides
+            evalAddLine(tables, i * size + size - 1, 1, -1);
+        }
+    }
+
+    for (int length = tables->winLength; length <= size; length++)
+    {
+        EvalPattern *patterns = &tables->patterns[evalPatternStart(tables->winLength, length)];
+        int codes = evalPower3(length);
+        for (int code = 0; code < codes; code++)
+        {
+            uint8_t cells[BOARD_MAX_SIZE];
+            for (int i = 0, rest = code; i < length; i++, rest /= 3)
+                cells[i] = rest % 3;
+            evalPatternInit(&patterns[code], cells, length, tables->winLength);
+        }
+    }
+}
+
+bool evalTablesMatch(const EvalTables *tables, const BoardGeometry *geometry)
+{
+    return tables->geometry == geometry && tables->size == geometry->size &&
+           tables->winLength == geometry->winLength;
+}
+
+static inline const EvalPattern *evalPattern(const EvalState *state, const EvalTables *tables,
+                                             int line)
+{
+    return &tables->linePatterns[line][state->code[line]];
+}
+
+static inline int evalCount(const EvalState *state, int shift)
+{
+    return (state->counts >> shift) & 0xFF;
+}
+
+void evalInit(EvalState *state, const EvalTables *tables, const Board *board)
+{
+    memset(state, 0, sizeof(*state));
+    for (int line = 0; line < tables->lineCount; line++)
+    {
+        int code = 0;
+        for (int i = tables->lineLength[line] - 1; i >= 0; i--)
+            code = code * 3 + board->cell[tables->lineCells[line][i]];
+        state->code[line] = code;
+        state->score += evalPattern(state, tables, line)->score;
+        state->counts += evalPattern(state, tables, line)->counts;
+    }
+}
+
+void HOT(evalPlay)(EvalState *state, const EvalTables *tables, int pos, Player player)
+{
+    for (int i = 0; i < tables->cellLineCount[pos]; i++)
+    {
+        int line = tables->cellLines[pos][i];
+        const EvalPattern *before = evalPattern(state, tables, line);
+        state->code[line] += player * tables->cellWeights[pos][i];
+        const EvalPattern *after = evalPattern(state, tables, line);
+        state->score += after->score - before->score;
+        state->counts += after->counts - before->counts;
+    }
+}
+
+void HOT(evalUndo)(EvalState *state, const EvalTables *tables, int pos, Player player)
+{
+    for (int i = 0; i < tables->cellLineCount[pos]; i++)
+    {
+        int line = tables->cellLines[pos][i];
+        const EvalPattern *before = evalPattern(state, tables, line);
+        state->code[line] -= player * tables->cellWeights[pos][i];
+        const EvalPattern *after = evalPattern(state, tables, line);
+        state->score += after->score - before->score;
+        state->counts += after->counts - before->counts;
+    }
+}
+
+// The distinct cells where player would win, over every line.
+static int evalDistinctWinCells(const EvalState *state, const EvalTables *tables, int side)
+{
+    uint64_t cells = 0;
+    for (int line = 0; line < tables->lineCount; line++)
+    {
+        for (uint8_t mask = evalPattern(state, tables, line)->winCells[side]; mask;
+             mask &= mask - 1)
+        {
+            cells |= 1ull << tables->lineCells[line][__builtin_ctz(mask)];
+        }
+    }
+    return __builtin_popcountll(cells);
+}
+
+// From toMove's side. A win cell of its own wins next move, and two of the
+// opponent's can't both be blocked. Failing those, an open three of its own
+// becomes an open four while the opponent has no four to answer with.
+int HOT(evalScore)(const EvalState *state, const EvalTables *tables, Player toMove)
+{
+    int us = toMove - 1;
+
+    int theirWinCells = evalCount(state, EVAL_WIN_CELLS(us ^ 1));
+
+    if (evalCount(state, EVAL_WIN_CELLS(us)) > 0)
+        return EVAL_WIN_NEXT;
+    if (theirWinCells >= 2 && evalDistinctWinCells(state, tables, us ^ 1) >= 2)
+        return -EVAL_WIN_NEXT;
+    if (evalCount(state, EVAL_OPEN_THREES(us)) > 0 && theirWinCells == 0)
+        return EVAL_WIN_SOON;
+    return toMove == human ? state->score : -state->score;
+}
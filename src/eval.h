@@ -0,0 +1,82 @@
+#ifndef _EVAL_H_
+#define _EVAL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "logic.h"
+
+// Static evaluation from line patterns, for the depth-limited search on boards
+// bigger than 3x3.
+//
+// A board is read as its full lines: every row, column and diagonal long enough
+// to hold a win, edge to edge. Each one is packed into a base 3 code (a digit
+// per cell: 0 empty, 1 X, 2 O) and looked up in a table built for its length,
+// which gives the line's score and, for each player, its threats:
+//   - win cells: empty cells that would complete winLength in a row. One is a
+//     four; two or more in a line (.XXX. with four in a row) is an open four,
+//     which can't be blocked.
+//   - an open three: one move short of an open four. A broken three (X.XX.)
+//     counts when filling the gap makes one.
+// Each window of winLength cells still open to one player also scores by how
+// many of that player's pieces it holds, as twos and threes that aren't yet
+// threats.
+//
+// The codes, the summed score and the threat counts are updated as moves are
+// played and undone, so a leaf costs a few lookups instead of a pass over
+// every line.
+
+// 7x7 with three in a row: 7 rows, 7 columns and 9 diagonals each way.
+#define EVAL_MAX_LINES 32
+// 3^length codes for each line length from BOARD_MIN_WIN up to
+// BOARD_MAX_SIZE, one table after another: 27 + 81 + 243 + 729 + 2187.
+#define EVAL_PATTERNS 3267
+
+// Scores for the side to move with a win next move, or facing two it can't
+// both block; below any SEARCH_WIN score so a real win is still preferred.
+#define EVAL_WIN_NEXT 10000
+#define EVAL_WIN_SOON 5000
+
+// Threat counts packed a byte each, so adding up a line's takes one addition:
+// win cells of X and of O, then open threes of X and of O.
+#define EVAL_WIN_CELLS(side) (8 * (side))
+#define EVAL_OPEN_THREES(side) (16 + 8 * (side))
+
+typedef struct
+{
+  uint32_t counts;     // EVAL_WIN_CELLS and EVAL_OPEN_THREES
+  int16_t score;       // X's patterns less O's
+  uint8_t winCells[2]; // per player (index player - 1), a bit per cell of the line
+} EvalPattern;
+
+// Everything that depends only on the board's shape.
+typedef struct
+{
+  const BoardGeometry *geometry;
+  uint8_t size, winLength; // of the geometry the tables were built for
+  uint8_t lineCount;
+  uint8_t lineLength[EVAL_MAX_LINES];
+  uint8_t lineCells[EVAL_MAX_LINES][BOARD_MAX_SIZE];
+  const EvalPattern *linePatterns[EVAL_MAX_LINES]; // the table for the line's length
+  // The full lines through each cell, and 3^(the cell's place in the line).
+  uint8_t cellLineCount[BOARD_MAX_CELLS];
+  uint8_t cellLines[BOARD_MAX_CELLS][4];
+  uint16_t cellWeights[BOARD_MAX_CELLS][4];
+  EvalPattern patterns[EVAL_PATTERNS]; // from length winLength up
+} EvalTables;
+
+typedef struct
+{
+  uint16_t code[EVAL_MAX_LINES];
+  int32_t score;   // for X
+  uint32_t counts; // the lines' EvalPattern counts, summed
+} EvalState;
+
+void evalTablesInit(EvalTables *tables, const BoardGeometry *geometry);
+bool evalTablesMatch(const EvalTables *tables, const BoardGeometry *geometry);
+void evalInit(EvalState *state, const EvalTables *tables, const Board *board);
+void evalPlay(EvalState *state, const EvalTables *tables, int pos, Player player);
+void evalUndo(EvalState *state, const EvalTables *tables, int pos, Player player);
+int evalScore(const EvalState *state, const EvalTables *tables, Player toMove);
+
+#endif // _EVAL_H_
@@ -0,0 +1,89 @@
+#include "event_queue.h"
+
+#include <string.h>
+
+#include "hardware/sync.h"
+#include "trace.h"
+
+void eventQueueInit(EventQueue *queue)
+{
+    memset(queue, 0, sizeof(*queue));
+}
+
+static bool eventQueueFull(const EventQueue *queue)
+{
+    return queue->head - queue->tail == EVENT_QUEUE_LEN;
+}
+
+// Publishes one event. The slot must be fully written before head moves, and
+// the consumer woken after.
+static void eventQueuePublish(EventQueue *queue, const Event *event)
+{
+    queue->slots[queue->head % EVENT_QUEUE_LEN] = *event;
+    __dmb();
+    queue->head++;
+    __sev();
+    TRACE_INSTANT(EventPush, event->type);
+}
+
+// Moves the coalescing slot into the ring if there is room. Producer only.
+bool eventQueueFlush(EventQueue *queue)
+{
+    if (!queue->hasPending)
+        return true;
+    if (eventQueueFull(queue))
+        return false;
+    eventQueuePublish(queue, &queue->pending);
+    queue->hasPending = false;
+    return true;
+}
+
+bool eventQueuePush(EventQueue *queue, const Event *event, EventPolicy policy)
+{
+    // Anything parked earlier goes first to keep ordering.
+    if (eventQueueFlush(queue) && !eventQueueFull(queue))
+    {
+        eventQueuePublish(queue, event);
+        return true;
+    }
+
+    switch (policy)
+    {
+    case EventDrop:
+        queue->dropped++;
+        return false;
+    case EventCoalesce:
+        if (queue->hasPending && queue->pending.type == event->type &&
+            queue->pending.arg == event->arg)
+        {
+            queue->pending.count += event->count;
+            queue->pending.timeUs = event->timeUs;
+            queue->coalesced++;
+        }
+        else
+        {
+            if (queue->hasPending)
+                queue->dropped++;
+            queue->pending = *event;
+            queue->hasPending = true;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool eventQueuePop(EventQueue *queue, Event *event)
+{
+    if (eventQueueEmpty(queue))
+        return false;
+    __dmb();
+    *event = queue->slots[queue->tail % EVENT_QUEUE_LEN];
+    __dmb();
+    queue->tail++;
+    return true;
+}
+
+bool eventQueueEmpty(const EventQueue *queue)
+{
+    return queue->head == queue->tail;
+}
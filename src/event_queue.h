@@ -0,0 +1,57 @@
+#ifndef _EVENT_QUEUE_H_
+#define _EVENT_QUEUE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Lock-free single-producer/single-consumer ring of typed, timestamped events
+// in shared SRAM. Each queue must have exactly one producer context (a core's
+// main loop, or one interrupt handler) and one consumer context.
+//
+// Pushing signals the consumer with SEV, so a consumer sleeping in WFE (the
+// scheduler's idle wait) wakes up. A full queue never blocks the producer:
+// EventDrop discards the new event and EventCoalesce parks it in a
+// producer-side slot, merging repeats of the same event, until space frees up.
+
+#define EVENT_QUEUE_LEN 32 // must be a power of two
+
+typedef enum
+{
+  EventNone,
+  EventMove,   // arg: Move, count: repeats merged by coalescing
+  EventButton, // a debounced button press
+} EventType;
+
+typedef struct
+{
+  uint8_t type;
+  uint8_t arg;
+  uint16_t count;
+  uint32_t timeUs;
+} Event;
+
+typedef enum
+{
+  EventDrop,
+  EventCoalesce
+} EventPolicy;
+
+typedef struct
+{
+  Event slots[EVENT_QUEUE_LEN];
+  volatile uint32_t head; // written only by the producer
+  volatile uint32_t tail; // written only by the consumer
+  // Producer-private state.
+  Event pending;
+  bool hasPending;
+  uint32_t dropped;
+  uint32_t coalesced;
+} EventQueue;
+
+void eventQueueInit(EventQueue *queue);
+bool eventQueuePush(EventQueue *queue, const Event *event, EventPolicy policy);
+bool eventQueueFlush(EventQueue *queue);
+bool eventQueuePop(EventQueue *queue, Event *event);
+bool eventQueueEmpty(const EventQueue *queue);
+
+#endif // _EVENT_QUEUE_H_
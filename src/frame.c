@@ -0,0 +1,79 @@
+#include "frame.h"
+
+#include <string.h>
+
+enum
+{
+    WaitSync0,
+    WaitSync1,
+    WaitType,
+    WaitLength,
+    WaitPayload,
+    WaitChecksum
+};
+
+// Writes a complete frame to out (length + FRAME_OVERHEAD bytes) and returns
+// its size.
+uint16_t frameEncode(uint8_t type, const void *payload, uint8_t length, uint8_t *out)
+{
+    uint8_t checksum = type + length;
+    const uint8_t *bytes = payload;
+
+    out[0] = FRAME_SYNC0;
+    out[1] = FRAME_SYNC1;
+    out[2] = type;
+    out[3] = length;
+    memcpy(&out[4], payload, length);
+    for (int i = 0; i < length; i++)
+    {
+        checksum += bytes[i];
+    }
+    out[4 + length] = checksum;
+    return length + FRAME_OVERHEAD;
+}
+
+void frameParserInit(FrameParser *parser)
+{
+    parser->state = WaitSync0;
+}
+
+// Feeds one byte from the stream. Returns true when a frame with a valid
+// checksum has just completed; its type, length and payload are then valid
+// until the next call.
+bool frameParserFeed(FrameParser *parser, uint8_t byte)
+{
+    switch (parser->state)
+    {
+    case WaitSync0:
+        if (byte == FRAME_SYNC0)
+            parser->state = WaitSync1;
+        break;
+    case WaitSync1:
+        if (byte == FRAME_SYNC1)
+            parser->state = WaitType;
+        else if (byte != FRAME_SYNC0)
+            parser->state = WaitSync0;
+        break;
+    case WaitType:
+        parser->type = byte;
+        parser->checksum = byte;
+        parser->state = WaitLength;
+        break;
+    case WaitLength:
+        parser->length = byte;
+        parser->checksum += byte;
+        parser->received = 0;
+        parser->state = byte == 0 ? WaitChecksum : WaitPayload;
+        break;
+    case WaitPayload:
+        parser->payload[parser->received++] = byte;
+        parser->checksum += byte;
+        if (parser->received == parser->length)
+            parser->state = WaitChecksum;
+        break;
+    case WaitChecksum:
+        parser->state = WaitSync0;
+        return byte == parser->checksum;
+    }
+    return false;
+}
@@ -0,0 +1,44 @@
+#ifndef _FRAME_H_
+#define _FRAME_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Binary frames sent over the USB serial link. They share the stream with
+// ordinary printf text, so each one starts with a two byte sync pattern and
+// ends with a checksum, letting the host resynchronise on garbage:
+//
+//   0xA5 0x5A <type> <length> <payload...> <checksum>
+//
+// The checksum is the 8-bit sum of type, length and payload bytes.
+
+#define FRAME_SYNC0 0xA5
+#define FRAME_SYNC1 0x5A
+#define FRAME_OVERHEAD 5
+#define FRAME_MAX_PAYLOAD 255
+
+typedef enum
+{
+  FrameImuTraceHeader = 1,
+  FrameImuTraceSamples = 2,
+  FrameTraceNames = 3,
+  FrameTraceEvents = 4,
+  FrameTraceEnd = 5,
+  FrameLog = 6,
+} FrameType;
+
+typedef struct
+{
+  uint8_t state;
+  uint8_t type;
+  uint8_t length;
+  uint8_t received;
+  uint8_t checksum;
+  uint8_t payload[FRAME_MAX_PAYLOAD];
+} FrameParser;
+
+uint16_t frameEncode(uint8_t type, const void *payload, uint8_t length, uint8_t *out);
+void frameParserInit(FrameParser *parser);
+bool frameParserFeed(FrameParser *parser, uint8_t byte);
+
+#endif // _FRAME_H_
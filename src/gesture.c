@@ -0,0 +1,95 @@
+#include "gesture.h"
+
+#include <stddef.h>
+
+// Tuned for ~125 Hz accelerometer samples: the filter settles in roughly three
+// samples and a held tilt repeats at about the rate the old 500 ms polling
+// loop produced moves.
+const GestureConfig gestureDefaultConfig = {
+    .smoothing = 0.35f,
+    .enterThreshold = {0.6f, 0.4f},
+    .exitThreshold = {0.3f, 0.2f},
+    .repeatDelayUs = 500 * 1000,
+    .repeatIntervalUs = 350 * 1000,
+};
+
+static const Move positiveMove[2] = {Left, Up};
+static const Move negativeMove[2] = {Right, Down};
+
+void gestureInit(Gesture *gesture, const GestureConfig *config)
+{
+    gesture->config = *config;
+    gesture->primed = false;
+    for (int i = 0; i < 2; i++)
+    {
+        gesture->filtered[i] = 0;
+        gesture->axis[i] = AxisNeutral;
+    }
+    gesture->nextRepeatUs = 0;
+}
+
+static Move axisMove(int axis, AxisState state)
+{
+    return state == AxisPositive ? positiveMove[axis] : negativeMove[axis];
+}
+
+// Feeds one sample. Returns true and sets *move when a move should be
+// performed. Only one axis can be engaged at a time, so a diagonal tilt never
+// produces two moves, and an axis must pass back through its neutral zone
+// before it can fire again (other than through auto-repeat).
+bool gestureUpdate(Gesture *gesture, float x, float y, uint32_t timeUs, Move *move)
+{
+    const GestureConfig *config = &gesture->config;
+    const float sample[2] = {x, y};
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (!gesture->primed)
+            gesture->filtered[i] = sample[i];
+        else
+            gesture->filtered[i] += config->smoothing * (sample[i] - gesture->filtered[i]);
+    }
+    gesture->primed = true;
+
+    // Engaged axis: release on entering the neutral zone, otherwise repeat.
+    for (int i = 0; i < 2; i++)
+    {
+        AxisState state = gesture->axis[i];
+        if (state == AxisNeutral)
+            continue;
+
+        float value = state == AxisPositive ? gesture->filtered[i] : -gesture->filtered[i];
+        if (value < config->exitThreshold[i])
+        {
+            gesture->axis[i] = AxisNeutral;
+            return false;
+        }
+        if (config->repeatDelayUs != 0 && (int32_t)(timeUs - gesture->nextRepeatUs) >= 0)
+        {
+            gesture->nextRepeatUs = timeUs + config->repeatIntervalUs;
+            *move = axisMove(i, state);
+            return true;
+        }
+        return false;
+    }
+
+    // Nothing engaged: x takes priority, as it did in the original classifier.
+    for (int i = 0; i < 2; i++)
+    {
+        float value = gesture->filtered[i];
+        AxisState state = AxisNeutral;
+        if (value > config->enterThreshold[i])
+            state = AxisPositive;
+        else if (value < -config->enterThreshold[i])
+            state = AxisNegative;
+
+        if (state != AxisNeutral)
+        {
+            gesture->axis[i] = state;
+            gesture->nextRepeatUs = timeUs + config->repeatDelayUs;
+            *move = axisMove(i, state);
+            return true;
+        }
+    }
+    return false;
+}
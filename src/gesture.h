@@ -0,0 +1,53 @@
+#ifndef _GESTURE_H_
+#define _GESTURE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum
+{
+  Left,
+  Right,
+  Up,
+  Down
+} Move;
+
+// Tilt thresholds are in g. Index 0 is the x axis (+x = Left), index 1 the y
+// axis (+y = Up).
+typedef struct
+{
+  // Single-pole low-pass coefficient applied per sample: 1 disables filtering,
+  // smaller values smooth more (and add latency).
+  float smoothing;
+  // Filtered tilt needed to engage an axis and emit a move.
+  float enterThreshold[2];
+  // Filtered tilt below which an engaged axis returns to neutral and re-arms.
+  // Keeping it well under enterThreshold is what gives the hysteresis.
+  float exitThreshold[2];
+  // Hold time before a held tilt starts repeating, 0 disables auto-repeat.
+  uint32_t repeatDelayUs;
+  uint32_t repeatIntervalUs;
+} GestureConfig;
+
+typedef enum
+{
+  AxisNeutral,
+  AxisPositive,
+  AxisNegative
+} AxisState;
+
+typedef struct
+{
+  GestureConfig config;
+  bool primed;
+  float filtered[2];
+  AxisState axis[2];
+  uint32_t nextRepeatUs;
+} Gesture;
+
+extern const GestureConfig gestureDefaultConfig;
+
+void gestureInit(Gesture *gesture, const GestureConfig *config);
+bool gestureUpdate(Gesture *gesture, float x, float y, uint32_t timeUs, Move *move);
+
+#endif // _GESTURE_H_
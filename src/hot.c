@@ -0,0 +1,122 @@
+#include "hot.h"
+
+#if HOT_BENCH
+
+#include <stdio.h>
+
+#include "pico/stdlib.h"
+#include "hardware/structs/systick.h"
+#include "hardware/structs/xip_ctrl.h"
+#include "lib/st7735.h"
+#include "lib/ICM20948.h"
+#include "logic.h"
+#include "search.h"
+#include "constants.h"
+
+#define HOT_BENCH_RUNS 16
+
+#if HOT_IN_RAM
+#define HOT_PLACEMENT "SRAM"
+#else
+#define HOT_PLACEMENT "flash"
+#endif
+
+typedef struct
+{
+    const char *name;
+    void (*prepare)(void); // untimed, may be NULL
+    void (*run)(void);
+} HotBenchCase;
+
+static BoardGeometry benchGeometry;
+static Board benchBoard;
+static GridPos benchGrid[POSITIONS];
+
+static void benchFillRectangle(void)
+{
+    ST7735_FillRectangle(0, ST7735_HEIGHT - 8, 8, 8, ST7735_BLACK);
+}
+
+static void benchDrawPixel(void)
+{
+    ST7735_DrawPixel(0, ST7735_HEIGHT - 1, ST7735_BLACK);
+}
+
+static void benchWinner(void)
+{
+    winner(benchGrid);
+}
+
+static void benchSearchPrepare(void)
+{
+    searchClear();
+    boardInit(&benchBoard, &benchGeometry);
+    boardPlay(&benchBoard, 4, human);
+}
+
+static void benchSearch(void)
+{
+    SearchResult result;
+    searchBestMove(&benchBoard, ai, 4, 1, &result);
+}
+
+static void benchAhrs(void)
+{
+    imuAHRSupdate(0.01f, -0.02f, 0.005f, 0.0f, 0.0f, 1.0f, 20.0f, 5.0f, -40.0f);
+}
+
+static const HotBenchCase benchCases[] = {
+    {"FillRectangle 8x8", NULL, benchFillRectangle},
+    {"DrawPixel", NULL, benchDrawPixel},
+    {"winner", NULL, benchWinner},
+    {"search 3x3 d4", benchSearchPrepare, benchSearch},
+    {"imuAHRSupdate", NULL, benchAhrs},
+};
+
+// Kept in SRAM whatever TTT_HOT_IN_RAM says, so that the harness's own code
+// never misses after the flush.
+static uint32_t __not_in_flash_func(hotTime)(void (*run)(void), bool flush)
+{
+    if (flush)
+    {
+        xip_ctrl_hw->flush = 1;
+        (void)xip_ctrl_hw->flush; // reads stall until the flush is done
+    }
+    uint32_t start = systick_hw->cvr;
+    run();
+    return (start - systick_hw->cvr) & 0xFFFFFF;
+}
+
+// Times each hot path right after an XIP cache flush (cold) and straight after
+// a previous call (warm), keeping the best of HOT_BENCH_RUNS. Code in SRAM
+// should show little difference; compare with a -DTTT_HOT_IN_RAM=OFF build.
+void hotBenchmark(void)
+{
+    systick_hw->rvr = 0xFFFFFF;
+    systick_hw->cvr = 0;
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+    boardGeometryInit(&benchGeometry, 3, 3);
+
+    printf("hot path benchmark (cycles, hot code in " HOT_PLACEMENT ")\n");
+    printf("  %-18s %8s %8s\n", "case", "cold", "warm");
+    for (int c = 0; c < (int)(sizeof(benchCases) / sizeof(benchCases[0])); c++)
+    {
+        const HotBenchCase *bench = &benchCases[c];
+        uint32_t best[2] = {UINT32_MAX, UINT32_MAX};
+        for (int run = 0; run < HOT_BENCH_RUNS; run++)
+        {
+            for (int warm = 0; warm < 2; warm++)
+            {
+                if (bench->prepare)
+                    bench->prepare();
+                uint32_t cycles = hotTime(bench->run, !warm);
+                if (cycles < best[warm])
+                    best[warm] = cycles;
+            }
+        }
+        printf("  %-18s %8lu %8lu\n", bench->name, (unsigned long)best[0],
+               (unsigned long)best[1]);
+    }
+}
+
+#endif // HOT_BENCH
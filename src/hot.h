@@ -0,0 +1,43 @@
+#ifndef _HOT_H_
+#define _HOT_H_
+
+#include <stdint.h>
+
+#include "pico/platform.h"
+#include "hardware/regs/addressmap.h"
+
+// Code runs from flash through a 16 KB XIP cache, which large assets such as
+// the splash image and font also pass through. HOT(name) in a function's
+// definition copies it to SRAM at boot so it never misses:
+//
+//   void HOT(winner)(GridPos *grid) { ... }
+//
+// and HOT_DATA does the same for a constant lookup table. Keep both to code
+// that runs per pixel, per search node or per sample; SRAM is the scarcer of
+// the two. mem_report.txt lists everything placed this way.
+//
+// Configure with -DTTT_HOT_IN_RAM=OFF to leave everything in flash, e.g. to
+// compare with the cold-cache numbers from -DTTT_HOT_BENCH=ON.
+
+#if HOT_IN_RAM
+#define HOT(name) __not_in_flash_func(name)
+#define HOT_DATA __not_in_flash("hot_data")
+#else
+#define HOT(name) name
+#define HOT_DATA
+#endif
+
+// The same flash contents through the uncached, non-allocating XIP alias. For
+// assets that are read once per draw, so they don't evict cached code.
+#if PICO_NO_HARDWARE
+#define UNCACHED(pointer) (pointer)
+#else
+#define UNCACHED(pointer) \
+  ((__typeof__(pointer))((uintptr_t)(pointer) - XIP_BASE + XIP_NOCACHE_NOALLOC_BASE))
+#endif
+
+#if HOT_BENCH
+void hotBenchmark(void);
+#endif
+
+#endif // _HOT_H_
@@ -0,0 +1,68 @@
+#include "imu_trace.h"
+
+static void put16(uint8_t *out, uint16_t value)
+{
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static uint16_t get16(const uint8_t *in)
+{
+    return in[0] | (in[1] << 8);
+}
+
+void imuTraceEncodeHeader(const ImuTraceHeader *header, uint8_t *out)
+{
+    out[0] = header->version;
+    out[1] = header->samplePeriodMs;
+    put16(&out[2], header->accelLsbPerG);
+    put16(&out[4], header->gyroLsbPerDps10);
+}
+
+bool imuTraceDecodeHeader(const uint8_t *in, uint8_t length, ImuTraceHeader *header)
+{
+    if (length < IMU_TRACE_HEADER_LEN || in[0] != IMU_TRACE_VERSION)
+    {
+        return false;
+    }
+    header->version = in[0];
+    header->samplePeriodMs = in[1];
+    header->accelLsbPerG = get16(&in[2]);
+    header->gyroLsbPerDps10 = get16(&in[4]);
+    return true;
+}
+
+void imuTraceEncodeRecord(const ImuTraceRecord *record, uint8_t *out)
+{
+    put16(&out[0], record->timeUs & 0xFFFF);
+    put16(&out[2], record->timeUs >> 16);
+    for (int i = 0; i < 3; i++)
+    {
+        put16(&out[4 + 2 * i], (uint16_t)record->accel[i]);
+        put16(&out[10 + 2 * i], (uint16_t)record->gyro[i]);
+    }
+}
+
+void imuTraceDecodeRecord(const uint8_t *in, ImuTraceRecord *record)
+{
+    record->timeUs = get16(&in[0]) | ((uint32_t)get16(&in[2]) << 16);
+    for (int i = 0; i < 3; i++)
+    {
+        record->accel[i] = (int16_t)get16(&in[4 + 2 * i]);
+        record->gyro[i] = (int16_t)get16(&in[10 + 2 * i]);
+    }
+}
+
+void imuTraceRecorderInit(ImuTraceRecorder *recorder)
+{
+    recorder->count = 0;
+}
+
+// Appends a record to the current batch. Returns true when the batch is full;
+// the caller then sends payload (count records) and re-initialises.
+bool imuTraceRecorderAdd(ImuTraceRecorder *recorder, const ImuTraceRecord *record)
+{
+    imuTraceEncodeRecord(record, &recorder->payload[recorder->count * IMU_TRACE_RECORD_LEN]);
+    recorder->count++;
+    return recorder->count == IMU_TRACE_BATCH;
+}
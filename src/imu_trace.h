@@ -0,0 +1,50 @@
+#ifndef _IMU_TRACE_H_
+#define _IMU_TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Compact binary trace of raw IMU samples, streamed inside serial frames (see
+// frame.h) so a capture of the USB serial port can be replayed on the host.
+//
+// A FrameImuTraceHeader frame describes the units; FrameImuTraceSamples frames
+// carry up to IMU_TRACE_BATCH records of IMU_TRACE_RECORD_LEN bytes each. All
+// fields are little-endian.
+
+#define IMU_TRACE_VERSION 1
+#define IMU_TRACE_HEADER_LEN 6
+#define IMU_TRACE_RECORD_LEN 16
+#define IMU_TRACE_BATCH 8
+// The header is repeated so a capture started after boot can still be decoded.
+#define IMU_TRACE_HEADER_INTERVAL 32
+
+typedef struct
+{
+  uint8_t version;
+  uint8_t samplePeriodMs;
+  uint16_t accelLsbPerG;
+  uint16_t gyroLsbPerDps10; // LSB per degree/s, times 10
+} ImuTraceHeader;
+
+typedef struct
+{
+  uint32_t timeUs;
+  int16_t accel[3];
+  int16_t gyro[3];
+} ImuTraceRecord;
+
+typedef struct
+{
+  uint8_t count;
+  uint8_t payload[IMU_TRACE_BATCH * IMU_TRACE_RECORD_LEN];
+} ImuTraceRecorder;
+
+void imuTraceEncodeHeader(const ImuTraceHeader *header, uint8_t *out);
+bool imuTraceDecodeHeader(const uint8_t *in, uint8_t length, ImuTraceHeader *header);
+void imuTraceEncodeRecord(const ImuTraceRecord *record, uint8_t *out);
+void imuTraceDecodeRecord(const uint8_t *in, ImuTraceRecord *record);
+
+void imuTraceRecorderInit(ImuTraceRecorder *recorder);
+bool imuTraceRecorderAdd(ImuTraceRecorder *recorder, const ImuTraceRecord *record);
+
+#endif // _IMU_TRACE_H_
@@ -28,6 +28,7 @@
 #
 ******************************************************************************/
 #include "DEV_Config.h"
+#include "../hot.h"
 
 
 
@@ -43,7 +44,7 @@ uint slice_num;
 /**
  * GPIO read and write
 **/
-void DEV_Digital_Write(UWORD Pin, UBYTE Value)
+void HOT(DEV_Digital_Write)(UWORD Pin, UBYTE Value)
 {
 	gpio_put(Pin, Value);
 }
@@ -106,7 +107,12 @@ UBYTE DEV_Module_Init(void)
     gpio_set_function(EPD_MOSI_PIN, GPIO_FUNC_SPI);
     // GPIO Config
     DEV_GPIO_Init();
+#if PICO_ON_DEVICE
     printf("DEV_Module_Init OK \r\n");
+#else
+    // stdout carries the host tools' reports (micro_bench's JSON).
+    fprintf(stderr, "DEV_Module_Init OK\n");
+#endif
     return 0;
 }
 
@@ -1,10 +1,39 @@
 #include "ICM20948.h"
+#include "../hot.h"
 #include <hardware/gpio.h>
+#include <pico/time.h>
+#include <stdio.h>
+#include <string.h>
 
 #define I2C_PORT i2c0
 IMU_ST_SENSOR_DATA gstGyroOffset = { 0, 0, 0 };
+IMU_ST_SENSOR_DATA gstAccelOffset = { 0, 0, 0 };
+float              gfMagHardIron[3] = { 0.0f, 0.0f, 0.0f };
+float              gfMagSoftIron[3] = { 1.0f, 1.0f, 1.0f };
 
-char I2C_ReadOneByte(uint8_t reg) {
+// REG_BANK_SEL is readable from every bank, so the last value written is all we
+// need to know which bank the device is in.
+static uint8_t su8CurrentBank = REG_VAL_REG_BANK_UNKNOWN;
+
+/* Power-up configuration. Consecutive registers of the same bank are sent as a
+ * single burst write by icm20948ApplyTable(). */
+static const ICM20948_ST_REG_WRITE sstInitTable[] = {
+  /* user bank 0 register */
+  { REG_VAL_REG_BANK_0, REG_ADD_PWR_MIGMT_1, REG_VAL_RUN_MODE },
+  { REG_VAL_REG_BANK_0, REG_ADD_INT_ENABLE_1, REG_VAL_BIT_RAW_DATA_0_RDY_EN },
+  /* user bank 2 register */
+  { REG_VAL_REG_BANK_2, REG_ADD_GYRO_SMPLRT_DIV, 0x08 },
+  { REG_VAL_REG_BANK_2, REG_ADD_GYRO_CONFIG_1, REG_VAL_BIT_GYRO_DLPCFG_6
+                                               | REG_VAL_BIT_GYRO_FS_2000DPS
+                                               | REG_VAL_BIT_GYRO_DLPF },
+  { REG_VAL_REG_BANK_2, REG_ADD_ACCEL_SMPLRT_DIV_1, 0x00 },  // 119 Hz
+  { REG_VAL_REG_BANK_2, REG_ADD_ACCEL_SMPLRT_DIV_2, 0x08 },
+  { REG_VAL_REG_BANK_2, REG_ADD_ACCEL_CONFIG, REG_VAL_BIT_ACCEL_DLPCFG_6
+                                              | REG_VAL_BIT_ACCEL_FS_4g
+                                              | REG_VAL_BIT_ACCEL_DLPF },
+};
+
+uint8_t I2C_ReadOneByte(uint8_t reg) {
   uint8_t buf;
   i2c_write_blocking(I2C_PORT, I2C_ADD_ICM20948, &reg, 1, true);
   i2c_read_blocking(I2C_PORT, I2C_ADD_ICM20948, &buf, 1, false);
@@ -14,6 +43,180 @@ char I2C_ReadOneByte(uint8_t reg) {
 void I2C_WriteOneByte(uint8_t reg, uint8_t value) {
   uint8_t buf[] = { reg, value };
   i2c_write_blocking(I2C_PORT, I2C_ADD_ICM20948, buf, 2, false);
+  if (reg == REG_ADD_REG_BANK_SEL) {
+    su8CurrentBank = value;
+  }
+}
+
+/******************************************************************************
+ * Register access layer                                                      *
+ ******************************************************************************/
+
+void icm20948SelectBank(uint8_t u8Bank) {
+  if (u8Bank != su8CurrentBank) {
+    I2C_WriteOneByte(REG_ADD_REG_BANK_SEL, u8Bank);
+  }
+}
+
+void icm20948InvalidateBank(void) {
+  su8CurrentBank = REG_VAL_REG_BANK_UNKNOWN;
+}
+
+uint8_t icm20948ReadReg(uint8_t u8Bank, uint8_t u8Reg) {
+  icm20948SelectBank(u8Bank);
+  return I2C_ReadOneByte(u8Reg);
+}
+
+void icm20948WriteReg(uint8_t u8Bank, uint8_t u8Reg, uint8_t u8Val) {
+  icm20948SelectBank(u8Bank);
+  I2C_WriteOneByte(u8Reg, u8Val);
+}
+
+// Reads u8Len consecutive registers in one transaction (the device
+// auto-increments the register address).
+bool icm20948ReadRegs(uint8_t u8Bank, uint8_t u8Reg, uint8_t *pu8Data, uint8_t u8Len) {
+  icm20948SelectBank(u8Bank);
+  if (i2c_write_blocking(I2C_PORT, I2C_ADD_ICM20948, &u8Reg, 1, true) != 1) {
+    return false;
+  }
+  return i2c_read_blocking(I2C_PORT, I2C_ADD_ICM20948, pu8Data, u8Len, false) == u8Len;
+}
+
+// Writes u8Len consecutive registers in one transaction.
+bool icm20948WriteRegs(uint8_t u8Bank, uint8_t u8Reg, const uint8_t *pu8Data,
+                       uint8_t u8Len) {
+  uint8_t u8Buf[ICM20948_BURST_MAX + 1];
+
+  if (u8Len > ICM20948_BURST_MAX) {
+    return false;
+  }
+  icm20948SelectBank(u8Bank);
+  u8Buf[0] = u8Reg;
+  memcpy(&u8Buf[1], pu8Data, u8Len);
+  return i2c_write_blocking(I2C_PORT, I2C_ADD_ICM20948, u8Buf, u8Len + 1, false)
+         == u8Len + 1;
+}
+
+// Applies a register table, merging runs of consecutive registers in the same
+// bank into burst writes and only switching banks when the bank changes.
+void icm20948ApplyTable(const ICM20948_ST_REG_WRITE *pstTable, uint8_t u8Count) {
+  uint8_t u8Burst[ICM20948_BURST_MAX];
+  uint8_t i = 0;
+
+  while (i < u8Count) {
+    const ICM20948_ST_REG_WRITE *pstStart = &pstTable[i];
+    uint8_t u8Len = 0;
+
+    while (i < u8Count && u8Len < ICM20948_BURST_MAX
+           && pstTable[i].u8Bank == pstStart->u8Bank
+           && pstTable[i].u8Reg == pstStart->u8Reg + u8Len) {
+      u8Burst[u8Len++] = pstTable[i++].u8Val;
+    }
+    icm20948WriteRegs(pstStart->u8Bank, pstStart->u8Reg, u8Burst, u8Len);
+  }
+}
+
+// Polls a register until (value & u8Mask) == u8Val. Failed reads (e.g. the
+// device NACKing while it resets) count as "not yet".
+bool icm20948WaitReg(uint8_t u8Bank, uint8_t u8Reg, uint8_t u8Mask, uint8_t u8Val,
+                     uint32_t u32TimeoutUs) {
+  absolute_time_t stDeadline = make_timeout_time_us(u32TimeoutUs);
+  uint8_t         u8Data;
+
+  do {
+    if (icm20948ReadRegs(u8Bank, u8Reg, &u8Data, 1) && (u8Data & u8Mask) == u8Val) {
+      return true;
+    }
+  } while (!time_reached(stDeadline));
+  return false;
+}
+
+// Waits for the next "raw data ready" edge. INT_STATUS_1 clears on read, so a
+// stale flag is discarded first.
+bool icm20948WaitDataReady(uint32_t u32TimeoutUs) {
+  icm20948ReadReg(REG_VAL_REG_BANK_0, REG_ADD_INT_STATUS_1);
+  return icm20948WaitReg(REG_VAL_REG_BANK_0, REG_ADD_INT_STATUS_1,
+                         REG_VAL_BIT_RAW_DATA_0_RDY_INT, REG_VAL_BIT_RAW_DATA_0_RDY_INT,
+                         u32TimeoutUs);
+}
+
+// Runs the queued I2C master (secondary bus) transactions once. The master is
+// clocked by the sensor sample rate, so EXT_SENS_DATA is fresh after the next
+// data-ready edge.
+static void icm20948RunMaster(void) {
+  uint8_t u8Temp = icm20948ReadReg(REG_VAL_REG_BANK_0, REG_ADD_USER_CTRL);
+
+  I2C_WriteOneByte(REG_ADD_USER_CTRL, u8Temp | REG_VAL_BIT_I2C_MST_EN);
+  if (!icm20948WaitDataReady(ICM20948_DATA_TIMEOUT_US)) {
+    printf("ICM20948: secondary I2C timed out\n");
+  }
+  icm20948WriteReg(REG_VAL_REG_BANK_0, REG_ADD_USER_CTRL,
+                   u8Temp & ~REG_VAL_BIT_I2C_MST_EN);
+}
+
+/******************************************************************************
+ * Asynchronous sample reads                                                  *
+ ******************************************************************************/
+
+// Queues a burst read of one accel+gyro sample into pu8Buf
+// (ICM20948_SAMPLE_LEN bytes). If the cached bank is not bank 0, a bank
+// switch is queued ahead of it.
+bool icm20948SubmitSampleRead(I2C_ASYNC_ST_TXN *pstTxn, uint8_t *pu8Buf,
+                              I2C_ASYNC_CALLBACK pfnDone, void *pvContext) {
+  static const uint8_t    su8SampleReg     = REG_ADD_ACCEL_XOUT_H;
+  static const uint8_t    su8SelectBank0[] = { REG_ADD_REG_BANK_SEL, REG_VAL_REG_BANK_0 };
+  static I2C_ASYNC_ST_TXN sstBankTxn;
+
+  if (su8CurrentBank != REG_VAL_REG_BANK_0) {
+    sstBankTxn.u8Addr     = I2C_ADD_ICM20948;
+    sstBankTxn.pu8Write   = su8SelectBank0;
+    sstBankTxn.u8WriteLen = sizeof(su8SelectBank0);
+    sstBankTxn.u8ReadLen  = 0;
+    sstBankTxn.pfnDone    = NULL;
+    if (!i2cAsyncSubmit(&sstBankTxn)) {
+      return false;
+    }
+    su8CurrentBank = REG_VAL_REG_BANK_0;
+  }
+
+  pstTxn->u8Addr     = I2C_ADD_ICM20948;
+  pstTxn->pu8Write   = &su8SampleReg;
+  pstTxn->u8WriteLen = 1;
+  pstTxn->pu8Read    = pu8Buf;
+  pstTxn->u8ReadLen  = ICM20948_SAMPLE_LEN;
+  pstTxn->pfnDone    = pfnDone;
+  pstTxn->pvContext  = pvContext;
+  return i2cAsyncSubmit(pstTxn);
+}
+
+void icm20948ParseSample(const uint8_t *pu8Buf, ICM20948_ST_RAW_SAMPLE *pstSample) {
+  pstSample->stAccel.s16X = (int16_t)((pu8Buf[0] << 8) | pu8Buf[1]);
+  pstSample->stAccel.s16Y = (int16_t)((pu8Buf[2] << 8) | pu8Buf[3]);
+  pstSample->stAccel.s16Z = (int16_t)((pu8Buf[4] << 8) | pu8Buf[5]);
+  pstSample->stGyro.s16X  = (int16_t)((pu8Buf[6] << 8) | pu8Buf[7]);
+  pstSample->stGyro.s16Y  = (int16_t)((pu8Buf[8] << 8) | pu8Buf[9]);
+  pstSample->stGyro.s16Z  = (int16_t)((pu8Buf[10] << 8) | pu8Buf[11]);
+}
+
+// Blocking counterpart of icm20948SubmitSampleRead(), returning raw counts.
+bool icm20948ReadRawSample(ICM20948_ST_RAW_SAMPLE *pstSample) {
+  uint8_t u8Buf[ICM20948_SAMPLE_LEN];
+
+  if (!icm20948ReadRegs(REG_VAL_REG_BANK_0, REG_ADD_ACCEL_XOUT_H, u8Buf, sizeof(u8Buf))) {
+    return false;
+  }
+  icm20948ParseSample(u8Buf, pstSample);
+  return true;
+}
+
+// Removes the calibrated accel and gyro biases from a raw sample.
+void icm20948ApplyOffsets(ICM20948_ST_RAW_SAMPLE *pstSample) {
+  pstSample->stAccel.s16X -= gstAccelOffset.s16X;
+  pstSample->stAccel.s16Y -= gstAccelOffset.s16Y;
+  pstSample->stAccel.s16Z -= gstAccelOffset.s16Z;
+  pstSample->stGyro.s16X  -= gstGyroOffset.s16X;
+  pstSample->stGyro.s16Y  -= gstGyroOffset.s16Y;
+  pstSample->stGyro.s16Z  -= gstGyroOffset.s16Z;
 }
 
 /******************************************************************************
@@ -118,7 +321,7 @@ bool imuDataGet(IMU_ST_ANGLES_DATA *pstAngles,
   return true;
 }
 
-void imuAHRSupdate(float gx, float gy, float gz, float ax, float ay, float az,
+void HOT(imuAHRSupdate)(float gx, float gy, float gz, float ax, float ay, float az,
                              float mx, float my, float mz) {
   float norm;
   float hx, hy, hz, bx, bz;
@@ -190,13 +393,14 @@ void imuAHRSupdate(float gx, float gy, float gz, float ax, float ay, float az,
   q3   = q3 * norm;
 }
 
-float invSqrt(float x) {
+float HOT(invSqrt)(float x) {
   float halfx = 0.5f * x;
   float y     = x;
 
-  long i = *(long *)&y;                   // get bits for floating value
+  int32_t i;
+  memcpy(&i, &y, sizeof(i));              // get bits for floating value
   i      = 0x5f3759df - (i >> 1);         // gives initial guss you
-  y      = *(float *)&i;                  // convert bits back to float
+  memcpy(&y, &i, sizeof(y));              // convert bits back to float
   y      = y * (1.5f - (halfx * y * y));  // newtop step, repeating increases accuracy
 
   return y;
@@ -221,35 +425,29 @@ void setContinuousMode(){
 void icm20948init() {
 
   /* user bank 0 register */
-  I2C_WriteOneByte(REG_ADD_REG_BANK_SEL, REG_VAL_REG_BANK_0);
-  I2C_WriteOneByte(REG_ADD_PWR_MIGMT_1, REG_VAL_ALL_RGE_RESET);
-  sleep_ms(10);
-  I2C_WriteOneByte(REG_ADD_PWR_MIGMT_1, REG_VAL_RUN_MODE);
-
-  /* user bank 2 register */
-  I2C_WriteOneByte(REG_ADD_REG_BANK_SEL, REG_VAL_REG_BANK_2);
-  I2C_WriteOneByte(REG_ADD_GYRO_SMPLRT_DIV, 0x08);
-  I2C_WriteOneByte(REG_ADD_GYRO_CONFIG_1, REG_VAL_BIT_GYRO_DLPCFG_6
-                                            | REG_VAL_BIT_GYRO_FS_2000DPS
-                                            | REG_VAL_BIT_GYRO_DLPF);
-  I2C_WriteOneByte( REG_ADD_ACCEL_SMPLRT_DIV_1,  0x00);  // 119 Hz
-  I2C_WriteOneByte( REG_ADD_ACCEL_SMPLRT_DIV_2,  0x08);
-  I2C_WriteOneByte(REG_ADD_ACCEL_CONFIG, REG_VAL_BIT_ACCEL_DLPCFG_6
-                                           | REG_VAL_BIT_ACCEL_FS_4g
-                                           | REG_VAL_BIT_ACCEL_DLPF);
-
-
-  /* user bank 0 register */
-  I2C_WriteOneByte(REG_ADD_REG_BANK_SEL, REG_VAL_REG_BANK_0);
+  icm20948WriteReg(REG_VAL_REG_BANK_0, REG_ADD_PWR_MIGMT_1, REG_VAL_ALL_RGE_RESET);
+  // The reset returns REG_BANK_SEL to bank 0 along with everything else.
+  su8CurrentBank = REG_VAL_REG_BANK_0;
+  if (!icm20948WaitReg(REG_VAL_REG_BANK_0, REG_ADD_PWR_MIGMT_1, REG_VAL_ALL_RGE_RESET, 0,
+                       ICM20948_RESET_TIMEOUT_US)) {
+    printf("ICM20948: reset timed out\n");
+  }
 
-  sleep_ms(100);
-  /* offset */
-  icm20948GyroOffset();
+  icm20948ApplyTable(sstInitTable, sizeof(sstInitTable) / sizeof(sstInitTable[0]));
 
+  // Wait for the first sample instead of a fixed settling delay.
+  if (!icm20948WaitDataReady(ICM20948_RESET_TIMEOUT_US)) {
+    printf("ICM20948: no data after init\n");
+  }
+  // Offsets are not measured here: the caller either restores them from flash
+  // or runs icm20948GyroOffset()/icm20948AccelOffset() (see calibration.c).
   icm20948MagCheck();
 
   icm20948WriteSecondary(I2C_ADD_ICM20948_AK09916 | I2C_ADD_ICM20948_AK09916_WRITE,
                          REG_ADD_MAG_CNTL2, REG_VAL_MAG_MODE_20HZ);
+
+  // Leave the device in bank 0, where all sample registers live.
+  icm20948SelectBank(REG_VAL_REG_BANK_0);
 }
 
 bool icm20948Check() {
@@ -263,38 +461,16 @@ bool icm20948Check() {
 bool icm20948GyroRead(float *ps16X, float *ps16Y, float *ps16Z) {
   uint8_t u8Buf[6];
   int16_t s16Buf[3] = { 0 };
-  uint8_t i;
-  int32_t s32OutBuf[3] = { 0 };
-  //
-  static ICM20948_ST_AVG_DATA sstAvgBuf[3];
-  static int16_t              ss16c = 0;
-  ss16c++;
-
-  u8Buf[0]  = I2C_ReadOneByte(REG_ADD_GYRO_XOUT_L);
-  u8Buf[1]  = I2C_ReadOneByte(REG_ADD_GYRO_XOUT_H);
-  s16Buf[0] = (u8Buf[1] << 8) | u8Buf[0];
-
-  u8Buf[0]  = I2C_ReadOneByte(REG_ADD_GYRO_YOUT_L);
-  u8Buf[1]  = I2C_ReadOneByte(REG_ADD_GYRO_YOUT_H);
-  s16Buf[1] = (u8Buf[1] << 8) | u8Buf[0];
-
-  u8Buf[0]  = I2C_ReadOneByte(REG_ADD_GYRO_ZOUT_L);
-  u8Buf[1]  = I2C_ReadOneByte(REG_ADD_GYRO_ZOUT_H);
-  s16Buf[2] = (u8Buf[1] << 8) | u8Buf[0];
-
-  *ps16X = s16Buf[0] * 2000.0 / 32768.0;
-  *ps16Y = s16Buf[1] * 2000.0 / 32768.0;
-  *ps16Z = s16Buf[2] * 2000.0 / 32768.0;
-
- /*
-  for (i = 0; i < 3; i++) {
-    icm20948CalAvgValue(&sstAvgBuf[i].u8Index, sstAvgBuf[i].s16AvgBuffer, s16Buf[i],
-                        s32OutBuf + i);
-  }
-  *ps16X = s32OutBuf[0] - gstGyroOffset.s16X;
-  *ps16Y = s32OutBuf[1] - gstGyroOffset.s16Y;
-  *ps16Z = s32OutBuf[2] - gstGyroOffset.s16Z;
-*/
+
+  // One burst read of XOUT_H..ZOUT_L (big-endian pairs).
+  icm20948ReadRegs(REG_VAL_REG_BANK_0, REG_ADD_GYRO_XOUT_H, u8Buf, sizeof(u8Buf));
+  s16Buf[0] = (u8Buf[0] << 8) | u8Buf[1];
+  s16Buf[1] = (u8Buf[2] << 8) | u8Buf[3];
+  s16Buf[2] = (u8Buf[4] << 8) | u8Buf[5];
+
+  *ps16X = (s16Buf[0] - gstGyroOffset.s16X) * 2000.0 / 32768.0;
+  *ps16Y = (s16Buf[1] - gstGyroOffset.s16Y) * 2000.0 / 32768.0;
+  *ps16Z = (s16Buf[2] - gstGyroOffset.s16Z) * 2000.0 / 32768.0;
 
   if (*ps16X == 0 && *ps16Y == 0 && *ps16Z == 0) {
     return false;
@@ -304,38 +480,17 @@ bool icm20948GyroRead(float *ps16X, float *ps16Y, float *ps16Z) {
 }
 
 bool icm20948AccelRead(float *ps16X, float *ps16Y, float *ps16Z) {
-  uint8_t                     u8Buf[2];
+  uint8_t                     u8Buf[6];
   int16_t                     s16Buf[3] = { 0 };
-  uint8_t                     i;
-  int32_t                     s32OutBuf[3] = { 0 };
-  //
-  static ICM20948_ST_AVG_DATA sstAvgBuf[3];
-
-  u8Buf[0]  = I2C_ReadOneByte(REG_ADD_ACCEL_XOUT_L);
-  u8Buf[1]  = I2C_ReadOneByte(REG_ADD_ACCEL_XOUT_H);
-  s16Buf[0] = (u8Buf[1] << 8) | u8Buf[0];
-
-  u8Buf[0]  = I2C_ReadOneByte(REG_ADD_ACCEL_YOUT_L);
-  u8Buf[1]  = I2C_ReadOneByte(REG_ADD_ACCEL_YOUT_H);
-  s16Buf[1] = (u8Buf[1] << 8) | u8Buf[0];
-
-  u8Buf[0]  = I2C_ReadOneByte(REG_ADD_ACCEL_ZOUT_L);
-  u8Buf[1]  = I2C_ReadOneByte(REG_ADD_ACCEL_ZOUT_H);
-  s16Buf[2] = (u8Buf[1] << 8) | u8Buf[0];
-
-  *ps16X = s16Buf[0] * 4.0 / 32768.0;
-  *ps16Y = s16Buf[1] * 4.0 / 32768.0;
-  *ps16Z = s16Buf[2] * 4.0 / 32768.0;
-
-  //  for (i = 0; i < 3; i++)
-  //	{
-  //	  icm20948CalAvgValue (&sstAvgBuf[i].u8Index, sstAvgBuf[i].s16AvgBuffer,
-  // s16Buf[i], s32OutBuf + i);
-  //	}
-  //
-  //  *ps16X = s32OutBuf[0];
-  //  *ps16Y = s32OutBuf[1];
-  //  *ps16Z = s32OutBuf[2];
+
+  icm20948ReadRegs(REG_VAL_REG_BANK_0, REG_ADD_ACCEL_XOUT_H, u8Buf, sizeof(u8Buf));
+  s16Buf[0] = (u8Buf[0] << 8) | u8Buf[1];
+  s16Buf[1] = (u8Buf[2] << 8) | u8Buf[3];
+  s16Buf[2] = (u8Buf[4] << 8) | u8Buf[5];
+
+  *ps16X = (s16Buf[0] - gstAccelOffset.s16X) * 4.0 / 32768.0;
+  *ps16Y = (s16Buf[1] - gstAccelOffset.s16Y) * 4.0 / 32768.0;
+  *ps16Z = (s16Buf[2] - gstAccelOffset.s16Z) * 4.0 / 32768.0;
 
   if (*ps16X == 0 && *ps16Y == 0 && *ps16Z == 0) {
     return false;
@@ -347,12 +502,8 @@ bool icm20948MagRead(float *ps16X, float *ps16Y, float *ps16Z) {
   uint8_t counter = 20;
   uint8_t u8Data[MAG_DATA_LEN];
   int16_t s16Buf[3] = { 0 };
-  uint8_t i;
-  int32_t s32OutBuf[3] = { 0 };
-  //
-  static ICM20948_ST_AVG_DATA sstAvgBuf[3];
+  // Each secondary read already waits for a new sample, so no extra delay here.
   while (counter > 0) {
-    sleep_ms(1);
     icm20948ReadSecondary(I2C_ADD_ICM20948_AK09916 | I2C_ADD_ICM20948_AK09916_READ,
                           REG_ADD_MAG_ST2, 1, u8Data);
 
@@ -370,21 +521,11 @@ bool icm20948MagRead(float *ps16X, float *ps16Y, float *ps16Z) {
     s16Buf[2] = ((int16_t)u8Data[5] << 8) | u8Data[4];
   }
 
-  *ps16X = s16Buf[0] * 4.0 * 100.0 / 32768.0;
-  *ps16Y = s16Buf[1] * 4.0 * 100.0 / 32768.0;
-  *ps16Z = s16Buf[2] * 4.0 * 100.0 / 32768.0;
-
-/*
-  for (i = 0; i < 3; i++) {
-    icm20948CalAvgValue(&sstAvgBuf[i].u8Index, sstAvgBuf[i].s16AvgBuffer, s16Buf[i],
-                        s32OutBuf + i);
-  }
+  *ps16X = (s16Buf[0] * 4.0 * 100.0 / 32768.0 - gfMagHardIron[0]) * gfMagSoftIron[0];
+  *ps16Y = (s16Buf[1] * 4.0 * 100.0 / 32768.0 - gfMagHardIron[1]) * gfMagSoftIron[1];
+  *ps16Z = (s16Buf[2] * 4.0 * 100.0 / 32768.0 - gfMagHardIron[2]) * gfMagSoftIron[2];
 
-  *ps16X = s32OutBuf[0];
-  *ps16Y = -s32OutBuf[1];
-  *ps16Z = -s32OutBuf[2];
-  */
- if (*ps16X == 0 && *ps16Y == 0 && *ps16Z == 0) {
+  if (*ps16X == 0 && *ps16Y == 0 && *ps16Z == 0) {
     return false;
   }
   return true;
@@ -392,60 +533,23 @@ bool icm20948MagRead(float *ps16X, float *ps16Y, float *ps16Z) {
 
 void icm20948ReadSecondary(uint8_t u8I2CAddr, uint8_t u8RegAddr,
                                      uint8_t u8Len, uint8_t *pu8data) {
-  uint8_t i;
-  uint8_t u8Temp;
+  const uint8_t u8Slv0[] = { u8I2CAddr, u8RegAddr, REG_VAL_BIT_SLV0_EN | u8Len };
 
-  I2C_WriteOneByte(REG_ADD_REG_BANK_SEL, REG_VAL_REG_BANK_3);  // swtich bank3
-  I2C_WriteOneByte(REG_ADD_I2C_SLV0_ADDR, u8I2CAddr);
-  I2C_WriteOneByte(REG_ADD_I2C_SLV0_REG, u8RegAddr);
-  I2C_WriteOneByte(REG_ADD_I2C_SLV0_CTRL, REG_VAL_BIT_SLV0_EN | u8Len);
-
-  I2C_WriteOneByte(REG_ADD_REG_BANK_SEL, REG_VAL_REG_BANK_0);  // swtich bank0
-
-  u8Temp = I2C_ReadOneByte(REG_ADD_USER_CTRL);
-  u8Temp |= REG_VAL_BIT_I2C_MST_EN;
-  I2C_WriteOneByte(REG_ADD_USER_CTRL, u8Temp);
-  sleep_ms(5);
-  u8Temp &= ~REG_VAL_BIT_I2C_MST_EN;
-  I2C_WriteOneByte(REG_ADD_USER_CTRL, u8Temp);
-
-  for (i = 0; i < u8Len; i++) {
-    *(pu8data + i) = I2C_ReadOneByte(REG_ADD_EXT_SENS_DATA_00 + i);
-  }
-  I2C_WriteOneByte(REG_ADD_REG_BANK_SEL, REG_VAL_REG_BANK_3);  // swtich bank3
-
-  u8Temp = I2C_ReadOneByte(REG_ADD_I2C_SLV0_CTRL);
-  u8Temp &= ~((REG_VAL_BIT_I2C_MST_EN) & (REG_VAL_BIT_MASK_LEN));
-  I2C_WriteOneByte(REG_ADD_I2C_SLV0_CTRL, u8Temp);
-
-  I2C_WriteOneByte(REG_ADD_REG_BANK_SEL, REG_VAL_REG_BANK_0);  // swtich bank0
+  /* user bank 3: I2C_SLV0_ADDR, I2C_SLV0_REG, I2C_SLV0_CTRL */
+  icm20948WriteRegs(REG_VAL_REG_BANK_3, REG_ADD_I2C_SLV0_ADDR, u8Slv0, sizeof(u8Slv0));
+  icm20948RunMaster();
+  icm20948ReadRegs(REG_VAL_REG_BANK_0, REG_ADD_EXT_SENS_DATA_00, pu8data, u8Len);
 }
 
 void icm20948WriteSecondary(uint8_t u8I2CAddr, uint8_t u8RegAddr,
                                       uint8_t u8data) {
-  uint8_t u8Temp;
-  I2C_WriteOneByte(REG_ADD_REG_BANK_SEL, REG_VAL_REG_BANK_3);  // swtich bank3
-  I2C_WriteOneByte(REG_ADD_I2C_SLV1_ADDR, u8I2CAddr);
-  I2C_WriteOneByte(REG_ADD_I2C_SLV1_REG, u8RegAddr);
-  I2C_WriteOneByte(REG_ADD_I2C_SLV1_DO, u8data);
-  I2C_WriteOneByte(REG_ADD_I2C_SLV1_CTRL, REG_VAL_BIT_SLV0_EN | 1);
-
-  I2C_WriteOneByte(REG_ADD_REG_BANK_SEL, REG_VAL_REG_BANK_0);  // swtich bank0
+  const uint8_t u8Slv1[] = { u8I2CAddr, u8RegAddr, REG_VAL_BIT_SLV0_EN | 1, u8data };
 
-  u8Temp = I2C_ReadOneByte(REG_ADD_USER_CTRL);
-  u8Temp |= REG_VAL_BIT_I2C_MST_EN;
-  I2C_WriteOneByte(REG_ADD_USER_CTRL, u8Temp);
-  sleep_ms(5);
-  u8Temp &= ~REG_VAL_BIT_I2C_MST_EN;
-  I2C_WriteOneByte(REG_ADD_USER_CTRL, u8Temp);
-
-  I2C_WriteOneByte(REG_ADD_REG_BANK_SEL, REG_VAL_REG_BANK_3);  // swtich bank3
-
-  u8Temp = I2C_ReadOneByte(REG_ADD_I2C_SLV0_CTRL);
-  u8Temp &= ~((REG_VAL_BIT_I2C_MST_EN) & (REG_VAL_BIT_MASK_LEN));
-  I2C_WriteOneByte(REG_ADD_I2C_SLV0_CTRL, u8Temp);
-
-  I2C_WriteOneByte(REG_ADD_REG_BANK_SEL, REG_VAL_REG_BANK_0);
+  /* user bank 3: I2C_SLV1_ADDR, I2C_SLV1_REG, I2C_SLV1_CTRL, I2C_SLV1_DO */
+  icm20948WriteRegs(REG_VAL_REG_BANK_3, REG_ADD_I2C_SLV1_ADDR, u8Slv1, sizeof(u8Slv1));
+  icm20948RunMaster();
+  // Disable SLV1 again so the write is not repeated every sample period.
+  icm20948WriteReg(REG_VAL_REG_BANK_3, REG_ADD_I2C_SLV1_CTRL, 0);
 }
 
 void icm20948CalAvgValue(uint8_t *pIndex, int16_t *pAvgBuffer, int16_t InVal,
@@ -462,20 +566,62 @@ void icm20948CalAvgValue(uint8_t *pIndex, int16_t *pAvgBuffer, int16_t InVal,
   *pOutVal >>= 3;
 }
 
-void icm20948GyroOffset() {
-  uint8_t  i;
-  float s16Gx = 0, s16Gy = 0, s16Gz = 0;
-  int32_t  s32TempGx = 0, s32TempGy = 0, s32TempGz = 0;
-  for (i = 0; i < 32; i++) {
-    icm20948GyroRead(&s16Gx, &s16Gy, &s16Gz);
-    s32TempGx += (uint16_t)s16Gx;
-    s32TempGy += (uint16_t)s16Gy;
-    s32TempGz += (uint16_t)s16Gz;
-    sleep_ms(10);
+// Averages ICM20948_OFFSET_SAMPLES consecutive samples of the stationary
+// board, in raw counts. Samples that time out or fail to read are skipped;
+// false if fewer than ICM20948_OFFSET_MIN_SAMPLES were good.
+static bool icm20948AverageSamples(ICM20948_ST_RAW_SAMPLE *pstAverage) {
+  ICM20948_ST_RAW_SAMPLE stSample;
+  uint8_t                i, u8Good = 0;
+  int32_t                s32Sum[6] = { 0, 0, 0, 0, 0, 0 };
+
+  for (i = 0; i < ICM20948_OFFSET_SAMPLES; i++) {
+    if (!icm20948WaitDataReady(ICM20948_DATA_TIMEOUT_US) || !icm20948ReadRawSample(&stSample)) {
+      continue;
+    }
+    s32Sum[0] += stSample.stAccel.s16X;
+    s32Sum[1] += stSample.stAccel.s16Y;
+    s32Sum[2] += stSample.stAccel.s16Z;
+    s32Sum[3] += stSample.stGyro.s16X;
+    s32Sum[4] += stSample.stGyro.s16Y;
+    s32Sum[5] += stSample.stGyro.s16Z;
+    u8Good++;
+  }
+  if (u8Good < ICM20948_OFFSET_MIN_SAMPLES) {
+    printf("ICM20948: only %u of %u offset samples read\n", u8Good, ICM20948_OFFSET_SAMPLES);
+    return false;
+  }
+  pstAverage->stAccel.s16X = s32Sum[0] / u8Good;
+  pstAverage->stAccel.s16Y = s32Sum[1] / u8Good;
+  pstAverage->stAccel.s16Z = s32Sum[2] / u8Good;
+  pstAverage->stGyro.s16X  = s32Sum[3] / u8Good;
+  pstAverage->stGyro.s16Y  = s32Sum[4] / u8Good;
+  pstAverage->stGyro.s16Z  = s32Sum[5] / u8Good;
+  return true;
+}
+
+// Measures the gyro bias of the stationary board. The offset is left as it was
+// if too few samples could be read.
+bool icm20948GyroOffset() {
+  ICM20948_ST_RAW_SAMPLE stAverage;
+
+  if (!icm20948AverageSamples(&stAverage)) {
+    return false;
   }
-  gstGyroOffset.s16X = s32TempGx >> 5;
-  gstGyroOffset.s16Y = s32TempGy >> 5;
-  gstGyroOffset.s16Z = s32TempGz >> 5;
+  gstGyroOffset = stAverage.stGyro;
+  return true;
+}
+
+// Same for the accelerometer. The board must lie flat, face up, so the
+// expected reading is +1 g on Z.
+bool icm20948AccelOffset() {
+  ICM20948_ST_RAW_SAMPLE stAverage;
+
+  if (!icm20948AverageSamples(&stAverage)) {
+    return false;
+  }
+  gstAccelOffset = stAverage.stAccel;
+  gstAccelOffset.s16Z -= (int16_t)ICM20948_ACCEL_LSB_PER_G;
+  return true;
 }
 
 bool icm20948MagCheck() {
@@ -2,6 +2,7 @@
 #define _ICM20948_H_
 
 #include <hardware/i2c.h>
+#include "i2c_async.h"
 
 #include <math.h>
 
@@ -46,6 +47,10 @@
 #define REG_ADD_GYRO_YOUT_L 0x36
 #define REG_ADD_GYRO_ZOUT_H 0x37
 #define REG_ADD_GYRO_ZOUT_L 0x38
+#define REG_ADD_INT_ENABLE_1 0x11
+#define REG_VAL_BIT_RAW_DATA_0_RDY_EN 0x01
+#define REG_ADD_INT_STATUS_1 0x1A
+#define REG_VAL_BIT_RAW_DATA_0_RDY_INT 0x01
 #define REG_ADD_EXT_SENS_DATA_00 0x3B
 #define FIFO_EN_1 0x66
 #define FIFO_EN_2 0x67
@@ -60,6 +65,7 @@
 #define REG_VAL_REG_BANK_1 0x10
 #define REG_VAL_REG_BANK_2 0x20
 #define REG_VAL_REG_BANK_3 0x30
+#define REG_VAL_REG_BANK_UNKNOWN 0xFF  // forces the next access to select a bank
 
 #define FIFO_COUNT_H 0x70
 #define FIFO_COUNT_L 0x71
@@ -120,6 +126,18 @@
 
 #define MAG_DATA_LEN 6
 
+/* register access layer */
+#define ICM20948_BURST_MAX 16           // longest burst read/write in one transaction
+#define ICM20948_RESET_TIMEOUT_US 50000 // device reset normally completes in ~10 ms
+#define ICM20948_DATA_TIMEOUT_US 20000  // > 2 sample periods at the configured ODR
+#define ICM20948_OFFSET_SAMPLES 32      // averaged for a bias measurement
+#define ICM20948_OFFSET_MIN_SAMPLES 24  // good ones needed, or the measurement fails
+
+/* async sample reads: ACCEL_XOUT_H .. GYRO_ZOUT_L in one burst */
+#define ICM20948_SAMPLE_LEN 12
+#define ICM20948_ACCEL_LSB_PER_G 8192.0f  // +-4 g full scale
+#define ICM20948_GYRO_LSB_PER_DPS 16.4f   // +-2000 dps full scale
+
 typedef enum {
   IMU_EN_SENSOR_TYPE_NULL = 0,
   IMU_EN_SENSOR_TYPE_ICM20948,
@@ -138,12 +156,29 @@ typedef struct imu_st_sensor_data_tag {
   int16_t s16Z;
 } IMU_ST_SENSOR_DATA;
 
+// One entry of a declarative register configuration table.
+typedef struct icm20948_st_reg_write_tag {
+  uint8_t u8Bank;
+  uint8_t u8Reg;
+  uint8_t u8Val;
+} ICM20948_ST_REG_WRITE;
+
+typedef struct icm20948_st_raw_sample_tag {
+  IMU_ST_SENSOR_DATA stAccel;
+  IMU_ST_SENSOR_DATA stGyro;
+} ICM20948_ST_RAW_SAMPLE;
+
 typedef struct icm20948_st_avg_data_tag {
   uint8_t u8Index;
   int16_t s16AvgBuffer[8];
 } ICM20948_ST_AVG_DATA;
 
 
+extern IMU_ST_SENSOR_DATA gstGyroOffset;   // raw LSB
+extern IMU_ST_SENSOR_DATA gstAccelOffset;  // raw LSB
+extern float              gfMagHardIron[3];  // uT
+extern float              gfMagSoftIron[3];  // per-axis scale
+
 void  imuAHRSupdate(float gx, float gy, float gz, float ax, float ay, float az,
                             float mx, float my, float mz);
 float invSqrt(float x);
@@ -155,7 +190,8 @@ bool icm20948MagRead(float *ps16X, float *ps16Y, float *ps16Z);
 bool icm20948MagCheck(void);
 void icm20948CalAvgValue(uint8_t *pIndex, int16_t *pAvgBuffer, int16_t InVal,
                                 int32_t *pOutVal);
-void icm20948GyroOffset();
+bool icm20948GyroOffset();
+bool icm20948AccelOffset();
 void icm20948ReadSecondary(uint8_t u8I2CAddr, uint8_t u8RegAddr, uint8_t u8Len,
                                   uint8_t *pu8data);
 void icm20948WriteSecondary(uint8_t u8I2CAddr, uint8_t u8RegAddr,
@@ -167,7 +203,25 @@ bool reserved_addr(uint8_t addr);
 void imuInit(IMU_EN_SENSOR_TYPE *penMotionSensorType);
 
 void I2C_WriteOneByte(uint8_t reg, uint8_t value);
-char I2C_ReadOneByte(uint8_t reg);
+uint8_t I2C_ReadOneByte(uint8_t reg);
+
+void icm20948SelectBank(uint8_t u8Bank);
+void icm20948InvalidateBank(void);
+uint8_t icm20948ReadReg(uint8_t u8Bank, uint8_t u8Reg);
+void icm20948WriteReg(uint8_t u8Bank, uint8_t u8Reg, uint8_t u8Val);
+bool icm20948ReadRegs(uint8_t u8Bank, uint8_t u8Reg, uint8_t *pu8Data, uint8_t u8Len);
+bool icm20948WriteRegs(uint8_t u8Bank, uint8_t u8Reg, const uint8_t *pu8Data,
+                       uint8_t u8Len);
+void icm20948ApplyTable(const ICM20948_ST_REG_WRITE *pstTable, uint8_t u8Count);
+bool icm20948WaitReg(uint8_t u8Bank, uint8_t u8Reg, uint8_t u8Mask, uint8_t u8Val,
+                     uint32_t u32TimeoutUs);
+bool icm20948WaitDataReady(uint32_t u32TimeoutUs);
+
+bool icm20948SubmitSampleRead(I2C_ASYNC_ST_TXN *pstTxn, uint8_t *pu8Buf,
+                              I2C_ASYNC_CALLBACK pfnDone, void *pvContext);
+void icm20948ParseSample(const uint8_t *pu8Buf, ICM20948_ST_RAW_SAMPLE *pstSample);
+bool icm20948ReadRawSample(ICM20948_ST_RAW_SAMPLE *pstSample);
+void icm20948ApplyOffsets(ICM20948_ST_RAW_SAMPLE *pstSample);
 
 int  dataReady();
 bool imuDataGet(IMU_ST_ANGLES_DATA *pstAngles,
@@ -0,0 +1,127 @@
+#include "i2c_async.h"
+
+#include <stddef.h>
+
+// Hardware-independent part of the queue: bookkeeping and command encoding.
+// Everything touching registers lives behind the i2cAsyncPort* functions.
+
+static I2C_ASYNC_ST_TXN *volatile spstQueue[I2C_ASYNC_QUEUE_LEN];
+static volatile uint8_t           su8Head  = 0;
+static volatile uint8_t           su8Count = 0;
+static I2C_ASYNC_ST_TXN *volatile spstActive = NULL;
+static uint32_t                   su32Cmds[2 * I2C_ASYNC_MAX_LEN];
+
+void i2cAsyncInit(void) {
+  su8Head    = 0;
+  su8Count   = 0;
+  spstActive = NULL;
+  i2cAsyncPortInit();
+}
+
+// Builds the IC_DATA_CMD words for a transaction: the write bytes, then one
+// read command per byte to receive, with RESTART on the first read and STOP on
+// the last word.
+uint8_t i2cAsyncEncode(const I2C_ASYNC_ST_TXN *pstTxn, uint32_t *pu32Cmds) {
+  uint8_t u8Len = 0;
+  uint8_t i;
+
+  for (i = 0; i < pstTxn->u8WriteLen; i++) {
+    pu32Cmds[u8Len++] = pstTxn->pu8Write[i];
+  }
+  for (i = 0; i < pstTxn->u8ReadLen; i++) {
+    pu32Cmds[u8Len] = I2C_ASYNC_CMD_READ;
+    if (i == 0 && pstTxn->u8WriteLen > 0) {
+      pu32Cmds[u8Len] |= I2C_ASYNC_CMD_RESTART;
+    }
+    u8Len++;
+  }
+  if (u8Len > 0) {
+    pu32Cmds[u8Len - 1] |= I2C_ASYNC_CMD_STOP;
+  }
+  return u8Len;
+}
+
+// Pops the next queued transaction and hands it to the port. Must be called
+// with the port lock held.
+static void i2cAsyncStartNext(void) {
+  I2C_ASYNC_ST_TXN *pstTxn;
+  uint8_t           u8CmdLen;
+
+  if (su8Count == 0) {
+    spstActive = NULL;
+    return;
+  }
+  pstTxn  = spstQueue[su8Head];
+  su8Head = (su8Head + 1) % I2C_ASYNC_QUEUE_LEN;
+  su8Count--;
+
+  u8CmdLen         = i2cAsyncEncode(pstTxn, su32Cmds);
+  pstTxn->enStatus = I2C_ASYNC_BUSY;
+  spstActive       = pstTxn;
+  i2cAsyncPortStart(pstTxn->u8Addr, su32Cmds, u8CmdLen, pstTxn->pu8Read,
+                    pstTxn->u8ReadLen);
+}
+
+bool i2cAsyncSubmit(I2C_ASYNC_ST_TXN *pstTxn) {
+  uint32_t u32State;
+  bool     bRet = false;
+
+  if (pstTxn->u8WriteLen > I2C_ASYNC_MAX_LEN || pstTxn->u8ReadLen > I2C_ASYNC_MAX_LEN
+      || pstTxn->u8WriteLen + pstTxn->u8ReadLen == 0) {
+    return false;
+  }
+
+  u32State = i2cAsyncPortLock();
+  if (su8Count < I2C_ASYNC_QUEUE_LEN) {
+    pstTxn->enStatus = I2C_ASYNC_QUEUED;
+    spstQueue[(su8Head + su8Count) % I2C_ASYNC_QUEUE_LEN] = pstTxn;
+    su8Count++;
+    if (spstActive == NULL) {
+      i2cAsyncStartNext();
+    }
+    bRet = true;
+  }
+  i2cAsyncPortUnlock(u32State);
+  return bRet;
+}
+
+void i2cAsyncOnComplete(bool bOk) {
+  I2C_ASYNC_ST_TXN *pstTxn = spstActive;
+  uint32_t          u32State;
+
+  if (pstTxn == NULL) {
+    return;
+  }
+  pstTxn->enStatus = bOk ? I2C_ASYNC_DONE : I2C_ASYNC_ERROR;
+
+  // Keep the bus busy before running the callback, which may itself submit.
+  u32State = i2cAsyncPortLock();
+  i2cAsyncStartNext();
+  i2cAsyncPortUnlock(u32State);
+
+  if (pstTxn->pfnDone != NULL) {
+    pstTxn->pfnDone(pstTxn);
+  }
+}
+
+bool i2cAsyncIsDone(const I2C_ASYNC_ST_TXN *pstTxn) {
+  I2C_ASYNC_EN_STATUS enStatus = pstTxn->enStatus;
+  return enStatus == I2C_ASYNC_DONE || enStatus == I2C_ASYNC_ERROR;
+}
+
+I2C_ASYNC_EN_STATUS i2cAsyncWait(const I2C_ASYNC_ST_TXN *pstTxn) {
+  while (pstTxn->enStatus == I2C_ASYNC_QUEUED || pstTxn->enStatus == I2C_ASYNC_BUSY) {
+    i2cAsyncPortIdleWait();
+  }
+  return pstTxn->enStatus;
+}
+
+bool i2cAsyncIdle(void) {
+  return spstActive == NULL && su8Count == 0;
+}
+
+void i2cAsyncFlush(void) {
+  while (!i2cAsyncIdle()) {
+    i2cAsyncPortIdleWait();
+  }
+}
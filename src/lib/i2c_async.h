@@ -0,0 +1,72 @@
+#ifndef _I2C_ASYNC_H_
+#define _I2C_ASYNC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Asynchronous I2C transaction queue.
+ *
+ * Transactions are owned by the caller and queued by pointer. Each one is an
+ * optional write phase followed by an optional read phase (with a repeated
+ * start in between), executed in submission order by the platform port. The
+ * transaction's enStatus doubles as a future: poll i2cAsyncIsDone() or block
+ * in i2cAsyncWait(), or pass a callback which runs in interrupt context.
+ *
+ * The queue is meant to be driven from one core. Do not mix it with the
+ * blocking i2c_* calls on the same bus unless i2cAsyncFlush() returned first.
+ */
+
+#define I2C_ASYNC_QUEUE_LEN 8
+#define I2C_ASYNC_MAX_LEN 32  // max bytes per phase
+
+/* DW_apb_i2c IC_DATA_CMD bits used to encode a transaction */
+#define I2C_ASYNC_CMD_READ 0x100
+#define I2C_ASYNC_CMD_STOP 0x200
+#define I2C_ASYNC_CMD_RESTART 0x400
+
+typedef enum {
+  I2C_ASYNC_IDLE = 0,  // never submitted
+  I2C_ASYNC_QUEUED,
+  I2C_ASYNC_BUSY,
+  I2C_ASYNC_DONE,
+  I2C_ASYNC_ERROR  // NACK or bus abort
+} I2C_ASYNC_EN_STATUS;
+
+typedef struct i2c_async_st_txn_tag I2C_ASYNC_ST_TXN;
+typedef void (*I2C_ASYNC_CALLBACK)(I2C_ASYNC_ST_TXN *pstTxn);
+
+struct i2c_async_st_txn_tag {
+  uint8_t            u8Addr;
+  const uint8_t     *pu8Write;
+  uint8_t            u8WriteLen;
+  uint8_t           *pu8Read;
+  uint8_t            u8ReadLen;
+  I2C_ASYNC_CALLBACK pfnDone;  // optional, called from interrupt context
+  void              *pvContext;
+  volatile I2C_ASYNC_EN_STATUS enStatus;
+};
+
+void i2cAsyncInit(void);
+bool i2cAsyncSubmit(I2C_ASYNC_ST_TXN *pstTxn);
+bool i2cAsyncIsDone(const I2C_ASYNC_ST_TXN *pstTxn);
+I2C_ASYNC_EN_STATUS i2cAsyncWait(const I2C_ASYNC_ST_TXN *pstTxn);
+bool i2cAsyncIdle(void);
+void i2cAsyncFlush(void);
+uint8_t i2cAsyncEncode(const I2C_ASYNC_ST_TXN *pstTxn, uint32_t *pu32Cmds);
+
+/* Called by the port when the active transaction has finished. */
+void i2cAsyncOnComplete(bool bOk);
+
+/*
+ * Port interface, implemented once per platform (i2c_async_rp2040.c on the
+ * Pico, host/i2c_async_mock.c on Linux).
+ */
+void i2cAsyncPortInit(void);
+void i2cAsyncPortStart(uint8_t u8Addr, const uint32_t *pu32Cmds, uint8_t u8CmdLen,
+                       uint8_t *pu8Read, uint8_t u8ReadLen);
+uint32_t i2cAsyncPortLock(void);
+void i2cAsyncPortUnlock(uint32_t u32State);
+void i2cAsyncPortIdleWait(void);
+
+#endif  //_I2C_ASYNC_H_
@@ -0,0 +1,111 @@
+#include "i2c_async.h"
+
+#include <hardware/dma.h>
+#include <hardware/i2c.h>
+#include <hardware/irq.h>
+#include <hardware/sync.h>
+#include <pico/stdlib.h>
+
+// RP2040 port of the async I2C queue. The encoded command words are streamed
+// into IC_DATA_CMD by one DMA channel while a second drains received bytes
+// from the RX FIFO. The controller's STOP_DET interrupt marks the end of a
+// transaction; TX_ABRT (e.g. address NACK) fails it.
+
+#define I2C_PORT i2c0
+#define I2C_IRQ I2C0_IRQ
+
+_Static_assert(I2C_ASYNC_CMD_READ == I2C_IC_DATA_CMD_CMD_BITS, "IC_DATA_CMD layout");
+_Static_assert(I2C_ASYNC_CMD_STOP == I2C_IC_DATA_CMD_STOP_BITS, "IC_DATA_CMD layout");
+_Static_assert(I2C_ASYNC_CMD_RESTART == I2C_IC_DATA_CMD_RESTART_BITS, "IC_DATA_CMD layout");
+
+static uint               suTxChan;
+static uint               suRxChan;
+static dma_channel_config sstTxConfig;
+static dma_channel_config sstRxConfig;
+static volatile bool      sbReading = false;
+static volatile bool      sbAborted = false;
+
+static void i2cAsyncIrqHandler(void) {
+  i2c_hw_t *pstHw   = i2c_get_hw(I2C_PORT);
+  uint32_t  u32Stat = pstHw->intr_stat;
+  bool      bOk;
+
+  if (u32Stat & I2C_IC_INTR_STAT_R_TX_ABRT_BITS) {
+    (void)pstHw->clr_tx_abrt;
+    dma_channel_abort(suTxChan);
+    dma_channel_abort(suRxChan);
+    sbAborted = true;
+  }
+  if (u32Stat & I2C_IC_INTR_STAT_R_STOP_DET_BITS) {
+    (void)pstHw->clr_stop_det;
+    pstHw->intr_mask = 0;
+    if (!sbAborted && sbReading) {
+      // The last byte may still be on its way out of the RX FIFO.
+      dma_channel_wait_for_finish_blocking(suRxChan);
+    }
+    bOk       = !sbAborted;
+    sbAborted = false;
+    i2cAsyncOnComplete(bOk);
+  }
+}
+
+void i2cAsyncPortInit(void) {
+  i2c_hw_t *pstHw = i2c_get_hw(I2C_PORT);
+
+  suTxChan = dma_claim_unused_channel(true);
+  suRxChan = dma_claim_unused_channel(true);
+
+  sstTxConfig = dma_channel_get_default_config(suTxChan);
+  channel_config_set_transfer_data_size(&sstTxConfig, DMA_SIZE_32);
+  channel_config_set_read_increment(&sstTxConfig, true);
+  channel_config_set_write_increment(&sstTxConfig, false);
+  channel_config_set_dreq(&sstTxConfig, i2c_get_dreq(I2C_PORT, true));
+
+  sstRxConfig = dma_channel_get_default_config(suRxChan);
+  channel_config_set_transfer_data_size(&sstRxConfig, DMA_SIZE_8);
+  channel_config_set_read_increment(&sstRxConfig, false);
+  channel_config_set_write_increment(&sstRxConfig, true);
+  channel_config_set_dreq(&sstRxConfig, i2c_get_dreq(I2C_PORT, false));
+
+  // Interrupts stay masked while idle so blocking i2c_* calls, which poll
+  // STOP_DET themselves, keep working between async batches.
+  pstHw->intr_mask = 0;
+  pstHw->dma_cr    = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+  irq_set_exclusive_handler(I2C_IRQ, i2cAsyncIrqHandler);
+  irq_set_enabled(I2C_IRQ, true);
+}
+
+void i2cAsyncPortStart(uint8_t u8Addr, const uint32_t *pu32Cmds, uint8_t u8CmdLen,
+                       uint8_t *pu8Read, uint8_t u8ReadLen) {
+  i2c_hw_t *pstHw = i2c_get_hw(I2C_PORT);
+
+  // The target address can only change while the controller is disabled.
+  pstHw->enable = 0;
+  pstHw->tar    = u8Addr;
+  pstHw->enable = 1;
+
+  (void)pstHw->clr_stop_det;
+  (void)pstHw->clr_tx_abrt;
+  sbAborted        = false;
+  sbReading        = u8ReadLen > 0;
+  pstHw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+
+  if (sbReading) {
+    dma_channel_configure(suRxChan, &sstRxConfig, pu8Read, &pstHw->data_cmd, u8ReadLen,
+                          true);
+  }
+  dma_channel_configure(suTxChan, &sstTxConfig, &pstHw->data_cmd, pu32Cmds, u8CmdLen,
+                        true);
+}
+
+uint32_t i2cAsyncPortLock(void) {
+  return save_and_disable_interrupts();
+}
+
+void i2cAsyncPortUnlock(uint32_t u32State) {
+  restore_interrupts(u32State);
+}
+
+void i2cAsyncPortIdleWait(void) {
+  tight_loop_contents();
+}
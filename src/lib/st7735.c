@@ -1,17 +1,18 @@
 /* vim: set ai et ts=4 sw=4: */
 #include "DEV_Config.h"
 #include "st7735.h"
+#include "../profile.h"
+#include "../hot.h"
 
 #define DELAY 0x80
 
 // based on Adafruit ST7735 library for Arduino
 static const uint8_t
   init_cmds1[] = {            // Init for 7735R, part 1 (red or green tab)
-    15,                       // 15 commands in list:
-    ST7735_SWRESET,   DELAY,  //  1: Software reset, 0 args, w/delay
-      150,                    //     150 ms delay
+    14,                       // 14 commands in list:
+                              //  1: (no SWRESET, ST7735_Reset() just did a hardware reset)
     ST7735_SLPOUT ,   DELAY,  //  2: Out of sleep mode, 0 args, w/delay
-      255,                    //     500 ms delay
+      120,                    //     120 ms delay (datasheet minimum)
     ST7735_FRMCTR1, 3      ,  //  3: Frame rate ctrl - normal mode, 3 args:
       0x01, 0x2C, 0x2D,       //     Rate = fosc/(1x2+40) * (LINE+2C+2D)
     ST7735_FRMCTR2, 3      ,  //  4: Frame rate control - idle mode, 3 args:
@@ -81,14 +82,14 @@ static const uint8_t
     ST7735_NORON  ,    DELAY, //  3: Normal display on, no args, w/delay
       10,                     //     10 ms delay
     ST7735_DISPON ,    DELAY, //  4: Main screen turn on, no args w/delay
-      100 };                  //     100 ms delay
+      10 };                   //     10 ms delay
 
-static void ST7735_Select() {
+static void HOT(ST7735_Select)() {
    // HAL_GPIO_WritePin(ST7735_CS_GPIO_Port, ST7735_CS_Pin, GPIO_PIN_RESET);
    DEV_Digital_Write(EPD_CS_PIN, 0);
 }
 
-void ST7735_Unselect() {
+void HOT(ST7735_Unselect)() {
     //HAL_GPIO_WritePin(ST7735_CS_GPIO_Port, ST7735_CS_Pin, GPIO_PIN_SET);
      DEV_Digital_Write(EPD_CS_PIN, 1);
 }
@@ -97,19 +98,47 @@ static void ST7735_Reset() {
     DEV_Digital_Write(EPD_RST_PIN, 0);
     sleep_ms(5);
     DEV_Digital_Write(EPD_RST_PIN, 1);
+    // Reset completes in 5 ms from sleep-in, the power-on state, but takes
+    // 120 ms from sleep-out, which is where a warm reboot, watchdog reset or
+    // reload leaves the panel; SLPOUT sent sooner can be ignored. Core 1 is
+    // bringing up the IMU meanwhile.
+    sleep_ms(120);
 }
 
-static void ST7735_WriteCommand(uint8_t cmd) {
+// spi_write_blocking() runs from flash; this is the same loop, kept in SRAM
+// with the rest of the write path.
+static void HOT(ST7735_SpiWrite)(const uint8_t *src, size_t len) {
+#if PICO_NO_HARDWARE
+    spi_write_blocking(SPI_PORT, src, len);
+#else
+    spi_hw_t *hw = spi_get_hw(SPI_PORT);
+    for(size_t i = 0; i < len; i++) {
+        while(!spi_is_writable(SPI_PORT))
+            tight_loop_contents();
+        hw->dr = src[i];
+    }
+    // Drain RX, wait for the last bits to shift out, drain RX again
+    while(spi_is_readable(SPI_PORT))
+        (void)hw->dr;
+    while(hw->sr & SPI_SSPSR_BSY_BITS)
+        tight_loop_contents();
+    while(spi_is_readable(SPI_PORT))
+        (void)hw->dr;
+    hw->icr = SPI_SSPICR_RORIC_BITS;
+#endif
+}
+
+static void HOT(ST7735_WriteCommand)(uint8_t cmd) {
     //HAL_GPIO_WritePin(ST7735_DC_GPIO_Port, ST7735_DC_Pin, GPIO_PIN_RESET);
     DEV_Digital_Write(EPD_DC_PIN, 0);
-    spi_write_blocking(SPI_PORT, &cmd, sizeof(cmd));
+    ST7735_SpiWrite(&cmd, sizeof(cmd));
    // HAL_SPI_Transmit(&ST7735_SPI_PORT, &cmd, sizeof(cmd), HAL_MAX_DELAY);
 }
 
-static void ST7735_WriteData(uint8_t* buff, size_t buff_size) {
+static void HOT(ST7735_WriteData)(uint8_t* buff, size_t buff_size) {
     //HAL_GPIO_WritePin(ST7735_DC_GPIO_Port, ST7735_DC_Pin, GPIO_PIN_SET);
      DEV_Digital_Write(EPD_DC_PIN, 1);
-     spi_write_blocking(SPI_PORT, buff, buff_size);
+     ST7735_SpiWrite(buff, buff_size);
    // HAL_SPI_Transmit(&ST7735_SPI_PORT, buff, buff_size, HAL_MAX_DELAY);
 }
 
@@ -139,7 +168,7 @@ static void ST7735_ExecuteCommandList(const uint8_t *addr) {
     }
 }
 
-static void ST7735_SetAddressWindow(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1) {
+static void HOT(ST7735_SetAddressWindow)(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1) {
     // column address set
     ST7735_WriteCommand(ST7735_CASET);
     uint8_t data[] = { 0x00, x0 + ST7735_XSTART, 0x00, x1 + ST7735_XSTART };
@@ -165,7 +194,8 @@ void ST7735_Init() {
     ST7735_Unselect();
 }
 
-void ST7735_DrawPixel(uint16_t x, uint16_t y, uint16_t color) {
+void HOT(ST7735_DrawPixel)(uint16_t x, uint16_t y, uint16_t color) {
+    PROFILE_ZONE(DrawPixel);
     if((x >= ST7735_WIDTH) || (y >= ST7735_HEIGHT))
         return;
 
@@ -178,13 +208,15 @@ void ST7735_DrawPixel(uint16_t x, uint16_t y, uint16_t color) {
     ST7735_Unselect();
 }
 
-static void ST7735_WriteChar(uint16_t x, uint16_t y, char ch, FontDef font, uint16_t color, uint16_t bgcolor) {
+static void HOT(ST7735_WriteChar)(uint16_t x, uint16_t y, char ch, FontDef font, uint16_t color, uint16_t bgcolor) {
     uint32_t i, b, j;
+    // The glyph table is large and rarely used; don't let it evict code
+    const uint16_t *glyphs = UNCACHED(font.data);
 
     ST7735_SetAddressWindow(x, y, x+font.width-1, y+font.height-1);
 
     for(i = 0; i < font.height; i++) {
-        b = font.data[(ch - 32) * font.height + i];
+        b = glyphs[(ch - 32) * font.height + i];
         for(j = 0; j < font.width; j++) {
             if((b << j) & 0x8000)  {
                 uint8_t data[] = { color >> 8, color & 0xFF };
@@ -240,7 +272,8 @@ void ST7735_WriteString(uint16_t x, uint16_t y, const char* str, FontDef font, u
     ST7735_Unselect();
 }
 
-void ST7735_FillRectangle(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color) {
+void HOT(ST7735_FillRectangle)(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color) {
+    PROFILE_ZONE(FillRectangle);
     // clipping
     if((x >= ST7735_WIDTH) || (y >= ST7735_HEIGHT)) return;
     if((x + w - 1) >= ST7735_WIDTH) w = ST7735_WIDTH - x;
@@ -256,7 +289,7 @@ void ST7735_FillRectangle(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16
     for(y = h; y > 0; y--) {
         for(x = w; x > 0; x--) {
            // HAL_SPI_Transmit(&ST7735_SPI_PORT, data, sizeof(data), HAL_MAX_DELAY);
-            spi_write_blocking(SPI_PORT, data, sizeof(data));
+            ST7735_SpiWrite(data, sizeof(data));
         }
     }
 
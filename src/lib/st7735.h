@@ -107,6 +107,7 @@
 #define ST7735_XSTART 2
 #define ST7735_YSTART 3
 #define ST7735_ROTATION (ST7735_MADCTL_MX | ST7735_MADCTL_MY | ST7735_MADCTL_BGR)
+*/
 
 // 1.44" display, rotate right
 /*
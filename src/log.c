@@ -0,0 +1,138 @@
+#include "log.h"
+
+#if !LOG_PRINTF
+
+#include <stdarg.h>
+
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "frame.h"
+#include "serial.h"
+
+// Single-producer/single-consumer ring per core. The producer side is every
+// LOG() on that core, serialised by masking interrupts; the consumer is
+// logDrain() on core 0.
+typedef struct
+{
+    const char *format;
+    uint32_t timeUs;
+    uint8_t argCount;
+    int32_t args[LOG_MAX_ARGS];
+} LogRecord;
+
+typedef struct
+{
+    LogRecord records[LOG_RING_LEN];
+    volatile uint32_t head;    // written only by the producer
+    volatile uint32_t tail;    // written only by the consumer
+    volatile uint32_t dropped; // records lost to a full ring
+    uint32_t droppedReported;  // consumer-private
+} LogRing;
+
+static LogRing logRings[2];
+
+void logWrite(const char *format, int argCount, ...)
+{
+    LogRing *ring = &logRings[get_core_num()];
+    uint32_t save = save_and_disable_interrupts();
+    uint32_t head = ring->head;
+
+    if (head - ring->tail == LOG_RING_LEN)
+    {
+        ring->dropped++;
+        restore_interrupts(save);
+        return;
+    }
+
+    LogRecord *record = &ring->records[head % LOG_RING_LEN];
+    va_list args;
+    record->format = format;
+    record->timeUs = time_us_32();
+    record->argCount = argCount;
+    va_start(args, argCount);
+    for (int i = 0; i < argCount; i++)
+    {
+        record->args[i] = va_arg(args, int32_t);
+    }
+    va_end(args);
+    __dmb();
+    ring->head = head + 1;
+    restore_interrupts(save);
+}
+
+static uint8_t logPutWord(uint8_t *out, uint32_t value)
+{
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+    return 4;
+}
+
+// FrameLog payload: <core> then records of <format:4> <timeUs:4> <argCount:1>
+// <args:4 each>, little endian. A record with a null format reports, in its
+// one argument, how many records were dropped before it.
+static uint8_t logEncode(uint8_t *out, uint32_t format, uint32_t timeUs, uint8_t argCount,
+                         const int32_t *args)
+{
+    uint8_t length = 0;
+    length += logPutWord(&out[length], format);
+    length += logPutWord(&out[length], timeUs);
+    out[length++] = argCount;
+    for (int i = 0; i < argCount; i++)
+    {
+        length += logPutWord(&out[length], args[i]);
+    }
+    return length;
+}
+
+#define LOG_RECORD_MAX_LEN (9 + 4 * LOG_MAX_ARGS)
+
+static void logDrainRing(uint8_t core)
+{
+    LogRing *ring = &logRings[core];
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    uint8_t length = 1;
+
+    payload[0] = core;
+    while (ring->tail != ring->head)
+    {
+        __dmb();
+        const LogRecord *record = &ring->records[ring->tail % LOG_RING_LEN];
+        if (length + LOG_RECORD_MAX_LEN > FRAME_MAX_PAYLOAD)
+        {
+            serialWriteFrame(FrameLog, payload, length);
+            length = 1;
+        }
+        length += logEncode(&payload[length], (uintptr_t)record->format, record->timeUs,
+                            record->argCount, record->args);
+        __dmb();
+        ring->tail++;
+    }
+
+    uint32_t dropped = ring->dropped;
+    if (dropped != ring->droppedReported)
+    {
+        int32_t count = dropped - ring->droppedReported;
+        ring->droppedReported = dropped;
+        if (length + LOG_RECORD_MAX_LEN > FRAME_MAX_PAYLOAD)
+        {
+            serialWriteFrame(FrameLog, payload, length);
+            length = 1;
+        }
+        length += logEncode(&payload[length], 0, time_us_32(), 1, &count);
+    }
+    if (length > 1)
+    {
+        serialWriteFrame(FrameLog, payload, length);
+    }
+}
+
+// Sends everything logged so far on both cores. Core 0 only.
+void logDrain(void)
+{
+    logDrainRing(0);
+    logDrainRing(1);
+}
+
+#endif // !LOG_PRINTF
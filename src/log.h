@@ -0,0 +1,50 @@
+#ifndef _LOG_H_
+#define _LOG_H_
+
+#include <stdint.h>
+
+// Deferred binary logging. LOG("Moving %s to %d", name, pos) formats nothing
+// on the spot: it stores the format string's address, a timestamp and up to
+// LOG_MAX_ARGS raw 32-bit arguments in the calling core's ring, which a
+// low-priority task later drains over USB serial as binary frames.
+// tools/log_decode.py reads the strings back out of the firmware ELF and
+// prints the messages.
+//
+// Arguments must be integers, characters or pointers to strings in flash
+// (%d %i %u %x %X %o %c %s %p). The format must be a string literal. A newline
+// is added when decoding.
+//
+// Configure with -DTTT_LOG_PRINTF=ON to print straight away instead, for a
+// console that does not have the decoder at hand.
+
+#define LOG_MAX_ARGS 4
+
+#ifndef LOG_RING_LEN
+#define LOG_RING_LEN 64 // records per core
+#endif
+
+// Counts up to 8 so that the static assert below can reject 5 to 8.
+#define LOG_NARGS(...) LOG_NARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+
+#if LOG_PRINTF
+
+#include <stdio.h>
+#define LOG(format, ...) printf(format "\n", ##__VA_ARGS__)
+#define logDrain() ((void)0)
+
+#else
+
+#define LOG(format, ...)                                                          \
+  do                                                                              \
+  {                                                                               \
+    _Static_assert(LOG_NARGS(__VA_ARGS__) <= LOG_MAX_ARGS, "too many LOG args"); \
+    logWrite("" format, LOG_NARGS(__VA_ARGS__), ##__VA_ARGS__);                  \
+  } while (0)
+
+void logWrite(const char *format, int argCount, ...);
+void logDrain(void);
+
+#endif // LOG_PRINTF
+
+#endif // _LOG_H_
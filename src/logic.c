@@ -1,8 +1,15 @@
 #include "logic.h"
 #include "pico/stdlib.h"
-#include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "constants.h"
+#include "search.h"
+#include "tablebase.h"
+#include "book.h"
+#include "mcts.h"
+#include "profile.h"
+#include "log.h"
+#include "hot.h"
 
 // True if all players in a portion of the grid are the same.
 bool allElementsEqual(GridPos grid[], int size)
@@ -17,84 +24,45 @@ bool allElementsEqual(GridPos grid[], int size)
     return true;
 }
 
-Player winner(GridPos *grid)
-{
-    // Check horizontal lines
-    for (int row = 0; row < GRID_SIZE; row++)
-    {
-        GridPos *ptrRowArray = grid + (row * GRID_SIZE);
-        if (allElementsEqual(ptrRowArray, GRID_SIZE) && (*ptrRowArray).player != empty)
-        {
-            return (*ptrRowArray).player;
-        }
-    }
-
-    // Check vertical lines
-    for (int col = 0; col < GRID_SIZE; col++)
-    {
-        GridPos *ptrColArray = malloc(sizeof(GridPos) * GRID_SIZE);
-        for (int i = 0; i < GRID_SIZE; i++)
-        {
-            ptrColArray[i] = grid[i * GRID_SIZE + col];
-        }
-
-        Player player = (*ptrColArray).player;
-        bool verticalMatch = allElementsEqual(ptrColArray, 3) && player != empty;
-        free(ptrColArray);
-        if (verticalMatch)
-            return player;
-    }
+// The game grid's lines, shared with the search. Built by a constructor, before
+// main() starts core 1 or a host tool starts its threads, so every reader sees
+// the finished table without a lock.
+static BoardGeometry gridGeometryTable;
 
-    // Check diagonal lines
-    for (int diag = 0; diag < GRID_SIZE; diag++)
-    {
-        /*
-        ┌───┬───┬───┐
-        │ x │   │   │
-        ├───┼───┼───┤
-        │   │ x │   │
-        ├───┼───┼───┤
-        │   │   │ x │
-        └───┴───┴───┘
-        */
-        GridPos *ptrDiagArrayLtoR = malloc(sizeof(GridPos) * GRID_SIZE);
-        /*
-        ┌───┬───┬───┐
-        │   │   │ x │
-        ├───┼───┼───┤
-        │   │ x │   │
-        ├───┼───┼───┤
-        │ x │   │   │
-        └───┴───┴───┘
-        */
-        GridPos *ptrDiagArrayRtoL = malloc(sizeof(GridPos) * GRID_SIZE);
-        for (int i = 0; i < GRID_SIZE; i++)
-        {
-            ptrDiagArrayLtoR[i] = grid[rowColToPos(i, i)];
-            ptrDiagArrayRtoL[i] = grid[rowColToPos(GRID_SIZE - i - 1, i)];
-        }
+__attribute__((constructor)) static void gridGeometryInit(void)
+{
+    boardGeometryInit(&gridGeometryTable, GRID_SIZE, GRID_SIZE);
+}
 
-        Player player;
-        bool diagMatch = true;
+static inline const BoardGeometry *gridGeometry(void)
+{
+    return &gridGeometryTable;
+}
 
-        if (allElementsEqual(ptrDiagArrayLtoR, GRID_SIZE) //
-            && (player = (*ptrDiagArrayLtoR).player) != empty)
+// Checks every row, column and diagonal through the geometry's line table, so
+// nothing is copied or allocated.
+Player HOT(winner)(GridPos *grid)
+{
+    PROFILE_ZONE(Winner);
+    const BoardGeometry *geometry = gridGeometry();
+    for (int line = 0; line < geometry->lineCount; line++)
+    {
+        const uint8_t *cells = geometry->lines[line];
+        Player player = grid[cells[0]].player;
+        if (player == empty)
         {
+            continue;
         }
-        else if (allElementsEqual(ptrDiagArrayRtoL, GRID_SIZE) //
-                 && (player = (*ptrDiagArrayRtoL).player) != empty)
+        int i = 1;
+        while (i < geometry->winLength && grid[cells[i]].player == player)
         {
+            i++;
         }
-        else
+        if (i == geometry->winLength)
         {
-            diagMatch = false;
-        }
-        free(ptrDiagArrayLtoR);
-        free(ptrDiagArrayRtoL);
-        if (diagMatch)
             return player;
+        }
     }
-
     return empty;
 }
 
@@ -108,7 +76,7 @@ bool playPos(Player player, int pos, GridPos grid[])
     if (!canPlayAtPos(pos, grid))
     {
         // error
-        printf("ERROR: Cannot play at position %d", pos);
+        LOG("ERROR: Cannot play at position %d", pos);
         return false;
     }
 
@@ -116,11 +84,59 @@ bool playPos(Player player, int pos, GridPos grid[])
     return true;
 }
 
+#if BOOK_ENABLED
+// Varies the book's choices from game to game.
+static uint32_t bookRandom(void)
+{
+    static uint32_t state;
+    if (state == 0)
+    {
+        state = time_us_32() | 1;
+    }
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+#endif
+
 int aiPlay(GridPos grid[])
 {
-    // One could implement a better AI algorithm such as minimax
-    // https://github.com/britannio/tic-tac-toe
-    return nextFreePos(grid);
+    Board board;
+    boardFromGrid(&board, gridGeometry(), grid);
+    if (board.winner != empty)
+    {
+        return -1;
+    }
+#if BOOK_ENABLED
+    // Openings are played from the book (see book.h).
+    int bookPos = bookMove(&book, &board, bookRandom());
+    if (bookPos >= 0)
+    {
+        return bookPos;
+    }
+#endif
+#if TABLEBASE_ENABLED
+    // Solved endgames are looked up instead (see tablebase.h).
+    if (POSITIONS - board.filled <= tablebase.maxEmpty + 1)
+    {
+        TablebaseValue value;
+        int pos = tablebaseBestMove(&tablebase, &board, &value);
+        if (pos >= 0)
+        {
+            return pos;
+        }
+    }
+#endif
+#if AI_MCTS
+    // Monte Carlo tree search for the time budget, on this core (see mcts.h).
+    MctsResult result;
+    return mctsBestMove(&board, ai, MCTS_BUDGET_US, 0, &result);
+#else
+    // Alpha-beta search, split across both cores when core 1 is up.
+    SearchResult result;
+    return searchBestMove(&board, ai, SEARCH_DEPTH, 2, &result);
+#endif
 }
 
 int nextFreePos(GridPos grid[])
@@ -138,5 +154,145 @@ int nextFreePos(GridPos grid[])
 
 int rowColToPos(int row, int col)
 {
-    return row * 3 + col;
-}
\ No newline at end of file
+    return row * GRID_SIZE + col;
+}
+
+// Appends the line of winLength cells starting at (row, col) in direction
+// (dRow, dCol).
+static void boardAddLine(BoardGeometry *geometry, int row, int col, int dRow, int dCol)
+{
+    uint8_t line = geometry->lineCount++;
+    for (int i = 0; i < geometry->winLength; i++)
+    {
+        uint8_t pos = (row + i * dRow) * geometry->size + col + i * dCol;
+        geometry->lines[line][i] = pos;
+        geometry->cellLines[pos][geometry->cellLineCount[pos]++] = line;
+    }
+}
+
+bool boardGeometryInit(BoardGeometry *geometry, int size, int winLength)
+{
+    if (size > BOARD_MAX_SIZE || winLength > size || winLength < BOARD_MIN_WIN)
+    {
+        return false;
+    }
+    memset(geometry, 0, sizeof(*geometry));
+    geometry->size = size;
+    geometry->winLength = winLength;
+    geometry->cells = size * size;
+
+    int span = size - winLength; // last start row/col of a line
+    for (int row = 0; row < size; row++)
+    {
+        for (int col = 0; col < size; col++)
+        {
+            if (col <= span)
+                boardAddLine(geometry, row, col, 0, 1); // horizontal
+            if (row <= span)
+                boardAddLine(geometry, row, col, 1, 0); // vertical
+            if (row <= span && col <= span)
+                boardAddLine(geometry, row, col, 1, 1); // diagonal, left to right
+            if (row <= span && col >= winLength - 1)
+                boardAddLine(geometry, row, col, 1, -1); // diagonal, right to left
+        }
+    }
+
+    // Insertion sort keeps equally good cells in reading order.
+    for (int i = 0; i < geometry->cells; i++)
+    {
+        int j = i;
+        while (j > 0 && geometry->cellLineCount[geometry->order[j - 1]] < geometry->cellLineCount[i])
+        {
+            geometry->order[j] = geometry->order[j - 1];
+            j--;
+        }
+        geometry->order[j] = i;
+    }
+
+    int last = size - 1;
+    for (int row = 0; row < size; row++)
+    {
+        for (int col = 0; col < size; col++)
+        {
+            const uint8_t targets[BOARD_SYMMETRIES][2] = {
+                {row, col},        {col, last - row}, {last - row, last - col}, {last - col, row},
+                {row, last - col}, {col, row},        {last - row, col},        {last - col, last - row},
+            };
+            for (int s = 0; s < BOARD_SYMMETRIES; s++)
+            {
+                geometry->symmetry[s][row * size + col] = targets[s][0] * size + targets[s][1];
+            }
+        }
+    }
+
+    // Fixed-seed xorshift64 so hashes are reproducible between runs. The seed
+    // depends on the shape so different boards never share keys.
+    uint64_t seed = 0x9E3779B97F4A7C15ull ^ ((uint64_t)size << 8 | winLength);
+    for (int i = 0; i < geometry->cells * 2 + 2; i++)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        if (i < geometry->cells * 2)
+            geometry->zobrist[i / 2][i % 2] = seed;
+        else
+            geometry->zobristSide[i % 2] = seed;
+    }
+    return true;
+}
+
+void boardInit(Board *board, const BoardGeometry *geometry)
+{
+    memset(board, 0, sizeof(*board));
+    board->geometry = geometry;
+    board->winner = empty;
+}
+
+void boardFromGrid(Board *board, const BoardGeometry *geometry, GridPos grid[])
+{
+    boardInit(board, geometry);
+    for (int pos = 0; pos < geometry->cells; pos++)
+    {
+        if (grid[pos].player != empty)
+        {
+            boardPlay(board, pos, grid[pos].player);
+        }
+    }
+}
+
+// Plays without checking the cell is free. Only the lines through pos can
+// have changed, so that is all the win check looks at.
+void HOT(boardPlay)(Board *board, int pos, Player player)
+{
+    const BoardGeometry *geometry = board->geometry;
+    int side = player - 1;
+
+    board->cell[pos] = player;
+    board->filled++;
+    board->hash ^= geometry->zobrist[pos][side];
+    for (int i = 0; i < geometry->cellLineCount[pos]; i++)
+    {
+        uint8_t line = geometry->cellLines[pos][i];
+        if (++board->count[line][side] == geometry->winLength)
+        {
+            board->winner = player;
+        }
+    }
+}
+
+// Takes back the last move at pos. Nothing is played once the game is won, so
+// undoing any move leaves a position without a winner.
+void HOT(boardUndo)(Board *board, int pos)
+{
+    const BoardGeometry *geometry = board->geometry;
+    int side = board->cell[pos] - 1;
+
+    for (int i = 0; i < geometry->cellLineCount[pos]; i++)
+    {
+        board->count[geometry->cellLines[pos][i]][side]--;
+    }
+    board->hash ^= geometry->zobrist[pos][side];
+    board->filled--;
+    board->cell[pos] = empty;
+    board->winner = empty;
+}
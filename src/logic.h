@@ -1,3 +1,6 @@
+#ifndef _LOGIC_H_
+#define _LOGIC_H_
+
 #include "pico/stdlib.h"
 
 typedef enum
@@ -22,3 +25,64 @@ bool playPos(Player player, int pos, GridPos grid[]);
 int nextFreePos(GridPos grid[]);
 int rowColToPos(int row, int col);
 bool allElementsEqual(GridPos grid[], int size);
+
+// Board representation used by the search. Unlike GridPos[] it works for any
+// size up to BOARD_MAX_SIZE and any win length, keeps a count of each player's
+// pieces on every winning line so a win is detected as the move is played, and
+// carries a Zobrist hash of the position.
+
+#define BOARD_MAX_SIZE 7
+#define BOARD_MAX_CELLS (BOARD_MAX_SIZE * BOARD_MAX_SIZE)
+#define BOARD_MIN_WIN 3
+// Worst case is 7x7 with three in a row: 35 rows, 35 columns, 50 diagonals.
+#define BOARD_MAX_LINES 120
+// Worst case is the centre of 7x7 with four in a row: four lines each way.
+#define BOARD_MAX_CELL_LINES 16
+// Rotations and reflections of the square.
+#define BOARD_SYMMETRIES 8
+
+// Everything that depends only on the board's shape, shared by every Board of
+// that shape.
+typedef struct
+{
+  uint8_t size;
+  uint8_t winLength;
+  uint8_t cells;
+  uint8_t lineCount;
+  uint8_t lines[BOARD_MAX_LINES][BOARD_MAX_SIZE];
+  uint8_t cellLineCount[BOARD_MAX_CELLS];
+  uint8_t cellLines[BOARD_MAX_CELLS][BOARD_MAX_CELL_LINES];
+  // Cells sorted by the number of lines through them, most first: a cheap
+  // static move ordering (centre, then corners, then edges on 3x3).
+  uint8_t order[BOARD_MAX_CELLS];
+  // Where each symmetry takes each cell, the identity first.
+  uint8_t symmetry[BOARD_SYMMETRIES][BOARD_MAX_CELLS];
+  uint64_t zobrist[BOARD_MAX_CELLS][2];
+  // Side to move, index player - 1. Neither is zero, so no position keys to 0
+  // (which is what a cleared hash table entry would match).
+  uint64_t zobristSide[2];
+} BoardGeometry;
+
+typedef struct
+{
+  const BoardGeometry *geometry;
+  uint8_t cell[BOARD_MAX_CELLS]; // Player
+  // Pieces per player (index player - 1) on each line.
+  uint8_t count[BOARD_MAX_LINES][2];
+  uint8_t filled;
+  Player winner;
+  uint64_t hash;
+} Board;
+
+bool boardGeometryInit(BoardGeometry *geometry, int size, int winLength);
+void boardInit(Board *board, const BoardGeometry *geometry);
+void boardFromGrid(Board *board, const BoardGeometry *geometry, GridPos grid[]);
+void boardPlay(Board *board, int pos, Player player);
+void boardUndo(Board *board, int pos);
+
+static inline Player opponent(Player player)
+{
+  return player == human ? ai : human;
+}
+
+#endif // _LOGIC_H_
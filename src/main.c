@@ -7,93 +7,300 @@
 #include "logic.h"
 #include "constants.h"
 #include "lib/ICM20948.h"
+#include "lib/i2c_async.h"
+#include "gesture.h"
+#include "calibration.h"
+#include "event_queue.h"
+#include "scheduler.h"
+#include "search.h"
+#include "profile.h"
+#include "trace.h"
+#include "log.h"
+#include "boot.h"
+#include "memstat.h"
+#include "hot.h"
+#include "bench.h"
+#include "serial.h"
+#if IMU_TRACE_RECORD
+#include "imu_trace.h"
+#include "frame.h"
+#endif
 #include "pico/multicore.h"
-
-typedef enum
-{
-  Left,
-  Right,
-  Up,
-  Down
-} Move;
+#include "pico/stdio_usb.h"
 
 static void core1_entry();
-static void clearScreen();
-static void paintGrid();
-static void paintCursor();
-static void paintHuman(uint8_t pos);
-static void paintAI(uint8_t pos);
+static void sensorTaskRun(void *context);
+static void inputTaskRun(void *context);
+static void renderTaskRun(void *context);
+static void aiTaskRun(void *context);
+static void logTaskRun(void *context);
+static void searchTaskRun(void *context);
+static void commandTaskRun(void *context);
+static void wakeSearchHelper();
 static void buttonCallback(uint gpio, uint32_t events);
+static int64_t buttonDebounced(alarm_id_t id, void *userData);
+static void handleButtonPress();
+static void handleEvent(const Event *event);
 static void updatePosWithMove(Move move);
-static void paintGameOverText();
+static void initImu();
+static void initTasks();
 static void startGame();
+#if IMU_TRACE_RECORD
+static void recordSample(ImuTraceRecorder *recorder, uint32_t *batches,
+                         const ICM20948_ST_RAW_SAMPLE *sample, uint32_t timeUs);
+#endif
 
 static int cursorPos = 0;
 
+// Events from the sensor core (core 1) to the UI core (core 0).
+static EventQueue sensorEvents;
+// Debounced button presses, from the timer IRQ to inputTask on core 0.
+static EventQueue buttonEvents;
+// Time of the falling edge that started the current debounce.
+static volatile uint32_t buttonEdgeUs;
+
+// Each core runs its work as tasks on its own scheduler. Core 0 owns the game
+// state and the display; core 1 only reads the IMU.
+static Scheduler core0Scheduler;
+static Scheduler core1Scheduler;
+static Task inputTask;  // core 0, signalled by both event queues' producers
+static Task renderTask; // core 0, signalled whenever the grid or cursor changed
+static Task aiTask;     // core 0, signalled after the human played
+static Task logTask;    // core 0, periodic
+static Task commandTask; // core 0, periodic, polls for serial commands
+static Task sensorTask; // core 1, periodic at the IMU's output data rate
+static Task searchTask; // core 1, signalled by core 0 to help with AI searches
+// Set once core 1's tasks are registered and may be signalled.
+static volatile bool core1Ready = false;
+
+// Core 1 state for the sensor task.
+typedef struct
+{
+  I2C_ASYNC_ST_TXN txn[2];
+  uint8_t sampleBuf[2][ICM20948_SAMPLE_LEN];
+  uint8_t current;
+  Gesture gesture;
+  DriftTracker drift;
+#if IMU_TRACE_RECORD
+  ImuTraceRecorder recorder;
+  uint32_t batches;
+#endif
+} SensorState;
+static SensorState sensor;
+
 // Initialise the grid
 GridPos grid[POSITIONS] =
     {[0 ... LAST_POSITION] = (GridPos){.player = empty, .winningPos = false}};
 
 // The second core (core 1) reads accelerometer data, converts it to
-// (left/right/up/down) then puts it onto the multicore queue where the first
-// core can receive it.
+// (left/right/up/down) then puts it onto the sensor event queue where the
+// first core can receive it.
 void core1_entry()
 {
-  float x;
-  float y;
-  float z;
   printf("Running core1_entry()\n");
 
-  while (true)
+  // Lets core 0 pause this core while it writes calibration to flash. The
+  // lockout handshake owns the SIO FIFOs, so nothing else may use them: moves
+  // travel through sensorEvents instead.
+  multicore_lockout_victim_init();
+  profileInitCore();
+  initImu();
+
+  bootBegin(BootSensor);
+  calibrationTrackerInit(&sensor.drift);
+  gestureInit(&sensor.gesture, &gestureDefaultConfig);
+#if IMU_TRACE_RECORD
+  sensor.batches = 0;
+  imuTraceRecorderInit(&sensor.recorder);
+#endif
+  i2cAsyncInit();
+  sensor.current = 0;
+  icm20948SubmitSampleRead(&sensor.txn[0], sensor.sampleBuf[0], NULL, NULL);
+
+  schedulerInit(&core1Scheduler);
+  schedulerAdd(&core1Scheduler, &sensorTask, "sensor", sensorTaskRun, &sensor);
+  schedulerAdd(&core1Scheduler, &searchTask, "search", searchTaskRun, NULL);
+  taskStartPeriodic(&sensorTask, IMU_SAMPLE_PERIOD_MS * 1000);
+  bootEnd(BootSensor);
+  core1Ready = true;
+  schedulerRun(&core1Scheduler);
+}
+
+// Lends core 1 to an AI search on core 0. Sampling pauses until the search is
+// done, which is fine: nobody tilts the board while waiting for the AI.
+void searchTaskRun(void *context)
+{
+  searchHelperRun();
+}
+
+// Called by the search on core 0 to bring core 1 in.
+void wakeSearchHelper()
+{
+  if (core1Ready)
   {
-    sleep_ms(500);
-    // Use the addresses of our variables.
-    // This function sets data at a pointer, so we give it three pointers.
-    icm20948AccelRead(&x, &y, &z);
-    // Left = +x
-    // Up = +y
-    // printf("x\ty\n%.2f\t%.2f\n", x, y);
-
-    const float xThreshold = 0.6;
-    const float yThreshold = 0.4;
-    Move move = -1;
-
-    // Detect action
-    if (x > xThreshold)
-      move = Left;
-    else if (x < -xThreshold)
-      move = Right;
-    else if (y > yThreshold)
-      move = Up;
-    else if (y < -yThreshold)
-      move = Down;
-
-    if (move == -1)
-    {
-      continue;
-    }
+    taskSignal(&searchTask);
+  }
+}
+
+// Samples are read through the async I2C queue with two buffers: the read for
+// the next sample is already on the bus while the current one runs through the
+// gesture recogniser.
+void sensorTaskRun(void *context)
+{
+  SensorState *state = context;
+  ICM20948_ST_RAW_SAMPLE sample;
 
-    multicore_fifo_push_blocking(move);
+  // Retry moves parked while core 0 was busy.
+  if (sensorEvents.hasPending && eventQueueFlush(&sensorEvents))
+  {
+    taskSignal(&inputTask);
   }
+  uint8_t next = state->current ^ 1;
+  icm20948SubmitSampleRead(&state->txn[next], state->sampleBuf[next], NULL, NULL);
+
+  I2C_ASYNC_EN_STATUS status;
+  {
+    PROFILE_ZONE(ImuRead);
+    status = i2cAsyncWait(&state->txn[state->current]);
+  }
+  uint8_t done = state->current;
+  state->current = next;
+  if (status != I2C_ASYNC_DONE)
+  {
+    return;
+  }
+  icm20948ParseSample(state->sampleBuf[done], &sample);
+  uint32_t now = time_us_32();
+#if IMU_TRACE_RECORD
+  recordSample(&state->recorder, &state->batches, &sample, now);
+#endif
+  icm20948ApplyOffsets(&sample);
+  calibrationTrackDrift(&state->drift, &sample);
+  // Left = +x
+  // Up = +y
+  float x = sample.stAccel.s16X / ICM20948_ACCEL_LSB_PER_G;
+  float y = sample.stAccel.s16Y / ICM20948_ACCEL_LSB_PER_G;
+
+  Move move;
+  if (gestureUpdate(&state->gesture, x, y, now, &move))
+  {
+    // Never stall sensing on a busy UI: repeated moves merge while the queue
+    // is full.
+    Event event = {.type = EventMove, .arg = move, .count = 1, .timeUs = now};
+    eventQueuePush(&sensorEvents, &event, EventCoalesce);
+    taskSignal(&inputTask);
+  }
+}
+
+#if IMU_TRACE_RECORD
+// Streams raw samples over USB serial for host-side replay (see imu_trace.h).
+static void recordSample(ImuTraceRecorder *recorder, uint32_t *batches,
+                         const ICM20948_ST_RAW_SAMPLE *sample, uint32_t timeUs)
+{
+  ImuTraceRecord record = {
+      .timeUs = timeUs,
+      .accel = {sample->stAccel.s16X, sample->stAccel.s16Y, sample->stAccel.s16Z},
+      .gyro = {sample->stGyro.s16X, sample->stGyro.s16Y, sample->stGyro.s16Z},
+  };
+  if (!imuTraceRecorderAdd(recorder, &record))
+  {
+    return;
+  }
+  if (*batches % IMU_TRACE_HEADER_INTERVAL == 0)
+  {
+    const ImuTraceHeader header = {
+        .version = IMU_TRACE_VERSION,
+        .samplePeriodMs = IMU_SAMPLE_PERIOD_MS,
+        .accelLsbPerG = ICM20948_ACCEL_LSB_PER_G,
+        .gyroLsbPerDps10 = ICM20948_GYRO_LSB_PER_DPS * 10,
+    };
+    uint8_t headerBytes[IMU_TRACE_HEADER_LEN];
+    imuTraceEncodeHeader(&header, headerBytes);
+    serialWriteFrame(FrameImuTraceHeader, headerBytes, sizeof(headerBytes));
+  }
+  serialWriteFrame(FrameImuTraceSamples, recorder->payload,
+                   recorder->count * IMU_TRACE_RECORD_LEN);
+  imuTraceRecorderInit(recorder);
+  (*batches)++;
 }
+#endif
 
 int main()
 {
+  // Before anything else runs, for the 'm' command's high water marks.
+  memstatPaintStacks();
+
   // INITIALISE SERIAL IN/OUTPUT
+  bootBegin(BootStdio);
   stdio_init_all();
+  // Disable line and block buffering on stdout (for talking through serial)
+  setvbuf(stdout, NULL, _IONBF, 0);
+  profileInitCore();
+  bootEnd(BootStdio);
+
+  // INITIALISE BUTTON
+  // ---------------------------------------------------------------------------
+  // We are using the button to pull down to 0v when pressed, so it uses
+  // internal pull ups; otherwise when unpressed, the input would be floating.
+  // Use an interrupt to invoke a callback function when the button is pressed
+  // See: https://github.com/raspberrypi/pico-examples/blob/master/gpio/hello_gpio_irq/hello_gpio_irq.c
+  // The callback only starts a debounce; the press is handled by inputTask.
+  // Holding the button during boot forces a full recalibration: the pin is
+  // only sampled after IMU reset on core 1, and a held button makes no edge.
+  bootBegin(BootTasks);
+  gpio_init(BUTTON_GPIO);
+  gpio_set_dir(BUTTON_GPIO, GPIO_IN);
+  gpio_pull_up(BUTTON_GPIO);
+  initTasks();
+  gpio_set_irq_enabled_with_callback(BUTTON_GPIO, GPIO_IRQ_EDGE_FALL, true, &buttonCallback);
+  printf("Button initialised!\n");
+  bootEnd(BootTasks);
+
+  // Start the second core to bring up and then read the accelerometer while
+  // this one brings up the screen. Core 1 may write calibration to flash during
+  // its boot, which needs this core paused.
+  multicore_lockout_victim_init();
+  eventQueueInit(&sensorEvents);
+  multicore_launch_core1(core1_entry);
 
   // INITIALISE SCREEN (https://github.com/plaaosert/st7735-guide)
   // ---------------------------------------------------------------------------
-  // Disable line and block buffering on stdout (for talking through serial)
-  setvbuf(stdout, NULL, _IONBF, 0);
-  // Give the Pico some time to think...
-  sleep_ms(1000);
-  // Initialise the screen
+  bootBegin(BootDisplay);
   ST7735_Init();
-  clearScreen();
+  bootEnd(BootDisplay);
+  bootBegin(BootSplash);
+  paintSplash();
+  bootEnd(BootSplash);
+
+  // The game is only playable once the IMU is.
+  bootBegin(BootImuWait);
+  while (!core1Ready)
+  {
+    tight_loop_contents();
+  }
+  bootEnd(BootImuWait);
 
-  // INITIALISE ACCELEROMETER (https://github.com/plaaosert/icm20948-guide)
-  // ---------------------------------------------------------------------------
+#if SEARCH_BENCH || HOT_BENCH
+  // Boot doesn't wait for the host otherwise, and the results are printed.
+  while (!stdio_usb_connected())
+  {
+    sleep_ms(10);
+  }
+#endif
+#if SEARCH_BENCH
+  searchBenchmark();
+#endif
+#if HOT_BENCH
+  hotBenchmark();
+#endif
+  startGame();
+}
+
+// INITIALISE ACCELEROMETER (https://github.com/plaaosert/icm20948-guide)
+// Runs on core 1, concurrently with the screen's bring-up on core 0.
+void initImu()
+{
+  bootBegin(BootImu);
   i2c_init(i2c0, 400 * 1000);
   gpio_set_function(4, GPIO_FUNC_I2C);
   gpio_set_function(5, GPIO_FUNC_I2C);
@@ -101,58 +308,231 @@ int main()
   gpio_pull_up(5);
   IMU_EN_SENSOR_TYPE enMotionSensorType;
   imuInit(&enMotionSensorType);
+  bootEnd(BootImu);
   if (IMU_EN_SENSOR_TYPE_ICM20948 != enMotionSensorType)
   {
     printf("Failed to initialise IMU...\n");
+    return;
   }
+
+  bootBegin(BootCalibration);
+  bool forceCalibration = !gpio_get(BUTTON_GPIO);
+  bool restored = calibrationBoot(forceCalibration);
+  if (restored)
+    printf("IMU calibration restored from flash\n");
+  bootEnd(BootCalibration);
   printf("IMU initialised!\n");
+}
 
-  // INITIALISE BUTTON
-  // ---------------------------------------------------------------------------
-  gpio_init(BUTTON_GPIO);
-  gpio_set_dir(BUTTON_GPIO, GPIO_IN);
-  // We are using the button to pull down to 0v when pressed, so ensure that when
-  // unpressed, it uses internal pull ups. Otherwise when unpressed, the input will
-  // be floating.
-  gpio_pull_up(BUTTON_GPIO);
-  // Use an interrupt to invoke a callback function when the button is pressed
-  // See: https://github.com/raspberrypi/pico-examples/blob/master/gpio/hello_gpio_irq/hello_gpio_irq.c
-  gpio_set_irq_enabled_with_callback(BUTTON_GPIO, GPIO_IRQ_EDGE_FALL, true, &buttonCallback);
-  printf("Button initialised!\n");
-  // ---------------------------------------------------------------------------
+// Sets up core 0's tasks. They must exist before anything can signal them:
+// the button interrupt and core 1.
+void initTasks()
+{
+  eventQueueInit(&buttonEvents);
+  searchInit(wakeSearchHelper);
+  schedulerInit(&core0Scheduler);
+  // Within one pass tasks run in this order, so a human move is on screen
+  // before the AI starts thinking.
+  schedulerAdd(&core0Scheduler, &inputTask, "input", inputTaskRun, NULL);
+  schedulerAdd(&core0Scheduler, &renderTask, "render", renderTaskRun, NULL);
+  schedulerAdd(&core0Scheduler, &aiTask, "ai", aiTaskRun, NULL);
+  schedulerAdd(&core0Scheduler, &logTask, "log", logTaskRun, NULL);
+  schedulerAdd(&core0Scheduler, &commandTask, "command", commandTaskRun, NULL);
+  taskStartPeriodic(&logTask, LOG_PERIOD_MS * 1000);
+  taskStartPeriodic(&commandTask, COMMAND_POLL_PERIOD_MS * 1000);
+}
 
-  // Start the second core to manage the accelerometer.
-  multicore_launch_core1(core1_entry);
+void startGame()
+{
+  // Initial paint. The grid covers the top half; the splash's bottom half is
+  // cleared here.
+  bootBegin(BootFirstFrame);
+  ST7735_FillRectangle(0, ST7735_HEIGHT / 2, ST7735_WIDTH, ST7735_HEIGHT / 2, ST7735_BLACK);
+  paintGrid(grid, cursorPos);
+  bootEnd(BootFirstFrame);
+  schedulerRun(&core0Scheduler);
+}
 
-  startGame();
+// Drains both event queues. Button presses are taken first so a stream of
+// moves can't delay placing a piece, and draining pauses once a piece is
+// played so the AI answers before the next press is looked at.
+void inputTaskRun(void *context)
+{
+  Event event;
+  while (!aiTask.signalled &&
+         (eventQueuePop(&buttonEvents, &event) || eventQueuePop(&sensorEvents, &event)))
+  {
+    handleEvent(&event);
+  }
 }
 
-void startGame()
+void handleEvent(const Event *event)
 {
-  // Initial paint
-  paintGrid();
-  Player _winner; // human, ai or empty
-  while ((_winner = winner(grid)) == empty)
+  switch (event->type)
   {
-    // Accept the next move from core 1
-    Move move = multicore_fifo_pop_blocking(); // Left, Right, Up or Down.
-    // Update the cursor based on that move
-    updatePosWithMove(move);
-    // Repaint the grid
-    paintGrid();
+  case EventButton:
+    handleButtonPress();
+    break;
+  case EventMove:
+    // Update the cursor based on that move (Left, Right, Up or Down),
+    // repeated if core 1 merged several while we were busy.
+    for (int i = 0; i < event->count; i++)
+    {
+      updatePosWithMove(event->arg);
+    }
+    taskSignal(&renderTask);
+    break;
+  default:
+    break;
   }
-  printf("Winner is %d!!!\n", _winner);
+}
+
+// Repaints the grid and, once someone has won, ends the game.
+void renderTaskRun(void *context)
+{
+  paintGrid(grid, cursorPos);
+  Player _winner = winner(grid); // human, ai or empty
+  if (_winner == empty)
+  {
+    return;
+  }
+  LOG("Winner is %d!!!", _winner);
   paintGameOverText();
+  taskStop(&inputTask);
+  taskStop(&aiTask);
+  taskStop(&renderTask);
+}
+
+// The AI responds to the human's move, if it can.
+void aiTaskRun(void *context)
+{
+  int pos = aiPlay(grid);
+  // There is no move the AI can respond with if pos is -1 or the game is over.
+  if (pos != -1 && winner(grid) == empty)
+  {
+    playPos(ai, pos, grid);
+    taskSignal(&renderTask);
+  }
+  // Pick up anything that arrived while the AI was thinking.
+  taskSignal(&inputTask);
 }
 
-// This method is invoked when the button is pressed.
-// It does the following:
-// 1. Uses the current cursor position to attempt to play a nought.
-// 2. If successful, it repaints the grid then the AI responds with it's own move.
-// 3. If the AI was able to play a move, the grid is repainted once more.
+// Background housekeeping: sends deferred LOG() output, persists gyro offsets
+// re-estimated by core 1, prints the boot report once and periodically prints
+// where both cores spend their time.
+void logTaskRun(void *context)
+{
+  static bool bootReported = false;
+
+  logDrain();
+  calibrationFlush();
+  // Boot no longer waits for the host, so hold the report until it is there.
+  if (!bootReported && stdio_usb_connected())
+  {
+    bootPrintReport();
+    bootReported = true;
+  }
+  if (logTask.runs % (TASK_REPORT_PERIOD_MS / LOG_PERIOD_MS) == 0)
+  {
+    schedulerPrintReport(&core0Scheduler);
+    schedulerPrintReport(&core1Scheduler);
+  }
+}
+
+// Serial console commands:
+//   p  print the profiler report
+//   r  reset the profiler
+//   t  dump the event trace as binary frames (tools/trace_to_chrome.py)
+//   m  print SRAM use and both cores' stack high water marks
+void commandTaskRun(void *context)
+{
+  int command;
+  while ((command = serialReadCommand()) >= 0)
+  {
+    switch (command)
+    {
+#if PROFILE_ENABLED
+    case 'p':
+      profilePrintReport();
+      break;
+    case 'r':
+      profileReset();
+      printf("profile reset\n");
+      break;
+#else
+    case 'p':
+    case 'r':
+      printf("profiler not built in (configure with -DTTT_PROFILE=ON)\n");
+      break;
+#endif
+#if TRACE_ENABLED
+    case 't':
+      traceDump();
+      break;
+#else
+    case 't':
+      printf("trace not built in (configure with -DTTT_TRACE=ON)\n");
+      break;
+#endif
+    case 'm':
+      memstatPrintReport();
+      break;
+#if BENCH_ENABLED
+    case 'b':
+      benchRun(stdout);
+      // The drawing cases painted over the grid.
+      paintGrid(grid, cursorPos);
+      break;
+#else
+    case 'b':
+      printf("benchmarks not built in (configure with -DTTT_BENCH=ON)\n");
+      break;
+#endif
+    default:
+      printf("unknown command '%c'\n", command);
+      break;
+    }
+  }
+}
+
+// GPIO interrupt on the button's falling edge. Contact bounce would otherwise
+// deliver several edges per press, so the pin's interrupt is switched off and a
+// hardware alarm checks the level again once it has settled.
 void buttonCallback(uint gpio, uint32_t events)
 {
-  printf("Button pressed, place piece\n");
+  buttonEdgeUs = time_us_32();
+  TRACE_INSTANT(ButtonEdge, 0);
+  gpio_set_irq_enabled(BUTTON_GPIO, GPIO_IRQ_EDGE_FALL, false);
+  if (add_alarm_in_ms(BUTTON_DEBOUNCE_MS, buttonDebounced, NULL, true) < 0)
+  {
+    // No alarm slot free: drop this press rather than lose the button.
+    gpio_set_irq_enabled(BUTTON_GPIO, GPIO_IRQ_EDGE_FALL, true);
+  }
+}
+
+// Timer interrupt, BUTTON_DEBOUNCE_MS after the edge. Only a button that is
+// still held counts as a press; it is queued with the time of the edge.
+int64_t buttonDebounced(alarm_id_t id, void *userData)
+{
+  if (!gpio_get(BUTTON_GPIO))
+  {
+    TRACE_INSTANT(ButtonPress, 0);
+    Event event = {.type = EventButton, .count = 1, .timeUs = buttonEdgeUs};
+    eventQueuePush(&buttonEvents, &event, EventDrop);
+    taskSignal(&inputTask);
+  }
+  // Forget edges from the bounce before listening again.
+  gpio_acknowledge_irq(BUTTON_GPIO, GPIO_IRQ_EDGE_FALL);
+  gpio_set_irq_enabled(BUTTON_GPIO, GPIO_IRQ_EDGE_FALL, true);
+  return 0;
+}
+
+// Runs on core 0 for each debounced button press. Uses the current cursor
+// position to attempt to play a nought; if successful the grid is repainted and
+// the AI asked to respond.
+void handleButtonPress()
+{
+  LOG("Button pressed, place piece");
   bool played = playPos(human, cursorPos, grid);
   if (!played)
   {
@@ -161,21 +541,12 @@ void buttonCallback(uint gpio, uint32_t events)
     return;
   }
 
-  paintGrid();
-  // AI's turn
-  int pos = aiPlay(grid);
-  if (pos == -1 || winner(grid) != empty)
+  taskSignal(&renderTask);
+  if (winner(grid) == empty)
   {
-    // There is no move the AI can respond with or the game is over.
-    return;
+    // AI's turn
+    taskSignal(&aiTask);
   }
-  playPos(ai, pos, grid);
-  paintGrid();
-}
-
-void clearScreen()
-{
-  ST7735_FillScreen(ST7735_BLACK);
 }
 
 void updatePosWithMove(Move move)
@@ -186,132 +557,41 @@ void updatePosWithMove(Move move)
     if (cursorPos % GRID_SIZE == 0)
     {
       // Cursor is on the left edge.
-      printf("Rejecting move Left: %d\n", cursorPos);
+      LOG("Rejecting move Left: %d", cursorPos);
       return;
     }
-    printf("Moving Left\n");
+    LOG("Moving Left");
     cursorPos--;
     break;
   case Right:
     if ((cursorPos + 1) % GRID_SIZE == 0)
     {
       // Cursor is on the right edge.
-      printf("Rejecting move Right: %d\n", cursorPos);
+      LOG("Rejecting move Right: %d", cursorPos);
       return;
     }
-    printf("Moving Right\n");
+    LOG("Moving Right");
     cursorPos++;
     break;
   case Up:
     if (cursorPos < GRID_SIZE)
     {
       // Cursor is on the top edge.
-      printf("Rejecting move Up: %d\n", cursorPos);
+      LOG("Rejecting move Up: %d", cursorPos);
       return;
     }
-    printf("Moving Up\n");
-    cursorPos -= 3;
+    LOG("Moving Up");
+    cursorPos -= GRID_SIZE;
     break;
   case Down:
     if (cursorPos >= POSITIONS - GRID_SIZE)
     {
       // Cursor is on the bottom edge.
-      printf("Rejecting move Down: %d\n", cursorPos);
+      LOG("Rejecting move Down: %d", cursorPos);
       return;
     }
-    printf("Moving Down\n");
-    cursorPos += 3;
+    LOG("Moving Down");
+    cursorPos += GRID_SIZE;
     break;
   }
 }
-
-void paintGrid()
-{
-  // Clear top half of screen
-  ST7735_FillRectangle(0, 0, ST7735_WIDTH, ST7735_HEIGHT / 2, ST7735_BLACK);
-
-  // Paint the lines forming the grid
-  const uint16_t oneThird = ST7735_WIDTH / 3;
-  const uint16_t twoThirds = oneThird * 2;
-  paintVerticalLine(oneThird, 0, ST7735_WIDTH, ST7735_WHITE);
-  paintVerticalLine(twoThirds, 0, ST7735_WIDTH, ST7735_WHITE);
-  paintHorizontalLine(oneThird, 0, ST7735_WIDTH, ST7735_WHITE);
-  paintHorizontalLine(twoThirds, 0, ST7735_WIDTH, ST7735_WHITE);
-
-  // Paint the players
-  for (int i = 0; i < POSITIONS; i++)
-  {
-    switch (grid[i].player)
-    {
-    case empty:
-      break;
-    case human:
-      paintHuman(i);
-      break;
-    case ai:
-      paintAI(i);
-      break;
-    }
-  }
-
-  paintCursor();
-}
-
-void paintCursor()
-{
-  // Roughly one third of the display.
-  const uint16_t oneThird = 26;
-
-  // Top left of the cell
-  uint16_t x = cursorPos % 3;
-  x += x * oneThird;
-  uint16_t y = cursorPos / 3;
-  y += y * oneThird;
-
-  // Add inset
-  const uint16_t inset = 12; // Just under half of the box
-  x += inset;
-  y += inset;
-  uint16_t size = 4;
-  ST7735_FillRectangle(x, y, size, size, ST7735_GREEN);
-}
-
-void paintHuman(uint8_t pos)
-{
-  const uint16_t oneThird = 26;
-
-  // Paint a square
-  uint16_t x = (pos % 3);
-  x += x * oneThird;
-  uint16_t y = pos / 3;
-  y += y * oneThird;
-
-  // Add inset
-  const uint16_t inset = 5;
-  x += inset;
-  y += inset;
-  paintSquare(x, y, oneThird - (2 * inset), ST7735_WHITE);
-}
-
-void paintAI(uint8_t pos)
-{
-  const uint16_t oneThird = 26;
-
-  uint16_t x = (pos % 3);
-  x += x * oneThird;
-  uint16_t y = pos / 3;
-  y += y * oneThird;
-
-  const uint16_t inset = 5;
-  paintVerticalLine(x + (oneThird / 2), y + inset, y + oneThird - inset, ST7735_WHITE);
-  paintHorizontalLine(y + (oneThird / 2), x + inset, x + oneThird - inset, ST7735_WHITE);
-}
-
-void paintGameOverText()
-{
-  const uint16_t textHeight = 26;
-  const uint16_t y = 94;
-  const uint16_t inset = 8;
-  ST7735_WriteString(inset, y, "GAME", Font_16x26, ST7735_RED, ST7735_BLACK);
-  ST7735_WriteString(inset, y + textHeight, "OVER", Font_16x26, ST7735_RED, ST7735_BLACK);
-}
\ No newline at end of file
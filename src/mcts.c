@@ -0,0 +1,389 @@
+#include "mcts.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+// Iterations between looks at the clock.
+#define MCTS_BATCH 16
+
+typedef struct
+{
+  uint32_t visits;
+  uint32_t score;      // 2 per win and 1 per draw of the player who moved here
+  uint16_t firstChild; // children are contiguous in the pool
+  uint8_t childCount;  // 0 until expanded
+  uint8_t move;
+} MctsNode;
+
+static MctsNode mctsPool[MCTS_POOL_NODES];
+static uint32_t mctsUsed; // the root is always node 0
+static uint64_t mctsRootMasks[2]; // pieces at the root, index player - 1
+static Player mctsRootToMove;
+static uint32_t mctsSeed = 1;
+
+// The board the pool was built for, and a cell mask per winning line.
+static const BoardGeometry *mctsGeometry;
+static uint8_t mctsSize, mctsWinLength;
+static uint64_t mctsLineMask[BOARD_MAX_LINES];
+static uint64_t mctsFull;
+
+// Compaction scratch: the nodes kept, and how many are kept before each word.
+static uint32_t mctsKept[(MCTS_POOL_NODES + 31) / 32];
+static uint16_t mctsKeptBefore[(MCTS_POOL_NODES + 31) / 32];
+
+static inline uint32_t mctsRandom(uint32_t *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    return *seed;
+}
+
+static void mctsUseGeometry(const BoardGeometry *geometry)
+{
+    if (geometry == mctsGeometry && geometry->size == mctsSize &&
+        geometry->winLength == mctsWinLength)
+    {
+        return;
+    }
+    for (int line = 0; line < geometry->lineCount; line++)
+    {
+        mctsLineMask[line] = 0;
+        for (int i = 0; i < geometry->winLength; i++)
+        {
+            mctsLineMask[line] |= 1ull << geometry->lines[line][i];
+        }
+    }
+    mctsFull = (1ull << geometry->cells) - 1;
+    mctsGeometry = geometry;
+    mctsSize = geometry->size;
+    mctsWinLength = geometry->winLength;
+    mctsUsed = 0;
+}
+
+// True if mask, which has just had pos added, holds a line through pos.
+static inline bool mctsWins(uint64_t mask, int pos)
+{
+    const BoardGeometry *geometry = mctsGeometry;
+    for (int i = 0; i < geometry->cellLineCount[pos]; i++)
+    {
+        uint64_t line = mctsLineMask[geometry->cellLines[pos][i]];
+        if ((mask & line) == line)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static Player mctsPlayoutMasks(uint64_t masks[2], Player toMove, uint32_t *seed)
+{
+    uint8_t cells[BOARD_MAX_CELLS];
+    int count = 0;
+
+    for (uint64_t free = ~(masks[0] | masks[1]) & mctsFull; free; free &= free - 1)
+    {
+        cells[count++] = __builtin_ctzll(free);
+    }
+    while (count > 0)
+    {
+        int i = ((mctsRandom(seed) >> 16) * count) >> 16;
+        int pos = cells[i];
+        cells[i] = cells[--count];
+        masks[toMove - 1] |= 1ull << pos;
+        if (mctsWins(masks[toMove - 1], pos))
+        {
+            return toMove;
+        }
+        toMove = opponent(toMove);
+    }
+    return empty;
+}
+
+// A uniformly random game from the board to its end; returns the winner, or
+// empty for a draw.
+Player mctsPlayout(const Board *board, Player toMove, uint32_t *seed)
+{
+    uint64_t masks[2] = {0, 0};
+
+    mctsUseGeometry(board->geometry);
+    if (board->winner != empty)
+    {
+        return board->winner;
+    }
+    for (int pos = 0; pos < board->geometry->cells; pos++)
+    {
+        if (board->cell[pos] != empty)
+            masks[board->cell[pos] - 1] |= 1ull << pos;
+    }
+    return mctsPlayoutMasks(masks, toMove, seed);
+}
+
+void mctsReset(void)
+{
+    mctsGeometry = NULL;
+    mctsUsed = 0;
+    mctsSeed = 1;
+}
+
+static void mctsNewRoot(const uint64_t masks[2], Player toMove)
+{
+    memset(&mctsPool[0], 0, sizeof(MctsNode));
+    mctsUsed = 1;
+    mctsRootMasks[0] = masks[0];
+    mctsRootMasks[1] = masks[1];
+    mctsRootToMove = toMove;
+}
+
+static void mctsMark(uint32_t node)
+{
+    const MctsNode *parent = &mctsPool[node];
+    mctsKept[node / 32] |= 1u << (node % 32);
+    for (int c = 0; c < parent->childCount; c++)
+    {
+        mctsMark(parent->firstChild + c);
+    }
+}
+
+static inline uint32_t mctsNewIndex(uint32_t node)
+{
+    return mctsKeptBefore[node / 32] +
+           __builtin_popcount(mctsKept[node / 32] & ((1u << (node % 32)) - 1));
+}
+
+// Moves the subtree under root to the front of the pool. Children are always
+// allocated after their parent, and each node's children together, so keeping
+// the old order moves every node down and keeps children contiguous.
+static void mctsCompact(uint32_t root)
+{
+    uint32_t words = (mctsUsed + 31) / 32;
+    uint32_t kept = 0;
+
+    memset(mctsKept, 0, words * sizeof(uint32_t));
+    mctsMark(root);
+    for (uint32_t w = 0; w < words; w++)
+    {
+        mctsKeptBefore[w] = kept;
+        kept += __builtin_popcount(mctsKept[w]);
+    }
+    for (uint32_t node = root; node < mctsUsed; node++)
+    {
+        if (!(mctsKept[node / 32] & (1u << (node % 32))))
+            continue;
+        MctsNode moved = mctsPool[node];
+        if (moved.childCount > 0)
+            moved.firstChild = mctsNewIndex(moved.firstChild);
+        mctsPool[mctsNewIndex(node)] = moved;
+    }
+    mctsUsed = kept;
+}
+
+// Follows the moves played since the last search down the tree; true if the
+// position reached is in it, which then becomes the root.
+static bool mctsReuse(const uint64_t masks[2], Player toMove)
+{
+    if (mctsUsed == 0 || (mctsRootMasks[0] & ~masks[0]) || (mctsRootMasks[1] & ~masks[1]))
+    {
+        return false;
+    }
+    uint64_t added[2] = {masks[0] & ~mctsRootMasks[0], masks[1] & ~mctsRootMasks[1]};
+    uint32_t node = 0;
+    Player mover = mctsRootToMove;
+    while (added[0] | added[1])
+    {
+        const MctsNode *parent = &mctsPool[node];
+        uint64_t *mine = &added[mover - 1];
+        int c = 0;
+        while (c < parent->childCount && !(*mine & (1ull << mctsPool[parent->firstChild + c].move)))
+            c++;
+        if (c == parent->childCount)
+            return false;
+        node = parent->firstChild + c;
+        *mine &= ~(1ull << mctsPool[node].move);
+        mover = opponent(mover);
+    }
+    if (mover != toMove)
+    {
+        return false;
+    }
+    mctsCompact(node);
+    mctsRootMasks[0] = masks[0];
+    mctsRootMasks[1] = masks[1];
+    mctsRootToMove = toMove;
+    return true;
+}
+
+// Gives the node a child per empty cell, in the geometry's move order; false
+// if the pool hasn't room.
+static bool mctsExpand(uint32_t node, const uint64_t masks[2])
+{
+    const BoardGeometry *geometry = mctsGeometry;
+    uint64_t free = ~(masks[0] | masks[1]) & mctsFull;
+    uint32_t count = __builtin_popcountll(free);
+
+    if (count == 0 || mctsUsed + count > MCTS_POOL_NODES)
+    {
+        return false;
+    }
+    MctsNode *parent = &mctsPool[node];
+    parent->firstChild = mctsUsed;
+    parent->childCount = count;
+    for (int i = 0; i < geometry->cells; i++)
+    {
+        int pos = geometry->order[i];
+        if (free & (1ull << pos))
+        {
+            MctsNode *child = &mctsPool[mctsUsed++];
+            memset(child, 0, sizeof(*child));
+            child->move = pos;
+        }
+    }
+    return true;
+}
+
+// The child with the best upper confidence bound; unvisited ones first.
+static uint32_t mctsSelect(const MctsNode *parent)
+{
+    float logVisits = logf((float)parent->visits);
+    uint32_t best = parent->firstChild;
+    float bestValue = -1;
+
+    for (uint32_t c = parent->firstChild; c < parent->firstChild + parent->childCount; c++)
+    {
+        const MctsNode *child = &mctsPool[c];
+        if (child->visits == 0)
+        {
+            return c;
+        }
+        float value = child->score / (2.0f * child->visits) +
+                      MCTS_EXPLORATION * sqrtf(logVisits / child->visits);
+        if (value > bestValue)
+        {
+            best = c;
+            bestValue = value;
+        }
+    }
+    return best;
+}
+
+// Selection, expansion, a playout and back-propagation.
+static void mctsIterate(void)
+{
+    uint64_t masks[2] = {mctsRootMasks[0], mctsRootMasks[1]};
+    Player toMove = mctsRootToMove;
+    uint16_t path[BOARD_MAX_CELLS + 1];
+    int depth = 0;
+    uint32_t node = 0;
+    bool over = false;
+    Player result = empty;
+
+    path[depth++] = node;
+    for (;;)
+    {
+        MctsNode *parent = &mctsPool[node];
+        // A leaf is expanded on its second visit (the root at once).
+        if (parent->childCount == 0 &&
+            ((parent->visits == 0 && node != 0) || !mctsExpand(node, masks)))
+        {
+            break;
+        }
+        node = mctsSelect(parent);
+        path[depth++] = node;
+        int pos = mctsPool[node].move;
+        masks[toMove - 1] |= 1ull << pos;
+        if (mctsWins(masks[toMove - 1], pos))
+        {
+            result = toMove;
+            over = true;
+            break;
+        }
+        toMove = opponent(toMove);
+        if ((masks[0] | masks[1]) == mctsFull)
+        {
+            over = true;
+            break;
+        }
+    }
+    if (!over)
+    {
+        result = mctsPlayoutMasks(masks, toMove, &mctsSeed);
+    }
+
+    // Each node is scored for the player who moved into it.
+    for (int i = depth - 1; i >= 0; i--)
+    {
+        Player mover = i % 2 == 1 ? mctsRootToMove : opponent(mctsRootToMove);
+        MctsNode *scored = &mctsPool[path[i]];
+        scored->visits++;
+        scored->score += result == empty ? 1 : result == mover ? 2 : 0;
+    }
+}
+
+// Searches until budgetUs has passed or maxIterations playouts have run,
+// whichever is first (0 for no limit, but not both), and returns the most
+// visited move. A move that wins on the spot is played without searching.
+int mctsBestMove(const Board *board, Player toMove, uint32_t budgetUs, uint32_t maxIterations,
+                 MctsResult *result)
+{
+    const BoardGeometry *geometry = board->geometry;
+    uint32_t start = time_us_32();
+    uint64_t masks[2] = {0, 0};
+
+    memset(result, 0, sizeof(*result));
+    result->move = -1;
+    if (board->winner != empty || board->filled == geometry->cells)
+    {
+        return -1;
+    }
+    mctsUseGeometry(geometry);
+    for (int pos = 0; pos < geometry->cells; pos++)
+    {
+        if (board->cell[pos] != empty)
+            masks[board->cell[pos] - 1] |= 1ull << pos;
+    }
+    for (int pos = 0; pos < geometry->cells; pos++)
+    {
+        if (board->cell[pos] == empty && mctsWins(masks[toMove - 1] | 1ull << pos, pos))
+        {
+            result->move = pos;
+            result->score = 1;
+            result->timeUs = time_us_32() - start;
+            return pos;
+        }
+    }
+
+    if (mctsReuse(masks, toMove))
+        result->reused = mctsUsed;
+    else
+        mctsNewRoot(masks, toMove);
+    do
+    {
+        uint32_t batch = MCTS_BATCH;
+        if (maxIterations != 0 && maxIterations - result->iterations < batch)
+            batch = maxIterations - result->iterations;
+        for (uint32_t i = 0; i < batch; i++)
+        {
+            mctsIterate();
+        }
+        result->iterations += batch;
+    } while ((maxIterations == 0 || result->iterations < maxIterations) &&
+             (budgetUs == 0 || time_us_32() - start < budgetUs));
+
+    const MctsNode *root = &mctsPool[0];
+    uint32_t bestVisits = 0;
+    for (uint32_t c = root->firstChild; c < root->firstChild + root->childCount; c++)
+    {
+        const MctsNode *child = &mctsPool[c];
+        if (child->visits > bestVisits)
+        {
+            bestVisits = child->visits;
+            result->move = child->move;
+            result->score = child->score / (2.0f * child->visits);
+        }
+    }
+    result->nodes = mctsUsed;
+    result->timeUs = time_us_32() - start;
+    return result->move;
+}
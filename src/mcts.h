@@ -0,0 +1,46 @@
+#ifndef _MCTS_H_
+#define _MCTS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "logic.h"
+
+// Monte Carlo tree search (UCT), the alternative to search.h for boards where
+// alpha-beta can't see far enough: configure with -DTTT_MCTS=ON and aiPlay()
+// uses it for MCTS_BUDGET_US per move (constants.h).
+//
+// The tree lives in a fixed pool of MCTS_POOL_NODES nodes, and the children of
+// a node are allocated together when it is first revisited. Playouts play
+// uniformly random moves on a pair of cell masks, checking only the lines
+// through each move. Between calls the subtree of the position actually
+// reached is kept, and the pool is compacted around it so the rest is reused.
+// Once the pool is full the tree stops growing, but playouts go on until the
+// time budget runs out.
+//
+// The pool and the tree are global: one search runs at a time, on the calling
+// core.
+
+#ifndef MCTS_POOL_NODES
+#define MCTS_POOL_NODES 2048 // 12 bytes each
+#endif
+
+// UCT exploration constant.
+#define MCTS_EXPLORATION 1.4f
+
+typedef struct
+{
+  int move;            // -1 if there was nothing to play
+  uint32_t iterations; // playouts run by this call
+  uint32_t reused;     // nodes kept from the previous call
+  uint32_t nodes;      // pool nodes in use afterwards
+  uint32_t timeUs;
+  float score; // the move's mean result for the side to move: 1 win, 0.5 draw
+} MctsResult;
+
+void mctsReset(void);
+int mctsBestMove(const Board *board, Player toMove, uint32_t budgetUs, uint32_t maxIterations,
+                 MctsResult *result);
+Player mctsPlayout(const Board *board, Player toMove, uint32_t *seed);
+
+#endif // _MCTS_H_
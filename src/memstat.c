@@ -0,0 +1,80 @@
+#include "memstat.h"
+
+#include <malloc.h>
+#include <stdio.h>
+
+#include "pico/stdlib.h"
+
+// From the SDK's linker script.
+extern uint32_t __data_start__, __data_end__;
+extern uint32_t __bss_start__, __bss_end__;
+extern uint32_t __end__, __HeapLimit;
+extern uint32_t __StackBottom, __StackTop;
+extern uint32_t __StackOneBottom, __StackOneTop;
+
+#define SRAM_SIZE (264 * 1024)
+
+// Must run on core 0 before core 1 is launched: core 1's stack is painted
+// whole, core 0's from its bottom up to just below the caller.
+void __attribute__((noinline)) memstatPaintStacks(void)
+{
+    uint32_t marker;
+    uint32_t *limit = &marker - MEMSTAT_PAINT_MARGIN;
+
+    for (uint32_t *word = &__StackBottom; word < limit; word++)
+    {
+        *word = MEMSTAT_STACK_PAINT;
+    }
+    for (uint32_t *word = &__StackOneBottom; word < &__StackOneTop; word++)
+    {
+        *word = MEMSTAT_STACK_PAINT;
+    }
+}
+
+// Bytes of the stack [bottom, top) that have ever been used.
+static uint32_t memstatStackUsed(const uint32_t *bottom, const uint32_t *top)
+{
+    const uint32_t *word = bottom;
+    while (word < top && *word == MEMSTAT_STACK_PAINT)
+    {
+        word++;
+    }
+    return (top - word) * sizeof(uint32_t);
+}
+
+static uint32_t memstatBytes(const uint32_t *start, const uint32_t *end)
+{
+    return (end - start) * sizeof(uint32_t);
+}
+
+static void memstatPrintStack(int core, const uint32_t *bottom, const uint32_t *top)
+{
+    uint32_t size = memstatBytes(bottom, top);
+    uint32_t used = memstatStackUsed(bottom, top);
+    printf("  stack core %d     %6lu used of %6lu, %6lu free\n", core, (unsigned long)used,
+           (unsigned long)size, (unsigned long)(size - used));
+}
+
+void memstatPrintReport(void)
+{
+    uint32_t data = memstatBytes(&__data_start__, &__data_end__);
+    uint32_t bss = memstatBytes(&__bss_start__, &__bss_end__);
+    uint32_t heapSize = memstatBytes(&__end__, &__HeapLimit);
+    uint32_t stacks = memstatBytes(&__StackBottom, &__StackTop) +
+                      memstatBytes(&__StackOneBottom, &__StackOneTop);
+    struct mallinfo heap = mallinfo();
+
+    printf("memory (bytes of %d SRAM)\n", SRAM_SIZE);
+    printf("  .data            %6lu (includes code run from RAM)\n", (unsigned long)data);
+    printf("  .bss             %6lu\n", (unsigned long)bss);
+    printf("  heap             %6lu in use of %6lu\n", (unsigned long)heap.uordblks,
+           (unsigned long)heapSize);
+#if NO_HEAP
+    if (heap.arena != 0)
+        printf("  WARNING: the heap was used in a TTT_NO_HEAP build\n");
+#endif
+    memstatPrintStack(0, &__StackBottom, &__StackTop);
+    memstatPrintStack(1, &__StackOneBottom, &__StackOneTop);
+    printf("  headroom         %6lu after static data, heap and stacks\n",
+           (unsigned long)(SRAM_SIZE - data - bss - heap.arena - stacks));
+}
@@ -0,0 +1,18 @@
+#ifndef _MEMSTAT_H_
+#define _MEMSTAT_H_
+
+// SRAM accounting on the device: static data, heap and each core's stack high
+// water mark, printed with the 'm' serial command. Per-subsystem static RAM
+// comes from the linker map instead, see tools/mem_report.py.
+//
+// High water marks are found by filling the unused part of both stacks with a
+// pattern at boot and later looking for the deepest word that changed.
+
+#define MEMSTAT_STACK_PAINT 0x5AA5C3E1u
+// Words below the caller's frame left unpainted, for memstatPaintStacks() itself.
+#define MEMSTAT_PAINT_MARGIN 16
+
+void memstatPaintStacks(void);
+void memstatPrintReport(void);
+
+#endif // _MEMSTAT_H_
@@ -0,0 +1,14 @@
+#ifndef _NO_HEAP_H_
+#define _NO_HEAP_H_
+
+// Force-included into every firmware source of this project by
+// -DTTT_NO_HEAP=ON, so that any use of the heap in game, rendering or sensor
+// code is a compile error. The C library headers that declare the allocator
+// are pulled in first; poisoning only rejects uses after this point.
+
+#include <malloc.h>
+#include <stdlib.h>
+
+#pragma GCC poison malloc calloc realloc free
+
+#endif // _NO_HEAP_H_
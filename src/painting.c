@@ -1,5 +1,9 @@
 #include "painting.h"
 #include "lib/st7735.h"
+#include "lib/fonts.h"
+#include "constants.h"
+#include "profile.h"
+#include "hot.h"
 
 void paintSquare(uint16_t x, uint16_t y, uint16_t size, uint16_t color)
 {
@@ -37,4 +41,96 @@ void paintHorizontalLine(uint16_t y, uint16_t x1, uint16_t x2, uint16_t color)
     {
         ST7735_DrawPixel(x, y, color);
     }
-}
\ No newline at end of file
+}
+
+void paintGrid(const GridPos grid[], int cursorPos)
+{
+    PROFILE_ZONE(PaintGrid);
+    // Clear top half of screen
+    ST7735_FillRectangle(0, 0, ST7735_WIDTH, ST7735_HEIGHT / 2, ST7735_BLACK);
+
+    // Paint the lines forming the grid
+    for (int i = 1; i < GRID_SIZE; i++)
+    {
+        paintVerticalLine(i * CELL_SIZE, 0, ST7735_WIDTH, ST7735_WHITE);
+        paintHorizontalLine(i * CELL_SIZE, 0, ST7735_WIDTH, ST7735_WHITE);
+    }
+
+    // Paint the players
+    for (int i = 0; i < POSITIONS; i++)
+    {
+        switch (grid[i].player)
+        {
+        case empty:
+            break;
+        case human:
+            paintHuman(i);
+            break;
+        case ai:
+            paintAI(i);
+            break;
+        }
+    }
+
+    paintCursor(cursorPos);
+}
+
+void paintCursor(int cursorPos)
+{
+    // Top left of the cell
+    uint16_t x = cursorPos % GRID_SIZE;
+    x += x * CELL_SIZE;
+    uint16_t y = cursorPos / GRID_SIZE;
+    y += y * CELL_SIZE;
+
+    // Add inset
+    const uint16_t inset = CELL_SIZE / 2 - 1; // Just under half of the box
+    x += inset;
+    y += inset;
+    uint16_t size = 4;
+    ST7735_FillRectangle(x, y, size, size, ST7735_GREEN);
+}
+
+void paintHuman(uint8_t pos)
+{
+    // Paint a square
+    uint16_t x = (pos % GRID_SIZE);
+    x += x * CELL_SIZE;
+    uint16_t y = pos / GRID_SIZE;
+    y += y * CELL_SIZE;
+
+    // Add inset
+    const uint16_t inset = CELL_SIZE / 5;
+    x += inset;
+    y += inset;
+    paintSquare(x, y, CELL_SIZE - (2 * inset), ST7735_WHITE);
+}
+
+void paintAI(uint8_t pos)
+{
+    uint16_t x = (pos % GRID_SIZE);
+    x += x * CELL_SIZE;
+    uint16_t y = pos / GRID_SIZE;
+    y += y * CELL_SIZE;
+
+    const uint16_t inset = CELL_SIZE / 5;
+    paintVerticalLine(x + (CELL_SIZE / 2), y + inset, y + CELL_SIZE - inset, ST7735_WHITE);
+    paintHorizontalLine(y + (CELL_SIZE / 2), x + inset, x + CELL_SIZE - inset, ST7735_WHITE);
+}
+
+void paintGameOverText()
+{
+    const uint16_t textHeight = 26;
+    const uint16_t y = 94;
+    const uint16_t inset = 8;
+    ST7735_WriteString(inset, y, "GAME", Font_16x26, ST7735_RED, ST7735_BLACK);
+    ST7735_WriteString(inset, y + textHeight, "OVER", Font_16x26, ST7735_RED, ST7735_BLACK);
+}
+
+// Shown from the moment the screen is on until the game can be played. The
+// image is full screen, after an 8 byte header.
+void paintSplash()
+{
+    // Read past the XIP cache: 25 KB would otherwise flush every cached line.
+    ST7735_DrawImage(0, 0, ST7735_WIDTH, ST7735_HEIGHT, UNCACHED(&arducam_logo[8]));
+}
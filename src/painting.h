@@ -1,7 +1,26 @@
+#ifndef _PAINTING_H_
+#define _PAINTING_H_
+
 #include <stdio.h>
 
+#include "logic.h"
+#include "constants.h"
+#include "lib/st7735.h"
+
+// Width of one grid cell in pixels; the grid fills the top square of the screen.
+#define CELL_SIZE (ST7735_WIDTH / GRID_SIZE)
+
 void paintSquare(uint16_t x, uint16_t y, uint16_t size, uint16_t color);
 
 void paintVerticalLine(uint16_t x, uint16_t y1, uint16_t y2, uint16_t color);
 
-void paintHorizontalLine(uint16_t y, uint16_t x1, uint16_t x2, uint16_t color);
\ No newline at end of file
+void paintHorizontalLine(uint16_t y, uint16_t x1, uint16_t x2, uint16_t color);
+
+void paintGrid(const GridPos grid[], int cursorPos);
+void paintCursor(int cursorPos);
+void paintHuman(uint8_t pos);
+void paintAI(uint8_t pos);
+void paintGameOverText(void);
+void paintSplash(void);
+
+#endif // _PAINTING_H_
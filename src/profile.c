@@ -0,0 +1,96 @@
+#include "profile.h"
+
+#if PROFILE_ENABLED
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hardware/clocks.h"
+
+static const char *const zoneNames[ZoneCount] = {
+#define PROFILE_ZONE_NAME(name) #name,
+    PROFILE_ZONES(PROFILE_ZONE_NAME)
+#undef PROFILE_ZONE_NAME
+};
+
+// One row per core; each core only ever writes its own.
+static ProfileStats profileStats[2][ZoneCount];
+static uint32_t cyclesPerUs = 125;
+
+// SysTick is private to each core, so both cores call this once at start-up.
+void profileInitCore(void)
+{
+    if (get_core_num() == 0)
+    {
+        cyclesPerUs = clock_get_hz(clk_sys) / 1000000;
+        profileReset();
+    }
+    systick_hw->rvr = 0xFFFFFF;
+    systick_hw->cvr = 0;
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+}
+
+// Runs when a PROFILE_ZONE goes out of scope. A zone entered from an interrupt
+// that preempted the same zone on the same core can lose an update; the
+// numbers are for finding hot spots, not for accounting.
+void profileEnd(ProfileScope *scope)
+{
+    uint32_t endCycles = systick_hw->cvr;
+    uint32_t elapsedUs = timer_hw->timerawl - scope->startUs;
+    uint32_t cycles = (scope->startCycles - endCycles) & 0xFFFFFF;
+
+    // Well before SysTick could have wrapped, switch to the timer.
+    if (elapsedUs >= (0x1000000 / cyclesPerUs) / 2)
+        cycles = elapsedUs * cyclesPerUs;
+
+#if TRACE_ENABLED
+    traceRecord(TraceEnd, scope->zone, 0);
+#endif
+    ProfileStats *stats = &profileStats[get_core_num()][scope->zone];
+    stats->count++;
+    stats->totalCycles += cycles;
+    if (cycles < stats->minCycles)
+        stats->minCycles = cycles;
+    if (cycles > stats->maxCycles)
+        stats->maxCycles = cycles;
+}
+
+void profileReset(void)
+{
+    memset(profileStats, 0, sizeof(profileStats));
+    for (int core = 0; core < 2; core++)
+    {
+        for (int zone = 0; zone < ZoneCount; zone++)
+        {
+            profileStats[core][zone].minCycles = UINT32_MAX;
+        }
+    }
+}
+
+const char *profileZoneName(int zone)
+{
+    return zoneNames[zone];
+}
+
+void profilePrintReport(void)
+{
+    printf("profile (cycles, %lu per us)\n", (unsigned long)cyclesPerUs);
+    printf("  %-14s %4s %8s %10s %10s %10s %10s\n", "zone", "core", "count", "min", "mean",
+           "max", "total us");
+    for (int core = 0; core < 2; core++)
+    {
+        for (int zone = 0; zone < ZoneCount; zone++)
+        {
+            const ProfileStats *stats = &profileStats[core][zone];
+            if (stats->count == 0)
+                continue;
+            printf("  %-14s %4d %8lu %10lu %10lu %10lu %10llu\n", zoneNames[zone], core,
+                   (unsigned long)stats->count, (unsigned long)stats->minCycles,
+                   (unsigned long)(stats->totalCycles / stats->count),
+                   (unsigned long)stats->maxCycles,
+                   (unsigned long long)(stats->totalCycles / cyclesPerUs));
+        }
+    }
+}
+
+#endif // PROFILE_ENABLED
@@ -0,0 +1,89 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include <stdint.h>
+
+// Hot-path profiler. PROFILE_ZONE(Name) at the top of a block times the rest
+// of that block and adds it to the zone's count/min/max/total for the core it
+// ran on. Zones are declared once, in PROFILE_ZONES below.
+//
+// Durations are CPU cycles from the core's own SysTick. SysTick is only 24 bits
+// (~134 ms at 125 MHz), so longer zones are measured with the microsecond timer
+// instead.
+//
+// With -DTTT_TRACE=ON each zone also records begin/end events (see trace.h).
+//
+// Configure with -DTTT_PROFILE=ON to enable. Otherwise every macro here expands
+// to nothing and profile.c compiles to an empty object.
+
+#define PROFILE_ZONES(X) \
+  X(PaintGrid)           \
+  X(DrawPixel)           \
+  X(FillRectangle)       \
+  X(ImuRead)             \
+  X(Winner)              \
+  X(AiSearch)            \
+  X(AiHelper)
+
+#if PROFILE_ENABLED
+
+#include "pico/stdlib.h"
+#include "hardware/structs/systick.h"
+#include "hardware/structs/timer.h"
+#include "trace.h"
+
+typedef enum
+{
+#define PROFILE_ZONE_ENUM(name) Zone##name,
+  PROFILE_ZONES(PROFILE_ZONE_ENUM)
+#undef PROFILE_ZONE_ENUM
+  ZoneCount
+} ProfileZone;
+
+typedef struct
+{
+  uint32_t count;
+  uint32_t minCycles;
+  uint32_t maxCycles;
+  uint64_t totalCycles;
+} ProfileStats;
+
+typedef struct
+{
+  uint8_t zone;
+  uint32_t startCycles; // SysTick counts down
+  uint32_t startUs;
+} ProfileScope;
+
+void profileInitCore(void);
+void profileEnd(ProfileScope *scope);
+void profileReset(void);
+void profilePrintReport(void);
+const char *profileZoneName(int zone);
+
+static inline ProfileScope profileBegin(ProfileZone zone)
+{
+#if TRACE_ENABLED
+  traceRecord(TraceBegin, zone, 0);
+#endif
+  ProfileScope scope = {zone, systick_hw->cvr, timer_hw->timerawl};
+  return scope;
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name)                                                             \
+  ProfileScope PROFILE_CONCAT(profileScope, __LINE__) __attribute__((cleanup(profileEnd))) = \
+      profileBegin(Zone##name)
+
+#else
+
+#define PROFILE_ZONE(name) \
+  do                       \
+  {                        \
+  } while (0)
+#define profileInitCore() ((void)0)
+
+#endif // PROFILE_ENABLED
+
+#endif // _PROFILE_H_
@@ -0,0 +1,174 @@
+#include "scheduler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+void schedulerInit(Scheduler *scheduler)
+{
+    memset(scheduler, 0, sizeof(*scheduler));
+    scheduler->core = get_core_num();
+    scheduler->startUs = time_us_64();
+}
+
+// Registers an event-driven task. Tasks run in the order they were added, so
+// add latency-sensitive ones first. Start a timer on the task to make it
+// periodic or delayed.
+bool schedulerAdd(Scheduler *scheduler, Task *task, const char *name, TaskFunction run,
+                  void *context)
+{
+    if (scheduler->count == SCHEDULER_MAX_TASKS)
+        return false;
+    memset(task, 0, sizeof(*task));
+    task->name = name;
+    task->run = run;
+    task->context = context;
+    task->enabled = true;
+    task->dueUs = SCHEDULER_NEVER;
+    scheduler->tasks[scheduler->count++] = task;
+    return true;
+}
+
+// First run is immediate, then every periodUs. Runs that fall more than a
+// period behind are skipped rather than run back to back.
+void taskStartPeriodic(Task *task, uint32_t periodUs)
+{
+    task->periodUs = periodUs;
+    task->dueUs = time_us_64();
+    task->enabled = true;
+}
+
+void taskStartOneShot(Task *task, uint32_t delayUs)
+{
+    task->periodUs = 0;
+    task->dueUs = time_us_64() + delayUs;
+    task->enabled = true;
+}
+
+// Cancels the timer and ignores signals until a timer is started again.
+void taskStop(Task *task)
+{
+    task->enabled = false;
+    task->periodUs = 0;
+    task->dueUs = SCHEDULER_NEVER;
+    task->signalled = false;
+}
+
+void taskSignal(Task *task)
+{
+    task->signalled = true;
+    __dmb();
+    __sev();
+}
+
+static void taskRun(Task *task)
+{
+    uint32_t start = time_us_32();
+    task->run(task->context);
+    uint32_t elapsed = time_us_32() - start;
+
+    task->runs++;
+    task->totalUs += elapsed;
+    if (elapsed > task->maxUs)
+        task->maxUs = elapsed;
+}
+
+// Runs every task that is due or signalled once, and returns the earliest
+// deadline left (0 if a task was signalled meanwhile).
+uint64_t schedulerRunReady(Scheduler *scheduler)
+{
+    uint64_t next = SCHEDULER_NEVER;
+
+    for (int i = 0; i < scheduler->count; i++)
+    {
+        Task *task = scheduler->tasks[i];
+        if (!task->enabled)
+            continue;
+
+        uint64_t now = time_us_64();
+        bool timed = task->dueUs <= now;
+        if (timed || task->signalled)
+        {
+            if (timed)
+            {
+                uint64_t late = now - task->dueUs;
+                if (late > task->maxLateUs)
+                    task->maxLateUs = late;
+                if (task->periodUs == 0)
+                    task->dueUs = SCHEDULER_NEVER;
+                else if ((task->dueUs += task->periodUs) <= now)
+                    task->dueUs = now + task->periodUs;
+            }
+            // Cleared before running so a signal raised during the run is kept.
+            task->signalled = false;
+            taskRun(task);
+        }
+    }
+
+    for (int i = 0; i < scheduler->count; i++)
+    {
+        Task *task = scheduler->tasks[i];
+        if (!task->enabled)
+            continue;
+        if (task->signalled)
+            return 0;
+        if (task->dueUs < next)
+            next = task->dueUs;
+    }
+    return next;
+}
+
+// Never returns. The event register makes the sleep race-free: a signal that
+// lands after schedulerRunReady() looked leaves it set and WFE falls through.
+void schedulerRun(Scheduler *scheduler)
+{
+    while (true)
+    {
+        uint64_t next = schedulerRunReady(scheduler);
+        uint64_t idleStart = time_us_64();
+        if (next <= idleStart)
+            continue;
+
+        if (next == SCHEDULER_NEVER)
+            __wfe();
+        else
+            best_effort_wfe_or_timeout(from_us_since_boot(next));
+        scheduler->idleUs += time_us_64() - idleStart;
+    }
+}
+
+void schedulerResetStats(Scheduler *scheduler)
+{
+    for (int i = 0; i < scheduler->count; i++)
+    {
+        Task *task = scheduler->tasks[i];
+        task->runs = 0;
+        task->totalUs = 0;
+        task->maxUs = 0;
+        task->maxLateUs = 0;
+    }
+    scheduler->idleUs = 0;
+    scheduler->startUs = time_us_64();
+}
+
+void schedulerPrintReport(const Scheduler *scheduler)
+{
+    uint64_t span = time_us_64() - scheduler->startUs;
+    if (span == 0)
+        span = 1;
+
+    printf("core %u: %llu ms, %.1f%% idle\n", scheduler->core,
+           (unsigned long long)(span / 1000), 100.0 * scheduler->idleUs / span);
+    printf("  %-8s %8s %8s %8s %8s %6s\n", "task", "runs", "avg us", "max us", "late us",
+           "cpu%");
+    for (int i = 0; i < scheduler->count; i++)
+    {
+        const Task *task = scheduler->tasks[i];
+        printf("  %-8s %8lu %8lu %8lu %8lu %6.2f\n", task->name, (unsigned long)task->runs,
+               (unsigned long)(task->runs ? task->totalUs / task->runs : 0),
+               (unsigned long)task->maxUs, (unsigned long)task->maxLateUs,
+               100.0 * task->totalUs / span);
+    }
+}
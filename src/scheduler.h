@@ -0,0 +1,61 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Cooperative run-to-completion task scheduler, one instance per core.
+//
+// A task is a function that does a bounded amount of work and returns. It runs
+// when its timer is due (periodic tasks and one-shot timers), when it has been
+// signalled (event-driven tasks), or both. Between runs the core sleeps in WFE
+// until the earliest deadline, which a hardware alarm turns into a wake-up, or
+// until any SEV, which every taskSignal() issues.
+//
+// Timers must be started and stopped from the core that owns the task;
+// taskSignal() is safe from any core or interrupt handler.
+
+#define SCHEDULER_MAX_TASKS 8
+#define SCHEDULER_NEVER UINT64_MAX
+
+typedef void (*TaskFunction)(void *context);
+
+typedef struct
+{
+  const char *name;
+  TaskFunction run;
+  void *context;
+  bool enabled;
+  volatile bool signalled;
+  uint32_t periodUs; // 0 unless periodic
+  uint64_t dueUs;    // next timed run, SCHEDULER_NEVER if none
+  // Run-time accounting
+  uint32_t runs;
+  uint64_t totalUs;
+  uint32_t maxUs;
+  uint32_t maxLateUs; // worst delay past dueUs before a timed run started
+} Task;
+
+typedef struct
+{
+  Task *tasks[SCHEDULER_MAX_TASKS];
+  uint8_t count;
+  uint8_t core; // the core that called schedulerInit() and runs the tasks
+  uint64_t startUs;
+  uint64_t idleUs;
+} Scheduler;
+
+void schedulerInit(Scheduler *scheduler);
+bool schedulerAdd(Scheduler *scheduler, Task *task, const char *name, TaskFunction run,
+                  void *context);
+uint64_t schedulerRunReady(Scheduler *scheduler);
+void schedulerRun(Scheduler *scheduler);
+void schedulerResetStats(Scheduler *scheduler);
+void schedulerPrintReport(const Scheduler *scheduler);
+
+void taskStartPeriodic(Task *task, uint32_t periodUs);
+void taskStartOneShot(Task *task, uint32_t delayUs);
+void taskStop(Task *task);
+void taskSignal(Task *task);
+
+#endif // _SCHEDULER_H_
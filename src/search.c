@@ -0,0 +1,453 @@
+#include "search.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "eval.h"
+#include "threat.h"
+#include "profile.h"
+#include "hot.h"
+
+// Transposition table. Entries are written by both cores without a lock, so
+// each one stores its payload next to (key ^ payload). The two words are
+// written separately; a reader that catches a half-written entry (or another
+// position mapped to the same slot) gets a mismatch when it xors them back and
+// treats the entry as a miss.
+typedef struct
+{
+    volatile uint32_t check; // upper half of the key ^ data
+    volatile uint32_t data;
+} TtEntry;
+
+#define TT_SIZE (1u << SEARCH_TT_BITS)
+
+enum
+{
+    TtExact,
+    TtLower, // score is a lower bound (failed high)
+    TtUpper  // score is an upper bound (failed low)
+};
+
+#define NO_MOVE 31
+
+static TtEntry table[TT_SIZE];
+
+// Root state shared between the cores for one search. Claiming a root move and
+// publishing a better score are read-modify-writes on shared words: the M0+
+// has no exclusive load/store to build a compare-and-swap from, so both go
+// through a hardware spinlock. Reading the bound needs no lock because aligned
+// word loads are atomic.
+typedef enum
+{
+    HelperIdle,
+    HelperRequested,
+    HelperRunning
+} HelperState;
+
+typedef struct
+{
+    Board board;
+    EvalState eval;
+    Player toMove;
+    int depth;
+    bool evaluate; // false when the search reaches the end of every game
+    uint8_t moves[BOARD_MAX_CELLS];
+    uint8_t moveCount;
+    uint8_t next;
+    volatile int32_t alpha;
+    volatile int32_t bestMove;
+    volatile HelperState helper;
+    uint32_t nodes[2];
+} RootSearch;
+
+typedef struct
+{
+    Board board;
+    EvalState eval;
+    uint32_t nodes;
+} Worker;
+
+static RootSearch root;
+static Worker coreWorkers[2];
+static spin_lock_t *rootLock;
+static void (*volatile wakeHelper)(void);
+static EvalTables evalTables; // for the last geometry searched
+
+// wake, if not NULL, must make core 1 call searchHelperRun() soon. It may be
+// called from core 0 at any time after this returns.
+void searchInit(void (*wake)(void))
+{
+    if (rootLock == NULL)
+    {
+        rootLock = spin_lock_instance(spin_lock_claim_unused(true));
+    }
+    searchClear();
+    wakeHelper = wake;
+}
+
+void searchClear(void)
+{
+    memset((void *)table, 0, sizeof(table));
+}
+
+static inline uint32_t ttPack(int score, int depth, int flag, int move)
+{
+    return (uint16_t)score | (uint32_t)depth << 16 | (uint32_t)flag << 22 | (uint32_t)move << 24;
+}
+
+static inline int ttScore(uint32_t data)
+{
+    return (int16_t)(data & 0xFFFF);
+}
+
+static inline int ttDepth(uint32_t data)
+{
+    return (data >> 16) & 0x3F;
+}
+
+static inline int ttFlag(uint32_t data)
+{
+    return (data >> 22) & 0x3;
+}
+
+static inline int ttMove(uint32_t data)
+{
+    return (data >> 24) & 0x3F;
+}
+
+static bool HOT(ttProbe)(uint64_t key, uint32_t *data)
+{
+    const TtEntry *entry = &table[key & (TT_SIZE - 1)];
+    uint32_t check = entry->check;
+    uint32_t value = entry->data;
+    if ((check ^ value) != (uint32_t)(key >> 32))
+        return false;
+    *data = value;
+    return true;
+}
+
+static void HOT(ttStore)(uint64_t key, uint32_t data)
+{
+    TtEntry *entry = &table[key & (TT_SIZE - 1)];
+    entry->check = (uint32_t)(key >> 32) ^ data;
+    entry->data = data;
+}
+
+// Win scores are stored relative to the node rather than the root, so an entry
+// stays correct when the position is reached at another ply.
+static inline int scoreToTt(int score, int ply)
+{
+    return score > SEARCH_WIN - BOARD_MAX_CELLS ? score + ply
+           : score < -SEARCH_WIN + BOARD_MAX_CELLS ? score - ply
+                                                  : score;
+}
+
+static inline int scoreFromTt(int score, int ply)
+{
+    return score > SEARCH_WIN - BOARD_MAX_CELLS ? score - ply
+           : score < -SEARCH_WIN + BOARD_MAX_CELLS ? score + ply
+                                                  : score;
+}
+
+static inline uint64_t positionKey(const Board *board, Player toMove)
+{
+    return board->hash ^ board->geometry->zobristSide[toMove - 1];
+}
+
+// The pattern evaluation is only kept up to date when a search can stop short
+// of the end of the game.
+static inline void searchPlay(Worker *worker, int pos, Player player)
+{
+    boardPlay(&worker->board, pos, player);
+    if (root.evaluate)
+        evalPlay(&worker->eval, &evalTables, pos, player);
+}
+
+static inline void searchUndo(Worker *worker, int pos)
+{
+    if (root.evaluate)
+        evalUndo(&worker->eval, &evalTables, pos, worker->board.cell[pos]);
+    boardUndo(&worker->board, pos);
+}
+
+static int HOT(negamax)(Worker *worker, int depth, int ply, int alpha, int beta, Player toMove)
+{
+    Board *board = &worker->board;
+    const BoardGeometry *geometry = board->geometry;
+
+    worker->nodes++;
+    if (board->winner != empty)
+        return -(SEARCH_WIN - ply); // the previous move won
+    if (board->filled == geometry->cells)
+        return 0;
+    if (depth == 0)
+        return evalScore(&worker->eval, &evalTables, toMove);
+
+    uint64_t key = positionKey(board, toMove);
+    int alphaOrig = alpha;
+    int hashMove = NO_MOVE;
+    uint32_t data;
+    if (ttProbe(key, &data))
+    {
+        hashMove = ttMove(data);
+        if (ttDepth(data) >= depth)
+        {
+            int score = scoreFromTt(ttScore(data), ply);
+            int flag = ttFlag(data);
+            if (flag == TtExact)
+                return score;
+            if (flag == TtLower && score > alpha)
+                alpha = score;
+            else if (flag == TtUpper && score < beta)
+                beta = score;
+            if (alpha >= beta)
+                return score;
+        }
+    }
+
+    int best = -SEARCH_INF;
+    int bestMove = NO_MOVE;
+    Player other = opponent(toMove);
+    // The hash move first, then the static order.
+    for (int i = -1; i < geometry->cells; i++)
+    {
+        int pos = i < 0 ? hashMove : geometry->order[i];
+        if (pos >= geometry->cells || (i >= 0 && pos == hashMove) || board->cell[pos] != empty)
+            continue;
+
+        searchPlay(worker, pos, toMove);
+        int score = -negamax(worker, depth - 1, ply + 1, -beta, -alpha, other);
+        searchUndo(worker, pos);
+
+        if (score > best)
+        {
+            best = score;
+            bestMove = pos;
+        }
+        if (score > alpha)
+            alpha = score;
+        if (alpha >= beta)
+            break;
+    }
+
+    int flag = best <= alphaOrig ? TtUpper : best >= beta ? TtLower : TtExact;
+    ttStore(key, ttPack(scoreToTt(best, ply), depth, flag, bestMove));
+    return best;
+}
+
+// Index of the next unsearched root move, or -1 when none are left.
+static int rootClaim(void)
+{
+    uint32_t save = spin_lock_blocking(rootLock);
+    int i = root.next < root.moveCount ? root.next++ : -1;
+    spin_unlock(rootLock, save);
+    return i;
+}
+
+static void rootReport(int pos, int score)
+{
+    uint32_t save = spin_lock_blocking(rootLock);
+    if (score > root.alpha)
+    {
+        root.alpha = score;
+        root.bestMove = pos;
+    }
+    spin_unlock(rootLock, save);
+}
+
+// Searches one root move against the current shared bound. A score at or
+// below the bound is only an upper limit, which rootReport() ignores.
+static void rootSearchMove(Worker *worker, int pos)
+{
+    int alpha = root.alpha;
+    searchPlay(worker, pos, root.toMove);
+    int score = -negamax(worker, root.depth - 1, 1, -SEARCH_INF, -alpha, opponent(root.toMove));
+    searchUndo(worker, pos);
+    rootReport(pos, score);
+}
+
+static void rootWork(int core)
+{
+    Worker *worker = &coreWorkers[core];
+    int i;
+
+    worker->board = root.board;
+    worker->eval = root.eval;
+    worker->nodes = 0;
+    while ((i = rootClaim()) >= 0)
+    {
+        rootSearchMove(worker, root.moves[i]);
+    }
+    root.nodes[core] += worker->nodes;
+}
+
+// Called on core 1 in response to the wake callback. Returns straight away if
+// core 0 has already finished without it.
+void searchHelperRun(void)
+{
+    uint32_t save = spin_lock_blocking(rootLock);
+    bool join = root.helper == HelperRequested;
+    if (join)
+        root.helper = HelperRunning;
+    spin_unlock(rootLock, save);
+    if (!join)
+        return;
+
+    PROFILE_ZONE(AiHelper);
+    rootWork(1);
+    __dmb();
+    root.helper = HelperIdle;
+    __sev();
+}
+
+// Returns the best move for toMove, or -1 if the game is already over. Must
+// run on core 0, after searchInit(). workers is 1 (core 0 only) or 2; with no
+// wake callback it is always 1.
+int searchBestMove(const Board *board, Player toMove, int depth, int workers,
+                   SearchResult *result)
+{
+    PROFILE_ZONE(AiSearch);
+    const BoardGeometry *geometry = board->geometry;
+    uint32_t start = time_us_32();
+
+    memset(result, 0, sizeof(*result));
+    result->move = -1;
+    if (board->winner != empty || board->filled == geometry->cells)
+        return -1;
+    int left = geometry->cells - board->filled;
+    if (depth > left)
+        depth = left;
+    if (depth < 1)
+        depth = 1;
+
+    root.board = *board;
+    root.toMove = toMove;
+    root.depth = depth;
+    root.evaluate = depth < left;
+    if (root.evaluate)
+    {
+        // A win by fours is often deeper than the search can see.
+        ThreatResult threat;
+        if (threatSearch(board, toMove, (left + 1) / 2, &threat) >= 0)
+        {
+            result->move = threat.move;
+            result->score = SEARCH_WIN - (2 * threat.moves - 1);
+            result->nodes[0] = threat.nodes;
+            result->timeUs = time_us_32() - start;
+            return result->move;
+        }
+        if (!evalTablesMatch(&evalTables, geometry))
+            evalTablesInit(&evalTables, geometry);
+        evalInit(&root.eval, &evalTables, board);
+    }
+    root.moveCount = 0;
+    root.next = 0;
+    root.alpha = -SEARCH_INF;
+    root.bestMove = -1;
+    root.nodes[0] = root.nodes[1] = 0;
+
+    // Root move ordering: the previous best for this position, then static.
+    uint64_t key = positionKey(board, toMove);
+    uint32_t data;
+    int hashMove = ttProbe(key, &data) ? ttMove(data) : NO_MOVE;
+    if (hashMove < geometry->cells && board->cell[hashMove] == empty)
+        root.moves[root.moveCount++] = hashMove;
+    for (int i = 0; i < geometry->cells; i++)
+    {
+        int pos = geometry->order[i];
+        if (pos != hashMove && board->cell[pos] == empty)
+            root.moves[root.moveCount++] = pos;
+    }
+
+    // The eldest brother is searched alone: sharing a bound only pays once
+    // there is one.
+    coreWorkers[0].board = root.board;
+    coreWorkers[0].eval = root.eval;
+    coreWorkers[0].nodes = 0;
+    root.next = 1;
+    rootSearchMove(&coreWorkers[0], root.moves[0]);
+    root.nodes[0] = coreWorkers[0].nodes;
+
+    bool parallel = workers > 1 && wakeHelper != NULL && root.moveCount > 1;
+    if (parallel)
+    {
+        __dmb();
+        root.helper = HelperRequested;
+        wakeHelper();
+    }
+    rootWork(0);
+    if (parallel)
+    {
+        // Withdraw the request if core 1 never got to it, else wait it out.
+        uint32_t save = spin_lock_blocking(rootLock);
+        if (root.helper == HelperRequested)
+            root.helper = HelperIdle;
+        spin_unlock(rootLock, save);
+        while (root.helper != HelperIdle)
+            __wfe();
+        __dmb();
+    }
+
+    ttStore(key, ttPack(scoreToTt(root.alpha, 0), depth, TtExact, root.bestMove));
+    result->move = root.bestMove;
+    result->score = root.alpha;
+    result->nodes[0] = root.nodes[0];
+    result->nodes[1] = root.nodes[1];
+    result->timeUs = time_us_32() - start;
+    return result->move;
+}
+
+#if SEARCH_BENCH
+// Times the same searches on one core and on two, from a few openings on 4x4
+// and 5x5 boards, and prints the speedup. The table is cleared before every
+// search so neither run benefits from the other's entries.
+void searchBenchmark(void)
+{
+    static const struct
+    {
+        uint8_t size;
+        uint8_t winLength;
+        uint8_t depth;
+    } cases[] = {{4, 4, 8}, {5, 4, 7}};
+    static BoardGeometry geometry;
+
+    for (int c = 0; c < (int)(sizeof(cases) / sizeof(cases[0])); c++)
+    {
+        int size = cases[c].size;
+        int centre = (size / 2) * size + size / 2;
+        // Openings: empty, centre taken, centre and a corner taken.
+        const int openings[][2] = {{-1, -1}, {centre, -1}, {centre, 0}};
+        uint32_t timeUs[2] = {0, 0};
+        uint32_t nodes[2] = {0, 0};
+
+        boardGeometryInit(&geometry, size, cases[c].winLength);
+        for (int workers = 1; workers <= 2; workers++)
+        {
+            for (int o = 0; o < 3; o++)
+            {
+                Board board;
+                Player toMove = human;
+                boardInit(&board, &geometry);
+                for (int m = 0; m < 2 && openings[o][m] >= 0; m++)
+                {
+                    boardPlay(&board, openings[o][m], toMove);
+                    toMove = opponent(toMove);
+                }
+
+                SearchResult result;
+                searchClear();
+                searchBestMove(&board, toMove, cases[c].depth, workers, &result);
+                timeUs[workers - 1] += result.timeUs;
+                nodes[workers - 1] += result.nodes[0] + result.nodes[1];
+            }
+        }
+        printf("search %dx%d, %d in a row, depth %d: 1 core %lu ms (%lu nodes), "
+               "2 cores %lu ms (%lu nodes), speedup %.2fx\n",
+               size, size, cases[c].winLength, cases[c].depth, (unsigned long)(timeUs[0] / 1000),
+               (unsigned long)nodes[0], (unsigned long)(timeUs[1] / 1000), (unsigned long)nodes[1],
+               (double)timeUs[0] / (timeUs[1] ? timeUs[1] : 1));
+    }
+}
+#endif
@@ -0,0 +1,48 @@
+#ifndef _SEARCH_H_
+#define _SEARCH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "logic.h"
+
+// Negamax alpha-beta search over a Board, with a transposition table shared by
+// both cores.
+//
+// With two workers the root moves are split between the cores: core 0 searches
+// the first (best ordered) move alone to establish a bound, then both cores
+// take the remaining root moves one at a time, each searching against the best
+// score found so far by either. Core 1 joins through searchHelperRun(), which
+// must be called from a task on core 1 whenever the wake callback passed to
+// searchInit() is invoked.
+//
+// When the depth doesn't reach the end of the game, a threat-space search
+// (threat.h) looks for a forced win first, and the leaves are scored from line
+// patterns (eval.h) kept up to date move by move.
+
+// Transposition table size, as a power of two (8 bytes per entry).
+#ifndef SEARCH_TT_BITS
+#define SEARCH_TT_BITS 12
+#endif
+
+#define SEARCH_WIN 30000
+#define SEARCH_INF 32000
+
+typedef struct
+{
+  int move;  // -1 if there was nothing to play
+  int score; // from the point of view of the side to move
+  uint32_t nodes[2]; // per core
+  uint32_t timeUs;
+} SearchResult;
+
+void searchInit(void (*wakeHelper)(void));
+void searchClear(void);
+int searchBestMove(const Board *board, Player toMove, int depth, int workers,
+                   SearchResult *result);
+void searchHelperRun(void);
+#if SEARCH_BENCH
+void searchBenchmark(void);
+#endif
+
+#endif // _SEARCH_H_
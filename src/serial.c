@@ -0,0 +1,31 @@
+#include "serial.h"
+
+#include "pico/stdlib.h"
+#include "frame.h"
+
+// Sends a binary frame over stdio in one write. Core 1's IMU trace frames
+// share the port with core 0's printf, log drain and trace dump, and
+// stdio_put_string() holds the stdio mutex for the whole frame so neither can
+// land in the middle of the other's. CR/LF translation is off, as it would
+// otherwise corrupt payload bytes equal to '\n'.
+void serialWriteFrame(uint8_t type, const void *payload, uint8_t length)
+{
+    uint8_t buf[FRAME_MAX_PAYLOAD + FRAME_OVERHEAD];
+    uint16_t size = frameEncode(type, payload, length, buf);
+    stdio_put_string((const char *)buf, size, false, false);
+}
+
+// Single-character commands typed into the serial console. Returns the next
+// one, or -1 straight away if nothing has arrived; whitespace is skipped so a
+// terminal's line endings don't count as commands.
+int serialReadCommand(void)
+{
+    int c;
+    do
+    {
+        c = getchar_timeout_us(0);
+        if (c == PICO_ERROR_TIMEOUT)
+            return -1;
+    } while (c == '\r' || c == '\n' || c == ' ');
+    return c;
+}
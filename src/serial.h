@@ -0,0 +1,9 @@
+#ifndef _SERIAL_H_
+#define _SERIAL_H_
+
+#include <stdint.h>
+
+void serialWriteFrame(uint8_t type, const void *payload, uint8_t length);
+int serialReadCommand(void);
+
+#endif // _SERIAL_H_
@@ -0,0 +1,187 @@
+#include "tablebase.h"
+
+// Binomial coefficients for the O set's rank, built on first use.
+static uint32_t tablebaseBinomial[BOARD_MAX_CELLS + 1][BOARD_MAX_CELLS / 2 + 2];
+static bool tablebaseBinomialReady;
+
+static void tablebaseBinomialInit(void)
+{
+    for (int n = 0; n <= BOARD_MAX_CELLS; n++)
+    {
+        tablebaseBinomial[n][0] = 1;
+        for (int k = 1; k <= BOARD_MAX_CELLS / 2 + 1; k++)
+        {
+            tablebaseBinomial[n][k] =
+                n == 0 ? 0 : tablebaseBinomial[n - 1][k - 1] + tablebaseBinomial[n - 1][k];
+        }
+    }
+    tablebaseBinomialReady = true;
+}
+
+static uint32_t tablebaseTransform(const uint8_t *symmetry, uint32_t mask)
+{
+    uint32_t result = 0;
+    for (; mask; mask &= mask - 1)
+    {
+        result |= 1u << symmetry[__builtin_ctz(mask)];
+    }
+    return result;
+}
+
+// Decodes the block holding index as far as index.
+static TablebaseValue tablebaseValueAt(const Tablebase *table, const TablebaseLayer *layer,
+                                       uint32_t index)
+{
+    const uint8_t *token = layer->data + layer->blockIndex[index / table->blockPositions];
+    uint32_t offset = index % table->blockPositions;
+
+    for (;;)
+    {
+        uint32_t length = (((token[0] & 0x1F) << 8) | token[1]) + 1;
+        TablebaseValue common = (TablebaseValue)((token[0] >> 5) & 3);
+        if (token[0] & 0x80)
+        {
+            if (offset < length)
+            {
+                return common;
+            }
+            token += 2;
+        }
+        else
+        {
+            if (offset < length)
+            {
+                const uint8_t *code = token + 3;
+                uint32_t bit = 0;
+                for (;;)
+                {
+                    bool other = code[bit / 8] >> (bit % 8) & 1;
+                    bit++;
+                    if (offset-- == 0)
+                    {
+                        if (!other)
+                            return common;
+                        // The other two values in order.
+                        int second = code[bit / 8] >> (bit % 8) & 1;
+                        int value = TablebaseLoss + second;
+                        return (TablebaseValue)(value >= (int)common ? value + 1 : value);
+                    }
+                    bit += other;
+                }
+            }
+            token += 4 + token[2];
+        }
+        offset -= length;
+    }
+}
+
+// The value of a position with X to move, or TablebaseUnknown if the table
+// doesn't hold it.
+TablebaseValue tablebaseProbe(const Tablebase *table, const Board *board)
+{
+    const BoardGeometry *geometry = board->geometry;
+    const TablebaseLayer *layer = table->layers[board->filled];
+
+    if (table->size != geometry->size || table->winLength != geometry->winLength ||
+        layer == NULL || board->filled % 2 != 0)
+    {
+        return TablebaseUnknown;
+    }
+    if (!tablebaseBinomialReady)
+    {
+        tablebaseBinomialInit();
+    }
+
+    uint32_t x = 0, o = 0;
+    for (int pos = 0; pos < geometry->cells; pos++)
+    {
+        if (board->cell[pos] == human)
+            x |= 1u << pos;
+        else if (board->cell[pos] == ai)
+            o |= 1u << pos;
+    }
+
+    // The symmetry with the least X set, and of those the least O set.
+    uint32_t bestX = x, bestO = o;
+    for (int s = 1; s < BOARD_SYMMETRIES; s++)
+    {
+        uint32_t sx = tablebaseTransform(geometry->symmetry[s], x);
+        if (sx > bestX)
+            continue;
+        uint32_t so = tablebaseTransform(geometry->symmetry[s], o);
+        if (sx < bestX || so < bestO)
+        {
+            bestX = sx;
+            bestO = so;
+        }
+    }
+
+    uint32_t low = 0, high = layer->xSetCount;
+    while (low + 1 < high)
+    {
+        uint32_t middle = (low + high) / 2;
+        if (layer->xSets[middle] <= bestX)
+            low = middle;
+        else
+            high = middle;
+    }
+    if (high == 0 || layer->xSets[low] != bestX)
+    {
+        return TablebaseUnknown;
+    }
+
+    // Colex rank of O among the cells X leaves free.
+    uint32_t free = ~bestX & ((1u << geometry->cells) - 1);
+    uint32_t oRank = 0;
+    int i = 0;
+    for (uint32_t rest = bestO; rest; rest &= rest - 1)
+    {
+        int cell = __builtin_ctz(rest);
+        oRank += tablebaseBinomial[__builtin_popcount(free & ((1u << cell) - 1))][++i];
+    }
+    return tablebaseValueAt(table, layer, low * layer->oSets + oRank);
+}
+
+// The best move for O (the AI) to move, from the values of the positions it
+// leads to: a win now, else a move to a position X loses, else one X can only
+// draw, trying cells in the geometry's move order. -1 if any of them isn't in
+// the table. value is set to the outcome for O.
+int tablebaseBestMove(const Tablebase *table, const Board *board, TablebaseValue *value)
+{
+    const BoardGeometry *geometry = board->geometry;
+    Board child = *board;
+    int best = -1;
+    TablebaseValue bestValue = TablebaseUnknown;
+
+    if (board->winner != empty || board->filled % 2 != 1)
+    {
+        return -1;
+    }
+    for (int i = 0; i < geometry->cells; i++)
+    {
+        int pos = geometry->order[i];
+        if (child.cell[pos] != empty)
+            continue;
+        boardPlay(&child, pos, ai);
+        if (child.winner == ai)
+        {
+            *value = TablebaseWin;
+            return pos;
+        }
+        TablebaseValue reply = tablebaseProbe(table, &child);
+        boardUndo(&child, pos);
+        if (reply == TablebaseUnknown)
+        {
+            return -1;
+        }
+        // X's loss is O's win.
+        TablebaseValue outcome = (TablebaseValue)(TablebaseWin + TablebaseLoss - reply);
+        if (outcome > bestValue)
+        {
+            best = pos;
+            bestValue = outcome;
+        }
+    }
+    *value = bestValue;
+    return best;
+}
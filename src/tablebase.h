@@ -0,0 +1,73 @@
+#ifndef _TABLEBASE_H_
+#define _TABLEBASE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "logic.h"
+
+// Endgame tablebase kept in flash: the value of every position with X (the
+// human) to move and at most maxEmpty empty cells, taken from a database
+// solved on the host (host/retro_solve) and converted to a C source file by
+// host/tablebase_gen. With it aiPlay() plays solved endgames perfectly
+// instead of searching them.
+//
+// Positions are ranked within a layer of piece count as in host/retro.h:
+//
+//   index = place of the X set in xSets * oSets + colex rank of the O set
+//
+// where xSets holds only the X sets that are least among the board's 8
+// symmetries, so a position is looked up by its canonical form. The layer's
+// 2-bit values are cut into blocks of blockPositions, each compressed on its
+// own, with one offset per block in blockIndex. A probe decodes a single block
+// up to the position it wants. A block is a sequence of tokens:
+//
+//   1VVLLLLL LLLLLLLL          run: value V, L + 1 times
+//   0VVLLLLL LLLLLLLL BBBBBBBB literal: L + 1 values in the B + 1 bytes that
+//                              follow, as a prefix code from the low bit up:
+//                              0 for V, 10 and 11 for the other two in order
+//
+// Positions no probe can ask for (illegal, or not canonical) are stored as
+// whatever makes the code shortest.
+
+typedef enum
+{
+  TablebaseUnknown, // not in the table
+  TablebaseLoss,
+  TablebaseDraw,
+  TablebaseWin
+} TablebaseValue; // for the side to move; the same encoding as host/retro.h
+
+#define TABLEBASE_RUN_MAX 8192
+// Values per literal, so its code fits in 256 bytes.
+#define TABLEBASE_LITERAL_MAX 1024
+
+typedef struct
+{
+  uint32_t positions;
+  uint32_t oSets;             // O sets per X set: C(cells - x, o)
+  uint32_t xSetCount;
+  const uint32_t *xSets;      // canonical X sets as cell masks, sorted
+  const uint32_t *blockIndex; // offset of each block in data, then the end
+  const uint8_t *data;
+} TablebaseLayer;
+
+typedef struct
+{
+  uint8_t size;
+  uint8_t winLength;
+  uint8_t maxEmpty;
+  uint16_t blockPositions;
+  uint32_t flashBytes; // all of the table's data, for reports
+  const TablebaseLayer *layers[BOARD_MAX_CELLS + 1]; // by piece count, NULL if not stored
+} Tablebase;
+
+#if TABLEBASE_ENABLED
+// Defined by the generated source the build links in (TTT_TABLEBASE).
+extern const Tablebase tablebase;
+#endif
+
+TablebaseValue tablebaseProbe(const Tablebase *table, const Board *board);
+int tablebaseBestMove(const Tablebase *table, const Board *board, TablebaseValue *value);
+
+#endif // _TABLEBASE_H_
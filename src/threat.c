@@ -0,0 +1,109 @@
+#include "threat.h"
+
+#include <string.h>
+
+// The empty cells that would complete a line for side.
+static uint64_t threatWinCells(const Board *board, int side)
+{
+    const BoardGeometry *geometry = board->geometry;
+    uint64_t cells = 0;
+
+    for (int line = 0; line < geometry->lineCount; line++)
+    {
+        if (board->count[line][side] != geometry->winLength - 1 || board->count[line][side ^ 1])
+            continue;
+        for (int i = 0; i < geometry->winLength; i++)
+        {
+            int pos = geometry->lines[line][i];
+            if (board->cell[pos] == empty)
+                cells |= 1ull << pos;
+        }
+    }
+    return cells;
+}
+
+// True if side playing pos leaves a line one short of a win.
+static bool threatMakesFour(const Board *board, int pos, int side)
+{
+    const BoardGeometry *geometry = board->geometry;
+
+    for (int i = 0; i < geometry->cellLineCount[pos]; i++)
+    {
+        int line = geometry->cellLines[pos][i];
+        if (board->count[line][side] == geometry->winLength - 2 && !board->count[line][side ^ 1])
+            return true;
+    }
+    return false;
+}
+
+// The attacker's moves to a win by fours with at most moves left, or 0 if
+// there isn't one; the first move goes in move.
+static int threatFours(Board *board, Player attacker, int moves, uint32_t *nodes, int *move)
+{
+    const BoardGeometry *geometry = board->geometry;
+    int side = attacker - 1;
+
+    if (++*nodes > THREAT_MAX_NODES)
+        return 0;
+    uint64_t wins = threatWinCells(board, side);
+    if (wins)
+    {
+        *move = __builtin_ctzll(wins);
+        return 1;
+    }
+    uint64_t blocks = threatWinCells(board, side ^ 1);
+    if (moves < 2 || (blocks & (blocks - 1)))
+        return 0;
+
+    for (int i = 0; i < geometry->cells; i++)
+    {
+        int pos = geometry->order[i];
+        if (board->cell[pos] != empty || (blocks && !(blocks & (1ull << pos))) ||
+            !threatMakesFour(board, pos, side))
+            continue;
+
+        boardPlay(board, pos, attacker);
+        uint64_t threats = threatWinCells(board, side);
+        int found;
+        if (threats & (threats - 1))
+        {
+            // The defender had nothing to win with but pos, so it can't stop
+            // both.
+            found = 2;
+        }
+        else
+        {
+            int reply = __builtin_ctzll(threats);
+            int next;
+            boardPlay(board, reply, opponent(attacker));
+            found = threatFours(board, attacker, moves - 1, nodes, &next);
+            if (found)
+                found++;
+            boardUndo(board, reply);
+        }
+        boardUndo(board, pos);
+        if (found)
+        {
+            *move = pos;
+            return found;
+        }
+    }
+    return 0;
+}
+
+// Returns the first move of a forced win for attacker, to move, of at most
+// maxMoves of its moves, or -1.
+int threatSearch(const Board *board, Player attacker, int maxMoves, ThreatResult *result)
+{
+    Board scratch = *board;
+
+    memset(result, 0, sizeof(*result));
+    result->move = -1;
+    if (board->winner != empty)
+        return -1;
+    int move;
+    result->moves = threatFours(&scratch, attacker, maxMoves, &result->nodes, &move);
+    if (result->moves > 0)
+        result->move = move;
+    return result->move;
+}
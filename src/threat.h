@@ -0,0 +1,35 @@
+#ifndef _THREAT_H_
+#define _THREAT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "logic.h"
+
+// Threat-space search: looks for a forced win made only of fours, moves that
+// threaten to complete a line next turn. The defender's reply to each is
+// forced, so every level of the tree is one attacker move wide at most a few
+// moves, and a win many moves deep costs a few hundred nodes where alpha-beta
+// would need the full width of the board at every ply.
+//
+// The attacker wins at once if it can, must block a single four of the
+// defender's (and block with a four of its own), and gives up facing two. A
+// four that leaves two cells to win at, whether in one line or two, is a win.
+// Not finding a win proves nothing: wins that need threes as well as fours are
+// left to the alpha-beta search.
+
+// Gives up after this many positions.
+#ifndef THREAT_MAX_NODES
+#define THREAT_MAX_NODES 20000
+#endif
+
+typedef struct
+{
+  int move;       // the first move of the win, -1 if none was found
+  int moves;      // the attacker's moves up to and including the winning one
+  uint32_t nodes;
+} ThreatResult;
+
+int threatSearch(const Board *board, Player attacker, int maxMoves, ThreatResult *result);
+
+#endif // _THREAT_H_
@@ -0,0 +1,108 @@
+#include "trace.h"
+
+#if TRACE_ENABLED
+
+#include <string.h>
+
+#include "frame.h"
+#include "profile.h"
+#include "serial.h"
+
+TraceRing traceRings[2];
+volatile bool tracePaused = false;
+
+static const char *const instantNames[] = {
+#define TRACE_INSTANT_NAME(name) #name,
+    TRACE_INSTANTS(TRACE_INSTANT_NAME)
+#undef TRACE_INSTANT_NAME
+};
+
+#define TRACE_EVENT_LEN 8
+#define TRACE_EVENTS_PER_FRAME ((FRAME_MAX_PAYLOAD - 1) / TRACE_EVENT_LEN)
+
+// FrameTraceNames payload: repeated <id> <length> <name bytes>, split over as
+// many frames as needed.
+static void traceAppendName(uint8_t *payload, uint8_t *length, uint8_t id, const char *name)
+{
+    uint8_t nameLength = strlen(name);
+    if (*length + 2 + nameLength > FRAME_MAX_PAYLOAD)
+    {
+        serialWriteFrame(FrameTraceNames, payload, *length);
+        *length = 0;
+    }
+    payload[(*length)++] = id;
+    payload[(*length)++] = nameLength;
+    memcpy(&payload[*length], name, nameLength);
+    *length += nameLength;
+}
+
+static void traceSendNames(void)
+{
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    uint8_t length = 0;
+
+    for (int zone = 0; zone < ZoneCount; zone++)
+    {
+        traceAppendName(payload, &length, zone, profileZoneName(zone));
+    }
+    for (int i = 0; i < TraceInstantEnd - TRACE_INSTANT_BASE; i++)
+    {
+        traceAppendName(payload, &length, TRACE_INSTANT_BASE + i, instantNames[i]);
+    }
+    if (length > 0)
+    {
+        serialWriteFrame(FrameTraceNames, payload, length);
+    }
+}
+
+// FrameTraceEvents payload: <core> then up to TRACE_EVENTS_PER_FRAME events of
+// <timeUs:4> <phase:1> <id:1> <arg:2>, little endian, oldest first.
+static void traceSendRing(uint8_t core)
+{
+    TraceRing *ring = &traceRings[core];
+    uint32_t count = ring->head < TRACE_RING_LEN ? ring->head : TRACE_RING_LEN;
+    uint8_t payload[1 + TRACE_EVENTS_PER_FRAME * TRACE_EVENT_LEN];
+    uint8_t events = 0;
+
+    payload[0] = core;
+    for (uint32_t n = ring->head - count; n != ring->head; n++)
+    {
+        const TraceEvent *event = &ring->events[n & (TRACE_RING_LEN - 1)];
+        uint8_t *out = &payload[1 + events * TRACE_EVENT_LEN];
+        out[0] = event->timeUs;
+        out[1] = event->timeUs >> 8;
+        out[2] = event->timeUs >> 16;
+        out[3] = event->timeUs >> 24;
+        out[4] = event->phase;
+        out[5] = event->id;
+        out[6] = event->arg;
+        out[7] = event->arg >> 8;
+        if (++events == TRACE_EVENTS_PER_FRAME)
+        {
+            serialWriteFrame(FrameTraceEvents, payload, 1 + events * TRACE_EVENT_LEN);
+            events = 0;
+        }
+    }
+    if (events > 0)
+    {
+        serialWriteFrame(FrameTraceEvents, payload, 1 + events * TRACE_EVENT_LEN);
+    }
+    ring->head = 0;
+}
+
+// Sends both rings, then empties them. Recording is paused meanwhile so the
+// rings hold still; events from that window are lost.
+void traceDump(void)
+{
+    tracePaused = true;
+    // Let a record the other core had already started finish.
+    busy_wait_us(10);
+    traceSendNames();
+    traceSendRing(0);
+    traceSendRing(1);
+    uint8_t none = 0;
+    serialWriteFrame(FrameTraceEnd, &none, 0);
+    tracePaused = false;
+}
+
+#endif // TRACE_ENABLED
@@ -0,0 +1,95 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdint.h>
+
+// Per-core flight recorder of timestamped events, dumped over USB serial with
+// the 't' command and turned into Chrome/Perfetto JSON on the host by
+// tools/trace_to_chrome.py.
+//
+// Every PROFILE_ZONE records a begin and an end event; TRACE_INSTANT(Name, arg)
+// marks a point in time. Each core writes its own ring with interrupts briefly
+// masked, and the oldest events are overwritten once a ring is full.
+//
+// Configure with -DTTT_TRACE=ON (which also enables the profiler). Otherwise
+// the macros expand to nothing.
+
+// Instant events. Their ids follow the profiler's zones in one id space.
+#define TRACE_INSTANTS(X) \
+  X(ButtonEdge)           \
+  X(ButtonPress)          \
+  X(EventPush)
+
+#ifndef TRACE_RING_LEN
+#define TRACE_RING_LEN 2048 // events per core, a power of two
+#endif
+#define TRACE_INSTANT_BASE 64
+
+#if TRACE_ENABLED
+
+#include "pico/stdlib.h"
+#include "hardware/structs/timer.h"
+#include "hardware/sync.h"
+
+typedef enum
+{
+  TraceBegin,
+  TraceEnd,
+  TraceInstant
+} TracePhase;
+
+typedef enum
+{
+#define TRACE_INSTANT_ENUM(name) Trace##name,
+  TraceInstantFirst = TRACE_INSTANT_BASE - 1,
+  TRACE_INSTANTS(TRACE_INSTANT_ENUM)
+#undef TRACE_INSTANT_ENUM
+  TraceInstantEnd
+} TraceInstantId;
+
+// 8 bytes, sent over the wire as is (little endian).
+typedef struct
+{
+  uint32_t timeUs;
+  uint8_t phase;
+  uint8_t id;
+  uint16_t arg;
+} TraceEvent;
+
+typedef struct
+{
+  TraceEvent events[TRACE_RING_LEN];
+  uint32_t head; // total events written; the ring holds the last TRACE_RING_LEN
+} TraceRing;
+
+extern TraceRing traceRings[2];
+extern volatile bool tracePaused;
+
+static inline void traceRecord(uint8_t phase, uint8_t id, uint16_t arg)
+{
+  if (tracePaused)
+    return;
+  uint32_t save = save_and_disable_interrupts();
+  TraceRing *ring = &traceRings[get_core_num()];
+  TraceEvent *event = &ring->events[ring->head++ & (TRACE_RING_LEN - 1)];
+  event->timeUs = timer_hw->timerawl;
+  event->phase = phase;
+  event->id = id;
+  event->arg = arg;
+  restore_interrupts(save);
+}
+
+void traceDump(void);
+
+#define TRACE_INSTANT(name, arg) traceRecord(TraceInstant, Trace##name, (arg))
+
+#else
+
+#define TRACE_INSTANT(name, arg) \
+  do                             \
+  {                              \
+  } while (0)
+
+#endif // TRACE_ENABLED
+
+#endif // _TRACE_H_
@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""Print a microbenchmark report as a table, or compare two reports.
+
+The reports come from build-host/micro_bench or from the device's 'b' serial
+command (src/bench.c). A serial capture can be passed as it is: everything
+before the report's opening brace is skipped.
+
+    tools/bench_compare.py run.json
+    tools/bench_compare.py before.json after.json
+
+When comparing, each case's median is given with the change from the first
+report to the second. A change smaller than the two runs' spread (the larger
+of their standard deviations) is marked "~" as likely noise.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path, errors="replace") as f:
+        text = f.read()
+    start = text.find('{"platform"')
+    if start < 0:
+        raise ValueError("%s: no benchmark report found" % path)
+    report, _ = json.JSONDecoder().raw_decode(text, start)
+    return report
+
+
+def describe(report):
+    text = "%s, %dx%d grid, hot code in %s" % (
+        report["platform"], report["grid_size"], report["grid_size"],
+        "SRAM" if report["hot_in_ram"] else "flash")
+    if "tablebase_bytes" in report:
+        text += ", %d byte tablebase" % report["tablebase_bytes"]
+    if "book" in report:
+        book = report["book"]
+        text += ", %d byte book (%.0f%% of AI moves, %.0f us saved per game)" % (
+            book["bytes"], book["hit_rate"] * 100, book["saved_us_per_game"])
+    return text
+
+
+def show(report, out):
+    print(describe(report), file=out)
+    print("  %-22s %12s %12s %12s %10s" % ("case", "min ns", "median ns", "max ns", "stddev"),
+          file=out)
+    for result in report["results"]:
+        ns = result["ns"]
+        print("  %-22s %12.1f %12.1f %12.1f %10.1f" % (
+            result["name"], ns["min"], ns["median"], ns["max"], ns["stddev"]), file=out)
+
+
+def compare(before, after, out):
+    print("before: " + describe(before), file=out)
+    print("after:  " + describe(after), file=out)
+    print("  %-22s %12s %12s %9s" % ("case", "before ns", "after ns", "change"), file=out)
+    previous = {result["name"]: result["ns"] for result in before["results"]}
+    for result in after["results"]:
+        name = result["name"]
+        ns = result["ns"]
+        if name not in previous:
+            print("  %-22s %12s %12.1f %9s" % (name, "-", ns["median"], "new"), file=out)
+            continue
+        old = previous[name]
+        change = (ns["median"] - old["median"]) / old["median"] * 100 if old["median"] else 0
+        noise = abs(ns["median"] - old["median"]) <= max(ns["stddev"], old["stddev"])
+        print("  %-22s %12.1f %12.1f %+8.1f%%%s" % (
+            name, old["median"], ns["median"], change, " ~" if noise else ""), file=out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("report", help="JSON report or serial capture")
+    parser.add_argument("other", nargs="?", help="second report, to compare against the first")
+    args = parser.parse_args()
+
+    try:
+        first = load(args.report)
+        second = load(args.other) if args.other else None
+    except (OSError, ValueError) as error:
+        print(error, file=sys.stderr)
+        return 1
+    if second is None:
+        show(first, sys.stdout)
+    else:
+        compare(first, second, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""Decode deferred LOG() output from a firmware serial capture.
+
+LOG() sends the address of its format string rather than the text (see
+src/log.h), so decoding needs the ELF the firmware was built from:
+
+    cat /dev/ttyACM0 | tools/log_decode.py build/src/tic_tac_toe.elf -
+
+Plain printf text between the frames is passed through unchanged, so the
+decoded stream reads like the console used to. The frame layout is described
+in src/frame.h and the LOG payload in src/log.c.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+FRAME_SYNC = b"\xa5\x5a"
+FRAME_LOG = 6
+
+SHT_NOBITS = 8
+SHF_ALLOC = 0x2
+
+SPECIFIER = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z|t|j)?([diuxXocsp%])")
+
+
+class Elf:
+    """The loadable sections of a 32-bit little-endian ELF, by address."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+        if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+            raise ValueError("%s: not a 32-bit little-endian ELF" % path)
+        shoff, = struct.unpack_from("<I", data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", data, 0x2E)
+        self.sections = []
+        for n in range(shnum):
+            (_, sh_type, flags, addr, offset, size) = struct.unpack_from(
+                "<IIIIII", data, shoff + n * shentsize)
+            if flags & SHF_ALLOC and sh_type != SHT_NOBITS and size:
+                self.sections.append((addr, data[offset:offset + size]))
+
+    def string(self, address):
+        for start, contents in self.sections:
+            if start <= address < start + len(contents):
+                end = contents.find(b"\0", address - start)
+                return contents[address - start:end].decode("utf-8", "replace")
+        return None
+
+
+def format_message(elf, template, args):
+    args = list(args)
+
+    def substitute(match):
+        flags, conversion = match.groups()
+        if conversion == "%":
+            return "%"
+        if not args:
+            return match.group(0)
+        value = args.pop(0)
+        if conversion == "s":
+            return ("%" + flags + "s") % (elf.string(value & 0xFFFFFFFF) or "<0x%08x>" % value)
+        if conversion == "p":
+            return "0x%08x" % (value & 0xFFFFFFFF)
+        if conversion == "c":
+            return ("%" + flags + "c") % chr(value & 0xFF)
+        if conversion in "uxXo":
+            value &= 0xFFFFFFFF
+        return ("%" + flags + conversion) % value
+
+    return SPECIFIER.sub(substitute, template)
+
+
+def records(payload):
+    """Yields (core, format address, time, args) for each record in a payload."""
+    core, i = payload[0], 1
+    while i + 9 <= len(payload):
+        address, time_us, count = struct.unpack_from("<IIB", payload, i)
+        i += 9
+        args = struct.unpack_from("<%di" % count, payload, i)
+        i += 4 * count
+        yield core, address, time_us, args
+
+
+def decode(elf, data, out):
+    """Writes text and decoded frames from data to out. Returns the tail of
+    data that may hold an incomplete frame."""
+    i = 0
+    while True:
+        start = data.find(FRAME_SYNC, i)
+        if start < 0:
+            keep = len(data) - 1 if data.endswith(FRAME_SYNC[:1]) else len(data)
+            out.write(data[i:keep].decode("utf-8", "replace"))
+            return data[keep:]
+        out.write(data[i:start].decode("utf-8", "replace"))
+        if start + 4 > len(data):
+            return data[start:]
+        frame_type, length = data[start + 2], data[start + 3]
+        end = start + 4 + length
+        if end >= len(data):
+            return data[start:]
+        payload = data[start + 4:end]
+        if (frame_type + length + sum(payload)) & 0xFF != data[end]:
+            out.write(data[start:start + 1].decode("latin-1"))
+            i = start + 1
+            continue
+        if frame_type == FRAME_LOG and payload:
+            for core, address, time_us, args in records(payload):
+                if address == 0:
+                    message = "(%d messages dropped)" % args[0]
+                else:
+                    template = elf.string(address)
+                    message = (format_message(elf, template, args) if template is not None
+                               else "<unknown format 0x%08x> %r" % (address, args))
+                out.write("[%10.6f] core%d: %s\n" % (time_us / 1e6, core, message))
+        i = end + 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="firmware ELF the capture was produced by")
+    parser.add_argument("capture", help="raw serial capture, or - for stdin")
+    args = parser.parse_args()
+
+    elf = Elf(args.elf)
+    source = sys.stdin.buffer if args.capture == "-" else open(args.capture, "rb")
+    pending = b""
+    while True:
+        chunk = source.read1(4096) if hasattr(source, "read1") else source.read(4096)
+        if not chunk:
+            break
+        pending = decode(elf, pending + chunk, sys.stdout)
+        sys.stdout.flush()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
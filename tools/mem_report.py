@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""Summarise static RAM use per subsystem from the firmware's linker map.
+
+The build runs this on build/src/tic_tac_toe.elf.map and writes
+mem_report.txt next to it. It can also be run by hand:
+
+    tools/mem_report.py build/src/tic_tac_toe.elf.map
+
+Every input section placed in SRAM is attributed to a subsystem by the object
+file it came from. Stacks and the heap reservation are listed on their own;
+how much of each stack is actually used is reported on the device by the 'm'
+serial command (src/memstat.c).
+
+A second part lists what HOT (src/hot.h) and the SDK's __not_in_flash placed
+in SRAM, and the large constant tables left in flash.
+"""
+
+import argparse
+import collections
+import os
+import re
+import sys
+
+SRAM_START = 0x20000000
+SRAM_SIZE = 264 * 1024
+FLASH_START = 0x10000000
+FLASH_END = 0x11000000
+# Flash-resident read-only data at least this large is listed: it competes
+# with code for the 16 KB XIP cache.
+LARGE_RODATA = 1024
+
+# Object file base names of this project, by subsystem.
+SUBSYSTEMS = {
+    "game": ["main"],
+    "ai": ["logic", "search", "eval", "threat", "tablebase", "tablebase_data", "book", "book_data", "mcts"],
+    "display": ["painting", "st7735", "fonts", "DEV_Config"],
+    "sensor": ["ICM20948", "i2c_async", "i2c_async_rp2040", "gesture", "calibration",
+               "imu_trace"],
+    "runtime": ["scheduler", "event_queue"],
+    "diagnostics": ["profile", "trace", "log", "serial", "frame", "boot", "memstat", "hot",
+                    "bench"],
+}
+OBJECT_SUBSYSTEM = {name: subsystem for subsystem, names in SUBSYSTEMS.items()
+                    for name in names}
+
+SECTION = re.compile(r"^ (\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)(?:\s+(.*))?$")
+CONTINUATION = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)(?:\s+(.*))?$")
+LONE_NAME = re.compile(r"^ (\S+)$")
+
+
+def subsystem_of(section, path):
+    if section.startswith(".stack"):
+        return "stacks"
+    if section.startswith(".heap"):
+        return "heap"
+    if section == "*fill*" or not path:
+        return "padding"
+    if path.endswith(")"):
+        return "libc"  # archive member: newlib, libgcc
+    # Objects of this project's sources sit directly in the target's object
+    # directory (or its lib/); SDK sources compiled into the target are below
+    # their full path.
+    relative = path.split(".dir/", 1)[-1]
+    if relative.startswith("lib/"):
+        relative = relative[4:]
+    if "/" not in relative:
+        name = re.sub(r"\.(c|S)\.obj$|\.o$", "", relative)
+        return OBJECT_SUBSYSTEM.get(name, "other")
+    return "usb" if "tinyusb" in relative else "sdk"
+
+
+def ram_sections(lines):
+    """Yields (section, size, path) for every input section placed in SRAM."""
+    in_map = False
+    pending = None
+    for line in lines:
+        line = line.rstrip("\n")
+        if line.startswith("Linker script and memory map"):
+            in_map = True
+            continue
+        if not in_map:
+            continue
+        if pending is not None:
+            match = CONTINUATION.match(line)
+            name, pending = pending, None
+            if match:
+                address, size, path = match.groups()
+                yield name, int(address, 16), int(size, 16), (path or "").strip()
+                continue
+        match = SECTION.match(line)
+        if match:
+            name, address, size, path = match.groups()
+            yield name, int(address, 16), int(size, 16), (path or "").strip()
+            continue
+        match = LONE_NAME.match(line)
+        if match:
+            pending = match.group(1)
+
+
+def report(lines, out):
+    totals = collections.Counter()
+    largest = []
+    in_ram = []
+    flash_rodata = []
+    for section, address, size, path in ram_sections(lines):
+        if size == 0:
+            continue
+        if FLASH_START <= address < FLASH_END:
+            if section.startswith(".rodata") and size >= LARGE_RODATA:
+                flash_rodata.append((size, section, os.path.basename(path)))
+            continue
+        if not SRAM_START <= address < SRAM_START + SRAM_SIZE:
+            continue
+        if section.startswith(".time_critical."):
+            in_ram.append((section[len(".time_critical."):], size, subsystem_of(section, path),
+                           os.path.basename(path)))
+        subsystem = subsystem_of(section, path)
+        totals[subsystem] += size
+        largest.append((size, section, os.path.basename(path)))
+
+    used = sum(totals.values())
+    out.write("static RAM by subsystem (bytes of %d SRAM)\n" % SRAM_SIZE)
+    for subsystem, size in totals.most_common():
+        out.write("  %-12s %7d  %5.1f%%\n" % (subsystem, size, 100.0 * size / SRAM_SIZE))
+    out.write("  %-12s %7d  %5.1f%%\n" % ("total", used, 100.0 * used / SRAM_SIZE))
+    out.write("  %-12s %7d\n" % ("headroom", SRAM_SIZE - used))
+    out.write("\nlargest sections\n")
+    for size, section, path in sorted(largest, reverse=True)[:15]:
+        out.write("  %7d  %-40s %s\n" % (size, section, path))
+
+    out.write("\nrun from SRAM (HOT and __not_in_flash), %d bytes\n"
+              % sum(entry[1] for entry in in_ram))
+    for name, size, subsystem, path in sorted(in_ram, key=lambda e: (e[2], e[0])):
+        out.write("  %7d  %-32s %-12s %s\n" % (size, name, subsystem, path))
+    out.write("\nread-only data in flash, %d bytes or more\n" % LARGE_RODATA)
+    for size, section, path in sorted(flash_rodata, reverse=True):
+        out.write("  %7d  %-40s %s\n" % (size, section, path))
+    return used
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("map", help="linker map, e.g. build/src/tic_tac_toe.elf.map")
+    parser.add_argument("-o", "--output", help="write the report here instead of stdout")
+    args = parser.parse_args()
+
+    with open(args.map) as f:
+        lines = f.readlines()
+    out = open(args.output, "w") if args.output else sys.stdout
+    used = report(lines, out)
+    if args.output:
+        out.close()
+    if used == 0:
+        print("%s: no sections in SRAM found" % args.map, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
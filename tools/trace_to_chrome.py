@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""Convert a firmware event trace dump into Chrome trace JSON.
+
+Capture the USB serial stream of a TTT_TRACE build while typing 't' into it
+(e.g. `cat /dev/ttyACM0 > dump.bin`), then:
+
+    tools/trace_to_chrome.py dump.bin > trace.json
+
+and open trace.json in about:tracing or https://ui.perfetto.dev. Each core is a
+thread; profiler zones become slices and TRACE_INSTANT events instants. Printf
+text around the frames is ignored. The frame layout is described in
+src/frame.h and the payloads in src/trace.c.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+FRAME_SYNC = b"\xa5\x5a"
+FRAME_TRACE_NAMES = 3
+FRAME_TRACE_EVENTS = 4
+FRAME_TRACE_END = 5
+
+PHASES = {0: "B", 1: "E", 2: "i"}
+
+
+def frames(data):
+    """Yields (type, payload) for every well-formed frame in data."""
+    i = 0
+    while True:
+        i = data.find(FRAME_SYNC, i)
+        if i < 0 or i + 4 > len(data):
+            return
+        frame_type, length = data[i + 2], data[i + 3]
+        end = i + 4 + length
+        if end >= len(data):
+            return
+        payload = data[i + 4:end]
+        if (frame_type + length + sum(payload)) & 0xFF == data[end]:
+            yield frame_type, payload
+            i = end + 1
+        else:
+            i += 1
+
+
+def convert(data):
+    names = {}
+    events = {0: [], 1: []}
+    dumps = 0
+    for frame_type, payload in frames(data):
+        if frame_type == FRAME_TRACE_NAMES:
+            i = 0
+            while i + 2 <= len(payload):
+                ident, length = payload[i], payload[i + 1]
+                names[ident] = payload[i + 2:i + 2 + length].decode("ascii", "replace")
+                i += 2 + length
+        elif frame_type == FRAME_TRACE_EVENTS:
+            core = payload[0]
+            for offset in range(1, len(payload) - 7, 8):
+                events.setdefault(core, []).append(
+                    struct.unpack_from("<IBBH", payload, offset))
+        elif frame_type == FRAME_TRACE_END:
+            dumps += 1
+
+    # Timestamps are the low 32 bits of the microsecond timer. Unwrap them per
+    # core, then shift both cores by the same origin so they stay aligned.
+    unwrapped = {}
+    for core, core_events in events.items():
+        high, last, out = 0, None, []
+        for time_us, phase, ident, arg in core_events:
+            if last is not None and time_us < last and last - time_us > 1 << 31:
+                high += 1 << 32
+            last = time_us
+            out.append((high + time_us, phase, ident, arg))
+        unwrapped[core] = out
+    starts = [e[0][0] for e in unwrapped.values() if e]
+    origin = min(starts) if starts else 0
+
+    trace = []
+    for core in sorted(unwrapped):
+        trace.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": core,
+                      "args": {"name": "core %d" % core}})
+        for time_us, phase, ident, arg in unwrapped[core]:
+            event = {
+                "name": names.get(ident, "id%d" % ident),
+                "ph": PHASES.get(phase, "i"),
+                "ts": time_us - origin,
+                "pid": 0,
+                "tid": core,
+            }
+            if phase == 2:
+                event["s"] = "t"
+                event["args"] = {"arg": arg}
+            trace.append(event)
+    return {"traceEvents": trace, "displayTimeUnit": "ms"}, dumps
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("dump", help="raw serial capture containing a trace dump")
+    parser.add_argument("-o", "--output", help="write JSON here instead of stdout")
+    args = parser.parse_args()
+
+    with open(args.dump, "rb") as f:
+        result, dumps = convert(f.read())
+    if dumps == 0:
+        print("%s: no complete trace dump found" % args.dump, file=sys.stderr)
+    out = open(args.output, "w") if args.output else sys.stdout
+    json.dump(result, out)
+    if args.output:
+        out.close()
+    return 0 if dumps else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())